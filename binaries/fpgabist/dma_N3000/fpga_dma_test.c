@@ -40,10 +40,13 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <sys/stat.h>
+#include <signal.h>
+#include <unistd.h>
 #ifndef USE_ASE
 #include <hwloc.h>
 #endif
 #include "fpga_dma.h"
+#include "fpga_dma_internal.h"
 /**
  * \fpga_dma_test.c
  * \brief User-mode DMA test
@@ -66,7 +69,6 @@ char cbuf[2048];
 
 #define DMA_BUF_SIZE_MAX    (1023 * 1024)
 #define DMA_BUF_SIZE_MIN    128
-extern uint64_t fpga_dma_buf_size;
 
 static char *verify_buf = NULL;
 static uint64_t verify_buf_size = 0;
@@ -94,6 +96,29 @@ bool memory_affinity = false;
 		}                                                              \
 	} while (0)
 
+// The engine's control register, for the SIGHUP handler.
+static volatile uint32_t *csr_control;
+
+static void sig_handler(int sig, siginfo_t *info, void *unused)
+{
+	(void)(info);
+	(void)(unused);
+
+	switch (sig) {
+	case SIGHUP: {
+		// Driver removed - shut down!
+		if (csr_control)
+			*csr_control = DMA_SHUTDOWN_CTL_VAL;
+		ON_ERR_GOTO(FPGA_NO_DRIVER, out, "Got SIGHUP. Exiting.");
+	out:
+		usleep(1000);
+		exit(-1);
+	} break;
+	default:
+		break;
+	}
+}
+
 /*
  *  *  * Global configuration of bus, set during parse_args()
  *   *   * */
@@ -632,6 +657,7 @@ int main(int argc, char *argv[])
 	uint32_t use_ase;
 	struct bus_info info;
 	fpga_properties props = NULL;
+	struct sigaction sa;
 
 	if (argc < 2) {
 		usage();
@@ -762,6 +788,16 @@ int main(int argc, char *argv[])
         ON_ERR_GOTO(res, out_dma_close, "Invaid DMA Handle");
     }
 
+	// Stop the engine and exit if the driver goes away.
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_flags = SA_SIGINFO | SA_RESETHAND;
+	sa.sa_sigaction = sig_handler;
+	csr_control = HOST_MMIO_32_ADDR(dma_h, CSR_CONTROL(dma_h));
+	if (sigaction(SIGHUP, &sa, NULL) < 0) {
+		res = FPGA_EXCEPTION;
+		ON_ERR_GOTO(res, out_dma_close, "sigaction SIGHUP");
+	}
+
 	if (use_ase)
 		count = ASE_TEST_BUF_SIZE;
 	else
@@ -873,6 +909,7 @@ out_dma_close:
 	if (dma_buf_ptr)
 		free_aligned(dma_buf_ptr);
 	if (dma_h) {
+		csr_control = NULL;
 		res = fpgaDmaClose(dma_h);
 		ON_ERR_GOTO(res, out_unmap, "fpgaDmaClose");
 	}
@@ -434,9 +434,9 @@ int main(int argc, char *argv[])
 	if (config.dry_run)
 		printf("--dry-run is set\n");
 
-	/* allocate memory and read bitstream data */
+	/* map bitstream data */
 	print_msg(1, "Reading bitstream");
-	result = opae_load_bitstream(config.filename, &info);
+	result = opae_map_bitstream(config.filename, &info);
 	if (result != FPGA_OK) {
 		retval = 2;
 		goto out_exit;
@@ -43,13 +43,17 @@
 #define FPGA_PORT_INDEX_STP               1
 #define FPGA_PORT_STP_DFH_REVBIT         12
 
-#define GETOPT_STRING ":hs:P:Iv"
+// Most ports served by one mmlink instance
+#define MMLINK_MAX_ENDPOINTS              8
+
+#define GETOPT_STRING ":hs:P:It:v"
 
 struct option longopts[] = {
 	{ "help",        no_argument,       NULL, 'h' },
 	{ "socket-id",   required_argument, NULL, 's' },
 	{ "port",        required_argument, NULL, 'P' },
 	{ "ip",          required_argument, NULL, 'I' },
+	{ "stats",       required_argument, NULL, 't' },
 	{ "version",     no_argument,       NULL, 'v' },
 	{ 0,             0,                 0,    0   }
 };
@@ -60,9 +64,10 @@ struct  MMLinkCommandLine
 	int      socket;
 	int      port;
 	char     ip[16];
+	unsigned stats;
 };
 
-struct MMLinkCommandLine mmlinkCmdLine = { -1, 0, { 0, } };
+struct MMLinkCommandLine mmlinkCmdLine = { -1, 0, { 0, }, 0 };
 
 // mmlink Command line input help
 void MMLinkAppShowHelp()
@@ -83,6 +88,8 @@ void MMLinkAppShowHelp()
 		"OR  -P <PORT>\n");
 	printf("<IP ADDRESS>          --ip=<IP ADDRESS>            "
 		"OR  -I <IP ADDRESS>\n");
+	printf("<Stats interval>      --stats=<SECONDS>            "
+		"OR  -t <SECONDS>\n");
 	printf("<Version>             -v,--version Print version and exit\n");
 	printf("\n");
 
@@ -118,8 +125,9 @@ void mmlink_sig_handler(int)
 int ParseCmds(struct MMLinkCommandLine *mmlinkCmdLine,
 		int argc,
 		char *argv[]);
-int run_mmlink(fpga_handle  port_handle,
-		uint64_t *mmio_ptr,
+int run_mmlink(fpga_handle *port_handles,
+		uint64_t **mmio_ptrs,
+		uint32_t num_ports,
 		struct MMLinkCommandLine *mmlinkCmdLine );
 
 int main( int argc, char** argv )
@@ -127,9 +135,12 @@ int main( int argc, char** argv )
 	fpga_properties filter             = NULL;
 	uint32_t num_matches               = 1;
 	fpga_result result                 = FPGA_OK;
-	fpga_token port_token              = NULL;
-	fpga_handle  port_handle           = NULL;
-	uint64_t *mmio_ptr                 = NULL;
+	fpga_token port_tokens[MMLINK_MAX_ENDPOINTS] = { NULL };
+	fpga_handle port_handles[MMLINK_MAX_ENDPOINTS] = { NULL };
+	uint64_t *mmio_ptrs[MMLINK_MAX_ENDPOINTS] = { NULL };
+	uint32_t num_tokens                = 0;
+	uint32_t num_ports                 = 0;
+	uint32_t i;
 	int res;
 
 	// Parse command line
@@ -168,6 +179,7 @@ int main( int argc, char** argv )
 	printf(" Socket-id        : %d\n", mmlinkCmdLine.socket);
 	printf(" Port             : %d\n", mmlinkCmdLine.port);
 	printf(" IP address       : %s\n", mmlinkCmdLine.ip);
+	printf(" Stats interval   : %u\n", mmlinkCmdLine.stats);
 	printf(" ------- Command line Input END   ----\n\n");
 
 	// Signal Handler
@@ -185,7 +197,7 @@ int main( int argc, char** argv )
 		ON_ERR_GOTO(result, out_destroy_prop, "setting socket");
 	}
 
-	result = fpgaEnumerate(&filter, 1, &port_token,1, &num_matches);
+	result = fpgaEnumerate(&filter, 1, port_tokens, MMLINK_MAX_ENDPOINTS, &num_matches);
 	ON_ERR_GOTO(result, out_destroy_prop, "enumerating FPGAs");
 
 	if (num_matches < 1) {
@@ -193,37 +205,61 @@ int main( int argc, char** argv )
 		result = fpgaDestroyProperties(&filter);
 		return FPGA_INVALID_PARAM;
 	}
-	fprintf(stderr, "PORT Resource found.\n");
+	num_tokens = num_matches < MMLINK_MAX_ENDPOINTS ?
+		num_matches : MMLINK_MAX_ENDPOINTS;
+	fprintf(stderr, "PORT Resource found (%u).\n", num_tokens);
+
+	// Each matching port with a remote STP is served as one debug endpoint.
+	for (i = 0 ; i < num_tokens ; ++i) {
+		result = fpgaOpen(port_tokens[i], &port_handles[num_ports], FPGA_OPEN_SHARED);
+		if (result != FPGA_OK) {
+			print_err("opening accelerator", result);
+			continue;
+		}
 
-	result = fpgaOpen(port_token, &port_handle, FPGA_OPEN_SHARED);
-	ON_ERR_GOTO(result, out_destroy_tok, "opening accelerator");
+		result = fpgaMapMMIO(port_handles[num_ports], FPGA_PORT_INDEX_STP,
+				     &mmio_ptrs[num_ports]);
+		if (result != FPGA_OK) {
+			print_err("mapping MMIO space", result);
+			fpgaClose(port_handles[num_ports]);
+			port_handles[num_ports] = NULL;
+			continue;
+		}
+		++num_ports;
+	}
 
-	result = fpgaMapMMIO(port_handle, FPGA_PORT_INDEX_STP, &mmio_ptr);
-	ON_ERR_GOTO(result, out_close, "mapping MMIO space");
+	if (!num_ports) {
+		result = FPGA_NOT_FOUND;
+		goto out_destroy_tok;
+	}
 
-	if( run_mmlink(port_handle,mmio_ptr,&mmlinkCmdLine) != 0) {
+	result = FPGA_OK;
+	if( run_mmlink(port_handles, mmio_ptrs, num_ports, &mmlinkCmdLine) != 0) {
 		PRINT_ERR( "Failed to connect MMLINK  \n.");
 		result = FPGA_NOT_SUPPORTED;
 	}
 
-	/* Unmap MMIO space */
-	result = fpgaUnmapMMIO(port_handle, FPGA_PORT_INDEX_STP);
-	ON_ERR_GOTO(result, out_close, "unmapping MMIO space");
+	for (i = 0 ; i < num_ports ; ++i) {
+		/* Unmap MMIO space */
+		if (fpgaUnmapMMIO(port_handles[i], FPGA_PORT_INDEX_STP) != FPGA_OK)
+			print_err("unmapping MMIO space", FPGA_EXCEPTION);
 
-	/* Close driver handle */
-out_close:
-	result = fpgaClose(port_handle);
-	ON_ERR_GOTO(result, out_destroy_tok, "closing Port");
+		/* Close driver handle */
+		if (fpgaClose(port_handles[i]) != FPGA_OK)
+			print_err("closing Port", FPGA_EXCEPTION);
+	}
 
-	/* Destroy token */
+	/* Destroy tokens */
 out_destroy_tok:
-	result = fpgaDestroyToken(&port_token);
-	ON_ERR_GOTO(result, out_destroy_prop, "destroying token");
+	for (i = 0 ; i < num_tokens ; ++i) {
+		if (fpgaDestroyToken(&port_tokens[i]) != FPGA_OK)
+			print_err("destroying token", FPGA_EXCEPTION);
+	}
 
 	/* Destroy properties object */
 out_destroy_prop:
-	result = fpgaDestroyProperties(&filter);
-	ON_ERR_GOTO(result, out_exit, "destroying properties object");
+	if (fpgaDestroyProperties(&filter) != FPGA_OK)
+		print_err("destroying properties object", FPGA_EXCEPTION);
 
 out_exit:
 	return result;
@@ -235,15 +271,34 @@ enum mmlink_revision {
   MMLINK_STREAMING = 2
 };
 
+// Read the remote STP revision from the STP DFH of a port.
+static int mmlink_revision(fpga_handle port_handle, uint64_t *revision)
+{
+	uint64_t value = 0;
+
+	if (fpgaReadMMIO64(port_handle, FPGA_PORT_INDEX_STP, 0, &value) != FPGA_OK) {
+		PRINT_ERR("Failed to read STP DFH \n");
+		return -1;
+	}
+
+	value &= 0xF000;
+	*revision = value >> FPGA_PORT_STP_DFH_REVBIT;
+	return 0;
+}
+
 // run MMLink server
-int run_mmlink(fpga_handle  port_handle,
-		uint64_t *mmio_ptr,
+int run_mmlink(fpga_handle *port_handles,
+		uint64_t **mmio_ptrs,
+		uint32_t num_ports,
 		struct MMLinkCommandLine *mmlinkCmdLine )
 {
 	int res                        = 0;
 	uint64_t value                 = 0;
+	uint64_t rev                   = 0;
+	volatile uint64_t *endpoints[MMLINK_MAX_ENDPOINTS];
+	size_t num_endpoints           = 0;
 
-	if (mmio_ptr == NULL) {
+	if (!num_ports || mmio_ptrs[0] == NULL) {
 		PRINT_ERR("Invalid input mmio pointer \n");
 		return -1;
 	}
@@ -253,17 +308,18 @@ int run_mmlink(fpga_handle  port_handle,
 		return -1;
 	}
 
-
-	res = fpgaReadMMIO64(port_handle, FPGA_PORT_INDEX_STP, 0, &value);
-	if (res != 0) {
-		PRINT_ERR("Failed to read STP DFH \n");
+	// The first port selects the server; further ports are served
+	// alongside it when they carry the same STP revision.
+	if (mmlink_revision(port_handles[0], &value))
 		return -1;
-	}
-	//printf("STP DFH = 0x%lx\n" ,value);
-
-	value &= 0xF000;
-	value = value >> FPGA_PORT_STP_DFH_REVBIT;
 
+	for (uint32_t i = 0 ; i < num_ports ; ++i) {
+		if (i && (mmlink_revision(port_handles[i], &rev) || rev != value)) {
+			printf("skipping port %u: STP revision %lu\n", i, rev);
+			continue;
+		}
+		endpoints[num_endpoints++] = mmio_ptrs[i];
+	}
 
   switch (value) {
     case MMLINK_LEGACY:
@@ -277,7 +333,9 @@ int run_mmlink(fpga_handle  port_handle,
       return -1;
   }
   if (srv) {
-    res = srv->run(mmio_ptr, mmlinkCmdLine->ip, mmlinkCmdLine->port);
+    srv->stats_interval(mmlinkCmdLine->stats);
+    res = srv->run_endpoints(endpoints, num_endpoints,
+                             mmlinkCmdLine->ip, mmlinkCmdLine->port);
     delete srv;
     srv = 0;
   } else {
@@ -345,6 +403,16 @@ int ParseCmds(struct MMLinkCommandLine *mmlinkCmdLine, int argc, char *argv[])
 			mmlinkCmdLine->ip[15] = '\0';
 			break;
 
+		case 't':
+			// Throughput report interval
+			if (!tmp_optarg) {
+				PRINT_ERR("Missing required argument for --stats");
+				return -1;
+			}
+			endptr = NULL;
+			mmlinkCmdLine->stats = strtoul(tmp_optarg, &endptr, 0);
+			break;
+
 		case 'v':
 			// Version
 			printf("mmlink %s %s%s\n",
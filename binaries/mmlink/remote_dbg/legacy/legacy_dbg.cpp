@@ -32,6 +32,12 @@
 #include "mm_debug_link_interface.h"
 
 int legacy_dbg::run(volatile uint64_t *mmio_ptr, const char *address, int port)
+{
+  return run_endpoints(&mmio_ptr, 1, address, port);
+}
+
+int legacy_dbg::run_endpoints(volatile uint64_t **mmio, size_t count,
+                              const char *address, int port)
 {
   mmlink_server *server = NULL;
   struct sockaddr_in sock;
@@ -45,16 +51,27 @@ int legacy_dbg::run(volatile uint64_t *mmio_ptr, const char *address, int port)
     return -1;
   }
 
-
-  mm_debug_link_interface *driver = get_mm_debug_link();
-  server = new (std::nothrow) mmlink_server(&sock, driver);
+  server = new (std::nothrow) mmlink_server(&sock);
   if (!server) {
     PRINT_ERR("Failed to allocate memory \n");
     return -1;
   }
 
+  for (size_t i = 0; i < count; ++i)
+    server->add_endpoint((unsigned char*)mmio[i], get_mm_debug_link());
+
+  server->set_stats_interval(stats_interval_);
+
   // Run MMLink server
-  res = server->run((unsigned char*)mmio_ptr);
+  server_ = server;
+  res = server->run();
+  server_ = nullptr;
   delete server;
   return res;
 }
+
+void legacy_dbg::terminate()
+{
+  if (server_)
+    server_->stop();
+}
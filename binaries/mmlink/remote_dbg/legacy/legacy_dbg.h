@@ -26,10 +26,18 @@
 #pragma once
 #include "remote_dbg.h"
 
+class mmlink_server;
+
 class legacy_dbg : public remote_dbg
 {
 public:
-  legacy_dbg(){}
+  legacy_dbg() : server_(nullptr) {}
   virtual ~legacy_dbg(){}
   int run(volatile uint64_t *mmio, const char *address, int port) override;
+  int run_endpoints(volatile uint64_t **mmio, size_t count,
+                    const char *address, int port) override;
+  void terminate() override;
+
+private:
+  mmlink_server *server_;
 };
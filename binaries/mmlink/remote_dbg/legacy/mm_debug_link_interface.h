@@ -32,12 +32,15 @@
 #ifndef MM_DEBUG_LINK_INTERFACE_H
 #define MM_DEBUG_LINK_INTERFACE_H
 
+#include <cstdint>
+#include <ctime>
 #include <unistd.h>
 
 
 class mm_debug_link_interface
 {
 public:
+	virtual ~mm_debug_link_interface() {}
 	virtual int open(unsigned char* stpAddr) = 0;
 	virtual ssize_t read() = 0;
 	virtual ssize_t write(const void *buf, size_t count) = 0;
@@ -48,11 +51,16 @@ public:
 	virtual void enable(int channel, bool state) = 0;
 	virtual int get_fd(void) = 0;
 	virtual bool can_read_data() = 0;
-	virtual size_t buf_end(void) = 0;
-	virtual void buf_end(int index) = 0;
-	virtual char *buf(void) = 0;
+	// Microseconds until can_read_data() becomes true.
+	virtual uint64_t read_delay_us(void) = 0;
 	virtual bool is_empty(void) = 0;
+	virtual bool is_full(void) = 0;
 	virtual bool flush_request(void) = 0;
+	// Send pending t2h data to the socket fd; returns bytes sent or -1 (errno).
+	// read() and send_t2h() may run on different threads.
+	virtual ssize_t send_t2h(int fd) = 0;
+	// Drop pending t2h data. Neither read() nor send_t2h() may run meanwhile.
+	virtual void clear_t2h(void) = 0;
 };
 
 // Concrete classes must implement this routine.
@@ -60,5 +68,12 @@ mm_debug_link_interface *get_mm_debug_link(void);
 
 #define UNUSED_PARAM(x) (void)x
 
+static inline uint64_t mmlink_monotonic_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 #endif
 
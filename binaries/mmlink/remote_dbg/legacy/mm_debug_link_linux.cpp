@@ -42,6 +42,8 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/param.h>
 
 #include <unistd.h>
 #include <sys/mman.h>
@@ -73,6 +75,14 @@
 #define LEN_8B                          0x2
 #define LEN_4B                          0x1
 #define LEN_1B                          0x0
+#define LEN_INVALID                     0x3
+
+// Read FIFO polling interval bounds (microseconds).
+#define RFIFO_POLL_MIN_US               50
+#define RFIFO_POLL_MAX_US               10000
+
+// Upper bound on bytes drained from the read FIFO by one call to read().
+#define RFIFO_MAX_DRAIN                 (64 * 1024)
 
 //#define DEBUG_8B_4B_TRANSFERS 1 // Uncomment for 4B/8B DBG
 //#define DEBUG_FLAG 1 //Uncomment to enable read/write information
@@ -96,13 +106,15 @@ mm_debug_link_interface *get_mm_debug_link(void)
 }
 
 
-mm_debug_link_linux::mm_debug_link_linux() {
+mm_debug_link_linux::mm_debug_link_linux() : m_t2h(BUFFERSIZE_T2H) {
 	m_fd = -1;
-	m_buf_end = 0;
 	m_write_fifo_capacity = 0;
+	m_read_fifo_capacity = 0;
+	m_rd_len = LEN_INVALID;
+	m_wr_len = LEN_INVALID;
 	m_write_before_any_read_rfifo_level = false;
-	m_last_read_rfifo_level_empty_time = 0;
-	m_read_rfifo_level_empty_interval = 1;
+	m_last_read_rfifo_level_time = 0;
+	m_read_rfifo_level_interval = 0;
 	map_base = NULL;
 }
 
@@ -136,6 +148,13 @@ int mm_debug_link_linux::open(unsigned char* stpAddr)
 	this->m_write_fifo_capacity = read_mmr<int>(MM_DEBUG_LINK_WRITE_CAPACITY);
 	cout << "Read write fifo capacity value " << std::dec << this->m_write_fifo_capacity << " to hw\n";
 
+	this->m_read_fifo_capacity = read_mmr<int>(MM_DEBUG_LINK_READ_CAPACITY);
+	cout << "Read read fifo capacity value " << std::dec << this->m_read_fifo_capacity << " to hw\n";
+
+	// The length registers are write-only; force the first access to program them.
+	m_rd_len = LEN_INVALID;
+	m_wr_len = LEN_INVALID;
+
 	return 0;
 }
 
@@ -172,57 +191,69 @@ void mm_debug_link_linux::write_mmr(off_t target,
 
 bool mm_debug_link_linux::can_read_data()
 {
-	bool ret  = this->m_write_before_any_read_rfifo_level;
+	return read_delay_us() == 0;
+}
+
+uint64_t mm_debug_link_linux::read_delay_us()
+{
+	uint64_t elapsed;
 
-	if ( !ret )
+	if ( this->m_write_before_any_read_rfifo_level )
+		return 0;
+
+	elapsed = mmlink_monotonic_us() - this->m_last_read_rfifo_level_time;
+	return elapsed >= this->m_read_rfifo_level_interval ?
+		0 : this->m_read_rfifo_level_interval - elapsed;
+}
+
+void mm_debug_link_linux::set_rd_len(uint32_t len)
+{
+	// SW retains the last value written to REMSTP_MMIO_RD_LEN, so the
+	// register only needs to be written when the access width changes.
+	if ( len != m_rd_len )
 	{
-		clock_t cur_time = ::clock();
-		clock_t duration = cur_time - this->m_last_read_rfifo_level_empty_time;
-		if ( duration < 0 )
-		{
-			duration = -duration;
-		}
-		if ( duration >= this->m_read_rfifo_level_empty_interval )
-		{
-			ret = true;
-		}
+		write_mmr( REMSTP_MMIO_RD_LEN, 'w', len );
+		m_rd_len = len;
 	}
-
-	return ret;
 }
 
-ssize_t mm_debug_link_linux::read()
+void mm_debug_link_linux::set_wr_len(uint32_t len)
 {
-	uint8_t num_bytes;
+	if ( len != m_wr_len )
+	{
+		write_mmr( REMSTP_MMIO_WR_LEN, 'w', len );
+		m_wr_len = len;
+	}
+}
 
-	num_bytes = read_mmr<uint8_t>(MM_DEBUG_LINK_FIFO_READ_COUNT);
+// Adapt the read FIFO polling interval to the last observed fill level.
+// A FIFO that was at least half full is polled again immediately, a
+// partially filled one at the minimum interval, and an empty one with an
+// exponential backoff up to RFIFO_POLL_MAX_US.
+void mm_debug_link_linux::update_poll_interval(size_t level)
+{
+	size_t half = m_read_fifo_capacity > 0 ? (size_t)m_read_fifo_capacity / 2 : 128;
 
-	// Reset the timer record
-	if ( (this->m_write_before_any_read_rfifo_level ||  // when this is the first read after write
-	      num_bytes > 0) )                               // when something is available to read
+	if ( level >= half )
 	{
-		this->m_write_before_any_read_rfifo_level = false;
-		this->m_read_rfifo_level_empty_interval = 1;     // Increase the read fifo level polling freq. in anticipation of more read data availability.
+		m_read_rfifo_level_interval = 0;
 	}
-
-	if (num_bytes > 0 )
+	else if ( level > 0 )
 	{
-		if ( num_bytes > (mm_debug_link_linux::BUFSIZE - m_buf_end) )
-		{
-			num_bytes = mm_debug_link_linux::BUFSIZE - m_buf_end;
-		}
+		m_read_rfifo_level_interval = RFIFO_POLL_MIN_US;
+	}
+	else
+	{
+		m_read_rfifo_level_interval = m_read_rfifo_level_interval ?
+			MIN(m_read_rfifo_level_interval * 2, (uint64_t)RFIFO_POLL_MAX_US) :
+			RFIFO_POLL_MIN_US;
+	}
 
-#ifdef DEBUG_FLAG
-		cout << "Read " << num_bytes << " bytes\n";
-#endif
+	m_last_read_rfifo_level_time = mmlink_monotonic_us();
+}
 
 /*
   ==========================================================================================================================
-  At this point, num_bytes has the No. of bytes available to read from the FPGA
-  Default implementation: Tries to pull 1B at a time.
-
-  The Objective is to increase link utilization (1/8) to (8/8):
-  -------------------------------------------------------------
   The interface on HW to SLD HUB Controller system still supports 1B reads/ writes only
   The solution is to avoid 1B ping-pong and communicate to remote STP soft logic on HW with No. of bytes to read (say N)
   The HW should read so many bytes (N) from the SLD HUB Cont Sys and return a packed read response. (little endian 64b max payload)
@@ -252,125 +283,96 @@ ssize_t mm_debug_link_linux::read()
   | 2'b11     | Rsvd      |
   -------------------------
 
-  Performance impact:
-  -------------------
-  1)
-  OLD - Time to read 8bytes              = 8 * 1 MMIO Read latency from device
-  NEW - Time to read 8bytes (best case)  = 1 MMIO Read latency from device
-  NEW - Time to read 8bytes (worst case) = 1 MMIO Write latency to device + 1 MMIO Read latency from device
-
-  2) Through efficient utilization of MMIO data width, the amount of degradation seen on available AFU BW when using remoteSTP could be lowered
+  MM_DEBUG_LINK_DATA_READ is a single 64b register, so 8B is the widest read
+  the HW can answer. The 8B words of a burst are read back to back into a
+  block on the stack and copied into the t2h ring in one step; the length
+  register is only rewritten when the access width actually changes.
 
   NOTE:
   -----
   MMIO reads to REMSTP_MMIO_RD_LEN or REMSTP_MMIO_WR_LEN is NOT supported
 */
-
-		uint8_t  num_8B_reads, num_4B_reads, num_1B_reads, remaining_bytes;
-		num_8B_reads    = num_bytes/8;
-		remaining_bytes = num_bytes%8;
-		num_4B_reads    = remaining_bytes/4;
-		remaining_bytes = remaining_bytes%4;
-		num_1B_reads    = remaining_bytes;
+void mm_debug_link_linux::drain_rfifo(size_t num_bytes)
+{
+	// The FIFO level register is 8 bits wide, so one burst fits here.
+	uint64_t block[256 / 8];
+	size_t num_8B_reads = num_bytes / 8;
+	size_t remaining_bytes = num_bytes % 8;
 
 #ifdef DEBUG_8B_4B_TRANSFERS
-		cout << dec;
-		cout << "DBG_READ : Total_Bytes = " << (unsigned) num_bytes << " ; 8_bytes = "
-		     << (unsigned) num_8B_reads << " ; 4_bytes = " << (unsigned) num_4B_reads << " ; 1_bytes = " << (unsigned) num_1B_reads << endl << flush;
+	cout << dec << "DBG_READ : Total_Bytes = " << num_bytes << " ; 8_bytes = "
+	     << num_8B_reads << " ; 4_bytes = " << remaining_bytes / 4
+	     << " ; 1_bytes = " << remaining_bytes % 4 << endl << flush;
 #endif
 
-		// SW should update HW control (REMSTP_MMIO_RD_LEN) and use only REMSTP_MMIO_RD_LEN bytes returned
-		if (num_8B_reads > 0)
-		{
-			// Change REMSTP_MMIO_RD_LEN to 8B
-			write_mmr( REMSTP_MMIO_RD_LEN, 'w', LEN_8B);
-			for ( unsigned char  i = 0; i < num_8B_reads; ++i )
-			{
-				volatile uint64_t *p = reinterpret_cast<volatile uint64_t *>(this->m_buf +
-                                                                                             this->m_buf_end +
-                                                                                             (i*8));
-				*p = read_mmr<uint64_t>(MM_DEBUG_LINK_DATA_READ);
-#ifdef DEBUG_8B_4B_TRANSFERS
-				cout << "DBG_READ_8B : Iteration "<< (unsigned) i << "; READ VALUE : " << hex;
-				for (unsigned char j=0; j<8; j++)
-					cout << (int) *( this->m_buf + this->m_buf_end + (i*8) + j ) << flush;
-				cout << dec << endl << flush;
-#endif
-			}
-		}
+	if ( num_8B_reads > 0 )
+	{
+		set_rd_len( LEN_8B );
+		for ( size_t i = 0; i < num_8B_reads; ++i )
+			block[i] = read_mmr<uint64_t>(MM_DEBUG_LINK_DATA_READ);
+		m_t2h.write( block, num_8B_reads * 8 );
+	}
 
-		if (num_4B_reads > 0)
-		{
-			// Change REMSTP_MMIO_RD_LEN to 4B
-			write_mmr( REMSTP_MMIO_RD_LEN, 'w', LEN_4B);
-			for ( unsigned char  i = 0; i < num_4B_reads; ++i )
-			{
-				volatile uint32_t *p = reinterpret_cast<volatile uint32_t *>(this->m_buf +
-                                                                                             this->m_buf_end +
-                                                                                             (num_8B_reads*8) +
-                                                                                             (i*4));
-				*p = read_mmr<uint32_t>(MM_DEBUG_LINK_DATA_READ);
-#ifdef DEBUG_8B_4B_TRANSFERS
-				cout << "DBG_READ_4B : Iteration "<< (int) i << "; READ VALUE : " << hex;
-				for (unsigned char j=0; j<4; j++)
-					cout << (int) *( this->m_buf + this->m_buf_end + ( (num_8B_reads*8) + (i*4) + j)) << flush;
-				cout << dec << endl << flush;
-#endif
-			}
-		}
+	if ( remaining_bytes >= 4 )
+	{
+		uint32_t data;
 
-		if (num_1B_reads > 0)
-		{
-			// Change REMSTP_MMIO_RD_LEN to 1B
-			write_mmr( REMSTP_MMIO_RD_LEN, 'w', LEN_1B);
-			for ( unsigned char i = 0; i < num_1B_reads; ++i )
-			{
-				volatile uint8_t *p = reinterpret_cast<volatile uint8_t *>(this->m_buf + this->m_buf_end +
-                                                                                           (num_8B_reads*8) +
-                                                                                           (num_4B_reads*4) +
-                                                                                           i);
-				*p = read_mmr<uint8_t>(MM_DEBUG_LINK_DATA_READ);
-#ifdef DEBUG_8B_4B_TRANSFERS
-				cout << "DBG_READ_1B : Iteration "<< (int) i << "; READ VALUE : "
-				     << hex << (int) *( this->m_buf + this->m_buf_end + ( (num_8B_reads*8) + (num_4B_reads*4) +i)) << endl << flush << dec;
-#endif
-			}
-		}
-		// ==========================================================================================================================
+		set_rd_len( LEN_4B );
+		data = read_mmr<uint32_t>(MM_DEBUG_LINK_DATA_READ);
+		m_t2h.write( &data, 4 );
+		remaining_bytes -= 4;
+	}
 
-		unsigned int x;
-		for ( unsigned char i = 0; i < num_bytes; ++i )
+	if ( remaining_bytes > 0 )
+	{
+		set_rd_len( LEN_1B );
+		for ( size_t i = 0; i < remaining_bytes; ++i )
 		{
-			x = this->m_buf[this->m_buf_end + i];
-
-#ifdef DEBUG_FLAG
-			cout << setfill('0') << setw(2) << std::hex << x << " ";
-#else
-			UNUSED_PARAM(x);
-#endif
+			uint8_t data = read_mmr<uint8_t>(MM_DEBUG_LINK_DATA_READ);
+			m_t2h.write( &data, 1 );
 		}
-#ifdef DEBUG_FLAG
-		cout << std::dec << "\n";
-#endif
-
-		this->m_buf_end += num_bytes;
 	}
-	else
+}
+
+ssize_t mm_debug_link_linux::read()
+{
+	size_t total = 0;
+	size_t level = 0;
+
+	// Keep draining while the FIFO is busy, so a capture upload is not
+	// paced by the server loop. Stop once the FIFO runs low, the ring
+	// fills up, or RFIFO_MAX_DRAIN bytes were moved.
+	while ( total < RFIFO_MAX_DRAIN )
 	{
-		//printf( "%s %s(): error read hw read buffer level\n", __FILE__, __FUNCTION__ );
-		num_bytes = 0;
+		size_t space = m_t2h.writable();
+		size_t num_bytes;
 
-		this->m_last_read_rfifo_level_empty_time = ::clock();
+		level = read_mmr<uint8_t>(MM_DEBUG_LINK_FIFO_READ_COUNT);
+		if ( !level || !space )
+			break;
 
-		//Throttle the read rfifo level polling freq.  up to 10 sec.
-		this->m_read_rfifo_level_empty_interval *= 2;
-		if ( this->m_read_rfifo_level_empty_interval >= 10 * CLOCKS_PER_SEC )
-		{
-			this->m_read_rfifo_level_empty_interval = 10 * CLOCKS_PER_SEC;
-		}
+		num_bytes = MIN(level, space);
+		drain_rfifo(num_bytes);
+		total += num_bytes;
+
+		if ( num_bytes < level || level < 8 )
+			break;
 	}
 
-	return num_bytes;
+	if ( total > 0 )
+		this->m_write_before_any_read_rfifo_level = false;
+
+#ifdef DEBUG_FLAG
+	if ( total > 0 )
+		cout << "Read " << total << " bytes\n";
+#endif
+
+	// A write may still be waiting for its response; keep polling eagerly.
+	update_poll_interval( this->m_write_before_any_read_rfifo_level ?
+			      (size_t)m_read_fifo_capacity : level );
+	this->m_write_before_any_read_rfifo_level = false;
+
+	return total;
 }
 
 ssize_t mm_debug_link_linux::write(const void *buf, size_t count)
@@ -410,7 +412,7 @@ ssize_t mm_debug_link_linux::write(const void *buf, size_t count)
 		if (num_8B_writes > 0)
 		{
 			// Change REMSTP_MMIO_WR_LEN to 8B
-			write_mmr( REMSTP_MMIO_WR_LEN, 'w', LEN_8B);
+			set_wr_len( LEN_8B );
 			for ( size_t i = 0; i < num_8B_writes; ++i )
 			{
 #ifdef DEBUG_8B_4B_TRANSFERS
@@ -424,7 +426,7 @@ ssize_t mm_debug_link_linux::write(const void *buf, size_t count)
 		if (num_4B_writes > 0)
 		{
 			// Change REMSTP_MMIO_WR_LEN to 4B
-			write_mmr( REMSTP_MMIO_WR_LEN, 'w', LEN_4B);
+			set_wr_len( LEN_4B );
 			for ( size_t i = 0; i < num_4B_writes; ++i )
 			{
 #ifdef DEBUG_8B_4B_TRANSFERS
@@ -438,7 +440,7 @@ ssize_t mm_debug_link_linux::write(const void *buf, size_t count)
 		if (num_1B_writes > 0)
 		{
 			// Change REMSTP_MMIO_WR_LEN to 1B
-			write_mmr( REMSTP_MMIO_WR_LEN, 'w', LEN_1B);
+			set_wr_len( LEN_1B );
 			for ( size_t i = 0; i < num_1B_writes; ++i )
 			{
 #ifdef DEBUG_8B_4B_TRANSFERS
@@ -520,23 +522,24 @@ void mm_debug_link_linux::enable(int channel, bool state)
 
 bool mm_debug_link_linux::flush_request(void)
 {
-	bool should_flush = false;
-	if (m_buf_end == BUFSIZE)
-		// Full buffer? Send.
-		should_flush = true;
-	else if (memchr(m_buf, B2P_EOP, m_buf_end - 1))
-		// Buffer contains eop? Send.
-		// If the eop character occurs in the very last buffer byte, there's no packet here -
-		// we need at least one more byte.
-		// Interesting corner case: it's not strictly true that one more byte after EOP indicates
-		// the end of a packet - that byte after EOP might be the escape character. In this case,
-		// we flush even though it's not necessarily a complete packet. This probably has negligible
-		// impact on performance.
-		should_flush = true;
-
-	if ( m_buf_end > 0 )
-	{
-		should_flush = true;
-	}
-	return should_flush;
+	// Any pending data is sent as soon as the host socket can take it;
+	// the ring does not wait for a complete packet (EOP).
+	return !is_empty();
+}
+
+ssize_t mm_debug_link_linux::send_t2h(int fd)
+{
+	struct iovec iov[2];
+	int iovcnt = m_t2h.read_segments(iov);
+	ssize_t sent;
+
+	if ( !iovcnt )
+		return 0;
+
+	// Hand both halves of a wrapped ring to the socket in one call.
+	sent = ::writev(fd, iov, iovcnt);
+	if ( sent > 0 )
+		m_t2h.consume(sent);
+
+	return sent;
 }
@@ -37,25 +37,33 @@
 #include <cstdint>
 
 #include <unistd.h>
-#include "time.h"
 
 #include "mm_debug_link_interface.h"
+#include "mmlink_ring.h"
 
-// size of buffer for t2h data
-#define BUFFERSIZE_T2H 1073741824
+// size of the t2h ring buffer (must be a power of 2)
+#define BUFFERSIZE_T2H (4 * 1024 * 1024)
 
 class mm_debug_link_linux: public mm_debug_link_interface
 {
 private:
 	int m_fd;
-	static const size_t BUFSIZE = BUFFERSIZE_T2H;
-	char m_buf[BUFSIZE];
-	volatile size_t m_buf_end;
+	// Filled by read() on the driver service thread, drained by send_t2h().
+	mmlink_ring m_t2h;
 	int m_write_fifo_capacity;
+	int m_read_fifo_capacity;
 	volatile unsigned char* map_base;
+	// Last values written to REMSTP_MMIO_RD_LEN / REMSTP_MMIO_WR_LEN.
+	uint32_t m_rd_len;
+	uint32_t m_wr_len;
 	bool m_write_before_any_read_rfifo_level;
-	clock_t m_last_read_rfifo_level_empty_time;
-	clock_t m_read_rfifo_level_empty_interval;
+	uint64_t m_last_read_rfifo_level_time;
+	uint64_t m_read_rfifo_level_interval;
+
+	void set_rd_len(uint32_t len);
+	void set_wr_len(uint32_t len);
+	void drain_rfifo(size_t num_bytes);
+	void update_poll_interval(size_t level);
 
 public:
 	mm_debug_link_linux();
@@ -77,11 +85,12 @@ public:
 	void enable(int channel, bool state);
 	int get_fd(void) { return m_fd; }
 	bool can_read_data(void);
-	char *buf(void) { return m_buf; }
-	bool is_empty(void) { return m_buf_end == 0; }
+	uint64_t read_delay_us(void);
+	bool is_empty(void) { return m_t2h.empty(); }
+	bool is_full(void) { return m_t2h.writable() == 0; }
 	bool flush_request(void);
-	size_t buf_end(void) { return m_buf_end; }
-	void buf_end(int index) { m_buf_end = index; }
+	ssize_t send_t2h(int fd);
+	void clear_t2h(void) { m_t2h.clear(); }
 };
 
 #endif
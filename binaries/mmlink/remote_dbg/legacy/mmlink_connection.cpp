@@ -101,12 +101,45 @@ int mmlink_connection::handle_receive()
 	return fail;
 }
 
-size_t mmlink_connection::send(const char *msg, const size_t msg_len)
+ssize_t mmlink_connection::send(const char *msg, const size_t msg_len)
 {
-	size_t len;
+	ssize_t len = 0;
 
-	len = ::send(m_fd, msg, msg_len, 0);
-	return len;
+	// Keep the replies in order behind anything already queued.
+	if (m_out.empty())
+	{
+		len = ::send(m_fd, msg, msg_len, MSG_NOSIGNAL);
+		if (len < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return -1;
+			len = 0;
+		}
+	}
+
+	m_out.append(msg + len, msg_len - len);
+	return msg_len;
+}
+
+ssize_t mmlink_connection::flush_output(void)
+{
+	size_t done = 0;
+
+	while (done < m_out.size())
+	{
+		ssize_t len = ::send(m_fd, m_out.data() + done, m_out.size() - done,
+				     MSG_NOSIGNAL);
+		if (len < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return -1;
+			break;
+		}
+		done += len;
+	}
+
+	m_out.erase(0, done);
+	return done;
 }
 
 int mmlink_connection::handle_management()
@@ -188,24 +221,22 @@ int mmlink_connection::handle_unbound_command(char *cmd)
 	// Only HANDLE=xxxxxxxx is allowed
 	// If wrong handle value, close
 	// if any other input, close
-	char expect_handle[] = "HANDLE 01234567";
-
-	snprintf(expect_handle+7, 9,
-			"%08X", get_server_id());
+	mmlink_endpoint *endpoint = m_server->find_endpoint(this, cmd);
 
-	if (0 == strcmp(expect_handle, cmd))
+	if (endpoint)
 	{
 		cout << getsocket() << ": accepted handle value (' "<< cmd << "'),"
-				" setting to bound state\n";
+				" setting to bound state on endpoint "
+				<< endpoint->index() << "\n";
 
-		bind();
-		send(OK, strnlen(OK, MMLINK_OK_SIZE));
+		bind(endpoint);
+		if (send(OK, strnlen(OK, MMLINK_OK_SIZE)) < 0)
+			fail = -1;
 	}
 	else
 	{
 		cout << getsocket() << ": closing socket: incorrect HANDLE value "
-				"(expected: '"
-				<< expect_handle << "'; got: '"<< cmd << "')\n";
+				"(got: '"<< cmd << "')\n";
 		fail = -1;
 	}
 
@@ -230,6 +261,9 @@ int mmlink_connection::handle_bound_command(char *cmd)
 	unsigned u = 0;
 	int arg1, arg2;
 	bool unknown = true;
+	ssize_t res = 0;
+
+	std::lock_guard<std::mutex> lock(m_endpoint->mmio_lock());
 
 	if (1 == sscanf(cmd, "IDENT %X", &u))
 	{
@@ -245,7 +279,7 @@ int mmlink_connection::handle_bound_command(char *cmd)
 			snprintf(msg, msg_len, "%08X%08X%08X%08X\n",
 				 ident[3], ident[2], ident[1], ident[0]);
 
-			send(msg, strnlen(msg, msg_len + 1));
+			res = send(msg, strnlen(msg, msg_len + 1));
 			unknown = false;
 		}
 	}
@@ -254,7 +288,7 @@ int mmlink_connection::handle_bound_command(char *cmd)
 		if (arg1 == 0 || arg1 == 1)
 		{
 			driver()->reset(arg1);
-			send(OK, strnlen(OK, MMLINK_OK_SIZE));
+			res = send(OK, strnlen(OK, MMLINK_OK_SIZE));
 			unknown = false;
 		}
 	}
@@ -263,18 +297,25 @@ int mmlink_connection::handle_bound_command(char *cmd)
 		if (arg1 >= 0 && (arg2 == 0 || arg2 == 1))
 		{
 			driver()->enable(arg1, arg2);
-			send(OK, strnlen(OK, MMLINK_OK_SIZE));
+			res = send(OK, strnlen(OK, MMLINK_OK_SIZE));
 			unknown = false;
 		}
 	}
 	else if (0 == strncmp(cmd, "NOOP", 4))
 	{
-		send(OK, strnlen(OK, MMLINK_OK_SIZE));
+		res = send(OK, strnlen(OK, MMLINK_OK_SIZE));
+		unknown = false;
+	}
+	else if (0 == strncmp(cmd, "STATS", 5))
+	{
+		// Latency and throughput counters of this endpoint, one line.
+		char msg[256];
+		res = send(msg, m_endpoint->format_stats(msg, sizeof(msg)));
 		unknown = false;
 	}
 
 	if (unknown)
-		send(UNKNOWN, strnlen(UNKNOWN, MMLINK_UNKNOWN_SIZE));
+		res = send(UNKNOWN, strnlen(UNKNOWN, MMLINK_UNKNOWN_SIZE));
 
-	return 0;
+	return res < 0 ? -1 : 0;
 }
@@ -33,10 +33,13 @@
 #ifndef MMLINK_CONNECTION_H
 #define MMLINK_CONNECTION_H
 
+#include <string>
+
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include "mm_debug_link_interface.h"
+#include "mmlink_endpoint.h"
 #include "mmlink_server.h"
 
 class mmlink_connection
@@ -47,12 +50,18 @@ public:
 	~mmlink_connection() { close_connection(); delete[] m_buf; }
 	bool is_open() { return m_fd >= 0; }
 	bool is_data() { return m_is_data; }
-	bool is_bound() { return m_is_bound; }
+	bool is_bound() { return m_endpoint != NULL; }
 	void set_is_data(void) { m_is_data = true; }
 
-	size_t send(const char *msg, const size_t len);
+	// Send msg, queueing whatever the socket can't take yet.
+	// Returns -1 (errno) on a socket error.
+	ssize_t send(const char *msg, const size_t len);
+	// Send queued output; returns -1 (errno) on a socket error.
+	ssize_t flush_output(void);
+	bool output_pending(void) { return !m_out.empty(); }
 	void close_connection() { if (is_open()) ::close(m_fd); init(); }
-	void bind() { m_is_bound = true; }
+	void bind(mmlink_endpoint *endpoint) { m_endpoint = endpoint; }
+	mmlink_endpoint *endpoint() { return m_endpoint; }
 	void socket(int socket) { m_fd = socket; }
 	int getsocket() { return m_fd; }
 	int handle_receive();
@@ -67,13 +76,15 @@ public:
 
 protected:
 	int m_fd;
-	bool m_is_bound;
+	mmlink_endpoint *m_endpoint;
 	bool m_is_data;
 	const int m_bufsize;
 	mmlink_server *m_server;
 
 	char *m_buf;
 	volatile size_t m_buf_end;
+	// Output the non-blocking socket didn't take yet.
+	std::string m_out;
 
 	void init(mmlink_server *server) { m_server = server; init(); }
 
@@ -81,9 +92,10 @@ protected:
 		{
 			m_fd             = mm_conn.m_fd;
 			m_buf_end        = mm_conn.m_buf_end;
-			m_is_bound       = mm_conn.m_is_bound;
+			m_endpoint       = mm_conn.m_endpoint;
 			m_is_data        = mm_conn.m_is_data;
 			m_server         = mm_conn.m_server;
+			m_out            = mm_conn.m_out;
 
 			m_buf= new char[m_bufsize];
 			strncpy(m_buf, mm_conn.m_buf, m_bufsize);
@@ -94,9 +106,10 @@ protected:
 			if( this != &mm_conn) {
 				m_fd             = mm_conn.m_fd;
 				m_buf_end        = mm_conn.m_buf_end;
-				m_is_bound       = mm_conn.m_is_bound;
+				m_endpoint       = mm_conn.m_endpoint;
 				m_is_data        = mm_conn.m_is_data;
 				m_server         = mm_conn.m_server;
+				m_out            = mm_conn.m_out;
 
 				if(m_buf) delete m_buf;
 
@@ -111,12 +124,11 @@ private:
 	int handle_management_command(char *cmd);
 	int handle_unbound_command(char *cmd);
 	int handle_bound_command(char *cmd);
-	int get_server_id(void) { return m_server->get_server_id(); }
 	mm_debug_link_interface *driver(void) {
-		return m_server->get_driver_fd();
+		return m_endpoint->driver();
 	}
-	void init(void) { m_fd = -1; m_is_bound = false;
-				m_is_data = false; m_buf_end = 0; }
+	void init(void) { m_fd = -1; m_endpoint = NULL;
+				m_is_data = false; m_buf_end = 0; m_out.clear(); }
 };
 
 #endif
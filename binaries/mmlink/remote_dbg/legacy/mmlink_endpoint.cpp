@@ -0,0 +1,381 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+//****************************************************************************
+/// @file  mmlink_endpoint.cpp
+/// @brief One remote STP debug endpoint and its driver service thread.
+/// @ingroup SigTap
+/// @verbatim
+//****************************************************************************
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/param.h>
+#include <sys/uio.h>
+
+#include "mmlink_endpoint.h"
+
+// Retry interval while h2t data waits for room in the HW write FIFO.
+#define H2T_RETRY_US     50
+// Longest the service thread sleeps without being woken.
+#define SERVICE_MAX_US   10000
+
+void mmlink_counters::reset(void)
+{
+	bytes = 0;
+	active_us = 0;
+	last_us = 0;
+	lat_count = 0;
+	lat_sum_us = 0;
+	lat_max_us = 0;
+	queued_us = 0;
+}
+
+void mmlink_counters::transferred(size_t count, uint64_t now)
+{
+	uint64_t last = last_us.exchange(now);
+
+	if (last && now - last < IDLE_US)
+		active_us += now - last;
+	bytes += count;
+}
+
+void mmlink_counters::latency(uint64_t us)
+{
+	uint64_t max = lat_max_us.load();
+
+	lat_count++;
+	lat_sum_us += us;
+	while (us > max && !lat_max_us.compare_exchange_weak(max, us))
+		;
+}
+
+double mmlink_counters::mbps(void) const
+{
+	uint64_t us = active_us.load();
+	return us ? (double)bytes.load() / us : 0.0;
+}
+
+uint64_t mmlink_counters::lat_avg_us(void) const
+{
+	uint64_t count = lat_count.load();
+	return count ? lat_sum_us.load() / count : 0;
+}
+
+mmlink_endpoint::mmlink_endpoint(int index, unsigned char *stp_addr,
+				 mm_debug_link_interface *driver)
+	: m_index(index), m_handle(0), m_stp_addr(stp_addr), m_driver(driver),
+	  m_h2t(BUFFERSIZE_H2T), m_running(false), m_wake_fd(-1), m_event_fd(-1)
+{
+}
+
+mmlink_endpoint::~mmlink_endpoint()
+{
+	close();
+	delete m_driver;
+}
+
+int mmlink_endpoint::open(void)
+{
+	if (m_driver->open(m_stp_addr))
+	{
+		fprintf(stderr, "endpoint %d: failed to init driver\n", m_index);
+		return -1;
+	}
+
+	m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_wake_fd < 0 || m_event_fd < 0)
+	{
+		fprintf(stderr, "endpoint %d: eventfd failed: %d (%s)\n",
+			m_index, errno, strerror(errno));
+		return -1;
+	}
+
+	m_running = true;
+	m_thread = std::thread(&mmlink_endpoint::service, this);
+	return 0;
+}
+
+void mmlink_endpoint::close(void)
+{
+	if (m_thread.joinable())
+	{
+		m_running = false;
+		signal(m_wake_fd);
+		m_thread.join();
+		m_driver->close();
+	}
+
+	if (m_wake_fd >= 0)
+		::close(m_wake_fd);
+	if (m_event_fd >= 0)
+		::close(m_event_fd);
+	m_wake_fd = m_event_fd = -1;
+}
+
+void mmlink_endpoint::signal(int fd)
+{
+	uint64_t one = 1;
+	ssize_t res = ::write(fd, &one, sizeof(one));
+	UNUSED_PARAM(res);
+}
+
+void mmlink_endpoint::ack_event(void)
+{
+	uint64_t count;
+	ssize_t res = ::read(m_event_fd, &count, sizeof(count));
+	UNUSED_PARAM(res);
+}
+
+ssize_t mmlink_endpoint::recv_h2t(int fd)
+{
+	struct iovec iov[2];
+	int cnt = m_h2t.write_segments(iov);
+	bool was_empty = m_h2t.empty();
+	ssize_t size;
+
+	if (!cnt)
+	{
+		errno = EAGAIN;
+		return -1;
+	}
+
+	size = ::readv(fd, iov, cnt);
+	if (size > 0)
+	{
+		if (was_empty)
+			m_h2t_stats.queued_us = mmlink_monotonic_us();
+		m_h2t.commit(size);
+		signal(m_wake_fd);
+	}
+
+	return size;
+}
+
+size_t mmlink_endpoint::push_h2t(const char *buf, size_t len)
+{
+	bool was_empty = m_h2t.empty();
+	size_t done = m_h2t.write(buf, len);
+
+	if (done)
+	{
+		if (was_empty)
+			m_h2t_stats.queued_us = mmlink_monotonic_us();
+		signal(m_wake_fd);
+	}
+	return done;
+}
+
+ssize_t mmlink_endpoint::send_t2h(int fd)
+{
+	size_t total = 0;
+	ssize_t sent = 0;
+
+	while (!m_driver->is_empty())
+	{
+		sent = m_driver->send_t2h(fd);
+		if (sent <= 0)
+			break;
+		total += sent;
+	}
+
+	if (total > 0)
+	{
+		uint64_t now = mmlink_monotonic_us();
+
+		m_t2h_stats.transferred(total, now);
+		if (m_driver->is_empty())
+			m_t2h_stats.latency(now - m_t2h_stats.queued_us);
+		// The ring has room again; let the service thread drain the FIFO.
+		signal(m_wake_fd);
+		return total;
+	}
+
+	return sent;
+}
+
+// Move queued h2t data into the HW write FIFO until it is full.
+bool mmlink_endpoint::service_h2t(void)
+{
+	struct iovec iov[2];
+	int cnt = m_h2t.read_segments(iov);
+	size_t total = 0;
+
+	for (int i = 0; i < cnt; ++i)
+	{
+		size_t done = 0;
+
+		while (done < iov[i].iov_len)
+		{
+			ssize_t n = m_driver->write((char *)iov[i].iov_base + done,
+						    iov[i].iov_len - done);
+			if (n <= 0)
+				break;
+			done += n;
+		}
+		total += done;
+		if (done < iov[i].iov_len)
+			break;
+	}
+
+	if (!total)
+		return false;
+
+	uint64_t queued = m_h2t_stats.queued_us;
+	uint64_t now = mmlink_monotonic_us();
+
+	m_h2t.consume(total);
+	m_h2t_stats.transferred(total, now);
+	if (m_h2t.empty())
+		m_h2t_stats.latency(now - queued);
+	else
+		m_h2t_stats.queued_us = now;
+	signal(m_event_fd);
+
+	return true;
+}
+
+// Drain the HW read FIFO into the t2h ring when it is due for a poll.
+bool mmlink_endpoint::service_t2h(void)
+{
+	bool was_empty;
+
+	if (m_driver->is_full() || !m_driver->can_read_data())
+		return false;
+
+	was_empty = m_driver->is_empty();
+	if (m_driver->read() <= 0)
+		return false;
+
+	if (was_empty)
+		m_t2h_stats.queued_us = mmlink_monotonic_us();
+	signal(m_event_fd);
+
+	return true;
+}
+
+void mmlink_endpoint::wait(uint64_t us)
+{
+	struct pollfd pfd;
+	struct timespec ts;
+	uint64_t count;
+
+	pfd.fd = m_wake_fd;
+	pfd.events = POLLIN;
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+
+	if (ppoll(&pfd, 1, &ts, NULL) > 0)
+	{
+		ssize_t res = ::read(m_wake_fd, &count, sizeof(count));
+		UNUSED_PARAM(res);
+	}
+}
+
+void mmlink_endpoint::service(void)
+{
+	while (m_running)
+	{
+		bool busy;
+		uint64_t delay;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mmio_lock);
+
+			busy = service_h2t();
+			busy = service_t2h() || busy;
+
+			if (m_driver->is_full())
+				delay = SERVICE_MAX_US;
+			else
+				delay = MIN(m_driver->read_delay_us(), (uint64_t)SERVICE_MAX_US);
+		}
+
+		if (busy)
+			continue;
+
+		// h2t data stuck behind a full HW write FIFO: retry soon.
+		if (!m_h2t.empty())
+			delay = MIN(delay, (uint64_t)H2T_RETRY_US);
+
+		if (delay)
+			wait(delay);
+	}
+}
+
+size_t mmlink_endpoint::format_stats(char *msg, size_t msg_len)
+{
+	int len = snprintf(msg, msg_len,
+		"T2H_BYTES=%lu T2H_MBPS=%.2f T2H_LAT_AVG_US=%lu T2H_LAT_MAX_US=%lu "
+		"H2T_BYTES=%lu H2T_MBPS=%.2f H2T_LAT_AVG_US=%lu H2T_LAT_MAX_US=%lu\n",
+		(unsigned long)m_t2h_stats.bytes.load(), m_t2h_stats.mbps(),
+		(unsigned long)m_t2h_stats.lat_avg_us(),
+		(unsigned long)m_t2h_stats.lat_max_us.load(),
+		(unsigned long)m_h2t_stats.bytes.load(), m_h2t_stats.mbps(),
+		(unsigned long)m_h2t_stats.lat_avg_us(),
+		(unsigned long)m_h2t_stats.lat_max_us.load());
+
+	return len < 0 ? 0 : MIN((size_t)len, msg_len - 1);
+}
+
+void mmlink_endpoint::print_throughput(const char *when)
+{
+	uint64_t bytes = m_t2h_stats.bytes;
+
+	if (!bytes)
+		return;
+
+	if (m_t2h_stats.active_us)
+		printf("endpoint %d: t2h %s: %lu bytes in %.3f s (%.2f MB/s sustained)\n",
+		       m_index, when, (unsigned long)bytes,
+		       m_t2h_stats.active_us / 1e6, m_t2h_stats.mbps());
+	else
+		printf("endpoint %d: t2h %s: %lu bytes\n",
+		       m_index, when, (unsigned long)bytes);
+	fflush(stdout);
+}
+
+void mmlink_endpoint::reset_stats(void)
+{
+	m_t2h_stats.reset();
+	m_h2t_stats.reset();
+}
+
+void mmlink_endpoint::end_session(void)
+{
+	// The service thread only touches the rings while holding the lock,
+	// and the network thread is the caller.
+	std::lock_guard<std::mutex> lock(m_mmio_lock);
+
+	m_h2t.clear();
+	m_driver->clear_t2h();
+	reset_stats();
+}
@@ -0,0 +1,137 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+//****************************************************************************
+/// @file  mmlink_endpoint.h
+/// @brief One remote STP debug endpoint and its driver service thread.
+/// @ingroup SigTap
+/// @verbatim
+//****************************************************************************
+
+#ifndef MMLINK_ENDPOINT_H
+#define MMLINK_ENDPOINT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <unistd.h>
+
+#include "mm_debug_link_interface.h"
+#include "mmlink_ring.h"
+
+// size of the h2t ring buffer (must be a power of 2)
+#define BUFFERSIZE_H2T (256 * 1024)
+
+// Latency and throughput counters for one transfer direction. Updated by
+// both the network and the driver service thread, read by STATS queries.
+struct mmlink_counters
+{
+	// Gaps between transfers longer than this are idle time.
+	static const uint64_t IDLE_US = 100000;
+
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> active_us;
+	std::atomic<uint64_t> last_us;
+	std::atomic<uint64_t> lat_count;
+	std::atomic<uint64_t> lat_sum_us;
+	std::atomic<uint64_t> lat_max_us;
+	// When the oldest byte still queued in the direction's ring arrived.
+	std::atomic<uint64_t> queued_us;
+
+	mmlink_counters() { reset(); }
+	void reset(void);
+	void transferred(size_t count, uint64_t now);
+	void latency(uint64_t us);
+	double mbps(void) const;
+	uint64_t lat_avg_us(void) const;
+};
+
+class mmlink_endpoint
+{
+public:
+	mmlink_endpoint(int index, unsigned char *stp_addr, mm_debug_link_interface *driver);
+	~mmlink_endpoint();
+
+	mmlink_endpoint(const mmlink_endpoint &) = delete;
+	mmlink_endpoint &operator=(const mmlink_endpoint &) = delete;
+
+	// Open the driver and start the driver service thread.
+	int open(void);
+	void close(void);
+
+	int index(void) const { return m_index; }
+	int handle(void) const { return m_handle; }
+	void handle(int value) { m_handle = value; }
+
+	// The driver may only be touched while holding mmio_lock().
+	mm_debug_link_interface *driver(void) { return m_driver; }
+	std::mutex &mmio_lock(void) { return m_mmio_lock; }
+
+	// Readable when t2h data arrived or h2t space was freed.
+	int event_fd(void) const { return m_event_fd; }
+	void ack_event(void);
+
+	// Network thread side of the data path.
+	ssize_t recv_h2t(int fd);
+	size_t push_h2t(const char *buf, size_t len);
+	ssize_t send_t2h(int fd);
+	bool h2t_full(void) const { return m_h2t.writable() == 0; }
+	bool t2h_empty(void) { return m_driver->is_empty(); }
+
+	size_t format_stats(char *msg, size_t msg_len);
+	void print_throughput(const char *when);
+	void reset_stats(void);
+	// Drop the data and counters of a closed data connection, so that
+	// the next one starts clean.
+	void end_session(void);
+
+private:
+	int m_index;
+	int m_handle;
+	unsigned char *m_stp_addr;
+	mm_debug_link_interface *m_driver;
+	std::mutex m_mmio_lock;
+
+	mmlink_ring m_h2t;
+	mmlink_counters m_h2t_stats;
+	mmlink_counters m_t2h_stats;
+
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+	int m_wake_fd;
+	int m_event_fd;
+
+	void service(void);
+	bool service_h2t(void);
+	bool service_t2h(void);
+	void wait(uint64_t us);
+	static void signal(int fd);
+};
+
+#endif
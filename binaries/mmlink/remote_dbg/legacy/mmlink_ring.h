@@ -0,0 +1,152 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+//****************************************************************************
+/// @file  mmlink_ring.h
+/// @brief Lock-free single-producer/single-consumer byte ring.
+/// @ingroup SigTap
+/// @verbatim
+//****************************************************************************
+
+#ifndef MMLINK_RING_H
+#define MMLINK_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/uio.h>
+
+// Byte ring shared by exactly one producer thread and one consumer thread.
+// The producer only advances m_tail and the consumer only advances m_head,
+// so no lock is needed; the indices are free-running and the capacity must
+// be a power of 2.
+class mmlink_ring
+{
+public:
+	explicit mmlink_ring(size_t capacity)
+		: m_capacity(capacity), m_mask(capacity - 1),
+		  m_buf(new char[capacity]), m_head(0), m_tail(0) {}
+	~mmlink_ring() { delete[] m_buf; }
+
+	mmlink_ring(const mmlink_ring &) = delete;
+	mmlink_ring &operator=(const mmlink_ring &) = delete;
+
+	size_t capacity(void) const { return m_capacity; }
+
+	size_t readable(void) const
+	{
+		return (size_t)(m_tail.load(std::memory_order_acquire) -
+				m_head.load(std::memory_order_acquire));
+	}
+
+	size_t writable(void) const { return m_capacity - readable(); }
+	bool empty(void) const { return readable() == 0; }
+
+	// Producer: copy up to len bytes in; returns the number copied.
+	size_t write(const void *src, size_t len)
+	{
+		struct iovec iov[2];
+		int cnt = write_segments(iov);
+		size_t done = 0;
+
+		for (int i = 0; i < cnt && done < len; ++i) {
+			size_t n = len - done < iov[i].iov_len ? len - done : iov[i].iov_len;
+			memcpy(iov[i].iov_base, (const char *)src + done, n);
+			done += n;
+		}
+		commit(done);
+		return done;
+	}
+
+	// Producer: describe the free space as up to 2 segments (for readv()).
+	int write_segments(struct iovec iov[2])
+	{
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t space = m_capacity - (size_t)(tail - m_head.load(std::memory_order_acquire));
+		return segments(tail, space, iov);
+	}
+
+	// Producer: publish len bytes placed by write_segments().
+	void commit(size_t len)
+	{
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + len,
+			     std::memory_order_release);
+	}
+
+	// Consumer: describe the pending data as up to 2 segments (for writev()).
+	int read_segments(struct iovec iov[2])
+	{
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		size_t pending = (size_t)(m_tail.load(std::memory_order_acquire) - head);
+		return segments(head, pending, iov);
+	}
+
+	// Consumer: release len bytes described by read_segments().
+	void consume(size_t len)
+	{
+		m_head.store(m_head.load(std::memory_order_relaxed) + len,
+			     std::memory_order_release);
+	}
+
+	// Drop all pending data. Neither side may use the ring meanwhile.
+	void clear(void)
+	{
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_release);
+	}
+
+private:
+	int segments(uint64_t pos, size_t len, struct iovec iov[2])
+	{
+		size_t offset = (size_t)(pos & m_mask);
+		size_t first = len < m_capacity - offset ? len : m_capacity - offset;
+
+		if (!len)
+			return 0;
+
+		iov[0].iov_base = m_buf + offset;
+		iov[0].iov_len = first;
+		if (len == first)
+			return 1;
+
+		iov[1].iov_base = m_buf;
+		iov[1].iov_len = len - first;
+		return 2;
+	}
+
+	const size_t m_capacity;
+	const size_t m_mask;
+	char *m_buf;
+	// Keep the indices on separate cache lines; each is written by one side.
+	char m_pad0[64];
+	std::atomic<uint64_t> m_head;
+	char m_pad1[64 - sizeof(std::atomic<uint64_t>)];
+	std::atomic<uint64_t> m_tail;
+};
+
+#endif
@@ -23,6 +23,7 @@
 // CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
+
 //****************************************************************************
 /// @file  mmlink_server.cpp
 /// @brief Basic AFU interaction.
@@ -31,11 +32,12 @@
 //****************************************************************************
 
 #include <cerrno>
-#include <cstdarg>
+#include <csignal>
 #include <cstring>
 #include <string>
 #include <iostream>
 
+#include <sys/epoll.h>
 #include <sys/param.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -47,254 +49,228 @@
 
 #include "mm_debug_link_interface.h"
 #include "mmlink_connection.h"
+#include "mmlink_endpoint.h"
 #include "mmlink_server.h"
 
 using namespace std;
 
-mmlink_server::mmlink_server(struct sockaddr_in *sock, mm_debug_link_interface *driver)
+// epoll_event.data.u64 tags: the kind of fd in the upper half, the index
+// of the connection or endpoint in the lower half.
+#define TAG_LISTEN       (0ULL << 32)
+#define TAG_CONNECTION   (1ULL << 32)
+#define TAG_ENDPOINT     (2ULL << 32)
+#define TAG_KIND(t)      ((t) & ~0xffffffffULL)
+#define TAG_INDEX(t)     ((size_t)((t) & 0xffffffffULL))
+
+#define MAX_EVENTS       32
+#define EPOLL_TIMEOUT_MS 100
+
+mmlink_server::mmlink_server(struct sockaddr_in *sock)
 {
 	m_addr = *sock;
 
-	m_num_bound_connections = 0;
-	m_num_connections = 0;
+	m_epoll = -1;
+	m_next_handle = 0;
 
-	m_t2h_pending = false;
-	m_h2t_pending = false;
+	m_running = false;
 
-	m_conn = new mmlink_connection*[MAX_CONNECTIONS];
-	for (size_t i = 0; i < MAX_CONNECTIONS; ++i)
-		m_conn[i] = new mmlink_connection(this);
+	m_stats_interval_us = 0;
+	m_stats_last_us = 0;
+}
 
-	m_running = false;
-	m_driver = driver;
-	m_server_id = 0;
+mmlink_server::~mmlink_server()
+{
+	for (size_t i = 0; i < m_conn.size(); ++i)
+	{
+		delete m_conn[i]; m_conn[i] = NULL;
+	}
 
-	m_listen = -1;
+	for (size_t i = 0; i < m_endpoints.size(); ++i)
+	{
+		delete m_endpoints[i]; m_endpoints[i] = NULL;
+	}
 
-	m_h2t_stats = NULL;
-	m_t2h_stats = NULL;
-#ifdef ENABLE_MMLINK_STATS
-	m_h2t_stats = new mmlink_stats("h2t");
-	m_t2h_stats = new mmlink_stats("t2h");
-#endif
+	for (size_t i = 0; i < m_listen.size(); ++i)
+	{
+		if ( -1 != m_listen[i] ) {
+			close(m_listen[i]);
+		}
+	}
 
+	if ( -1 != m_epoll ) {
+		close(m_epoll);
+	}
 }
 
-mmlink_server::~mmlink_server()
+int mmlink_server::add_endpoint(unsigned char *stpAddr, mm_debug_link_interface *driver)
 {
-	if (m_conn)
-		for (size_t i = 0; i < MAX_CONNECTIONS; ++i)
-		{
-			delete m_conn[i]; m_conn[i] = NULL;
-		}
-	delete[] m_conn; m_conn = NULL;
-	m_driver->close();
+	mmlink_endpoint *ep = new mmlink_endpoint((int)m_endpoints.size(), stpAddr, driver);
+
+	m_endpoints.push_back(ep);
+	m_listen.push_back(-1);
+	m_listening.push_back(false);
 
-	if ( -1 != m_listen ) {
-		close(m_listen);
+	// One management and one data connection per endpoint.
+	for (size_t i = 0; i < CONNECTIONS_PER_ENDPOINT; ++i)
+	{
+		m_conn.push_back(new mmlink_connection(this));
+		m_conn_events.push_back(0);
 	}
 
-#ifdef ENABLE_MMLINK_STATS
-	delete m_h2t_stats; m_h2t_stats = NULL;
-	delete m_t2h_stats; m_t2h_stats = NULL;
-#endif
+	return ep->index();
 }
 
-int mmlink_server::setup_listen_socket(void)
+int mmlink_server::setup_listen_socket(size_t e)
 {
-	m_listen = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = m_addr;
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
 
-	if (m_listen < 0)
+	if (fd < 0)
 	{
 		cerr << "Socket creation failed: " <<  errno << endl;
 		return errno;
 	}
-	printf("m_listen: %d\n", m_listen);
+	m_listen[e] = fd;
+	printf("m_listen[%zu]: %d\n", e, fd);
 
 	// Allow reconnect sooner, after server exit.
 	int optval = 1;
 	int err =
-		setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
 
 	if (err < 0)
 	{
 		fprintf(stderr, "setsockopt failed: %d\n", errno);
 		return errno;
 	}
+
+	addr.sin_port = htons(ntohs(m_addr.sin_port) + e);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		fprintf(stderr, "bind() failed: %d (%s)\n", errno, strerror(errno));
+		return errno;
+	}
+
+	if (listen(fd, 5) < 0)
+	{
+		fprintf(stderr, "listen() failed: %d (%s)\n", errno, strerror(errno));
+		return errno;
+	}
+
+	printf("endpoint %zu listening on ip: %s; port: %d\n", e,
+	       inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
 	return 0;
 }
 
-int mmlink_server::run(unsigned char* stpAddr)
+int mmlink_server::watch(int op, int fd, uint32_t events, uint64_t tag)
 {
-	int err = 0;
-	m_running = true;
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.u64 = tag;
 
-	if (m_driver->open(stpAddr))
+	if (epoll_ctl(m_epoll, op, fd, &ev) < 0)
 	{
-		fprintf(stderr, "failed to init driver (%d).\n", err);
-		return err;
+		fprintf(stderr, "epoll_ctl(%d) on %d failed: %d (%s)\n",
+			op, fd, errno, strerror(errno));
+		return errno;
 	}
+	return 0;
+}
 
-	// Todo: modulate timeout based on number of connections, expectation of data.
-	struct timeval tv;
-	tv.tv_sec  = 0;
-	tv.tv_usec = 1000;
+int mmlink_server::run(void)
+{
+	int err = 0;
 
-	if (setup_listen_socket())
+	if (m_endpoints.empty())
 	{
-		fprintf(stderr, "setup_listen_socket() failed\n");
+		fprintf(stderr, "no debug endpoints to serve\n");
 		return -1;
 	}
 
-	if (bind(m_listen, (struct sockaddr *)&m_addr, sizeof(m_addr)) != 0)
+	// A client going away must not kill the server while sending to it.
+	signal(SIGPIPE, SIG_IGN);
+
+	for (size_t i = 0; i < m_endpoints.size(); ++i)
 	{
-		fprintf(stderr, "bind() failed: %d (%s)\n", errno, strerror(errno));
-		return errno;
+		if (m_endpoints[i]->open())
+		{
+			fprintf(stderr, "failed to init driver for endpoint %zu.\n", i);
+			return -1;
+		}
 	}
 
-	if (listen(m_listen, 5) < 0)
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll < 0)
 	{
-		fprintf(stderr, "listen() failed: %d (%s)\n", errno, strerror(errno));
+		fprintf(stderr, "epoll_create1() failed: %d (%s)\n", errno, strerror(errno));
 		return errno;
 	}
 
-	printf("listening on ip: %s; port: %d\n", inet_ntoa(m_addr.sin_addr),
-	       htons(m_addr.sin_port));
-
-	while (m_running)
+	for (size_t i = 0; i < m_endpoints.size(); ++i)
 	{
-		fd_set readfds, writefds;
-		FD_ZERO(&readfds);
-		FD_ZERO(&writefds);
-
-		int max_fd = -1;
-		// Listen for more connections, if needed.
-		if ((size_t)m_num_connections < MAX_CONNECTIONS)
+		if (setup_listen_socket(i))
 		{
-			FD_SET(m_listen, &readfds);
-			max_fd = MAX(m_listen, max_fd);
+			fprintf(stderr, "setup_listen_socket() failed\n");
+			return -1;
 		}
 
-		// Listen for read on all connections.
-		for (size_t i = 0; i < MAX_CONNECTIONS; ++i)
-		{
-			mmlink_connection *pc = *(m_conn + i);
-			if (pc->is_open())
-			{
-				int fd = pc->getsocket();
-				FD_SET(fd, &readfds);
-
-				max_fd = MAX(fd, max_fd);
-			}
-		}
+		err = watch(EPOLL_CTL_ADD, m_endpoints[i]->event_fd(), EPOLLIN, TAG_ENDPOINT | i);
+		if (err)
+			return err;
+		update_listen(i);
+	}
 
-		// If we have a data socket, listen for read and write on the driver fd.
-		mmlink_connection *data_conn = get_data_connection();
-		if (data_conn)
-		{
-			int host_fd = data_conn->getsocket();
+	m_running = true;
+	m_stats_last_us = mmlink_monotonic_us();
 
-			// Listen for write on the host
-			// Data from the driver are written here.
-			FD_SET(host_fd, &writefds);
-			max_fd = MAX(host_fd, max_fd);
-		}
+	while (m_running)
+	{
+		struct epoll_event events[MAX_EVENTS];
+		int n = epoll_wait(m_epoll, events, MAX_EVENTS, EPOLL_TIMEOUT_MS);
 
-		tv.tv_sec  = 0;
-		tv.tv_usec = 1000;
-		if (select(max_fd + 1, &readfds, &writefds, NULL, &tv) < 0)
+		if (n < 0)
 		{
-			fprintf(stderr, "select error: %d (%s)\n", errno, strerror(errno));
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "epoll_wait error: %d (%s)\n", errno, strerror(errno));
+			err = errno;
 			break;
 		}
 
-		// Handle new connection attempts.
-		if (FD_ISSET(m_listen, &readfds))
+		for (int e = 0; e < n; ++e)
 		{
-			mmlink_connection *pc = handle_accept();
-			// If a new connection was accepted, send the welcome string.
-			if (pc)
-			{
-				char msg[256];
-
-				get_welcome_message(msg, sizeof(msg) / sizeof(*msg));
-				// to do:spin until all bytes sent.
-				pc->send(msg, strnlen(msg, sizeof(msg)));
-			}
-		}
-
-		// Transfer response data from the driver to the data socket.
-		if (data_conn)
-		{
-			bool can_write_host = FD_ISSET(data_conn->getsocket(), &writefds);
-			//bool can_read_driver = FD_ISSET(m_driver->get_fd(), &readfds);
-			bool can_read_driver = m_driver->can_read_data();
-			err = handle_t2h(data_conn, can_read_driver, can_write_host); //TODO add logic to check if driver has data to be read
-
-			if (err)
-				break;
-
-			// Transfer command data from the data socket to the driver.
-			//bool can_write_driver = FD_ISSET(m_driver->get_fd(), &writefds);
-			bool can_write_driver = true;
-			bool can_read_host = FD_ISSET(data_conn->getsocket(), &readfds);
-			err = handle_h2t(data_conn, can_read_host, can_write_driver); //TODO add logic to check if host has data to be written to driver
+			uint64_t tag = events[e].data.u64;
 
-			if (err < 0)
+			switch (TAG_KIND(tag))
 			{
-				m_num_connections--;
-				data_conn->close_connection();
-				printf("closed data connection due to handle_h2t return value, now have %d\n", m_num_connections);
+			case TAG_LISTEN:
+				handle_accept(TAG_INDEX(tag));
+				break;
+			case TAG_CONNECTION:
+				handle_connection(TAG_INDEX(tag), events[e].events);
+				break;
+			case TAG_ENDPOINT:
+				handle_endpoint(m_endpoints[TAG_INDEX(tag)]);
+				break;
 			}
-
-			// Yield after done process the current known acitivty
-			::sched_yield();
 		}
 
-		// Handle management connection commands and responses.
-		for (size_t i = 0; i < MAX_CONNECTIONS; ++i)
+		if (m_stats_interval_us)
 		{
-			mmlink_connection *pc = *(m_conn + i);
-			if (!pc->is_open())
-			{
-				continue;
-			}
-			if (pc->is_data())
+			uint64_t now = mmlink_monotonic_us();
+			if (now - m_stats_last_us >= m_stats_interval_us)
 			{
-				continue;
-			}
-
-			if (FD_ISSET(pc->getsocket(), &readfds))
-			{
-				int fail = pc->handle_receive();
-				if (fail)
-				{
-					--m_num_connections;
-					printf("%d: handle_receive() returned %d, closing connection, now have %d\n",
-					       pc->getsocket(), fail, m_num_connections);
-					pc->close_connection();
-				}
-				else
-				{
-					fail = pc->handle_management();
-					if (fail)
-					{
-						--m_num_connections;
-						printf("%d: handle_management() returned %d, closing connection, now have %d\n",
-						       pc->getsocket(), fail, m_num_connections);
-						pc->close_connection();
-					}
-					else if (pc->is_data())
-					{
-						printf("%d: converted to data\n", pc->getsocket());
-						// A management connection was converted to data. There can be only one.
-						close_other_data_connection(pc);
-						m_h2t_pending = true;
-					}
-				}
+				for (size_t i = 0; i < m_endpoints.size(); ++i)
+					m_endpoints[i]->print_throughput("session");
+				m_stats_last_us = now;
 			}
 		}
 	}
+
+	for (size_t i = 0; i < m_endpoints.size(); ++i)
+		m_endpoints[i]->print_throughput("session");
 	printf("goodbye with code %d\n", err);
 
 	return err;
@@ -302,306 +278,352 @@ int mmlink_server::run(unsigned char* stpAddr)
 
 void mmlink_server::print_stats(void)
 {
-#ifdef ENABLE_MMLINK_STATS
-	printf("mmlink_connection::print_stats()\n");
+	char msg[256];
 
-	m_h2t_stats->print();
-	m_t2h_stats->print();
-#endif
+	for (size_t i = 0; i < m_endpoints.size(); ++i)
+	{
+		m_endpoints[i]->format_stats(msg, sizeof(msg));
+		printf("endpoint %zu: %s", i, msg);
+	}
+}
+
+void mmlink_server::update_listen(size_t e)
+{
+	size_t index;
+	bool want = get_unused_connection(e, &index) != NULL;
+
+	// Leave further connection attempts in the backlog while all
+	// connections of the endpoint are in use.
+	if (want == m_listening[e])
+		return;
+
+	if (!watch(want ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, m_listen[e], EPOLLIN, TAG_LISTEN | e))
+		m_listening[e] = want;
 }
 
-mmlink_connection *mmlink_server::handle_accept()
+void mmlink_server::update_events(size_t i)
+{
+	mmlink_connection *pc = m_conn[i];
+	uint32_t events = EPOLLIN;
+
+	if (!pc->is_open())
+		return;
+
+	if (pc->output_pending())
+		events |= EPOLLOUT;
+
+	if (pc->is_data())
+	{
+		mmlink_endpoint *ep = pc->endpoint();
+
+		// Stop reading while the h2t ring is full; the endpoint event
+		// fires again once the service thread made room.
+		if (ep->h2t_full())
+			events &= ~EPOLLIN;
+		if (!ep->t2h_empty())
+			events |= EPOLLOUT;
+	}
+	else if (pc->output_pending())
+	{
+		// Take no more commands until their replies went out.
+		events &= ~EPOLLIN;
+	}
+
+	if (events != m_conn_events[i])
+	{
+		watch(EPOLL_CTL_MOD, pc->getsocket(), events, TAG_CONNECTION | i);
+		m_conn_events[i] = events;
+	}
+}
+
+void mmlink_server::handle_accept(size_t e)
 {
 	int socket;
 	struct sockaddr_in incoming_addr;
 	socklen_t len = sizeof(incoming_addr);
+	size_t index = 0;
 
 	// Find an mmlink_connection for this new connection,
 	// or NULL if none available.
-	mmlink_connection *pc = get_unused_connection();
-	socket = ::accept(m_listen, (struct sockaddr *)&incoming_addr, &len);
+	mmlink_connection *pc = get_unused_connection(e, &index);
+	socket = ::accept4(m_listen[e], (struct sockaddr *)&incoming_addr, &len,
+			   SOCK_NONBLOCK | SOCK_CLOEXEC);
 	if (socket < 0)
 	{
-		fprintf(stderr, "accept failed: %d (%s)\n", errno, strerror(errno));
-		pc = NULL;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			fprintf(stderr, "accept failed: %d (%s)\n", errno, strerror(errno));
+		return;
 	}
-	else
+
+	if (!pc)
 	{
-		if (pc)
-		{
-			++m_num_connections;
-			pc->socket(socket);
-			printf("I have %d connections now; latest socket is %d\n", m_num_connections, socket);
-			// The 1st connection is bound upon connection.  The 2nd connection will
-			// be bound if it sends the correct handle.
-			if (m_num_connections == 1)
-			{
-				printf("%d: binding first connection\n", pc->getsocket());
-				pc->bind();
-			}
-			printf("%d: Accepted connection request from %s\n", pc->getsocket(), inet_ntoa(incoming_addr.sin_addr));
-		}
-		else
-		{
-			// If there are no unused connections available, we shouldn't be in
-			// this routine in the first place. If this happens anyway, accept
-			// and close the connection.
-			fprintf(stderr, "%d: Rejected connection request from %s\n", socket, inet_ntoa(incoming_addr.sin_addr));
-			::close(socket);
-			pc = NULL;
-		}
+		// If there are no unused connections available, we shouldn't be in
+		// this routine in the first place. If this happens anyway, accept
+		// and close the connection.
+		fprintf(stderr, "%d: Rejected connection request from %s\n", socket, inet_ntoa(incoming_addr.sin_addr));
+		::close(socket);
+		return;
 	}
 
-	return pc;
-}
-
-void mmlink_server::get_welcome_message(char *msg, size_t msg_len)
-{
-	int ident[4];
+	// Debug traffic is small and latency bound.
+	int optval = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
 
-	m_driver->ident(ident);
+	pc->socket(socket);
+	printf("%d: Accepted connection request from %s\n", socket, inet_ntoa(incoming_addr.sin_addr));
 
-	if (m_num_connections == 1)
+	// The 1st connection is bound upon connection.  The 2nd connection will
+	// be bound if it sends the correct handle.
+	if (!endpoint_in_use(e))
 	{
-		++m_server_id;
-		//snprintf(msg, msg_len, "SystemConsole CONFIGROM IDENT=%08X%08X%08X%08X HANDLE=%08X\r\n",
-		//         ident[3], ident[2], ident[1], ident[0], m_server_id);
+		mmlink_endpoint *ep = m_endpoints[e];
 
-		snprintf(msg, msg_len, "SystemConsole CONFIGROM IDENT=0001000000007BF899BB8B9AA2D864C3 HANDLE=%08X\r\n", m_server_id);
+		ep->handle(++m_next_handle);
+		pc->bind(ep);
+		printf("%d: binding first connection of endpoint %zu\n", socket, e);
 	}
-	else
+
+	if (watch(EPOLL_CTL_ADD, socket, EPOLLIN, TAG_CONNECTION | index))
 	{
-		strncpy(msg, "SystemConsole CONFIGROM IDENT=0001000000007BF899BB8B9AA2D864C3 HANDLE\r\n", 73);
+		pc->close_connection();
+		return;
+	}
+	m_conn_events[index] = EPOLLIN;
 
-		//snprintf(msg, msg_len, "SystemConsole CONFIGROM IDENT=0001000000007BF899BB8B9AA2D864C3 HANDLE\r\n");
-		//snprintf(msg, msg_len, "SystemConsole CONFIGROM IDENT=%08X%08X%08X%08X HANDLE\r\n",
-		//         ident[3], ident[2], ident[1], ident[0]);
+	char msg[256];
+	get_welcome_message(pc, msg, sizeof(msg) / sizeof(*msg));
+	if (pc->send(msg, strnlen(msg, sizeof(msg))) < 0)
+	{
+		close_connection(index, "welcome send");
+		return;
 	}
+
+	update_events(index);
+	update_listen(e);
 }
 
-mmlink_connection *mmlink_server::get_unused_connection()
+void mmlink_server::handle_connection(size_t i, uint32_t events)
 {
-	mmlink_connection *pc = NULL;
-	for (size_t i = 0; i < MAX_CONNECTIONS; ++i)
-		if (!m_conn[i]->is_open())
-		{
+	mmlink_connection *pc = m_conn[i];
 
-			pc = *(m_conn + i);
-			break;
-		}
+	if (!pc->is_open())
+		return;
 
-	return pc;
-}
+	if ((events & EPOLLERR) || (events & (EPOLLHUP | EPOLLIN)) == EPOLLHUP)
+	{
+		close_connection(i, "socket error");
+		return;
+	}
 
-void mmlink_server::close_other_data_connection(mmlink_connection *pc)
-{
-	for (size_t i = 0; i < MAX_CONNECTIONS; ++i)
+	if (pc->is_data())
 	{
-		mmlink_connection *other_pc = *(m_conn + i);
-		if (other_pc == pc)
-			continue;
-		if (other_pc->is_open() && other_pc->is_data())
+		mmlink_endpoint *ep = pc->endpoint();
+
+		// Transfer command data from the data socket to the endpoint.
+		if (events & EPOLLIN)
 		{
-			printf("closing old data connection in favor of new one\n");
-			m_num_connections--;
-			other_pc->close_connection();
+			ssize_t size = ep->recv_h2t(pc->getsocket());
+			if (size == 0 ||
+			    (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+			{
+				close_connection(i, "h2t receive");
+				return;
+			}
 		}
+
+		// Transfer response data from the endpoint to the data socket.
+		if ((events & EPOLLOUT) && !flush_t2h(i))
+			return;
+
+		update_events(i);
+		return;
 	}
-}
 
-// Return the data connection, or NULL if none.
-// Could cache this.
-mmlink_connection *mmlink_server::get_data_connection(void)
-{
-	for (size_t i = 0; i < MAX_CONNECTIONS; ++i)
+	// Handle management connection commands and responses.
+	if ((events & EPOLLOUT) && pc->flush_output() < 0)
 	{
-		mmlink_connection *pc = *(m_conn + i);
+		close_connection(i, "send");
+		return;
+	}
+
+	if (events & EPOLLIN)
+	{
+		int fail = pc->handle_receive();
+		if (fail)
+		{
+			close_connection(i, "handle_receive()");
+			return;
+		}
+
+		fail = pc->handle_management();
+		if (fail)
+		{
+			close_connection(i, "handle_management()");
+			return;
+		}
+
 		if (pc->is_data())
-			return pc;
+		{
+			printf("%d: converted to data on endpoint %d\n",
+			       pc->getsocket(), pc->endpoint()->index());
+			// A management connection was converted to data. There can be
+			// only one per endpoint.
+			close_other_data_connection(pc);
+
+			// Whatever was received from the conversion on is h2t data.
+			pc->endpoint()->push_h2t(pc->buf(), pc->buf_end());
+			pc->buf_end(0);
+
+			if (!flush_t2h(i))
+				return;
+		}
 	}
 
-	return NULL;
+	update_events(i);
 }
 
-int mmlink_server::handle_t2h(mmlink_connection *data_conn, bool can_read_driver, bool can_write_host)
+void mmlink_server::handle_endpoint(mmlink_endpoint *ep)
 {
-	int err = 0;
-	bool socket_error = false;
-	bool t2h_ready = m_t2h_pending ? can_write_host : can_read_driver;
+	size_t i;
 
+	ep->ack_event();
 
-	if (!t2h_ready)
+	// New t2h data or free h2t space: resume the data connection.
+	if (get_data_connection(ep, &i) && flush_t2h(i))
+		update_events(i);
+}
+
+bool mmlink_server::flush_t2h(size_t i)
+{
+	mmlink_connection *pc = m_conn[i];
+
+	// Replies queued before the conversion to data go out first.
+	if (pc->flush_output() < 0)
 	{
-		return 0;
+		close_connection(i, "send");
+		return false;
 	}
+	if (pc->output_pending())
+		return true;
 
-	// Try to get more data.
-	if (can_read_driver)
+	ssize_t sent = pc->endpoint()->send_t2h(pc->getsocket());
+
+	if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
 	{
-		m_driver->read();
+		// Socket error, disconnected?
+		close_connection(i, "t2h send");
+		return false;
 	}
-	if (m_driver->is_empty())
+	return true;
+}
+
+void mmlink_server::close_connection(size_t i, const char *why)
+{
+	mmlink_connection *pc = m_conn[i];
+	mmlink_endpoint *ep = pc->endpoint();
+	bool data = pc->is_data();
+
+	if (!pc->is_open())
+		return;
+
+	watch(EPOLL_CTL_DEL, pc->getsocket(), 0, 0);
+	printf("%d: closing %s connection: %s\n", pc->getsocket(),
+	       data ? "data" : "management", why);
+	pc->close_connection();
+	m_conn_events[i] = 0;
+
+	if (data && ep)
 	{
-		// Still no t2h data; done here.
-		m_t2h_pending = false;
-		return 0;
+		ep->print_throughput("session");
+		ep->end_session();
 	}
 
-	// Handle response data from the driver.
-	if (can_write_host && data_conn && m_driver->flush_request())
+	update_listen(i / CONNECTIONS_PER_ENDPOINT);
+}
+
+void mmlink_server::get_welcome_message(mmlink_connection *pc, char *msg, size_t msg_len)
+{
+	if (pc->is_bound())
+	{
+		snprintf(msg, msg_len, "SystemConsole CONFIGROM IDENT=0001000000007BF899BB8B9AA2D864C3 HANDLE=%08X\r\n",
+			 pc->endpoint()->handle());
+	}
+	else
 	{
-		// Send the data to the data socket.
-		int total_sent = 0;
+		strncpy(msg, "SystemConsole CONFIGROM IDENT=0001000000007BF899BB8B9AA2D864C3 HANDLE\r\n", msg_len);
+		msg[msg_len - 1] = '\0';
+	}
+}
 
-		while ((size_t)total_sent < m_driver->buf_end())
+mmlink_connection *mmlink_server::get_unused_connection(size_t e, size_t *index)
+{
+	for (size_t i = e * CONNECTIONS_PER_ENDPOINT;
+	     i < (e + 1) * CONNECTIONS_PER_ENDPOINT; ++i)
+		if (!m_conn[i]->is_open())
 		{
-			ssize_t sent = data_conn->send(m_driver->buf() + total_sent, m_driver->buf_end() - total_sent);
-			// printf("t2h sent: %u (%d of %d)\n", sent, total_sent, m_driver->buf_end());
-
-//      if (sent == 8 && !printed8)
-//      {
-//        // printed8 = true;
-//        for (int i = 0; i < sent; ++i)
-//        {
-//          printf_RAW("0x%02X; ", m_driver->buf()[i]);
-//        }
-//        printf_RAW("\n");
-//      }
-
-			if (sent < 0)
-			{
-				if (errno == EAGAIN)
-				{
-					// Try again later.
-					break;
-				}
-				else
-				{
-					// Socket error, disconnected?
-					socket_error = true;
-					break;
-				}
-			}
-			if (sent == 0)
-			{
-				// Didn't send all data; Try to send the remaining data later.
-				break;
-			}
-
-			total_sent += sent;
+			*index = i;
+			return m_conn[i];
 		}
 
-		if (total_sent > 0)
-			m_t2h_stats->update(total_sent, m_driver->buf());
-
-		int rem = m_driver->buf_end() - total_sent;
-		if (rem > 0)
-		{
-			printf("t2h rem: %d; total_sent: %d; m_h2t_pending: %d\n", rem, total_sent, m_t2h_pending);
-			if (total_sent > 0)
-			{
-				m_t2h_pending = true;
-				memmove(m_driver->buf(), m_driver->buf() + total_sent, rem);
-			}
-		}
-		m_driver->buf_end(rem);
-	}
+	return NULL;
+}
 
-	if (socket_error || !data_conn)
-	{
-		// We didn't have a data connection in the first place, or an error
-		// has occurred on the data connection.
-		fprintf(stderr, "hardware returned data but there's no data socket\n");
-		err = -1;
-	}
+// Whether any connection is bound to endpoint e.
+bool mmlink_server::endpoint_in_use(size_t e)
+{
+	for (size_t i = e * CONNECTIONS_PER_ENDPOINT;
+	     i < (e + 1) * CONNECTIONS_PER_ENDPOINT; ++i)
+		if (m_conn[i]->is_open() && m_conn[i]->is_bound())
+			return true;
 
-	return err;
+	return false;
 }
 
-int mmlink_server::handle_h2t(mmlink_connection *data_conn, bool can_read_host, bool can_write_driver)
+// Match a "HANDLE xxxxxxxx" command against the endpoint pc connected to.
+mmlink_endpoint *mmlink_server::find_endpoint(mmlink_connection *pc, const char *handle_cmd)
 {
-	int err = 0;
+	char expect_handle[] = "HANDLE 01234567";
 
-	bool h2t_ready = m_h2t_pending ? can_write_driver : can_read_host;
-	if (!h2t_ready)
+	for (size_t i = 0; i < m_conn.size(); ++i)
 	{
-		return 0;
+		if (m_conn[i] != pc)
+			continue;
+
+		mmlink_endpoint *ep = m_endpoints[i / CONNECTIONS_PER_ENDPOINT];
+		snprintf(expect_handle + 7, 9, "%08X", ep->handle());
+		return 0 == strcmp(expect_handle, handle_cmd) ? ep : NULL;
 	}
 
-	// printf("h2t_ready: m_h2t_pending: %d; can_read_host: %d; can_write_driver: %d\n", m_h2t_pending, can_read_host, can_write_driver);
+	return NULL;
+}
 
-	// If no stored data, try to get some.
-	if (can_read_host)
+void mmlink_server::close_other_data_connection(mmlink_connection *pc)
+{
+	for (size_t i = 0; i < m_conn.size(); ++i)
 	{
-		err = data_conn->handle_receive();
-		if (err < 0)
+		mmlink_connection *other_pc = m_conn[i];
+		if (other_pc == pc)
+			continue;
+		if (other_pc->is_open() && other_pc->is_data() &&
+		    other_pc->endpoint() == pc->endpoint())
 		{
-			return err;
+			close_connection(i, "replaced by a new data connection");
 		}
 	}
+}
 
-	if (data_conn->buf_end() == 0)
-	{
-		// No data to send.
-		m_h2t_pending = false;
-		return 0;
-	}
-
-	if (!can_write_driver)
-		return 0;
-
-	// Handle command data from the data socket.
-	int total_sent = 0;
-	while ((size_t)total_sent < data_conn->buf_end())
+// Return the data connection of an endpoint, or NULL if none.
+mmlink_connection *mmlink_server::get_data_connection(mmlink_endpoint *ep, size_t *index)
+{
+	for (size_t i = 0; i < m_conn.size(); ++i)
 	{
-		ssize_t sent = m_driver->write(data_conn->buf() + total_sent, data_conn->buf_end() - total_sent);
-		if (sent < 0)
+		mmlink_connection *pc = m_conn[i];
+		if (pc->is_open() && pc->is_data() && pc->endpoint() == ep)
 		{
-			if (errno == EAGAIN)
-			{
-				// Try again later
-				printf("handle_h2t(): driver returned EAGAIN\n");
-				break;
-			}
-			else
-			{
-				// Not sure if this can happen.
-				printf("handle_h2t(): driver returned error %d (%s)\n", errno, strerror(errno));
-			}
-		}
-		if (sent == 0)
-		{
-			// Didn't send all data; Try to send the remaining data later.
-			break;
-		}
-		total_sent += sent;
-	}
-//  if (total_sent > 0)
-//  {
-//    printf("sent on %d: %d bytes\n", data_conn->socket(), total_sent);
-//    for (int i = 0; i < total_sent; ++i)
-//    {
-//      unsigned char the_byte = data_conn->buf()[i];
-//      printf_RAW("%s\\x%02X", (the_byte == 0x7C) ? "\n" : "", the_byte);
-//    }
-//    printf_RAW("\n");
-//  }
-
-	if (total_sent > 0)
-		m_h2t_stats->update(total_sent, data_conn->buf());
-
-	int rem = data_conn->buf_end() - total_sent;
-	if (rem > 0)
-	{
-		// printf("h2t rem: %d; total_sent: %d; m_h2t_pending: %d\n", rem, total_sent, m_h2t_pending);
-		m_h2t_pending = true;
-		if (total_sent > 0)
-		{
-			// memmove(data_conn->buf(), data_conn->buf() + data_conn->buf_end(), rem);
-			memmove(data_conn->buf(), data_conn->buf() + total_sent, rem);
+			*index = i;
+			return pc;
 		}
 	}
-	data_conn->buf_end(rem);
 
-	return err;
+	return NULL;
 }
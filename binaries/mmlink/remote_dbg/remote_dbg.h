@@ -24,6 +24,7 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 
@@ -40,6 +41,16 @@ public:
   remote_dbg& operator=(const remote_dbg&) = delete;
   virtual ~remote_dbg() = default;
   virtual int run(volatile uint64_t *mmio, const char *address, int port) = 0;
+  // Serve several debug endpoints from one server. Implementations that
+  // handle a single endpoint serve the first one.
+  virtual int run_endpoints(volatile uint64_t **mmio, size_t count,
+                            const char *address, int port) {
+    return count ? run(mmio[0], address, port) : -1;
+  }
   virtual void terminate(){}
+  // Report t2h throughput every seconds while a session is active (0: off).
+  void stats_interval(unsigned seconds) { stats_interval_ = seconds; }
 
+protected:
+  unsigned stats_interval_ = 0;
 };
@@ -0,0 +1,84 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "mirror_ring.h"
+
+const MIRROR_RING MIRROR_RING_default = { NULL, 0, 0, 0 };
+
+RETURN_CODE mring_init(MIRROR_RING *ring, size_t size) {
+    long page_sz = sysconf(_SC_PAGESIZE);
+    char *base;
+    int fd;
+
+    *ring = MIRROR_RING_default;
+
+    if ((size == 0) || (size & (size - 1)) || (page_sz <= 0) || (size % (size_t)page_sz)) {
+        return FAILURE;
+    }
+
+    if ((fd = memfd_create("mml-stream-ring", MFD_CLOEXEC)) < 0) {
+        return FAILURE;
+    }
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return FAILURE;
+    }
+
+    // Reserve twice the span, then overlay both halves with the same pages.
+    base = (char *)mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return FAILURE;
+    }
+
+    if ((mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) ||
+        (mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+        munmap(base, 2 * size);
+        close(fd);
+        return FAILURE;
+    }
+
+    // The mappings hold their own reference to the file.
+    close(fd);
+
+    ring->base = base;
+    ring->size = size;
+    return OK;
+}
+
+void mring_destroy(MIRROR_RING *ring) {
+    if (ring->base != NULL) {
+        munmap(ring->base, 2 * ring->size);
+    }
+    *ring = MIRROR_RING_default;
+}
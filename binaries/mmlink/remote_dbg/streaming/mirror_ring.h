@@ -0,0 +1,88 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef STI_NOSYS_PROT_MIRROR_RING_H_INCLUDED
+#define STI_NOSYS_PROT_MIRROR_RING_H_INCLUDED
+
+#include <stddef.h>
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Byte ring whose backing pages are mapped twice, back to back, so that
+// any run of up to 'size' bytes starting at the read or write position is
+// contiguous in virtual memory.  Packets can therefore be received, parsed
+// and sent in place without splitting at the wrap point.
+//
+// 'head' and 'tail' are free running byte counts; the ring is used from a
+// single thread.
+typedef struct {
+    char *base;
+    size_t size;    // power of 2 and a multiple of the page size
+    size_t head;    // bytes produced
+    size_t tail;    // bytes consumed
+} MIRROR_RING;
+
+extern const MIRROR_RING MIRROR_RING_default;
+
+RETURN_CODE mring_init(MIRROR_RING *ring, size_t size);
+void mring_destroy(MIRROR_RING *ring);
+
+static inline void mring_reset(MIRROR_RING *ring) {
+    ring->head = ring->tail = 0;
+}
+
+static inline size_t mring_used(const MIRROR_RING *ring) {
+    return ring->head - ring->tail;
+}
+
+static inline size_t mring_space(const MIRROR_RING *ring) {
+    return ring->size - mring_used(ring);
+}
+
+static inline char *mring_read_ptr(const MIRROR_RING *ring) {
+    return ring->base + (ring->tail & (ring->size - 1));
+}
+
+static inline char *mring_write_ptr(const MIRROR_RING *ring) {
+    return ring->base + (ring->head & (ring->size - 1));
+}
+
+static inline void mring_produce(MIRROR_RING *ring, size_t len) {
+    ring->head += len;
+}
+
+static inline void mring_consume(MIRROR_RING *ring, size_t len) {
+    ring->tail += len;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //STI_NOSYS_PROT_MIRROR_RING_H_INCLUDED
@@ -64,6 +64,8 @@ const SERVER_CONN SERVER_CONN_default = {
     .buff = NULL,
     .h2t_waiting = 0,
     .mgmt_waiting = 0,
+    .h2t_ring = { NULL, 0, 0, 0 },
+    .t2h_ring = { NULL, 0, 0, 0 },
     .hw_callbacks = {
         .init_driver = NULL,
         .get_h2t_buffer = NULL,
@@ -103,6 +105,18 @@ const SERVER_HW_CALLBACKS SERVER_HW_CALLBACKS_default = {
 const SERVER_PKT_STATS SERVER_PKT_STATS_default = { 0, 0, 0, 0 };
 const CLIENT_CONN CLIENT_CONN_default = { INVALID_SOCKET, INVALID_SOCKET, INVALID_SOCKET, INVALID_SOCKET, INVALID_SOCKET };
 
+enum {
+    H2T_RING_SZ = 0x100000,
+    T2H_RING_SZ = 0x100000,
+    T2H_MAX_BATCH_PACKETS = 64
+};
+
+// Guardband + header as it appears on the H2T / T2H sockets
+#define SIZEOF_H2T_WIRE_HEADER (SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER)
+
+// Ring space needed to stage one T2H packet, including the 64-bit copy overrun
+#define T2H_MAX_STAGED_SZ (SIZEOF_H2T_WIRE_HEADER + USHRT_MAX + sizeof(uint64_t))
+
 // Global variables
 #if STI_NOSYS_PROT_PLATFORM==STI_PLATFORM_WINDOWS || STI_NOSYS_PROT_PLATFORM==STI_PLATFORM_NIOS_INICHE
 int sizeof_addr = -1;
@@ -233,6 +247,9 @@ RETURN_CODE connect_client(SERVER_CONN *server_conn, CLIENT_CONN *client_conn) {
     ssize_t bytes_transferred;
 
     server_conn->pkt_stats = SERVER_PKT_STATS_default;
+    server_conn->h2t_waiting = 0;
+    mring_reset(&server_conn->h2t_ring);
+    mring_reset(&server_conn->t2h_ring);
 
     // Initialize the driver if required.  Initialization occurs here since it is the first thing run per spec,
     // and the welcome message requires querying the driver for MGMT support.
@@ -486,68 +503,117 @@ unsigned long buff_len_to_wrap_boundary(char *buff_sa, size_t buff_sz, char *buf
     }
 }
 
-RETURN_CODE update_curr_h2t_header(CLIENT_CONN *client_conn, SERVER_CONN *server_conn) {
-    if (server_conn->h2t_waiting == 0) {
-        ssize_t bytes_recvd;
-        RETURN_CODE result = socket_recv_accumulate(client_conn->h2t_data_fd, server_conn->buff->h2t_header_buff, SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER, 0, &bytes_recvd);
-        if (result != OK) {
-            print_last_socket_error_b("Failed to recv H2T header", bytes_recvd, server_conn->hw_callbacks.server_printf);
-        }
-        return result;
+// The H2T / T2H data windows are device memory and are only accessed 64 bits at a time.
+// The host side may be unaligned and is read / written up to 7 bytes past 'len'.
+static void copy_to_mmio64(char *mmio, const char *src, size_t len) {
+    volatile uint64_t *mmio_ptr = (volatile uint64_t *)mmio;
+    size_t transfers = (len + 7) / 8;
+    for (size_t i = 0; i < transfers; ++i) {
+        uint64_t val;
+        memcpy(&val, src + (i * 8), sizeof(val));
+        *mmio_ptr++ = val;
     }
-    return OK;
 }
 
+static void copy_from_mmio64(char *dst, const char *mmio, size_t len) {
+    volatile const uint64_t *mmio_ptr = (volatile const uint64_t *)mmio;
+    size_t transfers = (len + 7) / 8;
+    for (size_t i = 0; i < transfers; ++i) {
+        uint64_t val = *mmio_ptr++;
+        memcpy(dst + (i * 8), &val, sizeof(val));
+    }
+}
+
+// Returns the on-the-wire size of the H2T packet at the front of the ring,
+// or 0 if its header hasn't been fully received yet.
+static size_t h2t_packet_len(const MIRROR_RING *ring) {
+    H2T_PACKET_HEADER header;
+    if (mring_used(ring) < SIZEOF_H2T_WIRE_HEADER) {
+        return 0;
+    }
+    memcpy(&header, mring_read_ptr(ring) + SIZEOF_PACKET_GUARDBAND, sizeof(header));
+    return SIZEOF_H2T_WIRE_HEADER + header.DATA_LEN_BYTES;
+}
+
+char h2t_packet_pending(SERVER_CONN *server_conn) {
+    size_t pkt_len = h2t_packet_len(&server_conn->h2t_ring);
+    return ((pkt_len != 0) && (mring_used(&server_conn->h2t_ring) >= pkt_len)) ? 1 : 0;
+}
+
+// Pulls everything the kernel has queued for the H2T socket into the ring with a single recv.
+RETURN_CODE recv_h2t_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn) {
+    MIRROR_RING *ring = &server_conn->h2t_ring;
+    size_t space = mring_space(ring);
+    if (space == 0) {
+        return OK;
+    }
+
+    ssize_t bytes_recvd = recv(client_conn->h2t_data_fd, mring_write_ptr(ring), space, MSG_DONTWAIT);
+    if (bytes_recvd > 0) {
+        mring_produce(ring, (size_t)bytes_recvd);
+        return OK;
+    }
+    if ((bytes_recvd < 0) && is_last_socket_error_would_block()) {
+        return OK;
+    }
+
+    print_last_socket_error_b("Failed to recv H2T data", bytes_recvd, server_conn->hw_callbacks.server_printf);
+    return FAILURE;
+}
+
+// Hands every complete packet in the H2T ring to the driver (or back to the client in loopback mode).
+// Stops early, leaving the packet in the ring, when the driver has no buffer for it yet.
 RETURN_CODE process_h2t_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn) {
-    ssize_t bytes_recvd;
+    MIRROR_RING *ring = &server_conn->h2t_ring;
+    H2T_PACKET_HEADER *header = (H2T_PACKET_HEADER *)(server_conn->buff->h2t_header_buff + SIZEOF_PACKET_GUARDBAND);
     RETURN_CODE has_error = OK;
+    size_t pkt_len;
 
-    if ((has_error = update_curr_h2t_header(client_conn, server_conn)) == OK) {
-        H2T_PACKET_HEADER *header = (H2T_PACKET_HEADER *)(server_conn->buff->h2t_header_buff + SIZEOF_PACKET_GUARDBAND);
+    USE_ARG_MACRO(client_conn);
+    server_conn->h2t_waiting = 0;
+
+    while ((has_error == OK) && ((pkt_len = h2t_packet_len(ring)) != 0) && (mring_used(ring) >= pkt_len)) {
+        const char *pkt = mring_read_ptr(ring);
+        const char *payload = pkt + SIZEOF_H2T_WIRE_HEADER;
+        memcpy(server_conn->buff->h2t_header_buff, pkt, SIZEOF_H2T_WIRE_HEADER);
         size_t bytes_to_transfer = header->DATA_LEN_BYTES;
 
+        // The loopback echo is staged in the T2H ring, it has to fit before the packet is taken
+        if ((server_conn->loopback_mode != 0) && (mring_space(&server_conn->t2h_ring) < pkt_len + sizeof(uint64_t))) {
+            server_conn->h2t_waiting = 1;
+            break;
+        }
+
         // Polls to see if there is room for the packet
         char *h2t_buff = ((server_conn->hw_callbacks.get_h2t_buffer != NULL) && (server_conn->loopback_mode == 0)) ? server_conn->hw_callbacks.get_h2t_buffer(bytes_to_transfer) : server_conn->buff->h2t_rx_buff;
+        if (h2t_buff == NULL) {
+            // Wait for buffer to be available!
+            server_conn->h2t_waiting = 1;
+            break;
+        }
 
-        // Recv H2T payload
-        if (h2t_buff != NULL) {
-            server_conn->pkt_stats.h2t_cnt++;
-            server_conn->h2t_waiting = 0;
-            size_t first_len;
-            if (server_conn->buff->use_wrapping_data_buffers && ((first_len = buff_len_to_wrap_boundary(server_conn->buff->h2t_rx_buff, server_conn->buff->h2t_rx_buff_sz, h2t_buff, header->DATA_LEN_BYTES)) != 0)) {
-                // Wrap, 2 recv necessary
-                size_t second_len = header->DATA_LEN_BYTES - first_len;
-                has_error = socket_recv_accumulate_h2t_data(client_conn->h2t_data_fd, h2t_buff, first_len, 0, &bytes_recvd);
-                if (has_error == OK) {
-                    has_error = socket_recv_accumulate_h2t_data(client_conn->h2t_data_fd, server_conn->buff->h2t_rx_buff, second_len, 0, &bytes_recvd);
-                }
-            } else {
-                // No wrap
-            	has_error = socket_recv_accumulate_h2t_data(client_conn->h2t_data_fd, h2t_buff, bytes_to_transfer, 0, &bytes_recvd);
-            }
+        server_conn->pkt_stats.h2t_cnt++;
+        size_t first_len;
+        if (server_conn->buff->use_wrapping_data_buffers && ((first_len = buff_len_to_wrap_boundary(server_conn->buff->h2t_rx_buff, server_conn->buff->h2t_rx_buff_sz, h2t_buff, bytes_to_transfer)) != 0)) {
+            // Wrap, the payload is split across the end and the start of the H2T window
+            copy_to_mmio64(h2t_buff, payload, first_len);
+            copy_to_mmio64(server_conn->buff->h2t_rx_buff, payload + first_len, bytes_to_transfer - first_len);
+        } else {
+            // No wrap
+            copy_to_mmio64(h2t_buff, payload, bytes_to_transfer);
+        }
+        mring_consume(ring, pkt_len);
 
-            // Push to driver or loopback
-            if (has_error == OK) {
-                if (server_conn->loopback_mode == 0) {
-                    // Normal operation, push the transaction to HW
-                    has_error = (server_conn->hw_callbacks.h2t_data_received != NULL) ? server_conn->hw_callbacks.h2t_data_received(header, (unsigned char *)h2t_buff) : OK;
-                } else {
-                    // Send the header
-                    if ((has_error = socket_send_all(client_conn->t2h_data_fd, server_conn->buff->h2t_header_buff, SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER, 0, &bytes_recvd)) == OK) {
-                        // Send the payload
-                        if ((has_error = socket_send_all_t2h_data(client_conn->t2h_data_fd, h2t_buff, bytes_to_transfer, 0, &bytes_recvd)) != OK) {
-                            print_last_socket_error_b("Failed to send loopback T2H data", bytes_recvd, server_conn->hw_callbacks.server_printf);
-                        }
-                    } else {
-                        print_last_socket_error_b("Failed to send loopback T2H header", bytes_recvd, server_conn->hw_callbacks.server_printf);
-                    }
-                }
-            } else {
-                print_last_socket_error_b("Failed to recv H2T data", bytes_recvd, server_conn->hw_callbacks.server_printf);
-            }
+        // Push to driver or loopback
+        if (server_conn->loopback_mode == 0) {
+            // Normal operation, push the transaction to HW
+            has_error = (server_conn->hw_callbacks.h2t_data_received != NULL) ? server_conn->hw_callbacks.h2t_data_received(header, (unsigned char *)h2t_buff) : OK;
         } else {
-            // Wait for buffer to be available!
-            server_conn->h2t_waiting = 1;
+            // Echo the header and the payload read back from the H2T window
+            char *echo = mring_write_ptr(&server_conn->t2h_ring);
+            memcpy(echo, server_conn->buff->h2t_header_buff, SIZEOF_H2T_WIRE_HEADER);
+            copy_from_mmio64(echo + SIZEOF_H2T_WIRE_HEADER, h2t_buff, bytes_to_transfer);
+            mring_produce(&server_conn->t2h_ring, pkt_len);
         }
     }
 
@@ -622,42 +688,65 @@ RETURN_CODE process_mgmt_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn
     return has_error;
 }
 
+// Gathers every T2H packet the driver has ready (bounded by the ring and batch size) into the
+// T2H ring, releasing each one back to the driver as soon as it is copied, then flushes the ring.
 RETURN_CODE process_t2h_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn) {
-    ssize_t bytes_sent;
-    RETURN_CODE has_error = OK;
-
+    MIRROR_RING *ring = &server_conn->t2h_ring;
     H2T_PACKET_HEADER *header = (H2T_PACKET_HEADER *)(server_conn->buff->t2h_header_buff + SIZEOF_PACKET_GUARDBAND);
     unsigned char *t2h_buff;
-    if ((has_error = (server_conn->hw_callbacks.acquire_t2h_data(header, &t2h_buff) == 0) ? OK : FAILURE) == OK) {
-        unsigned short curr_payload_bytes;
+
+    for (int pkts = 0; (pkts < T2H_MAX_BATCH_PACKETS) && (mring_space(ring) >= T2H_MAX_STAGED_SZ); ++pkts) {
+        if (server_conn->hw_callbacks.acquire_t2h_data(header, &t2h_buff) != 0) {
+            return FAILURE;
+        }
+        size_t curr_payload_bytes;
         if ((curr_payload_bytes = header->DATA_LEN_BYTES) == 0) {
-            return has_error;
+            break;
         }
         server_conn->pkt_stats.t2h_cnt++;
-        if ((has_error = socket_send_all(client_conn->t2h_data_fd, (const char *)server_conn->buff->t2h_header_buff, SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER, 0, &bytes_sent)) == OK) {
-            size_t first_len;
-            if (server_conn->buff->use_wrapping_data_buffers && ((first_len = buff_len_to_wrap_boundary(server_conn->buff->t2h_tx_buff, server_conn->buff->t2h_tx_buff_sz, (char *)t2h_buff, header->DATA_LEN_BYTES)) != 0)) {
-                // Wrap, 2 sends necessary
-            	size_t second_len = header->DATA_LEN_BYTES - first_len;
-            	if ((has_error = socket_send_all_t2h_data(client_conn->t2h_data_fd, (const char *)t2h_buff, first_len, 0, &bytes_sent)) == OK) {
-                    has_error = socket_send_all_t2h_data(client_conn->t2h_data_fd, (const char *)server_conn->buff->t2h_tx_buff, second_len, 0, &bytes_sent);
-            	}
-            } else {
-                // No wrap
-                has_error = socket_send_all_t2h_data(client_conn->t2h_data_fd, (const char *)t2h_buff, curr_payload_bytes, 0, &bytes_sent);
-            }
-            if (has_error == OK) {
-                if (server_conn->hw_callbacks.t2h_data_complete != NULL) {
-                    server_conn->hw_callbacks.t2h_data_complete();
-                }
-            }
+
+        char *dst = mring_write_ptr(ring);
+        memcpy(dst, server_conn->buff->t2h_header_buff, SIZEOF_H2T_WIRE_HEADER);
+        dst += SIZEOF_H2T_WIRE_HEADER;
+
+        size_t first_len;
+        if (server_conn->buff->use_wrapping_data_buffers && ((first_len = buff_len_to_wrap_boundary(server_conn->buff->t2h_tx_buff, server_conn->buff->t2h_tx_buff_sz, (char *)t2h_buff, curr_payload_bytes)) != 0)) {
+            // Wrap, the payload is split across the end and the start of the T2H window
+            copy_from_mmio64(dst, (const char *)t2h_buff, first_len);
+            copy_from_mmio64(dst + first_len, server_conn->buff->t2h_tx_buff, curr_payload_bytes - first_len);
+        } else {
+            // No wrap
+            copy_from_mmio64(dst, (const char *)t2h_buff, curr_payload_bytes);
         }
-        if (has_error != OK) {
-            print_last_socket_error_b("An error occurred sending T2H data", bytes_sent, server_conn->hw_callbacks.server_printf);
+        mring_produce(ring, SIZEOF_H2T_WIRE_HEADER + curr_payload_bytes);
+
+        if (server_conn->hw_callbacks.t2h_data_complete != NULL) {
+            server_conn->hw_callbacks.t2h_data_complete();
         }
     }
 
-    return has_error;
+    return flush_t2h_data(client_conn, server_conn);
+}
+
+// Sends as much of the T2H ring as the socket will take without blocking, in a single send.
+RETURN_CODE flush_t2h_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn) {
+    MIRROR_RING *ring = &server_conn->t2h_ring;
+    size_t used = mring_used(ring);
+    if (used == 0) {
+        return OK;
+    }
+
+    ssize_t bytes_sent = send(client_conn->t2h_data_fd, mring_read_ptr(ring), used, MSG_DONTWAIT);
+    if (bytes_sent > 0) {
+        mring_consume(ring, (size_t)bytes_sent);
+        return OK;
+    }
+    if ((bytes_sent < 0) && is_last_socket_error_would_block()) {
+        return OK;
+    }
+
+    print_last_socket_error_b("An error occurred sending T2H data", bytes_sent, server_conn->hw_callbacks.server_printf);
+    return FAILURE;
 }
 
 RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn) {
@@ -746,8 +835,11 @@ void handle_client(SERVER_CONN *server_conn, CLIENT_CONN *client_conn) {
         FD_ZERO(&write_fds);
         FD_ZERO(&except_fds);
         
-        // H2T, MGMT, and server listening socket are read-only
-        FD_SET(client_conn->h2t_data_fd, &read_fds);
+        // H2T, MGMT, and server listening socket are read-only.
+        // H2T is left alone while its ring is full so TCP flow control pushes back.
+        if (mring_space(&server_conn->h2t_ring) > 0) {
+            FD_SET(client_conn->h2t_data_fd, &read_fds);
+        }
         FD_SET(client_conn->mgmt_fd, &read_fds);
         FD_SET(server_conn->server_fd, &read_fds);
         
@@ -766,8 +858,9 @@ void handle_client(SERVER_CONN *server_conn, CLIENT_CONN *client_conn) {
         FD_SET(client_conn->h2t_data_fd, &except_fds);
         FD_SET(client_conn->t2h_data_fd, &except_fds);
         
+        // Don't sleep while a received H2T packet is waiting on a driver buffer
         struct timeval to;
-        to.tv_sec = 1;
+        to.tv_sec = h2t_packet_pending(server_conn) ? 0 : 1;
         to.tv_usec = 0;
         if (select((int)max_fd, &read_fds, &write_fds, &except_fds, &to) < 0) {
             print_last_socket_error("Select failure", server_conn->hw_callbacks.server_printf);
@@ -813,6 +906,11 @@ void handle_client(SERVER_CONN *server_conn, CLIENT_CONN *client_conn) {
 
         // Lastly handle incoming H2T data
         if (FD_ISSET(client_conn->h2t_data_fd, &read_fds)) {
+            if (recv_h2t_data(client_conn, server_conn) == FAILURE) {
+                break;
+            }
+        }
+        if (h2t_packet_pending(server_conn)) {
             if (process_h2t_data(client_conn, server_conn) == FAILURE) {
                 break;
             }
@@ -827,14 +925,17 @@ void handle_client(SERVER_CONN *server_conn, CLIENT_CONN *client_conn) {
                     }
                 }
             }
+        }
 
-            // See if any outbound t2h data is present, if so send it out
-            if (FD_ISSET(client_conn->t2h_data_fd, &write_fds)) {
-                if (server_conn->hw_callbacks.acquire_t2h_data != NULL) {
-                    if (process_t2h_data(client_conn, server_conn) == FAILURE) {
-                        break;
-                    }
+        // See if any outbound t2h data is present, if so send it out.
+        // In loopback mode the ring only holds H2T echoes.
+        if (FD_ISSET(client_conn->t2h_data_fd, &write_fds)) {
+            if ((server_conn->loopback_mode == 0) && (server_conn->hw_callbacks.acquire_t2h_data != NULL)) {
+                if (process_t2h_data(client_conn, server_conn) == FAILURE) {
+                    break;
                 }
+            } else if (flush_t2h_data(client_conn, server_conn) == FAILURE) {
+                break;
             }
         }
     }
@@ -849,6 +950,13 @@ RETURN_CODE initialize_server(unsigned short port, SERVER_CONN *server_conn, con
     populate_guardband((unsigned char *)server_conn->buff->mgmt_rsp_header_buff);
     populate_guardband((unsigned char *)server_conn->buff->t2h_header_buff);
 
+    if ((mring_init(&server_conn->h2t_ring, H2T_RING_SZ) != OK) || (mring_init(&server_conn->t2h_ring, T2H_RING_SZ) != OK)) {
+        server_conn->hw_callbacks.server_printf("Failed to allocate the H2T / T2H staging rings!\n");
+        mring_destroy(&server_conn->h2t_ring);
+        mring_destroy(&server_conn->t2h_ring);
+        return FAILURE;
+    }
+
     server_conn->server_addr.sin_family = AF_INET;
     server_conn->server_addr.sin_addr.s_addr = INADDR_ANY;
     server_conn->server_addr.sin_port = htons(port);
@@ -856,6 +964,8 @@ RETURN_CODE initialize_server(unsigned short port, SERVER_CONN *server_conn, con
 
     if (bind_server_socket(server_conn) != OK) {
         server_conn->hw_callbacks.server_printf("Failed to bind server socket!\n");
+        mring_destroy(&server_conn->h2t_ring);
+        mring_destroy(&server_conn->t2h_ring);
         return FAILURE;
     }
 
@@ -914,4 +1024,7 @@ void server_main(SERVER_LIFESPAN lifespan, SERVER_CONN *server_conn) {
 	    server_conn->hw_callbacks.server_printf("Error closing server socket.\n");
     else
         server_conn->server_fd = INVALID_SOCKET;
+
+    mring_destroy(&server_conn->h2t_ring);
+    mring_destroy(&server_conn->t2h_ring);
 }
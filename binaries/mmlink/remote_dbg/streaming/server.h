@@ -29,6 +29,7 @@
 #include "sockets.h"
 #include "packet.h"
 #include "platform.h"
+#include "mirror_ring.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -137,6 +138,11 @@ typedef struct {
     char h2t_waiting;
     char mgmt_waiting;
 
+    // Host staging for the H2T / T2H data sockets.  H2T bytes are received in
+    // bulk and parsed in place; T2H packets are gathered and sent in bulk.
+    MIRROR_RING h2t_ring;
+    MIRROR_RING t2h_ring;
+
     // Callbacks
     SERVER_HW_CALLBACKS hw_callbacks;
     char loopback_mode; // 1 enabled, 0 disabled (default)
@@ -182,11 +188,13 @@ const char *get_driver_parameter(char *cmd, SERVER_CONN *server_conn);
 const char *set_driver_parameter(char *cmd, SERVER_CONN *server_conn);
 RETURN_CODE process_control_message(CLIENT_CONN *client_conn, SERVER_CONN *server_conn, char *disconnect_client);
 unsigned long buff_len_to_wrap_boundary(char *buff_sa, size_t buff_sz, char *buff, size_t payload_sz);
-RETURN_CODE update_curr_h2t_header(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
+RETURN_CODE recv_h2t_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
 RETURN_CODE process_h2t_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
+char h2t_packet_pending(SERVER_CONN *server_conn);
 RETURN_CODE update_curr_mgmt_header(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
 RETURN_CODE process_mgmt_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
 RETURN_CODE process_t2h_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
+RETURN_CODE flush_t2h_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
 RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN *client_conn, SERVER_CONN *server_conn);
 
 // Misc helper
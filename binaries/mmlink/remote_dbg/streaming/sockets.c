@@ -35,10 +35,6 @@
 
 const struct timeval ZERO_TIMEOUT = { 0, 0 };
 
-enum { SW_SOCKET_BUFF_SZ = 0x1000 };
-static char g_socket_recv_buff[SW_SOCKET_BUFF_SZ+64];
-static char g_socket_send_buff[SW_SOCKET_BUFF_SZ+64];
-
 SOCKET max_of(SOCKET *array, int size) {
     SOCKET result = 0;
     for (int i = 0; i < size; ++i) {
@@ -135,21 +131,6 @@ RETURN_CODE socket_send_all(SOCKET fd, const char *buff, const size_t len, int f
     return OK;
 }
 
-
-RETURN_CODE socket_send_all_t2h_data(SOCKET fd, const char *buff, const size_t len, int flags, ssize_t *bytes_sent) {
-    // First copy the mmio ptr into local memory domain
-    volatile uint64_t *mmio_ptr = (uint64_t *)buff;
-    uint64_t *buff64 = (uint64_t *)g_socket_send_buff;
-    size_t transfers = (len + 7) / 8;
-    for (size_t i = 0; i < transfers; ++i) {
-        *buff64++ = *mmio_ptr++;      
-    }
-    
-    RETURN_CODE ret = socket_send_all(fd, g_socket_send_buff, len, flags, bytes_sent);
-
-    return ret;
-}
-
 RETURN_CODE socket_recv_until_null_reached(SOCKET sock_fd, char *buff, const size_t max_len, int flags, ssize_t *bytes_recvd) {
     ssize_t curr_bytes_recvd;
     size_t bytes_remaining = max_len;
@@ -202,23 +183,6 @@ RETURN_CODE socket_recv_accumulate(SOCKET sock_fd, char *buff, const size_t len,
     return OK;
 }
 
-
-RETURN_CODE socket_recv_accumulate_h2t_data(SOCKET sock_fd, char *buff, const size_t len, int flags, ssize_t *bytes_recvd) {
-    RETURN_CODE rc = socket_recv_accumulate(sock_fd, g_socket_recv_buff, len, flags, bytes_recvd);
-    
-    if (rc != FAILURE) {
-        // Copy the local memory ptr into the mmio domain
-        volatile uint64_t *mmio_ptr = (uint64_t *)buff;
-        uint64_t *buff64 = (uint64_t *)g_socket_recv_buff;
-        size_t transfers = (len +7) / 8;
-        for (size_t i = 0; i < transfers; ++i) {
-            *mmio_ptr++ = *buff64++;
-        }
-    }
-    
-    return OK;
-}
-
 RETURN_CODE initialize_sockets_library() {
 #if STI_NOSYS_PROT_PLATFORM==STI_PLATFORM_WINDOWS
     WORD wVersionRequested;
@@ -80,10 +80,8 @@ SOCKET max_of(SOCKET *array, int size);
 RETURN_CODE connect_with_timeout(SOCKET fd, const struct sockaddr *serv_addr, const struct timeval timeout);
 #endif
 RETURN_CODE socket_send_all(SOCKET fd, const char *buff, const size_t len, int flags, ssize_t *bytes_sent);
-RETURN_CODE socket_send_all_t2h_data(SOCKET fd, const char *buff, const size_t len, int flags, ssize_t *bytes_sent);
 RETURN_CODE socket_recv_until_null_reached(SOCKET sock_fd, char *buff, const size_t max_len, int flags, ssize_t *bytes_recvd);
 RETURN_CODE socket_recv_accumulate(SOCKET sock_fd, char *buff, const size_t len, int flags, ssize_t *bytes_recvd);
-RETURN_CODE socket_recv_accumulate_h2t_data(SOCKET sock_fd, char *buff, const size_t len, int flags, ssize_t *bytes_recvd);
 RETURN_CODE initialize_sockets_library();
 int set_boolean_socket_option(SOCKET socket_fd, int option, int option_val);
 int set_tcp_no_delay(SOCKET socket_fd, int no_delay);
@@ -26,6 +26,8 @@
 
 #pragma once
 
+#include <cstring>
+#include <stdexcept>
 #include <opae/vfio.h>
 
 
@@ -67,6 +69,64 @@ struct mmio_region {
   {
     *reinterpret_cast<uint64_t *>(ptr + offset) = value;
   }
+
+  // Bulk transfers between the region and host memory. The region is
+  // only accessed with naturally aligned 32/64-bit loads and stores, so
+  // offset and len must be multiples of 4. The host side may be unaligned.
+  void read_block(uint64_t offset, void *dst, size_t len) const
+  {
+    check_block(offset, len);
+    const volatile uint8_t *src = ptr + offset;
+    uint8_t *d = reinterpret_cast<uint8_t *>(dst);
+
+    if ((offset % sizeof(uint64_t)) && len) {
+      uint32_t v = *reinterpret_cast<const volatile uint32_t *>(src);
+      std::memcpy(d, &v, sizeof(v));
+      src += sizeof(v); d += sizeof(v); len -= sizeof(v);
+    }
+    while (len >= sizeof(uint64_t)) {
+      uint64_t v = *reinterpret_cast<const volatile uint64_t *>(src);
+      std::memcpy(d, &v, sizeof(v));
+      src += sizeof(v); d += sizeof(v); len -= sizeof(v);
+    }
+    if (len) {
+      uint32_t v = *reinterpret_cast<const volatile uint32_t *>(src);
+      std::memcpy(d, &v, sizeof(v));
+    }
+  }
+
+  void write_block(uint64_t offset, const void *src, size_t len)
+  {
+    check_block(offset, len);
+    volatile uint8_t *dst = ptr + offset;
+    const uint8_t *s = reinterpret_cast<const uint8_t *>(src);
+
+    if ((offset % sizeof(uint64_t)) && len) {
+      uint32_t v;
+      std::memcpy(&v, s, sizeof(v));
+      *reinterpret_cast<volatile uint32_t *>(dst) = v;
+      dst += sizeof(v); s += sizeof(v); len -= sizeof(v);
+    }
+    while (len >= sizeof(uint64_t)) {
+      uint64_t v;
+      std::memcpy(&v, s, sizeof(v));
+      *reinterpret_cast<volatile uint64_t *>(dst) = v;
+      dst += sizeof(v); s += sizeof(v); len -= sizeof(v);
+    }
+    if (len) {
+      uint32_t v;
+      std::memcpy(&v, s, sizeof(v));
+      *reinterpret_cast<volatile uint32_t *>(dst) = v;
+    }
+  }
+
+  void check_block(uint64_t offset, size_t len) const
+  {
+    if ((offset % sizeof(uint32_t)) || (len % sizeof(uint32_t)))
+      throw std::invalid_argument("block offset and length must be multiples of 4");
+    if ((offset > size) || (len > size - offset))
+      throw std::out_of_range("block exceeds region");
+  }
 };
 
 struct system_buffer {
@@ -34,6 +34,48 @@
 
 namespace py = pybind11;
 
+// Returns the length in bytes of a C-contiguous Python buffer.
+static size_t contiguous_size(const py::buffer_info &info)
+{
+  py::ssize_t stride = info.itemsize;
+  for (py::ssize_t i = info.ndim - 1 ; i >= 0 ; --i) {
+    if (info.shape[i] > 1 && info.strides[i] != stride)
+      throw std::invalid_argument("buffer must be C-contiguous");
+    stride *= info.shape[i];
+  }
+  return static_cast<size_t>(info.size * info.itemsize);
+}
+
+static py::bytes region_read_bytes(mmio_region *r, uint64_t offset, size_t size)
+{
+  r->check_block(offset, size);
+  auto out = py::reinterpret_steal<py::bytes>(
+    PyBytes_FromStringAndSize(nullptr, static_cast<py::ssize_t>(size)));
+  if (!out)
+    throw py::error_already_set();
+  char *dst = PyBytes_AS_STRING(out.ptr());
+  {
+    py::gil_scoped_release release;
+    r->read_block(offset, dst, size);
+  }
+  return out;
+}
+
+static void region_read_into(mmio_region *r, uint64_t offset, py::buffer buf)
+{
+  py::buffer_info info = buf.request(true);
+  size_t size = contiguous_size(info);
+  py::gil_scoped_release release;
+  r->read_block(offset, info.ptr, size);
+}
+
+static void region_write_block(mmio_region *r, uint64_t offset, py::buffer buf)
+{
+  py::buffer_info info = buf.request();
+  size_t size = contiguous_size(info);
+  py::gil_scoped_release release;
+  r->write_block(offset, info.ptr, size);
+}
 
 #ifdef LIBVFIO_EMBED
 #include <pybind11/embed.h>
@@ -65,11 +107,20 @@ PYBIND11_MODULE(libvfio, m)
           .def("write64", &mmio_region::write64)
           .def("read32", &mmio_region::read32)
           .def("read64", &mmio_region::read64)
+          .def("read_block", &region_read_into,
+               "Fill a writable buffer from the region at offset",
+               py::arg("offset"), py::arg("buffer"))
+          .def("read_block", &region_read_bytes,
+               "Read size bytes from the region at offset",
+               py::arg("offset"), py::arg("size"))
+          .def("write_block", &region_write_block,
+               "Write the contents of a buffer to the region at offset",
+               py::arg("offset"), py::arg("buffer"))
           .def("index", [](mmio_region *r) { return r->index; })
           .def("__repr__", [](mmio_region *r) { return std::to_string(r->index); })
           .def("__len__", [](mmio_region *r) { return r->size; });
 
-  py::class_<system_buffer> pybuffer(m, "system_buffer", "");
+  py::class_<system_buffer> pybuffer(m, "system_buffer", py::buffer_protocol(), "");
   pybuffer.def_property_readonly("size", [](system_buffer *b) -> size_t { return b->size; })
           .def_property_readonly("address", [](system_buffer *b) -> uint64_t { return reinterpret_cast<uint64_t>(b->buf); })
           .def_property_readonly("io_address", [](system_buffer *b) -> uint64_t { return b->iova; })
@@ -79,11 +130,21 @@ PYBIND11_MODULE(libvfio, m)
           .def("read16", &system_buffer::get<uint16_t>)
           .def("read32", &system_buffer::get<uint32_t>)
           .def("read64", &system_buffer::get<uint64_t>)
-          .def("fill8", &system_buffer::fill<uint8_t>)
-          .def("fill16", &system_buffer::fill<uint16_t>)
-          .def("fill32", &system_buffer::fill<uint32_t>)
-          .def("fill64", &system_buffer::fill<uint64_t>)
-          .def("compare", &system_buffer::compare)
+          .def("fill8", &system_buffer::fill<uint8_t>,
+               py::call_guard<py::gil_scoped_release>())
+          .def("fill16", &system_buffer::fill<uint16_t>,
+               py::call_guard<py::gil_scoped_release>())
+          .def("fill32", &system_buffer::fill<uint32_t>,
+               py::call_guard<py::gil_scoped_release>())
+          .def("fill64", &system_buffer::fill<uint64_t>,
+               py::call_guard<py::gil_scoped_release>())
+          .def("compare", &system_buffer::compare,
+               py::call_guard<py::gil_scoped_release>())
+          .def_buffer([](system_buffer &b) -> py::buffer_info {
+             return py::buffer_info(b.buf, sizeof(uint8_t),
+                                    py::format_descriptor<uint8_t>::format(),
+                                    static_cast<py::ssize_t>(b.size));
+          })
           .def("__repr__", [](system_buffer *b) -> std::string {
              std::ostringstream oss;
              oss << "size: " << b->size
@@ -53,8 +53,8 @@ struct option longopts[] = {
 
 // User clock Command line struct
 struct UserClkCommandLine {
-	int      freq_high;
-	int      freq_low;
+	double   freq_high;
+	double   freq_low;
 };
 
 struct UserClkCommandLine userclkCmdLine = { -1, -1 };
@@ -69,8 +69,8 @@ void UserClkAppShowHelp(void)
 	printf("Usage:\n");
 	printf("        userclk [PCI_ADDR] [-H HIGH] [-L LOW]\n");
 	printf("\n");
-	printf("                -H,--freq-high      Set user clock high frequency\n"
-	       "                -L,--freq-low       Set user clock low frequency\n"
+	printf("                -H,--freq-high      Set user clock high frequency (MHz)\n"
+	       "                -L,--freq-low       Set user clock low frequency (MHz)\n"
 	       "                -S,--segment        Set target segment number\n"
 	       "                -B,--bus            Set target bus number\n"
 	       "                -D,--device         Set target device number\n"
@@ -107,8 +107,8 @@ int main(int argc, char *argv[])
 	uint64_t userclk_high	= 0;
 	uint64_t userclk_low	= 0;
 	fpga_token accel_token	= NULL;
-	int high		= 0;
-	int low			= 0;
+	double high		= 0;
+	double low		= 0;
 	fpga_handle accelerator_handle;
 
 	// Parse command line
@@ -139,8 +139,8 @@ int main(int argc, char *argv[])
 
 	printf(" ------- Command line Input START ----\n \n");
 
-	printf(" Freq High             : %d\n", userclkCmdLine.freq_high);
-	printf(" Freq Low              : %d\n", userclkCmdLine.freq_low);
+	printf(" Freq High             : %g\n", userclkCmdLine.freq_high);
+	printf(" Freq Low              : %g\n", userclkCmdLine.freq_low);
 
 	printf(" ------- Command line Input END   ----\n\n");
 
@@ -183,13 +183,17 @@ int main(int argc, char *argv[])
 			low = userclkCmdLine.freq_high / 2;
 		} else if (high <= 0) {
 			high = userclkCmdLine.freq_low * 2;
-		} else if ((abs(high - (2 * low))) > 1) {
+		} else if ((high - (2 * low)) > 1 || (high - (2 * low)) < -1) {
 			res = FPGA_INVALID_PARAM;
 			OPAE_ERR("High freq must be ~ (2 * Low freq)");
 			goto out_close;
 		}
 
-		res = fpgaSetUserClock(accelerator_handle, high, low, 0);
+		// Pass kHz so that fractional MHz requests are honored.
+		res = fpgaSetUserClock(accelerator_handle,
+				       (uint64_t)(high * 1000 + 0.5),
+				       (uint64_t)(low * 1000 + 0.5),
+				       FPGA_USERCLK_KHZ);
 		ON_ERR_GOTO(res, out_close, "Failed to set user clock");
 
 		res = fpgaGetUserClock(accelerator_handle, &userclk_high, &userclk_low, 0);
@@ -254,7 +258,7 @@ int ParseCmds(struct UserClkCommandLine *userclkCmdLine, int argc, char *argv[])
 			if (!tmp_optarg)
 				return -1;
 			endptr = NULL;
-			userclkCmdLine->freq_high = strtol(tmp_optarg, &endptr, 0);
+			userclkCmdLine->freq_high = strtod(tmp_optarg, &endptr);
 			break;
 
 		case 'L':
@@ -262,7 +266,7 @@ int ParseCmds(struct UserClkCommandLine *userclkCmdLine, int argc, char *argv[])
 			if (!tmp_optarg)
 				return -1;
 			endptr = NULL;
-			userclkCmdLine->freq_low = strtol(tmp_optarg, &endptr, 0);
+			userclkCmdLine->freq_low = strtod(tmp_optarg, &endptr);
 			break;
 
 		case 'v':
@@ -27,6 +27,7 @@
 #define OFS_PRIMITIVES_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include <time.h>
 
 #define SEC2NSEC 1000000000
@@ -44,52 +45,168 @@
     .tv_nsec = _usec*USEC2NSEC-(long)(_usec*USEC2SEC)*SEC2NSEC  \
   }
 
-#define OFS_WAIT_FOR_EQ(_bit, _value, _timeout_usec, _sleep_usec)           \
+/**
+ * Per call site wait statistics.
+ *
+ * Every OFS_WAIT_FOR_* expansion owns one of these. When statistics
+ * are enabled (see ofs_wait_stats_enable() and the LIBOFS_WAIT_STATS
+ * environment variable), each completed wait is accounted to its
+ * site, and the site is linked into a global list on first use.
+ */
+typedef struct _ofs_wait_stats {
+	const char *func;		/**< function containing the wait */
+	const char *file;		/**< source file of the wait */
+	int line;			/**< source line of the wait */
+	int registered;			/**< site is linked into the list */
+	uint64_t calls;			/**< completed waits */
+	uint64_t timeouts;		/**< waits that timed out */
+	uint64_t spins;			/**< pause iterations */
+	uint64_t sleeps;		/**< backoff sleeps */
+	uint64_t events;		/**< eventfd wakeups */
+	uint64_t total_nsec;		/**< cumulative time waiting */
+	uint64_t max_nsec;		/**< longest single wait */
+	struct _ofs_wait_stats *next;	/**< next registered site */
+} ofs_wait_stats;
+
+#define OFS_WAIT_STATS_INITIALIZER \
+{ __func__, __FILE__, __LINE__, 0, 0, 0, 0, 0, 0, 0, 0, NULL }
+
+/**
+ * State of one in-progress wait.
+ *
+ * A wait first spins with a CPU relax hint for a short window
+ * (calibrated to the cost of an OS sleep), then backs off
+ * exponentially from 1 usec up to the caller's sleep time. If an
+ * event file descriptor is given, the backoff blocks on it instead
+ * of sleeping, so an interrupt ends the wait early. Deadlines are
+ * kept in ofs_ticks() units.
+ */
+typedef struct _ofs_waiter {
+	uint64_t begin;
+	uint64_t spin_until;
+	uint64_t deadline;
+	uint64_t sleep_nsec;
+	uint64_t max_sleep_nsec;
+	int event_fd;
+	int status;
+	uint32_t spins;
+	uint32_t sleeps;
+	uint32_t events;
+} ofs_waiter;
+
+#define OFS_WAIT_FOR(_cond, _timeout_usec, _sleep_usec, _event_fd)         \
 ({                                                                          \
-	int _status = 0;                                                    \
-	OFS_TIMESPEC_USEC(ts, _sleep_usec);                                 \
-	struct timespec begin, now;                                         \
-	clock_gettime(CLOCK_MONOTONIC, &begin);                             \
-	while(_bit != _value) {                                             \
-		if (_sleep_usec)                                            \
-			nanosleep(&ts, NULL);                               \
-		clock_gettime(CLOCK_MONOTONIC, &now);                       \
-		struct timespec delta;                                      \
-		ofs_diff_timespec(&delta, &now, &begin);                    \
-		uint64_t delta_nsec = delta.tv_nsec + delta.tv_sec*SEC2NSEC;\
-		if (delta_nsec > _timeout_usec*USEC2NSEC) {                 \
-			_status = 1;                                        \
-			break;                                              \
-		}                                                           \
-	}                                                                   \
-        _status;                                                            \
-})                                                                          \
+	static ofs_wait_stats _ofs_site = OFS_WAIT_STATS_INITIALIZER;       \
+	ofs_waiter _ofs_w;                                                  \
+	ofs_wait_begin(&_ofs_w, _timeout_usec, _sleep_usec, _event_fd);     \
+	while (!(_cond) && !ofs_wait_step(&_ofs_w))                         \
+		;                                                           \
+	ofs_wait_end(&_ofs_w, &_ofs_site);                                  \
+})
+
+#define OFS_WAIT_FOR_EQ(_bit, _value, _timeout_usec, _sleep_usec)           \
+	OFS_WAIT_FOR((_bit) == (_value), _timeout_usec, _sleep_usec, -1)
 
 #define OFS_WAIT_FOR_NE(_bit, _value, _timeout_usec, _sleep_usec)           \
-({                                                                          \
-	int _status = 0;                                                    \
-	OFS_TIMESPEC_USEC(ts, _sleep_usec);                                 \
-	struct timespec begin, now;                                         \
-	clock_gettime(CLOCK_MONOTONIC, &begin);                             \
-	while(_bit == _value) {                                             \
-		if (_sleep_usec)                                            \
-			nanosleep(&ts, NULL);                               \
-		clock_gettime(CLOCK_MONOTONIC, &now);                       \
-		struct timespec delta;                                      \
-		ofs_diff_timespec(&delta, &now, &begin);                    \
-		uint64_t delta_nsec = delta.tv_nsec + delta.tv_sec*SEC2NSEC;\
-		if (delta_nsec > _timeout_usec*USEC2NSEC) {                 \
-			_status = 1;                                        \
-			break;                                              \
-		}                                                           \
-	}                                                                   \
-        _status;                                                            \
-})                                                                          \
+	OFS_WAIT_FOR((_bit) != (_value), _timeout_usec, _sleep_usec, -1)
+
+#define OFS_WAIT_FOR_EQ_FD(_bit, _value, _timeout_usec, _sleep_usec, _fd)   \
+	OFS_WAIT_FOR((_bit) == (_value), _timeout_usec, _sleep_usec, _fd)
+
+#define OFS_WAIT_FOR_NE_FD(_bit, _value, _timeout_usec, _sleep_usec, _fd)   \
+	OFS_WAIT_FOR((_bit) != (_value), _timeout_usec, _sleep_usec, _fd)
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ *  Read the wait time base
+ *
+ *  Returns the invariant TSC where one is available, and
+ *  CLOCK_MONOTONIC nanoseconds otherwise.
+ *
+ *  @returns the current tick count
+ */
+uint64_t ofs_ticks(void);
+
+/**
+ *  Convert between ofs_ticks() units and time
+ *
+ *  @param[in] usec Microseconds to convert
+ *  @returns the number of ticks in usec microseconds
+ */
+uint64_t ofs_usec_to_ticks(uint64_t usec);
+
+/**
+ *  @param[in] ticks Ticks to convert
+ *  @returns the number of nanoseconds in ticks
+ */
+uint64_t ofs_ticks_to_nsec(uint64_t ticks);
+
+/**
+ *  Start a wait
+ *
+ *  @param[out] w           Wait state to initialize
+ *  @param[in] timeout_usec Timeout value in usec
+ *  @param[in] sleep_usec   Longest time (in usec) to sleep between polls,
+ *                          0 to spin for the whole wait
+ *  @param[in] event_fd     File descriptor (e.g. an eventfd) that becomes
+ *                          readable when the condition may have changed,
+ *                          or -1
+ */
+void ofs_wait_begin(ofs_waiter *w, uint64_t timeout_usec,
+		    uint32_t sleep_usec, int event_fd);
+
+/**
+ *  Back off once between two polls of the wait condition
+ *
+ *  @param[in] w Wait state
+ *  @returns 1 if the wait has timed out, 0 otherwise
+ */
+int ofs_wait_step(ofs_waiter *w);
+
+/**
+ *  Finish a wait, accounting it to site if statistics are enabled
+ *
+ *  @param[in] w    Wait state
+ *  @param[in] site Statistics for the waiting call site, may be NULL
+ *  @returns 1 if the wait timed out, 0 otherwise
+ */
+int ofs_wait_end(ofs_waiter *w, ofs_wait_stats *site);
+
+/**
+ *  Enable or disable wait statistics
+ *
+ *  Statistics are disabled by default, unless the LIBOFS_WAIT_STATS
+ *  environment variable is set, in which case they are printed to
+ *  stderr at exit.
+ *
+ *  @param[in] enable non-zero to start recording
+ */
+void ofs_wait_stats_enable(int enable);
+
+/**
+ *  Iterate the call sites that have recorded wait statistics
+ *
+ *  @param[in] cb      Called once for each site
+ *  @param[in] context Passed to cb
+ */
+void ofs_wait_stats_foreach(void (*cb)(const ofs_wait_stats *, void *),
+			    void *context);
+
+/**
+ *  Zero the counters of all registered call sites
+ */
+void ofs_wait_stats_reset(void);
+
+/**
+ *  Print the statistics of all registered call sites
+ *
+ *  @param[in] fp Stream to print to
+ */
+void ofs_wait_stats_print(FILE *fp);
+
 /**
  *  Get timespec difference
  *
@@ -141,27 +258,17 @@ inline int ofs_diff_timespec(struct timespec *result,
  *  @param[in] var          Pointer to a variable that may change
  *  @param[in] value        Value to compare to var
  *  @param[in] timeout_usec Timeout value in usec
- *  @param[in] sleep_usec   Time (in usec) to sleep while waiting
+ *  @param[in] sleep_usec   Longest time (in usec) to sleep while waiting
  *  @returns 0 if variable changed to value while waiting, 1 otherwise
  */
 inline int ofs_wait_for_eq32(uint32_t *var, uint32_t value,
 			     uint64_t timeout_usec, uint32_t sleep_usec)
 {
-	OFS_TIMESPEC_USEC(ts, sleep_usec);
-	struct timespec begin, now;
-	clock_gettime(CLOCK_MONOTONIC, &begin);
-	while(*var != value) {
-		if (sleep_usec)
-			nanosleep(&ts, NULL);
-		clock_gettime(CLOCK_MONOTONIC, &now);
-		struct timespec delta;
-		ofs_diff_timespec(&delta, &now, &begin);
-  		uint64_t delta_nsec = delta.tv_nsec + delta.tv_sec*SEC2NSEC;
-		if (delta_nsec > timeout_usec*USEC2NSEC) {
-			return 1;
-		}
-	}
-	return 0;
+	ofs_waiter w;
+	ofs_wait_begin(&w, timeout_usec, sleep_usec, -1);
+	while (*(volatile uint32_t *)var != value && !ofs_wait_step(&w))
+		;
+	return ofs_wait_end(&w, NULL);
 }
 
 /**
@@ -174,27 +281,17 @@ inline int ofs_wait_for_eq32(uint32_t *var, uint32_t value,
  *  @param[in] var          Pointer to a variable that may change
  *  @param[in] value        Value to compare to var
  *  @param[in] timeout_usec Timeout value in usec
- *  @param[in] sleep_usec   Time (in usec) to sleep while waiting
+ *  @param[in] sleep_usec   Longest time (in usec) to sleep while waiting
  *  @returns 0 if variable changed to value while waiting, 1 otherwise
  */
 inline int ofs_wait_for_eq64(uint64_t *var, uint64_t value,
 			     uint64_t timeout_usec, uint32_t sleep_usec)
 {
-	OFS_TIMESPEC_USEC(ts, sleep_usec);
-	struct timespec begin, now;
-	clock_gettime(CLOCK_MONOTONIC, &begin);
-	while(*var != value) {
-		if (sleep_usec)
-			nanosleep(&ts, NULL);
-		clock_gettime(CLOCK_MONOTONIC, &now);
-		struct timespec delta;
-		ofs_diff_timespec(&delta, &now, &begin);
-  		uint64_t delta_nsec = delta.tv_nsec + delta.tv_sec*SEC2NSEC;
-		if (delta_nsec > timeout_usec*USEC2NSEC) {
-			return 1;
-		}
-	}
-	return 0;
+	ofs_waiter w;
+	ofs_wait_begin(&w, timeout_usec, sleep_usec, -1);
+	while (*(volatile uint64_t *)var != value && !ofs_wait_step(&w))
+		;
+	return ofs_wait_end(&w, NULL);
 }
 
 #ifdef __cplusplus
@@ -24,10 +24,12 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 #pragma once
+#include <opae/cxx/core/buffer_pool.h>
 #include <opae/cxx/core/errors.h>
 #include <opae/cxx/core/events.h>
 #include <opae/cxx/core/except.h>
 #include <opae/cxx/core/handle.h>
+#include <opae/cxx/core/mmio.h>
 #include <opae/cxx/core/properties.h>
 #include <opae/cxx/core/pvalue.h>
 #include <opae/cxx/core/shared_buffer.h>
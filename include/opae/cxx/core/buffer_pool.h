@@ -0,0 +1,140 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+#include <opae/cxx/core/handle.h>
+#include <opae/cxx/core/shared_buffer.h>
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace opae {
+namespace fpga {
+namespace types {
+
+/** A pool of pinned, recyclable shared buffers
+ *
+ * Preparing a shared buffer pins and maps its pages for device
+ * access, which is expensive compared to the work done on many
+ * buffers. A buffer_pool keeps buffers that are no longer in use and
+ * hands them out again, so that loops which allocate the same sizes
+ * over and over pin memory only once.
+ *
+ * Requests are rounded up to a power-of-two size class of at least
+ * one page. acquire() returns a lease: an ordinary shared_buffer::ptr_t
+ * whose size() is the requested length. When the last reference to the
+ * lease is dropped, the buffer goes back to its size class instead of
+ * being released. Buffers still leased when the pool is destroyed are
+ * released normally when they're dropped.
+ */
+class buffer_pool : public std::enable_shared_from_this<buffer_pool> {
+ public:
+  typedef std::shared_ptr<buffer_pool> ptr_t;
+
+  buffer_pool(const buffer_pool &) = delete;
+  buffer_pool &operator=(const buffer_pool &) = delete;
+
+  virtual ~buffer_pool();
+
+  /** Create a buffer pool.
+   *
+   * @param[in] handle The handle that buffers are prepared on.
+   * @param[in] read_only Whether buffers are read-only to the device.
+   * @param[in] max_idle The maximum number of idle buffers kept per
+   *                     size class. 0 means no limit.
+   *
+   * @throws std::invalid_argument if handle is null.
+   */
+  static buffer_pool::ptr_t create(handle::ptr_t handle,
+                                   bool read_only = false,
+                                   size_t max_idle = 0);
+
+  /** Lease a buffer of at least len bytes.
+   *
+   * A recycled buffer is cleared, so that a lease starts zero-filled
+   * like a newly allocated buffer, unless zero is false.
+   *
+   * @param[in] len The number of bytes needed.
+   * @param[in] zero Whether to clear a recycled buffer.
+   *
+   * @return A shared_buffer of size len.
+   */
+  shared_buffer::ptr_t acquire(size_t len, bool zero = true);
+
+  /** Prepare count idle buffers for the size class of len.
+   *
+   * count is limited to the pool's max_idle, when it has one.
+   *
+   * @return The number of idle buffers in the size class.
+   */
+  size_t reserve(size_t len, size_t count);
+
+  /** As reserve(), but prepares the buffers on a background
+   * thread, so that the caller can continue while a large pool
+   * is pinned and prefaulted.
+   */
+  std::future<size_t> reserve_async(size_t len, size_t count);
+
+  /** Release all idle buffers.
+   */
+  void trim();
+
+  /** The number of idle buffers held by the pool.
+   */
+  size_t idle() const;
+
+  /** The size class that a request for len bytes is served from.
+   */
+  static size_t size_class(size_t len);
+
+  /** Retrieve the handle that buffers are prepared on.
+   */
+  handle::ptr_t owner() const { return handle_; }
+
+ protected:
+  buffer_pool(handle::ptr_t handle, bool read_only, size_t max_idle);
+
+ private:
+  typedef std::unique_ptr<shared_buffer> buffer_t;
+
+  buffer_t take(size_t cls);
+  buffer_t prepare(size_t cls);
+  static void recycle(std::weak_ptr<buffer_pool> pool, size_t cls,
+                      shared_buffer *buffer);
+
+  handle::ptr_t handle_;
+  bool read_only_;
+  size_t max_idle_;
+  mutable std::mutex lock_;
+  std::map<size_t, std::vector<buffer_t>> idle_;
+};
+
+}  // end of namespace types
+}  // end of namespace fpga
+}  // end of namespace opae
@@ -1,4 +1,4 @@
-// Copyright(c) 2018-2021, Intel Corporation
+// Copyright(c) 2018-2023, Intel Corporation
 //
 // Redistribution  and  use  in source  and  binary  forms,  with  or  without
 // modification, are permitted provided that the following conditions are met:
@@ -28,6 +28,8 @@
 #include <opae/enum.h>
 #include <opae/types.h>
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -140,6 +142,9 @@ class handle {
    * @param[in] offset The byte offset to add to MMIO base.
    * @param[in] csr_space The desired CSR space. Default is 0.
    * @return MMIO base + offset
+   *
+   * @note The region is mapped on first use, and the base
+   * address is cached until the handle is closed.
    */
   uint8_t *mmio_ptr(uint64_t offset, uint32_t csr_space = 0) const;
 
@@ -191,6 +196,10 @@ class handle {
 
   fpga_handle handle_;
   fpga_token token_;
+
+  // MMIO base addresses for the first few CSR spaces, mapped on demand.
+  static constexpr uint32_t mmio_cache_size = 8;
+  mutable std::array<std::atomic<uint8_t *>, mmio_cache_size> mmio_base_;
 };
 
 }  // end of namespace types
@@ -0,0 +1,191 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+#include <opae/cxx/core/handle.h>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace opae {
+namespace fpga {
+namespace types {
+
+/** A mapped MMIO region of an accelerator
+ *
+ * Maps one CSR space of a handle once and caches its base
+ * address, so that register accesses are plain volatile loads
+ * and stores rather than calls through the OPAE API. The region
+ * holds a reference to its handle, keeping the mapping alive.
+ *
+ * Registers are accessed either by offset, with read<T>() and
+ * write<T>(), or through csr<T, Offset> descriptors, which check
+ * the register width and alignment at compile time:
+ *
+ * @code
+ * using scratchpad = csr<uint64_t, 0x0048>;
+ * mmio_region mmio(h);
+ * mmio.write<scratchpad>(0xc0de);
+ * @endcode
+ */
+class mmio_region {
+ public:
+  /** Map a CSR space of a handle.
+   *
+   * @param[in] h The handle whose CSR space is mapped.
+   * @param[in] csr_space The CSR space to map. Default is 0.
+   *
+   * @throws invalid_param if the CSR space can't be mapped.
+   */
+  explicit mmio_region(handle::ptr_t h, uint32_t csr_space = 0)
+      : handle_(h), base_(h->mmio_ptr(0, csr_space)) {}
+
+  /** Retrieve the base address of the region.
+   */
+  volatile uint8_t *base() const { return base_; }
+
+  /** Retrieve the handle that the region belongs to.
+   */
+  handle::ptr_t get_handle() const { return handle_; }
+
+  /** Read a 32- or 64-bit register at a byte offset.
+   */
+  template <typename T>
+  T read(uint64_t offset) const {
+    static_assert(std::is_same<T, uint32_t>::value ||
+                      std::is_same<T, uint64_t>::value,
+                  "MMIO accesses are 32 or 64 bits wide");
+    return *reinterpret_cast<volatile const T *>(base_ + offset);
+  }
+
+  /** Write a 32- or 64-bit register at a byte offset.
+   */
+  template <typename T>
+  void write(uint64_t offset, T value) const {
+    static_assert(std::is_same<T, uint32_t>::value ||
+                      std::is_same<T, uint64_t>::value,
+                  "MMIO accesses are 32 or 64 bits wide");
+    *reinterpret_cast<volatile T *>(base_ + offset) = value;
+  }
+
+  /** Read the register described by a csr<> type.
+   */
+  template <typename Csr>
+  typename Csr::value_type read() const {
+    return read<typename Csr::value_type>(Csr::offset);
+  }
+
+  /** Write the register described by a csr<> type.
+   */
+  template <typename Csr>
+  void write(typename Csr::value_type value) const {
+    write<typename Csr::value_type>(Csr::offset, value);
+  }
+
+  /** Read-modify-write a field of a register.
+   *
+   * @param[in] value The new value of the field, unshifted.
+   */
+  template <typename Field>
+  void write_field(typename Field::value_type value) const {
+    typedef typename Field::register_type reg;
+    write<reg>(Field::insert(read<reg>(), value));
+  }
+
+  /** Read a field of a register, shifted down to bit 0.
+   */
+  template <typename Field>
+  typename Field::value_type read_field() const {
+    return Field::extract(read<typename Field::register_type>());
+  }
+
+ private:
+  handle::ptr_t handle_;
+  volatile uint8_t *base_;
+};
+
+/** Descriptor of a register at a fixed offset
+ *
+ * @tparam T The register width, uint32_t or uint64_t.
+ * @tparam Offset The byte offset of the register, which
+ * must be aligned to the register width.
+ */
+template <typename T, uint64_t Offset>
+struct csr {
+  static_assert(std::is_same<T, uint32_t>::value ||
+                    std::is_same<T, uint64_t>::value,
+                "MMIO accesses are 32 or 64 bits wide");
+  static_assert(Offset % sizeof(T) == 0, "misaligned register offset");
+
+  typedef T value_type;
+  static constexpr uint64_t offset = Offset;
+};
+
+template <typename T, uint64_t Offset>
+constexpr uint64_t csr<T, Offset>::offset;
+
+/** Descriptor of a bit field within a register
+ *
+ * @tparam Csr The csr<> type of the register.
+ * @tparam Lsb The least significant bit of the field.
+ * @tparam Width The number of bits in the field.
+ */
+template <typename Csr, unsigned Lsb, unsigned Width>
+struct csr_field {
+  typedef Csr register_type;
+  typedef typename Csr::value_type value_type;
+
+  static_assert(Width > 0, "empty register field");
+  static_assert(Lsb + Width <= sizeof(value_type) * 8,
+                "register field exceeds the register width");
+
+  /** The field's bits, in place within the register.
+   */
+  static constexpr value_type mask =
+      (Width == sizeof(value_type) * 8)
+          ? static_cast<value_type>(~value_type(0))
+          : static_cast<value_type>(
+                ((value_type(1) << (Width % (sizeof(value_type) * 8))) - 1)
+                << Lsb);
+
+  /** Extract the field from a register value.
+   */
+  static constexpr value_type extract(value_type reg) {
+    return (reg & mask) >> Lsb;
+  }
+
+  /** Replace the field within a register value.
+   */
+  static constexpr value_type insert(value_type reg, value_type value) {
+    return (reg & ~mask) | ((value << Lsb) & mask);
+  }
+};
+
+template <typename Csr, unsigned Lsb, unsigned Width>
+constexpr typename Csr::value_type csr_field<Csr, Lsb, Width>::mask;
+
+}  // end of namespace types
+}  // end of namespace fpga
+}  // end of namespace opae
@@ -1,4 +1,4 @@
-// Copyright(c) 2018, Intel Corporation
+// Copyright(c) 2018-2023, Intel Corporation
 //
 // Redistribution  and  use  in source  and  binary  forms,  with  or  without
 // modification, are permitted provided that the following conditions are met:
@@ -30,6 +30,7 @@
 
 #include <chrono>
 #include <cstdint>
+#include <future>
 #include <initializer_list>
 #include <memory>
 #include <thread>
@@ -68,6 +69,21 @@ class shared_buffer {
   static shared_buffer::ptr_t allocate(handle::ptr_t handle, size_t len,
                                        bool read_only = false);
 
+  /** Allocate a shared_buffer on a background thread.
+   *
+   * Buffer preparation pins memory and can take a long time for
+   * large buffers. allocate_async() runs allocate() on a separate
+   * thread, so that the caller can overlap it with other work.
+   *
+   * @param[in] handle The handle used to allocate the buffer.
+   * @param[in] len    The length in bytes of the requested buffer.
+   * @param[in] read_only Whether the buffer is read-only to the device.
+   * @return A future holding the buffer. Its get() rethrows any
+   * exception raised by allocate().
+   */
+  static std::future<shared_buffer::ptr_t> allocate_async(
+      handle::ptr_t handle, size_t len, bool read_only = false);
+
   /** Attach a pre-allocated buffer to a shared_buffer object.
    *
    * @param[in] handle The handle used to attach the buffer.
@@ -162,6 +178,8 @@ class shared_buffer {
   }
 
  protected:
+  friend class buffer_pool;
+
   shared_buffer(handle::ptr_t handle, size_t len, uint8_t *virt, uint64_t wsid,
                 uint64_t io_address);
 
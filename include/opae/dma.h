@@ -0,0 +1,300 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @file opae/dma.h
+ * @brief Asynchronous host DMA API.
+ *
+ * Presents a channel-oriented, asynchronous interface to the DMA engines
+ * found in an AFU. Each DMA handle owns one or more channels. Each channel
+ * is serviced by its own worker thread, which may be pinned to a CPU.
+ *
+ * Transfers are submitted to a channel and complete asynchronously. The
+ * caller may poll for completion, block waiting for completion, or register
+ * a callback that is invoked from the channel's worker thread.
+ *
+ * Two backends are provided: OPAE_DMA_BACKEND_MM drives the memory-mapped
+ * DMA BBB through an open fpga_handle, and OPAE_DMA_BACKEND_LOOPBACK
+ * simulates the device memory in host RAM so that applications and tests
+ * can exercise the API without hardware.
+ */
+
+#ifndef __OPAE_DMA_H__
+#define __OPAE_DMA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <opae/types.h>
+
+/**
+ * DMA backend
+ *
+ * Selects the engine that carries out the transfers for a DMA handle.
+ */
+typedef enum {
+	OPAE_DMA_BACKEND_MM = 0,	/**< Memory-mapped DMA BBB. */
+	OPAE_DMA_BACKEND_LOOPBACK	/**< Host RAM simulation. */
+} opae_dma_backend;
+
+/**
+ * DMA transfer direction
+ *
+ * Host addresses are process virtual addresses. FPGA addresses are
+ * offsets into the memory behind the DMA engine.
+ */
+typedef enum {
+	OPAE_DMA_HOST_TO_FPGA = 0,	/**< Host memory to FPGA memory. */
+	OPAE_DMA_FPGA_TO_HOST,		/**< FPGA memory to host memory. */
+	OPAE_DMA_FPGA_TO_FPGA,		/**< FPGA memory to FPGA memory. */
+	OPAE_DMA_MAX_DIRECTION
+} opae_dma_direction;
+
+/**
+ * DMA handle attributes
+ *
+ * Passed to opae_dma_open() to configure the new handle. Initialize
+ * with opae_dma_attr_init() to pick up the defaults.
+ */
+struct opae_dma_attr {
+	opae_dma_backend backend;	/**< Transfer engine. */
+	uint32_t num_channels;		/**< Channel count, or 0 for all available. */
+	uint32_t queue_depth;		/**< Max outstanding transfers per channel. */
+	size_t loopback_size;		/**< Simulated FPGA memory size (LOOPBACK). */
+};
+
+/** Default number of outstanding transfers per channel. */
+#define OPAE_DMA_DEFAULT_QUEUE_DEPTH 64
+/** Default size of the simulated FPGA memory of the loopback backend. */
+#define OPAE_DMA_DEFAULT_LOOPBACK_SIZE (64 * 1024 * 1024)
+
+/** Opaque DMA handle. */
+typedef struct _opae_dma_handle *opae_dma_handle;
+
+/** Opaque in-flight transfer. */
+typedef struct _opae_dma_request *opae_dma_request;
+
+/**
+ * Transfer completion callback
+ *
+ * Invoked from the channel worker thread once a transfer finishes.
+ *
+ * @param[in] context The context given to opae_dma_submit().
+ * @param[in] result  FPGA_OK on success, or the backend's error code.
+ * @param[in] bytes   Number of bytes transferred.
+ */
+typedef void (*opae_dma_callback)(void *context,
+				  fpga_result result,
+				  size_t bytes);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize DMA handle attributes
+ *
+ * Selects the MM backend with all available channels, a queue depth of
+ * OPAE_DMA_DEFAULT_QUEUE_DEPTH, and a loopback memory size of
+ * OPAE_DMA_DEFAULT_LOOPBACK_SIZE.
+ *
+ * @param[out] attr The attributes to initialize.
+ */
+void opae_dma_attr_init(struct opae_dma_attr *attr);
+
+/**
+ * Open a DMA handle
+ *
+ * Opens the requested number of channels on the selected backend and
+ * starts one worker thread per channel.
+ *
+ * @param[in] fpga  Handle to the AFU obtained via fpgaOpen(). May be NULL
+ *                  for OPAE_DMA_BACKEND_LOOPBACK.
+ * @param[in] attr  Handle attributes, or NULL for the defaults.
+ * @param[out] dma  Receives the new DMA handle.
+ * @returns FPGA_OK on success. FPGA_NOT_FOUND when the AFU exposes fewer
+ * DMA engines than requested.
+ *
+ * Example
+ * @code{.c}
+ * struct opae_dma_attr attr;
+ * opae_dma_handle dma = NULL;
+ *
+ * opae_dma_attr_init(&attr);
+ * attr.num_channels = 2;
+ *
+ * if (opae_dma_open(fpga_h, &attr, &dma) != FPGA_OK) {
+ *   // handle error
+ * }
+ * @endcode
+ */
+fpga_result opae_dma_open(fpga_handle fpga,
+			  const struct opae_dma_attr *attr,
+			  opae_dma_handle *dma);
+
+/**
+ * Query the number of channels
+ *
+ * @param[in] dma    The open DMA handle.
+ * @param[out] count Receives the channel count.
+ * @returns FPGA_OK on success.
+ */
+fpga_result opae_dma_channel_count(opae_dma_handle dma, uint32_t *count);
+
+/**
+ * Pin a channel worker to a CPU
+ *
+ * @param[in] dma     The open DMA handle.
+ * @param[in] channel Zero-based channel index.
+ * @param[in] cpu     The CPU to run the channel worker on, or -1 to
+ *                    allow it to run on any CPU.
+ * @returns FPGA_OK on success. FPGA_EXCEPTION if the affinity could not
+ * be applied.
+ */
+fpga_result opae_dma_channel_set_affinity(opae_dma_handle dma,
+					  uint32_t channel,
+					  int cpu);
+
+/**
+ * Submit an asynchronous transfer
+ *
+ * Queues the transfer on the given channel and returns immediately.
+ * Transfers on a channel complete in submission order.
+ *
+ * When req is non-NULL, it receives a request object that must be passed
+ * to opae_dma_request_release() once the caller is done with it. When req
+ * is NULL, the request is released automatically after completion, and
+ * cb is the only completion notification.
+ *
+ * @param[in] dma     The open DMA handle.
+ * @param[in] channel Zero-based channel index.
+ * @param[in] dst     Destination address.
+ * @param[in] src     Source address.
+ * @param[in] len     Transfer size in bytes.
+ * @param[in] dir     Transfer direction.
+ * @param[in] cb      Optional completion callback.
+ * @param[in] context Passed to cb.
+ * @param[out] req    Optional request object for poll/wait.
+ * @returns FPGA_OK on success. FPGA_BUSY when the channel queue is full.
+ */
+fpga_result opae_dma_submit(opae_dma_handle dma,
+			    uint32_t channel,
+			    uint64_t dst,
+			    uint64_t src,
+			    size_t len,
+			    opae_dma_direction dir,
+			    opae_dma_callback cb,
+			    void *context,
+			    opae_dma_request *req);
+
+/**
+ * Poll a transfer for completion
+ *
+ * @param[in] req      The request returned by opae_dma_submit().
+ * @param[out] bytes   Optional. Receives the number of bytes transferred.
+ * @returns FPGA_BUSY while the transfer is in flight. Otherwise the
+ * transfer's completion status.
+ */
+fpga_result opae_dma_poll(opae_dma_request req, size_t *bytes);
+
+/**
+ * Wait for a transfer to complete
+ *
+ * @param[in] req        The request returned by opae_dma_submit().
+ * @param[in] timeout_ms Milliseconds to wait, or -1 to wait forever.
+ * @param[out] bytes     Optional. Receives the number of bytes transferred.
+ * @returns FPGA_BUSY if the timeout expired. Otherwise the transfer's
+ * completion status.
+ */
+fpga_result opae_dma_wait(opae_dma_request req,
+			  int timeout_ms,
+			  size_t *bytes);
+
+/**
+ * Release a transfer request
+ *
+ * A request that is still in flight is detached and released by the
+ * channel worker once it completes.
+ *
+ * @param[in] req The request returned by opae_dma_submit().
+ * @returns FPGA_OK on success.
+ */
+fpga_result opae_dma_request_release(opae_dma_request req);
+
+/**
+ * Perform a blocking transfer
+ *
+ * Equivalent to opae_dma_submit() followed by opae_dma_wait() with
+ * no timeout.
+ *
+ * @returns The transfer's completion status.
+ */
+fpga_result opae_dma_transfer_sync(opae_dma_handle dma,
+				   uint32_t channel,
+				   uint64_t dst,
+				   uint64_t src,
+				   size_t len,
+				   opae_dma_direction dir);
+
+/**
+ * Wait for all outstanding transfers on a channel
+ *
+ * @param[in] dma     The open DMA handle.
+ * @param[in] channel Zero-based channel index.
+ * @returns FPGA_OK on success.
+ */
+fpga_result opae_dma_drain(opae_dma_handle dma, uint32_t channel);
+
+/**
+ * Close a DMA handle
+ *
+ * Drains all channels, stops the worker threads and closes the backend.
+ *
+ * @param[in] dma The open DMA handle.
+ * @returns FPGA_OK on success.
+ */
+fpga_result opae_dma_close(opae_dma_handle dma);
+
+/**
+ * Retrieve the simulated FPGA memory of a loopback handle
+ *
+ * Lets tests seed and inspect the device side of loopback transfers.
+ *
+ * @param[in] dma   A DMA handle opened with OPAE_DMA_BACKEND_LOOPBACK.
+ * @param[out] ptr  Receives the base address of the simulated memory.
+ * @param[out] size Optional. Receives its size.
+ * @returns FPGA_OK on success. FPGA_NOT_SUPPORTED for other backends.
+ */
+fpga_result opae_dma_loopback_memory(opae_dma_handle dma,
+				     uint8_t **ptr,
+				     size_t *size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // __OPAE_DMA_H__
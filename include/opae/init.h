@@ -44,6 +44,11 @@ extern "C" {
  * Initialize OPAE using the given configuration file path, or
  * perform default initialization if config_file is NULL.
  *
+ * Calling this is optional. Unless OPAE_EXPLICIT_INITIALIZE is set in
+ * the environment, default initialization is performed on the first
+ * call to fpgaEnumerate(). A call made with a config_file before then
+ * replaces the default initialization.
+ *
  * @param[in]  config_file   Path to OPAE configuration file.
  * @returns        Whether OPAE initialized successfully.
  */
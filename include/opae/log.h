@@ -40,42 +40,59 @@
 #ifdef __SHORT_FILE__
 #undef __SHORT_FILE__
 #endif // __SHORT_FILE__
+#ifdef __FILE_NAME__
+#define __SHORT_FILE__ __FILE_NAME__
+#else
+/* folded to a constant by the compiler, even at -O0 */
 #define __SHORT_FILE__                                         \
-	({                                                     \
-	const char *file = __FILE__;                           \
-	const char *p = file;                                  \
-	while (*p)                                             \
-		++p;                                           \
-	while ((p > file) && ('/' != *p) && ('\\' != *p))      \
-		--p;                                           \
-	if (p > file)                                          \
-		++p;                                           \
-	p;                                                     \
-	})
+	(__builtin_strrchr(__FILE__, '/') ?                    \
+	 __builtin_strrchr(__FILE__, '/') + 1 : __FILE__)
+#endif // __FILE_NAME__
+
+/*
+* Skip the call, and the evaluation of its arguments, when the
+* message would be filtered by the current log level.
+*/
+#define OPAE_LOG_ENABLED(level) \
+	__builtin_expect((int)(level) <= opae_log_threshold, 0)
 
 #ifdef OPAE_MSG
 #undef OPAE_MSG
 #endif // OPAE_MSG
-#define OPAE_MSG(format, ...)                                     \
-	opae_print(OPAE_LOG_MESSAGE, "%s:%u:%s() : " format "\n", \
-	__SHORT_FILE__, __LINE__, __func__, ##__VA_ARGS__)
+#define OPAE_MSG(format, ...)                                         \
+	do {                                                          \
+		if (OPAE_LOG_ENABLED(OPAE_LOG_MESSAGE))               \
+			opae_print(OPAE_LOG_MESSAGE,                  \
+			"%s:%u:%s() : " format "\n",                  \
+			__SHORT_FILE__, __LINE__, __func__,           \
+			##__VA_ARGS__);                               \
+	} while (0)
 
 #ifdef OPAE_ERR
 #undef OPAE_ERR
 #endif // OPAE_ERR
-#define OPAE_ERR(format, ...)                                     \
-	opae_print(OPAE_LOG_ERROR,                                \
-	"%s:%u:%s() **ERROR** : " format "\n",                    \
-	__SHORT_FILE__, __LINE__, __func__, ##__VA_ARGS__)
+#define OPAE_ERR(format, ...)                                         \
+	do {                                                          \
+		if (__builtin_expect(OPAE_LOG_ERROR <=                \
+				     opae_log_threshold, 1))          \
+			opae_print(OPAE_LOG_ERROR,                    \
+			"%s:%u:%s() **ERROR** : " format "\n",        \
+			__SHORT_FILE__, __LINE__, __func__,           \
+			##__VA_ARGS__);                               \
+	} while (0)
 
 #ifdef OPAE_DBG
 #undef OPAE_DBG
 #endif // OPAE_DBG
 #ifdef LIBOPAE_DEBUG
-#define OPAE_DBG(format, ...)                                    \
-	opae_print(OPAE_LOG_DEBUG,                               \
-	"%s:%u:%s() *DEBUG* : " format "\n",                     \
-	__SHORT_FILE__, __LINE__, __func__, ##__VA_ARGS__)
+#define OPAE_DBG(format, ...)                                         \
+	do {                                                          \
+		if (OPAE_LOG_ENABLED(OPAE_LOG_DEBUG))                 \
+			opae_print(OPAE_LOG_DEBUG,                    \
+			"%s:%u:%s() *DEBUG* : " format "\n",          \
+			__SHORT_FILE__, __LINE__, __func__,           \
+			##__VA_ARGS__);                               \
+	} while (0)
 #else
 #define OPAE_DBG(format, ...)                                    \
 {	}
@@ -96,8 +113,19 @@ enum opae_loglevel {
 extern "C" {
 #endif // __cplusplus
 
+/*
+* Messages at or below this level are printed. Set from LIBOPAE_LOG.
+*/
+extern int opae_log_threshold;
+
 void opae_print(int loglevel, const char *fmt, ...);
 
+/*
+* Write out any messages still queued for the log writer thread
+* (LIBOPAE_LOG_ASYNC=1) and flush the log streams.
+*/
+void opae_log_flush(void);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
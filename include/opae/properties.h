@@ -157,6 +157,28 @@ fpga_result fpgaClearProperties(fpga_properties prop);
  */
 fpga_result fpgaCloneProperties(fpga_properties src, fpga_properties *dst);
 
+/**
+ * Create a read-only snapshot of a fpga_properties object
+ *
+ * Creates an immutable copy of an fpga_properties object. A snapshot
+ * carries no lock: the fpgaPropertiesGet*() accessors read it directly,
+ * which makes snapshots well suited as fpgaEnumerate() filters and for
+ * properties that are read often from several threads. Any attempt to
+ * modify a snapshot with fpgaPropertiesSet*(), fpgaClearProperties() or
+ * fpgaUpdateProperties() fails with FPGA_INVALID_PARAM.
+ *
+ * @note A snapshot is destroyed using fpgaDestroyProperties(). Use
+ * fpgaCloneProperties() to obtain a modifiable copy of a snapshot.
+ *
+ * @param[in]  src        fpga_properties object to copy
+ * @param[out] snapshot   New read-only fpga_properties object
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if `src` is not a valid
+ * object, or if `snapshot` is NULL. FPGA_NO_MEMORY if there was not enough
+ * memory to allocate the snapshot.
+ */
+fpga_result fpgaSnapshotProperties(fpga_properties src,
+				   fpga_properties *snapshot);
+
 /**
  * Destroy a fpga_properties object
  *
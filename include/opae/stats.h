@@ -0,0 +1,146 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @file stats.h
+ * @brief Per-API call statistics and tracing for the OPAE C library.
+ *
+ * When enabled, libopae-c times every call that it forwards to a
+ * plugin and keeps, for each (API function, plugin) pair, a call
+ * count, an error count and a log2 latency histogram. An optional
+ * trace ring keeps the most recent calls.
+ *
+ * Statistics may also be enabled for the life of a process by setting
+ * LIBOPAE_API_STATS to 1 (counters) or 2 (counters and trace). The
+ * results are then written at exit to the file named by
+ * LIBOPAE_API_STATS_FILE, or to stderr.
+ */
+
+#ifndef __FPGA_STATS_H__
+#define __FPGA_STATS_H__
+
+#include <opae/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Collect per-API call counts and latency histograms. */
+#define FPGA_API_STATS_ENABLE 0x1
+/** Also record each call in the trace ring. */
+#define FPGA_API_STATS_TRACE  0x2
+
+/** Number of latency histogram buckets. */
+#define FPGA_API_STATS_BUCKETS 32
+#define FPGA_API_STATS_NAME_MAX 64
+
+/**
+ * Statistics for one API function as serviced by one plugin.
+ *
+ * histogram[i] counts the calls that took [2^i, 2^(i+1)) nsec.
+ * The last bucket also counts every call that took longer.
+ */
+typedef struct _fpga_api_stats {
+	char api[FPGA_API_STATS_NAME_MAX];     ///< e.g. "fpgaReadMMIO64"
+	char adapter[FPGA_API_STATS_NAME_MAX]; ///< e.g. "libxfpga.so"
+	uint64_t calls;
+	uint64_t errors;                       ///< calls not returning FPGA_OK
+	uint64_t total_nsec;
+	uint64_t min_nsec;
+	uint64_t max_nsec;
+	uint64_t histogram[FPGA_API_STATS_BUCKETS];
+} fpga_api_stats;
+
+/**
+ * One call recorded in the trace ring.
+ */
+typedef struct _fpga_api_trace_entry {
+	char api[FPGA_API_STATS_NAME_MAX];
+	char adapter[FPGA_API_STATS_NAME_MAX];
+	uint64_t start_nsec;                   ///< CLOCK_MONOTONIC
+	uint64_t duration_nsec;
+	uint32_t tid;
+	fpga_result result;
+} fpga_api_trace_entry;
+
+/**
+ * Enable or disable API statistics collection.
+ *
+ * @param[in] flags Bitwise OR of FPGA_API_STATS_ENABLE and
+ *                  FPGA_API_STATS_TRACE, or 0 to disable.
+ *                  Collected data is kept while disabled.
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if flags contains
+ * unknown bits. FPGA_NO_MEMORY if the trace ring could not be
+ * allocated.
+ */
+fpga_result fpgaEnableApiStats(int flags);
+
+/**
+ * Discard all collected statistics and trace entries.
+ *
+ * @returns FPGA_OK.
+ */
+fpga_result fpgaResetApiStats(void);
+
+/**
+ * Retrieve the statistics collected so far.
+ *
+ * Per-thread counters are merged at the time of the call. Only
+ * (API, plugin) pairs that have been called at least once are
+ * reported.
+ *
+ * @param[out] stats     Array of max_stats entries to fill. May be NULL
+ *                       when max_stats is 0.
+ * @param[in]  max_stats Number of entries in stats.
+ * @param[out] num_stats Number of available entries, which may be
+ *                       greater than max_stats.
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if num_stats is NULL,
+ * or if max_stats is non-zero and stats is NULL.
+ */
+fpga_result fpgaGetApiStats(fpga_api_stats *stats, uint32_t max_stats,
+			    uint32_t *num_stats);
+
+/**
+ * Retrieve the most recent calls from the trace ring, oldest first.
+ *
+ * @param[out] entries       Array of max_entries entries to fill. May
+ *                           be NULL when max_entries is 0.
+ * @param[in]  max_entries   Number of entries in entries.
+ * @param[out] num_entries   Number of entries filled.
+ * @param[out] num_available Number of entries in the ring, which may
+ *                           be greater than max_entries. May be NULL.
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if num_entries is
+ * NULL, or if max_entries is non-zero and entries is NULL.
+ */
+fpga_result fpgaGetApiTrace(fpga_api_trace_entry *entries,
+			    uint32_t max_entries, uint32_t *num_entries,
+			    uint32_t *num_available);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FPGA_STATS_H__
@@ -167,6 +167,16 @@ enum fpga_reconf_flags {
 	FPGA_RECONF_SKIP_USRCLK = (1u << 1)
 };
 
+/**
+ * User clock flags
+ *
+ * These flags can be passed to the fpgaSetUserClock() function.
+ */
+enum fpga_userclk_flags {
+	/** high_clk and low_clk are given in kHz rather than MHz */
+	FPGA_USERCLK_KHZ = (1u << 0)
+};
+
 enum fpga_sysobject_flags {
 	FPGA_OBJECT_SYNC = (1u << 0), /**< Synchronize data from driver */
 	FPGA_OBJECT_GLOB = (1u << 1), /**< Treat names as glob expressions */
@@ -40,10 +40,16 @@ extern "C" {
 
 /**
  * set afu user clock high and low
+ *
+ * The IOPLL dividers are computed for the requested low clock, so the
+ * frequency need not be a whole number of MHz when FPGA_USERCLK_KHZ is
+ * given. The resulting frequency is the closest the IOPLL can produce.
+ *
  * @param[in]  handle       Handle to previously opened accelerator resource.
  * @param[in]  high_clk     AFU High user clock frequency in MHz.
  * @param[in]  low_clk      AFU Low user clock frequency in MHz.
- * @param[in]  flags        Flags Reserved.
+ * @param[in]  flags        Flags: FPGA_USERCLK_KHZ - high_clk and low_clk
+ *                          are given in kHz.
  *
 .*@returns FPGA_OK on success. FPGA_INVALID_PARAM if invalid parameters were provided, or
  * if the parameter combination is not valid. FPGA_EXCEPTION if an internal
@@ -26,12 +26,23 @@
 #pragma once
 #include <poll.h>
 #include <regex.h>
+#include <sched.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <future>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <sstream>
 #include <thread>
+#include <vector>
 
 #include <CLI/CLI.hpp>
 #include <spdlog/spdlog.h>
@@ -108,6 +119,133 @@ union pcie_address {
 
 };
 
+// Parse a sysfs cpu list such as "0-3,8,10-11".
+inline std::vector<int> parse_cpulist(const std::string &s)
+{
+  std::vector<int> cpus;
+  std::stringstream ss(s);
+  std::string range;
+
+  while (std::getline(ss, range, ',')) {
+    int lo, hi;
+    int n = sscanf(range.c_str(), "%d-%d", &lo, &hi);
+    if (n < 1 || lo < 0)
+      throw std::runtime_error("invalid cpu list: " + s);
+    if (n == 1)
+      hi = lo;
+    for (int c = lo; c <= hi; ++c)
+      cpus.push_back(c);
+  }
+  return cpus;
+}
+
+// CPUs of the NUMA node the PCIe device is attached to (empty if unknown).
+inline std::vector<int> device_local_cpus(const std::string &address)
+{
+  std::ifstream f("/sys/bus/pci/devices/" + address + "/local_cpulist");
+  std::string s;
+  if (!std::getline(f, s))
+    return std::vector<int>();
+  return parse_cpulist(s);
+}
+
+inline std::string device_address(fpga::properties::ptr_t props)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%04x:%02x:%02x.%x",
+           static_cast<uint16_t>(props->segment),
+           static_cast<uint8_t>(props->bus),
+           static_cast<uint8_t>(props->device),
+           static_cast<uint8_t>(props->function));
+  return buf;
+}
+
+struct device_result {
+  std::string address;
+  int status;
+  double seconds;
+  std::map<std::string, double> metrics;
+};
+
+inline void json_string(std::ostream &os, const std::string &s)
+{
+  os << '"';
+  for (auto c : s) {
+    if (c == '"' || c == '\\')
+      os << '\\';
+    os << c;
+  }
+  os << '"';
+}
+
+inline void json_number(std::ostream &os, double v)
+{
+  if (std::isfinite(v))
+    os << v;
+  else
+    os << "null";
+}
+
+// Write the per-device and aggregate results of a run as JSON.
+inline void write_json_summary(std::ostream &os, const std::string &tool,
+                               const std::string &command,
+                               const std::vector<device_result> &results,
+                               double seconds)
+{
+  std::map<std::string, std::vector<double>> aggregate;
+  size_t passed = 0;
+
+  os << "{\n  \"tool\": ";
+  json_string(os, tool);
+  os << ",\n  \"command\": ";
+  json_string(os, command);
+  os << ",\n  \"devices\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto &r = results[i];
+    if (!r.status)
+      ++passed;
+    os << (i ? ",\n" : "\n") << "    {\"address\": ";
+    json_string(os, r.address);
+    os << ", \"status\": " << r.status
+       << ", \"result\": " << (r.status ? "\"FAIL\"" : "\"PASS\"")
+       << ", \"seconds\": ";
+    json_number(os, r.seconds);
+    os << ", \"metrics\": {";
+    for (auto it = r.metrics.begin(); it != r.metrics.end(); ++it) {
+      os << (it == r.metrics.begin() ? "" : ", ");
+      json_string(os, it->first);
+      os << ": ";
+      json_number(os, it->second);
+      aggregate[it->first].push_back(it->second);
+    }
+    os << "}}";
+  }
+  os << "\n  ],\n  \"aggregate\": {\"devices\": " << results.size()
+     << ", \"passed\": " << passed
+     << ", \"failed\": " << results.size() - passed
+     << ", \"seconds\": ";
+  json_number(os, seconds);
+  os << ", \"metrics\": {";
+  for (auto it = aggregate.begin(); it != aggregate.end(); ++it) {
+    auto &v = it->second;
+    double sum = 0.0;
+    for (auto x : v)
+      sum += x;
+    os << (it == aggregate.begin() ? "" : ", ");
+    json_string(os, it->first);
+    os << ": {\"sum\": ";
+    json_number(os, sum);
+    os << ", \"min\": ";
+    json_number(os, *std::min_element(v.begin(), v.end()));
+    os << ", \"max\": ";
+    json_number(os, *std::max_element(v.begin(), v.end()));
+    os << ", \"mean\": ";
+    json_number(os, sum / v.size());
+    os << "}";
+  }
+  os << "}}\n}\n";
+}
+
 class afu; // forward declaration
 
 class command {
@@ -168,6 +306,8 @@ public:
   , log_level_(log_level ? log_level : "info")
   , shared_(false)
   , timeout_msec_(60000)
+  , all_devices_(false)
+  , pin_("none")
   , handle_(nullptr)
   , current_command_(nullptr)
   {
@@ -180,6 +320,17 @@ public:
       check(CLI::IsMember(spdlog_levels()));
     app_.add_flag("-s,--shared", shared_, "open in shared mode, default is off");
     app_.add_option("-t,--timeout", timeout_msec_, "test timeout (msec)")->default_str(std::to_string(timeout_msec_));
+    app_.add_option("--devices", devices_,
+                    "run concurrently on each listed device "
+                    "[<domain>:]<bus>:<device>.<function>")->delimiter(',');
+    app_.add_flag("--all-devices", all_devices_,
+                  "run concurrently on every matching accelerator");
+    app_.add_option("--pin", pin_,
+                    "pin each device run to the CPUs local to the device {none, numa, cpu}")->
+      default_str(pin_)->
+      check(CLI::IsMember({"none", "numa", "cpu"}));
+    app_.add_option("--summary", summary_,
+                    "write a JSON summary of the results to file ('-' for stdout)");
   }
   virtual ~afu() {
     if (logger_)
@@ -193,22 +344,30 @@ public:
     return fpga::properties::get(handle_);
   }
 
-  int open_handle(const char *afu_id) {
+  fpga::properties::ptr_t device_filter(const char *afu_id,
+                                        const std::string &pci_addr) const {
     auto filter = fpga::properties::get();
-    auto app_afu_id = afu_id ? afu_id : afu_id_.c_str();
     filter->type = FPGA_ACCELERATOR;
     try {
-      filter->guid.parse(app_afu_id);
+      filter->guid.parse(afu_id);
     } catch(opae::fpga::types::except & err) {
-      return error;
+      return nullptr;
     }
-    if (!pci_addr_.empty()) {
-      auto p = pcie_address::parse(pci_addr_.c_str());
+    if (!pci_addr.empty()) {
+      auto p = pcie_address::parse(pci_addr.c_str());
       filter->segment = p.fields.domain;
       filter->bus = p.fields.bus;
       filter->device = p.fields.device;
       filter->function = p.fields.function;
     }
+    return filter;
+  }
+
+  int open_handle(const char *afu_id) {
+    auto app_afu_id = afu_id ? afu_id : afu_id_.c_str();
+    auto filter = device_filter(app_afu_id, pci_addr_);
+    if (!filter)
+      return error;
 
     auto tokens = fpga::token::enumerate({filter});
     if (tokens.size() < 1) {
@@ -256,20 +415,128 @@ public:
       return exit_codes::not_run;
     }
 
-    std::stringstream ss;
-    ss << name_ << "_" << test->name() << ".log";
-    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(ss.str(), true);
-    file_sink->set_level(spdlog::level::trace);
-    logger_ = std::make_shared<spdlog::logger>(test->name(), spdlog::sinks_init_list ({console_sink, file_sink}));
-    spdlog::register_logger(logger_);
-    logger_->set_level(spdlog::level::from_str(log_level_));
+    make_logger(test, "");
+
+    if (all_devices_ || !devices_.empty())
+      return run_devices(app, test);
 
     int res = open_handle(test->afu_id());
     if (res != exit_codes::not_run) {
       return res;
     }
 
-    return run(app, test);
+    auto start = std::chrono::steady_clock::now();
+    res = run(app, test);
+    if (!summary_.empty()) {
+      device_result r;
+      r.address = device_address(afu_properties());
+      r.status = res;
+      r.seconds = elapsed(start);
+      r.metrics = metrics();
+      write_summary(test, std::vector<device_result>(1, r), r.seconds);
+    }
+    return res;
+  }
+
+  // Run test on every selected device concurrently. Each device gets its
+  // own worker process, since the afu, its commands and their loggers are
+  // per-process state.
+  int run_devices(CLI::App *app, command::ptr_t test)
+  {
+    auto app_afu_id = test->afu_id() ? test->afu_id() : afu_id_.c_str();
+    std::vector<std::string> addresses;
+    std::vector<std::string> selected(devices_);
+
+    if (selected.empty())
+      selected.push_back(pci_addr_);
+
+    for (auto &d : selected) {
+      auto filter = device_filter(app_afu_id, d);
+      if (!filter)
+        return exit_codes::error;
+      auto tokens = fpga::token::enumerate({filter});
+      if (tokens.empty()) {
+        logger_->error("no accelerator found with id: {0} at PCIe address {1}",
+                       app_afu_id, d.empty() ? "any" : d);
+        return exit_codes::not_found;
+      }
+      if (!all_devices_)
+        tokens.resize(1);
+      for (auto t : tokens) {
+        auto a = device_address(fpga::properties::get(t));
+        if (std::find(addresses.begin(), addresses.end(), a) == addresses.end())
+          addresses.push_back(a);
+      }
+    }
+
+    std::vector<device_result> results(addresses.size());
+    std::vector<std::pair<pid_t, int>> workers;
+    auto start = std::chrono::steady_clock::now();
+
+    logger_->flush();
+    std::cout.flush();
+    fflush(nullptr);
+
+    for (size_t i = 0; i < addresses.size(); ++i) {
+      int fds[2];
+      pid_t pid = -1;
+
+      results[i].address = addresses[i];
+      results[i].status = exit_codes::exception;
+      results[i].seconds = 0.0;
+
+      if (pipe(fds)) {
+        logger_->error("{0}: pipe failed: {1}", addresses[i], strerror(errno));
+        workers.emplace_back(-1, -1);
+        continue;
+      }
+
+      pid = fork();
+      if (!pid) {
+        close(fds[0]);
+        for (auto &w : workers)
+          if (w.second >= 0)
+            close(w.second);
+        _exit(run_device(app, test, addresses[i], i, fds[1]));
+      }
+
+      close(fds[1]);
+      if (pid < 0) {
+        logger_->error("{0}: fork failed: {1}", addresses[i], strerror(errno));
+        close(fds[0]);
+        fds[0] = -1;
+      }
+      workers.emplace_back(pid, fds[0]);
+    }
+
+    int res = exit_codes::success;
+    for (size_t i = 0; i < workers.size(); ++i) {
+      auto &r = results[i];
+      int status = 0;
+
+      if (workers[i].first < 0)
+        continue;
+
+      read_results(workers[i].second, r);
+      close(workers[i].second);
+
+      while (waitpid(workers[i].first, &status, 0) < 0 && errno == EINTR)
+        ;
+      r.status = WIFEXITED(status) ? WEXITSTATUS(status) :
+                                     static_cast<int>(exit_codes::exception);
+    }
+
+    for (auto &r : results) {
+      std::cout << r.address << ": " << (r.status ? "FAIL" : "PASS")
+                << " (" << r.seconds << " s)\n";
+      if (r.status && !res)
+        res = r.status;
+    }
+
+    if (!summary_.empty())
+      write_summary(test, results, elapsed(start));
+
+    return res;
   }
 
   virtual int run(CLI::App *app, command::ptr_t test)
@@ -330,6 +597,18 @@ public:
     return current_command_;
   }
 
+  // Record a named result (e.g. bandwidth) of the current run for the
+  // --summary output.
+  void report_metric(const std::string &name, double value) {
+    std::lock_guard<std::mutex> lock(metrics_lock_);
+    metrics_[name] = value;
+  }
+
+  std::map<std::string, double> metrics() const {
+    std::lock_guard<std::mutex> lock(metrics_lock_);
+    return metrics_;
+  }
+
 protected:
   std::string name_;
   std::string afu_id_;
@@ -338,9 +617,146 @@ protected:
   std::string log_level_;
   bool shared_;
   uint32_t timeout_msec_;
+  std::vector<std::string> devices_;
+  bool all_devices_;
+  std::string pin_;
+  std::string summary_;
   fpga::handle::ptr_t handle_;
   command::ptr_t current_command_;
   std::map<CLI::App*, command::ptr_t> commands_;
+  mutable std::mutex metrics_lock_;
+  std::map<std::string, double> metrics_;
+
+  void make_logger(command::ptr_t test, const std::string &device)
+  {
+    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    std::stringstream ss;
+    ss << name_ << "_" << test->name();
+    if (!device.empty())
+      ss << "_" << device;
+    ss << ".log";
+    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(ss.str(), true);
+    file_sink->set_level(spdlog::level::trace);
+    if (logger_)
+      spdlog::drop(logger_->name());
+    logger_ = std::make_shared<spdlog::logger>(test->name(), spdlog::sinks_init_list ({console_sink, file_sink}));
+    spdlog::register_logger(logger_);
+    logger_->set_level(spdlog::level::from_str(log_level_));
+  }
+
+  static double elapsed(std::chrono::steady_clock::time_point start)
+  {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+  }
+
+  void pin_device(const std::string &address, size_t index)
+  {
+    if (pin_ == "none")
+      return;
+
+    auto cpus = device_local_cpus(address);
+    if (cpus.empty()) {
+      logger_->warn("{0}: local CPUs unknown, not pinning", address);
+      return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pin_ == "cpu")
+      CPU_SET(cpus[index % cpus.size()], &set);
+    else
+      for (auto c : cpus)
+        CPU_SET(c, &set);
+
+    if (sched_setaffinity(0, sizeof(set), &set))
+      logger_->warn("{0}: sched_setaffinity failed: {1}", address,
+                    strerror(errno));
+  }
+
+  // Worker process body: run test on one device and send the elapsed
+  // time and metrics back to the parent over fd.
+  int run_device(CLI::App *app, command::ptr_t test,
+                 const std::string &address, size_t index, int fd)
+  {
+    pci_addr_ = address;
+    make_logger(test, address);
+    pin_device(address, index);
+
+    auto start = std::chrono::steady_clock::now();
+    int res = open_handle(test->afu_id());
+    if (res == exit_codes::not_run)
+      res = run(app, test);
+
+    std::ostringstream os;
+    os.precision(std::numeric_limits<double>::max_digits10);
+    os << elapsed(start) << "\n";
+    for (auto &kv : metrics())
+      os << kv.first << "\t" << kv.second << "\n";
+
+    auto msg = os.str();
+    const char *p = msg.c_str();
+    size_t len = msg.size();
+    while (len) {
+      ssize_t n = write(fd, p, len);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      p += n;
+      len -= n;
+    }
+    close(fd);
+
+    logger_->flush();
+    std::cout.flush();
+    fflush(nullptr);
+    return res;
+  }
+
+  static void read_results(int fd, device_result &r)
+  {
+    std::string msg;
+    char buf[4096];
+    ssize_t n;
+
+    while ((n = read(fd, buf, sizeof(buf))) != 0) {
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+      msg.append(buf, n);
+    }
+
+    std::istringstream is(msg);
+    std::string line;
+    if (std::getline(is, line))
+      r.seconds = std::strtod(line.c_str(), nullptr);
+    while (std::getline(is, line)) {
+      auto tab = line.find('\t');
+      if (tab != std::string::npos)
+        r.metrics[line.substr(0, tab)] =
+          std::strtod(line.c_str() + tab + 1, nullptr);
+    }
+  }
+
+  void write_summary(command::ptr_t test,
+                     const std::vector<device_result> &results,
+                     double seconds)
+  {
+    if (summary_ == "-") {
+      write_json_summary(std::cout, name_, test->name(), results, seconds);
+      return;
+    }
+
+    std::ofstream f(summary_);
+    if (!f) {
+      logger_->error("could not open summary file: {0}", summary_);
+      return;
+    }
+    write_json_summary(f, name_, test->name(), results, seconds);
+  }
 public:
   std::shared_ptr<spdlog::logger> logger_;
 };
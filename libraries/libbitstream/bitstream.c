@@ -30,8 +30,11 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <uuid/uuid.h>
@@ -110,6 +113,53 @@ out_close:
 	return res;
 }
 
+STATIC fpga_result opae_bitstream_map_file(const char *file,
+					   uint8_t **buf,
+					   size_t *len)
+{
+	int fd;
+	struct stat st;
+	void *addr;
+	fpga_result res = FPGA_EXCEPTION;
+
+	fd = opae_open(file, O_RDONLY);
+	if (fd < 0) {
+		OPAE_ERR("open failed");
+		return FPGA_EXCEPTION;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		OPAE_ERR("fstat failed");
+		goto out_close;
+	}
+
+	if (!S_ISREG(st.st_mode) || !st.st_size) {
+		OPAE_ERR("not a regular, non-empty file");
+		res = FPGA_INVALID_PARAM;
+		goto out_close;
+	}
+
+	addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED) {
+		OPAE_ERR("mmap failed: %s", strerror(errno));
+		goto out_close;
+	}
+
+	// The image is streamed front to back exactly once by
+	// the PR engine. Ask for aggressive read-ahead and let
+	// the kernel drop pages behind us.
+	if (madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL) < 0)
+		OPAE_DBG("madvise failed: %s", strerror(errno));
+
+	*buf = (uint8_t *)addr;
+	*len = (size_t)st.st_size;
+	res = FPGA_OK;
+
+out_close:
+	opae_close(fd);
+	return res;
+}
+
 bool opae_is_legacy_bitstream(opae_bitstream_info *info)
 {
 	opae_legacy_bitstream_header *hdr;
@@ -142,18 +192,45 @@ STATIC void opae_resolve_legacy_bitstream(opae_bitstream_info *info)
 }
 
 STATIC void *opae_bitstream_parse_metadata(const char *metadata,
+					   size_t len,
 					   fpga_guid pr_interface_id,
 					   int *version)
 {
+	json_tokener *tok;
 	json_object *root = NULL;
 	json_object *j_version = NULL;
-	enum json_tokener_error j_err = json_tokener_success;
+	enum json_tokener_error j_err;
 	void *parsed = NULL;
 
-	root = json_tokener_parse_verbose(metadata, &j_err);
-	if (!root) {
+	// The metadata lives inside the GBS image and is not
+	// NUL-terminated. Stop at the first NUL, if any, to match
+	// the C-string semantics of the on-disk format.
+	len = strnlen(metadata, len);
+	if (len > INT_MAX) {
+		OPAE_ERR("metadata too large");
+		return NULL;
+	}
+
+	tok = json_tokener_new();
+	if (!tok) {
+		OPAE_ERR("json_tokener_new failed");
+		return NULL;
+	}
+
+	root = json_tokener_parse_ex(tok, metadata, (int)len);
+	j_err = json_tokener_get_error(tok);
+	json_tokener_free(tok);
+
+	if (j_err != json_tokener_success) {
 		OPAE_ERR("invalid JSON metadata: %s",
 			 json_tokener_error_desc(j_err));
+		if (root)
+			json_object_put(root);
+		return NULL;
+	}
+
+	if (!root) {
+		OPAE_ERR("empty JSON metadata");
 		return NULL;
 	}
 
@@ -206,7 +283,6 @@ STATIC fpga_result opae_resolve_bitstream(opae_bitstream_info *info)
 {
 	opae_bitstream_header *hdr;
 	size_t sz;
-	char *buf;
 
 	if (info->data_len < sizeof(opae_bitstream_header)) {
 		OPAE_ERR("file length smaller than bitstream header: "
@@ -235,26 +311,18 @@ STATIC fpga_result opae_resolve_bitstream(opae_bitstream_info *info)
 	info->rbf_data = info->data + sz;
 	info->rbf_len = info->data_len - sz;
 
-	buf = (char *)opae_malloc(hdr->metadata_length + 1);
-	if (!buf) {
-		OPAE_ERR("malloc failed");
-		return FPGA_NO_MEMORY;
-	}
-
-	memcpy(buf, hdr->metadata, hdr->metadata_length);
-	buf[hdr->metadata_length] = '\0';
-
 	info->parsed_metadata =
-		opae_bitstream_parse_metadata(buf,
+		opae_bitstream_parse_metadata(hdr->metadata,
+					      (size_t)hdr->metadata_length,
 					      info->pr_interface_id,
 					      &info->metadata_version);
 
-	opae_free(buf);
-
 	return info->parsed_metadata ? FPGA_OK : FPGA_EXCEPTION;
 }
 
-fpga_result opae_load_bitstream(const char *file, opae_bitstream_info *info)
+STATIC fpga_result opae_load_bitstream_common(const char *file,
+					      opae_bitstream_info *info,
+					      bool mapped)
 {
 	fpga_result res;
 
@@ -269,13 +337,21 @@ fpga_result opae_load_bitstream(const char *file, opae_bitstream_info *info)
 
 	memset(info, 0, sizeof(opae_bitstream_info));
 
-	res = opae_bitstream_read_file(file, &info->data, &info->data_len);
+	if (mapped)
+		res = opae_bitstream_map_file(file,
+					      &info->data,
+					      &info->data_len);
+	else
+		res = opae_bitstream_read_file(file,
+					       &info->data,
+					       &info->data_len);
 	if (res != FPGA_OK) {
 		OPAE_ERR("error loading \"%s\"", file);
 		return res;
 	}
 
 	info->filename = file;
+	info->mapped = mapped;
 
 	if (opae_is_legacy_bitstream(info)) {
 		opae_resolve_legacy_bitstream(info);
@@ -288,6 +364,16 @@ fpga_result opae_load_bitstream(const char *file, opae_bitstream_info *info)
 	return opae_resolve_bitstream(info);
 }
 
+fpga_result opae_load_bitstream(const char *file, opae_bitstream_info *info)
+{
+	return opae_load_bitstream_common(file, info, false);
+}
+
+fpga_result opae_map_bitstream(const char *file, opae_bitstream_info *info)
+{
+	return opae_load_bitstream_common(file, info, true);
+}
+
 fpga_result opae_unload_bitstream(opae_bitstream_info *info)
 {
 	fpga_result res = FPGA_OK;
@@ -295,8 +381,12 @@ fpga_result opae_unload_bitstream(opae_bitstream_info *info)
 	if (!info)
 		return FPGA_INVALID_PARAM;
 
-	if (info->data)
-		opae_free(info->data);
+	if (info->data) {
+		if (info->mapped)
+			munmap(info->data, info->data_len);
+		else
+			opae_free(info->data);
+	}
 
 	if (info->parsed_metadata) {
 
@@ -86,10 +86,11 @@ typedef struct _opae_bitstream_info {
 	fpga_guid pr_interface_id;	/**< identifies GBS compatibility */
 	int metadata_version;		/**< identifies metadata format */
 	void *parsed_metadata;		/**< the expanded metadata */
+	bool mapped;			/**< data is a read-only file mapping */
 } opae_bitstream_info;
 
 #define OPAE_BITSTREAM_INFO_INITIALIZER \
-{ NULL, NULL, 0, NULL, 0, { 0, }, 0, NULL }
+{ NULL, NULL, 0, NULL, 0, { 0, }, 0, NULL, false }
 
 #ifdef __cplusplus
 extern "C" {
@@ -110,6 +111,28 @@ extern "C" {
  */
 fpga_result opae_load_bitstream(const char *file, opae_bitstream_info *info);
 
+/**
+ * Map a GBS file from disk into memory
+ *
+ * Like `opae_load_bitstream`, but rather than copying the file
+ * into a heap buffer, `info->data` points into a read-only,
+ * private mapping of the file that is advised for sequential
+ * access. The metadata is parsed in place. This avoids holding
+ * two copies of large images while programming.
+ *
+ * The file must not be truncated while it is mapped.
+ *
+ * @param[in] file Location of the GBS file on disk.
+ * @param[out] info Storage for the mapped GBS file contents
+ *                  and its expanded metadata.
+ *
+ * @returns FPGA_OK on success. FPGA_INVALID_PARAM if the bitstream
+ * format is invalid or the file is not a regular, non-empty file.
+ * FPGA_EXCEPTION if the file could not be mapped or a metadata
+ * parsing error was encountered.
+ */
+fpga_result opae_map_bitstream(const char *file, opae_bitstream_info *info);
+
 /**
  * @deprecated Determine whether a loaded GBS is in legacy format.
  *
@@ -120,7 +143,8 @@ bool opae_is_legacy_bitstream(opae_bitstream_info *info);
 /**
  * Unload a memory-resident GBS
  *
- * Used to free the resources allocated by `opae_load_bitstream`.
+ * Used to free the resources allocated by `opae_load_bitstream`
+ * or `opae_map_bitstream`.
  *
  * @param[in] info The loaded GBS info to be released.
  *
@@ -27,4 +27,344 @@
 #include <config.h>
 #endif // HAVE_CONFIG_H
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif // _GNU_SOURCE
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#ifndef __USE_GNU
+#define __USE_GNU
+#endif // __USE_GNU
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
 #include <ofs/ofs_primitives.h>
+
+// Bounds on the calibrated spin window.
+#define OFS_WAIT_SPIN_MIN_USEC 1
+#define OFS_WAIT_SPIN_MAX_USEC 50
+// First backoff sleep after the spin window.
+#define OFS_WAIT_SLEEP_MIN_NSEC 1000
+
+static pthread_once_t wait_calibrated = PTHREAD_ONCE_INIT;
+static int use_tsc;
+static uint64_t ticks_per_usec = USEC2NSEC;
+static uint64_t spin_ticks;
+
+static int stats_enabled;
+static int stats_print_at_exit;
+static ofs_wait_stats *stats_head;
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+static uint64_t monotonic_nsec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * SEC2NSEC + (uint64_t)ts.tv_nsec;
+}
+
+static int tsc_is_invariant(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+	if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) ||
+	    eax < 0x80000007)
+		return 0;
+
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	return (edx >> 8) & 1;
+#else
+	return 0;
+#endif
+}
+
+static inline uint64_t read_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	if (use_tsc)
+		return __rdtsc();
+#endif
+	return monotonic_nsec();
+}
+
+static void ofs_wait_calibrate(void)
+{
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+	uint64_t t0, t1, best = UINT64_MAX;
+	uint64_t spin_usec;
+	char *s;
+	int i;
+
+	if (tsc_is_invariant()) {
+#if defined(__x86_64__) || defined(__i386__)
+		uint64_t c0, c1;
+
+		t0 = monotonic_nsec();
+		c0 = __rdtsc();
+		nanosleep(&ts, NULL);
+		c1 = __rdtsc();
+		t1 = monotonic_nsec();
+
+		if (t1 > t0 && c1 > c0) {
+			ticks_per_usec = (c1 - c0) * USEC2NSEC / (t1 - t0);
+			if (ticks_per_usec)
+				use_tsc = 1;
+			else
+				ticks_per_usec = USEC2NSEC;
+		}
+#endif
+	}
+
+	// Spinning for as long as the shortest sleep really takes
+	// never loses more than a factor of two against sleeping.
+	ts.tv_nsec = OFS_WAIT_SLEEP_MIN_NSEC;
+	for (i = 0 ; i < 3 ; ++i) {
+		t0 = monotonic_nsec();
+		nanosleep(&ts, NULL);
+		t1 = monotonic_nsec();
+		if (t1 - t0 < best)
+			best = t1 - t0;
+	}
+	spin_usec = best / USEC2NSEC;
+
+	s = getenv("LIBOFS_WAIT_SPIN_USEC");
+	if (s)
+		spin_usec = strtoul(s, NULL, 0);
+	else if (sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+		spin_usec = 0; // spinning only delays the thread we wait on
+	else if (spin_usec < OFS_WAIT_SPIN_MIN_USEC)
+		spin_usec = OFS_WAIT_SPIN_MIN_USEC;
+	else if (spin_usec > OFS_WAIT_SPIN_MAX_USEC)
+		spin_usec = OFS_WAIT_SPIN_MAX_USEC;
+
+	spin_ticks = spin_usec * ticks_per_usec;
+}
+
+uint64_t ofs_ticks(void)
+{
+	pthread_once(&wait_calibrated, ofs_wait_calibrate);
+	return read_ticks();
+}
+
+uint64_t ofs_usec_to_ticks(uint64_t usec)
+{
+	pthread_once(&wait_calibrated, ofs_wait_calibrate);
+	if (usec > UINT64_MAX / ticks_per_usec)
+		return UINT64_MAX;
+	return usec * ticks_per_usec;
+}
+
+uint64_t ofs_ticks_to_nsec(uint64_t ticks)
+{
+	pthread_once(&wait_calibrated, ofs_wait_calibrate);
+	if (ticks > UINT64_MAX / USEC2NSEC)
+		return ticks / ticks_per_usec * USEC2NSEC;
+	return ticks * USEC2NSEC / ticks_per_usec;
+}
+
+void ofs_wait_begin(ofs_waiter *w, uint64_t timeout_usec,
+		    uint32_t sleep_usec, int event_fd)
+{
+	uint64_t timeout = ofs_usec_to_ticks(timeout_usec);
+
+	w->begin = read_ticks();
+	w->spin_until = w->begin + spin_ticks;
+	w->deadline = (timeout > UINT64_MAX - w->begin) ?
+		UINT64_MAX : w->begin + timeout;
+	w->max_sleep_nsec = (uint64_t)sleep_usec * USEC2NSEC;
+	w->sleep_nsec = OFS_WAIT_SLEEP_MIN_NSEC;
+	if (w->sleep_nsec > w->max_sleep_nsec)
+		w->sleep_nsec = w->max_sleep_nsec;
+	w->event_fd = event_fd;
+	w->status = 0;
+	w->spins = 0;
+	w->sleeps = 0;
+	w->events = 0;
+}
+
+static void ofs_wait_block(ofs_waiter *w, uint64_t now)
+{
+	uint64_t remaining = ofs_ticks_to_nsec(w->deadline - now);
+	uint64_t nsec = w->sleep_nsec;
+	struct timespec ts;
+
+	if (w->event_fd >= 0 && !nsec)
+		nsec = remaining;
+	else if (nsec > remaining)
+		nsec = remaining;
+
+	ts.tv_sec = nsec / SEC2NSEC;
+	ts.tv_nsec = nsec % SEC2NSEC;
+
+	if (w->event_fd >= 0) {
+		struct pollfd pfd = { .fd = w->event_fd, .events = POLLIN };
+
+		if (ppoll(&pfd, 1, &ts, NULL) > 0 && (pfd.revents & POLLIN)) {
+			uint64_t count;
+
+			// Drain the eventfd so the next wait blocks again.
+			if (read(w->event_fd, &count, sizeof(count)) ==
+			    sizeof(count))
+				++w->events;
+			return;
+		}
+	} else {
+		nanosleep(&ts, NULL);
+	}
+
+	++w->sleeps;
+	if (w->sleep_nsec < w->max_sleep_nsec) {
+		w->sleep_nsec <<= 1;
+		if (w->sleep_nsec > w->max_sleep_nsec)
+			w->sleep_nsec = w->max_sleep_nsec;
+	}
+}
+
+int ofs_wait_step(ofs_waiter *w)
+{
+	uint64_t now = read_ticks();
+
+	if (now > w->deadline) {
+		w->status = 1;
+		return 1;
+	}
+
+	if (now < w->spin_until ||
+	    (!w->max_sleep_nsec && w->event_fd < 0)) {
+		cpu_relax();
+		++w->spins;
+		return 0;
+	}
+
+	ofs_wait_block(w, now);
+	return 0;
+}
+
+static void ofs_wait_stats_register(ofs_wait_stats *site)
+{
+	int expected = 0;
+
+	if (!__atomic_compare_exchange_n(&site->registered, &expected, 1,
+					 false, __ATOMIC_ACQ_REL,
+					 __ATOMIC_ACQUIRE))
+		return;
+
+	site->next = __atomic_load_n(&stats_head, __ATOMIC_ACQUIRE);
+	while (!__atomic_compare_exchange_n(&stats_head, &site->next, site,
+					    true, __ATOMIC_RELEASE,
+					    __ATOMIC_ACQUIRE))
+		;
+}
+
+int ofs_wait_end(ofs_waiter *w, ofs_wait_stats *site)
+{
+	uint64_t nsec, max;
+
+	if (!site || !__atomic_load_n(&stats_enabled, __ATOMIC_RELAXED))
+		return w->status;
+
+	ofs_wait_stats_register(site);
+
+	nsec = ofs_ticks_to_nsec(read_ticks() - w->begin);
+
+	__atomic_add_fetch(&site->calls, 1, __ATOMIC_RELAXED);
+	if (w->status)
+		__atomic_add_fetch(&site->timeouts, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&site->spins, w->spins, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&site->sleeps, w->sleeps, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&site->events, w->events, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&site->total_nsec, nsec, __ATOMIC_RELAXED);
+
+	max = __atomic_load_n(&site->max_nsec, __ATOMIC_RELAXED);
+	while (nsec > max &&
+	       !__atomic_compare_exchange_n(&site->max_nsec, &max, nsec,
+					    true, __ATOMIC_RELAXED,
+					    __ATOMIC_RELAXED))
+		;
+
+	return w->status;
+}
+
+void ofs_wait_stats_enable(int enable)
+{
+	if (enable)
+		pthread_once(&wait_calibrated, ofs_wait_calibrate);
+	__atomic_store_n(&stats_enabled, enable ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+void ofs_wait_stats_foreach(void (*cb)(const ofs_wait_stats *, void *),
+			    void *context)
+{
+	ofs_wait_stats *site;
+
+	for (site = __atomic_load_n(&stats_head, __ATOMIC_ACQUIRE) ;
+	     site ; site = site->next)
+		cb(site, context);
+}
+
+void ofs_wait_stats_reset(void)
+{
+	ofs_wait_stats *site;
+
+	for (site = __atomic_load_n(&stats_head, __ATOMIC_ACQUIRE) ;
+	     site ; site = site->next) {
+		__atomic_store_n(&site->calls, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->timeouts, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->spins, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->sleeps, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->events, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->total_nsec, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->max_nsec, 0, __ATOMIC_RELAXED);
+	}
+}
+
+static void print_site(const ofs_wait_stats *site, void *context)
+{
+	FILE *fp = (FILE *)context;
+	const char *file = strrchr(site->file, '/');
+
+	fprintf(fp, "%s:%d:%s() calls=%" PRIu64 " timeouts=%" PRIu64
+		" avg_nsec=%" PRIu64 " max_nsec=%" PRIu64 " spins=%" PRIu64
+		" sleeps=%" PRIu64 " events=%" PRIu64 "\n",
+		file ? file + 1 : site->file, site->line, site->func,
+		site->calls, site->timeouts,
+		site->calls ? site->total_nsec / site->calls : 0,
+		site->max_nsec, site->spins, site->sleeps, site->events);
+}
+
+void ofs_wait_stats_print(FILE *fp)
+{
+	ofs_wait_stats_foreach(print_site, fp);
+}
+
+__attribute__((constructor)) STATIC void ofs_wait_init(void)
+{
+	if (getenv("LIBOFS_WAIT_STATS")) {
+		stats_print_at_exit = 1;
+		stats_enabled = 1;
+	}
+}
+
+__attribute__((destructor)) STATIC void ofs_wait_release(void)
+{
+	if (stats_print_at_exit)
+		ofs_wait_stats_print(stderr);
+}
@@ -38,6 +38,7 @@
 #include <opae/types_enum.h>
 
 #include "pluginmgr.h"
+#include "api-stats.h"
 #include "opae_int.h"
 #include "props.h"
 #include "mock/opae_std.h"
@@ -73,12 +74,68 @@ __OPAE_API__ fpgaErrStr(fpga_result e)
 	}
 }
 
-STATIC pthread_mutex_t token_list_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+/*
+ * Wrapped token reference counts are atomic, so taking and dropping
+ * references (fpgaOpen, fpgaClose, fpgaCloneToken, fpga_properties
+ * parent fields) never serializes on a global lock.
+ *
+ * Tokens that may be a parent, ie FPGA_DEVICE tokens, are kept on
+ * token_list so that opae_get_parent_token() can find them. Debug
+ * builds keep every token on the list, for leak checking. The lock is
+ * taken only when a listed token is created or destroyed, and for
+ * reading during parent lookup.
+ */
+STATIC pthread_rwlock_t token_list_lock = PTHREAD_RWLOCK_INITIALIZER;
 STATIC opae_wrapped_token token_list_head = {
 	.prev = &token_list_head,
 	.next = &token_list_head,
 };
 
+static inline bool opae_wrapped_token_listed(opae_wrapped_token *wt)
+{
+#ifdef LIBOPAE_DEBUG
+	UNUSED_PARAM(wt);
+	return true;
+#else
+	return ((fpga_token_header *)wt->opae_token)->objtype == FPGA_DEVICE;
+#endif // LIBOPAE_DEBUG
+}
+
+static void opae_link_wrapped_token(opae_wrapped_token *wt)
+{
+	int res = pthread_rwlock_wrlock(&token_list_lock);
+	if (res)
+		OPAE_ERR("pthread_rwlock_wrlock() failed: %s", strerror(res));
+
+	wt->prev = &token_list_head;
+	wt->next = token_list_head.next;
+	token_list_head.next->prev = wt;
+	token_list_head.next = wt;
+
+	if (!res)
+		pthread_rwlock_unlock(&token_list_lock);
+}
+
+static void opae_unlink_wrapped_token(opae_wrapped_token *wt)
+{
+	int res = pthread_rwlock_wrlock(&token_list_lock);
+	if (res)
+		OPAE_ERR("pthread_rwlock_wrlock() failed: %s", strerror(res));
+
+	wt->prev->next = wt->next;
+	wt->next->prev = wt->prev;
+
+#ifdef LIBOPAE_DEBUG
+	if ((token_list_head.prev == &token_list_head) &&
+	    (token_list_head.next == &token_list_head)) {
+		OPAE_DBG("token ref count CLEAN HERE");
+	}
+#endif // LIBOPAE_DEBUG
+
+	if (!res)
+		pthread_rwlock_unlock(&token_list_lock);
+}
+
 opae_wrapped_token *
 opae_allocate_wrapped_token(fpga_token token,
 			    const opae_api_adapter_table *adapter)
@@ -89,11 +146,14 @@ opae_allocate_wrapped_token(fpga_token token,
 	if (wtok) {
 		wtok->magic = OPAE_WRAPPED_TOKEN_MAGIC;
 		wtok->opae_token = token;
-		wtok->ref_count = 0;
+		wtok->ref_count = 1;
 		wtok->prev = wtok->next = NULL;
 		wtok->adapter_table = (opae_api_adapter_table *)adapter;
 
-		opae_upref_wrapped_token(wtok);
+		OPAE_DBG("token ref count begin %p", wtok);
+
+		if (opae_wrapped_token_listed(wtok))
+			opae_link_wrapped_token(wtok);
 	}
 
 	return wtok;
@@ -101,84 +161,79 @@ opae_allocate_wrapped_token(fpga_token token,
 
 void opae_upref_wrapped_token(opae_wrapped_token *wt)
 {
-	int res;
+	uint32_t count = __atomic_add_fetch(&wt->ref_count, 1,
+					    __ATOMIC_RELAXED);
+	OPAE_DBG("token ref count up %p, %u", wt, count);
+#ifndef LIBOPAE_DEBUG
+	UNUSED_PARAM(count);
+#endif // LIBOPAE_DEBUG
+}
 
-	opae_mutex_lock(res, &token_list_lock);
+// Take a reference unless the count has already dropped to zero,
+// ie the token is being destroyed.
+static bool opae_tryref_wrapped_token(opae_wrapped_token *wt)
+{
+	uint32_t count = __atomic_load_n(&wt->ref_count, __ATOMIC_RELAXED);
 
-	++wt->ref_count;
-	if (wt->ref_count == 1) {
-		OPAE_DBG("token ref count begin %p", wt);
-		wt->prev = &token_list_head;
-		wt->next = token_list_head.next;
-		token_list_head.next->prev = wt;
-		token_list_head.next = wt;
-	}
-#ifdef LIBOPAE_DEBUG
-	else {
-		OPAE_DBG("token ref count up %p, %u", wt, wt->ref_count);
-	}
-#endif // LIBOPAE_DEBUG
+	do {
+		if (!count)
+			return false;
+	} while (!__atomic_compare_exchange_n(&wt->ref_count, &count,
+					      count + 1, true,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
 
-	opae_mutex_unlock(res, &token_list_lock);
+	return true;
 }
 
 fpga_result opae_downref_wrapped_token(opae_wrapped_token *wt)
 {
-	int res;
 	fpga_result fres = FPGA_OK;
+	uint32_t count;
 
-	opae_mutex_lock(res, &token_list_lock);
+	count = __atomic_sub_fetch(&wt->ref_count, 1, __ATOMIC_ACQ_REL);
+	if (count) {
+		OPAE_DBG("token ref count down %p, %u", wt, count);
+		return FPGA_OK;
+	}
 
-	--wt->ref_count;
-	if (wt->ref_count == 0) {
-		OPAE_DBG("token ref count end %p", wt);
-		wt->prev->next = wt->next;
-		wt->next->prev = wt->prev;
-		wt->magic = 0;
+	OPAE_DBG("token ref count end %p", wt);
 
-		if (wt->adapter_table->fpgaDestroyToken)
-			fres = wt->adapter_table->fpgaDestroyToken(
-					&wt->opae_token);
-		else
-			fres = FPGA_NOT_SUPPORTED;
+	// Parent lookup skips tokens whose count is zero, and only
+	// dereferences tokens while they are on the list.
+	if (opae_wrapped_token_listed(wt))
+		opae_unlink_wrapped_token(wt);
 
-		opae_free(wt);
+	wt->magic = 0;
 
-#ifdef LIBOPAE_DEBUG
-		if ((token_list_head.prev == &token_list_head) &&
-		    (token_list_head.next == &token_list_head)) {
-			OPAE_DBG("token ref count CLEAN HERE");
-		}
-#endif // LIBOPAE_DEBUG
-	}
-#ifdef LIBOPAE_DEBUG
-	else {
-		OPAE_DBG("token ref count down %p, %u", wt, wt->ref_count);
-	}
-#endif // LIBOPAE_DEBUG
+	if (wt->adapter_table->fpgaDestroyToken)
+		fres = opae_api_call(wt->adapter_table, fpgaDestroyToken,
+				&wt->opae_token);
+	else
+		fres = FPGA_NOT_SUPPORTED;
+
+	opae_free(wt);
 
-	opae_mutex_unlock(res, &token_list_lock);
 	return fres;
 }
 
 #ifdef LIBOPAE_DEBUG
 uint32_t opae_wrapped_tokens_in_use(void)
 {
-	int res;
 	uint32_t count = 0;
 	opae_wrapped_token *wt;
 
-	opae_mutex_lock(res, &token_list_lock);
+	pthread_rwlock_rdlock(&token_list_lock);
 
 	for (wt = token_list_head.next ;
 		wt != &token_list_head ;
 		    wt = wt->next) {
 		++count;
 		OPAE_DBG("token ref count %p, %u LEAKED",
-			 wt, wt->ref_count);
+			 wt, __atomic_load_n(&wt->ref_count, __ATOMIC_RELAXED));
 	}
 
-	opae_mutex_unlock(res, &token_list_lock);
+	pthread_rwlock_unlock(&token_list_lock);
 	return count;
 }
 #endif // LIBOPAE_DEBUG
@@ -260,6 +315,13 @@ opae_allocate_wrapped_object(fpga_object opae_object,
 
 fpga_result __OPAE_API__ fpgaInitialize(const char *config_file)
 {
+	// An explicit config file replaces the implicit initialization.
+	// Otherwise, let it run first so that WITH_ASE is still honored.
+	if (config_file)
+		opae_skip_implicit_initialize();
+	else
+		opae_initialize_on_demand();
+
 	return opae_plugin_mgr_initialize(config_file) ? FPGA_EXCEPTION
 						       : FPGA_OK;
 }
@@ -288,8 +350,8 @@ fpga_result __OPAE_API__ fpgaOpen(fpga_token token, fpga_handle *handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaClose,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_token->adapter_table->fpgaOpen(wrapped_token->opae_token,
-						     &opae_handle, flags);
+	res = opae_api_call(wrapped_token->adapter_table, fpgaOpen,
+		wrapped_token->opae_token, &opae_handle, flags);
 
 	ASSERT_RESULT(res);
 
@@ -299,7 +361,8 @@ fpga_result __OPAE_API__ fpgaOpen(fpga_token token, fpga_handle *handle,
 	if (!wrapped_handle) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		cres = wrapped_token->adapter_table->fpgaClose(opae_handle);
+		cres = opae_api_call(wrapped_token->adapter_table, fpgaClose,
+			opae_handle);
 	}
 
 	*handle = wrapped_handle;
@@ -317,7 +380,7 @@ fpga_result __OPAE_API__ fpgaClose(fpga_handle handle)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaClose,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_handle->adapter_table->fpgaClose(
+	res = opae_api_call(wrapped_handle->adapter_table, fpgaClose,
 		wrapped_handle->opae_handle);
 
 	opae_destroy_wrapped_handle(wrapped_handle);
@@ -334,14 +397,14 @@ fpga_result __OPAE_API__ fpgaReset(fpga_handle handle)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReset,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReset(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaReset,
 		wrapped_handle->opae_handle);
 }
 
 STATIC opae_wrapped_token *
 opae_get_parent_token(opae_wrapped_token *child)
 {
-	int mres = 0;
+	int res;
 	opae_wrapped_token *p;
 	opae_wrapped_token *parent = NULL;
 	fpga_token_header *child_hdr;
@@ -349,8 +412,15 @@ opae_get_parent_token(opae_wrapped_token *child)
 
 	child_hdr = (fpga_token_header *)child->opae_token;
 
-	if (opae_mutex_lock(mres, &token_list_lock))
+	// Only accelerators have parents.
+	if (child_hdr->objtype != FPGA_ACCELERATOR)
+		return NULL;
+
+	res = pthread_rwlock_rdlock(&token_list_lock);
+	if (res) {
+		OPAE_ERR("pthread_rwlock_rdlock() failed: %s", strerror(res));
 		return NULL;
+	}
 
 	for (p = token_list_head.next ;
 		p != &token_list_head ;
@@ -358,14 +428,14 @@ opae_get_parent_token(opae_wrapped_token *child)
 
 		parent_hdr = (fpga_token_header *)p->opae_token;
 
-		if (fpga_is_parent_child(parent_hdr, child_hdr)) {
+		if (fpga_is_parent_child(parent_hdr, child_hdr) &&
+		    opae_tryref_wrapped_token(p)) {
 			parent = p;
-			opae_upref_wrapped_token(parent);
 			break;
 		}
 	}
 
-	opae_mutex_unlock(mres, &token_list_lock);
+	pthread_rwlock_unlock(&token_list_lock);
 
 	return parent;
 }
@@ -386,7 +456,7 @@ fpga_result __OPAE_API__ fpgaGetPropertiesFromHandle(fpga_handle handle,
 		wrapped_handle->adapter_table->fpgaGetPropertiesFromHandle,
 		FPGA_NOT_SUPPORTED);
 
-	res = wrapped_handle->adapter_table->fpgaGetPropertiesFromHandle(
+	res = opae_api_call(wrapped_handle->adapter_table, fpgaGetPropertiesFromHandle,
 		wrapped_handle->opae_handle, prop);
 
 	ASSERT_RESULT(res);
@@ -400,7 +470,7 @@ fpga_result __OPAE_API__ fpgaGetPropertiesFromHandle(fpga_handle handle,
 		p->parent = wrapped_parent;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -436,7 +506,7 @@ fpga_result __OPAE_API__ fpgaGetProperties(fpga_token token,
 			wrapped_token->adapter_table->fpgaGetProperties,
 			FPGA_NOT_SUPPORTED);
 
-		res = wrapped_token->adapter_table->fpgaGetProperties(
+		res = opae_api_call(wrapped_token->adapter_table, fpgaGetProperties,
 			wrapped_token->opae_token, prop);
 
 		ASSERT_RESULT(res);
@@ -450,7 +520,7 @@ fpga_result __OPAE_API__ fpgaGetProperties(fpga_token token,
 			p->parent = wrapped_parent;
 		}
 
-		opae_mutex_unlock(err, &p->lock);
+		opae_properties_unlock(err, p);
 	}
 
 	return res;
@@ -473,7 +543,7 @@ fpga_result __OPAE_API__ fpgaUpdateProperties(fpga_token token,
 	// If the input properties already has a parent token
 	// set, then it will be wrapped.
 
-	p = opae_validate_and_lock_properties(prop);
+	p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -486,11 +556,11 @@ fpga_result __OPAE_API__ fpgaUpdateProperties(fpga_token token,
 		p->parent = NULL;
 	}
 
-	res = wrapped_token->adapter_table->fpgaUpdateProperties(
+	res = opae_api_call(wrapped_token->adapter_table, fpgaUpdateProperties,
 		wrapped_token->opae_token, prop);
 
 	if (res != FPGA_OK) {
-		opae_mutex_unlock(err, &p->lock);
+		opae_properties_unlock(err, p);
 		return res;
 	}
 
@@ -500,7 +570,7 @@ fpga_result __OPAE_API__ fpgaUpdateProperties(fpga_token token,
 		p->parent = wrapped_parent;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -515,7 +585,7 @@ fpga_result __OPAE_API__ fpgaWriteMMIO64(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaWriteMMIO64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaWriteMMIO64(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaWriteMMIO64,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -529,7 +599,7 @@ fpga_result __OPAE_API__ fpgaReadMMIO64(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReadMMIO64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReadMMIO64(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaReadMMIO64,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -543,7 +613,7 @@ fpga_result __OPAE_API__ fpgaWriteMMIO32(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaWriteMMIO32,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaWriteMMIO32(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaWriteMMIO32,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -557,7 +627,7 @@ fpga_result __OPAE_API__ fpgaReadMMIO32(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReadMMIO32,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReadMMIO32(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaReadMMIO32,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -571,7 +641,7 @@ fpga_result __OPAE_API__ fpgaWriteMMIO512(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaWriteMMIO512,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaWriteMMIO512(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaWriteMMIO512,
 		wrapped_handle->opae_handle, mmio_num, offset, value);
 }
 
@@ -585,7 +655,7 @@ fpga_result __OPAE_API__ fpgaMapMMIO(fpga_handle handle, uint32_t mmio_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaMapMMIO,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaMapMMIO(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaMapMMIO,
 		wrapped_handle->opae_handle, mmio_num, mmio_ptr);
 }
 
@@ -598,7 +668,7 @@ fpga_result __OPAE_API__ fpgaUnmapMMIO(fpga_handle handle, uint32_t mmio_num)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaUnmapMMIO,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaUnmapMMIO(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaUnmapMMIO,
 		wrapped_handle->opae_handle, mmio_num);
 }
 
@@ -611,76 +681,103 @@ typedef struct _opae_enumeration_context {
 	uint32_t *num_matches;
 	// </verbatim from fpgaEnumerate>
 
-	fpga_token *adapter_tokens;
 	uint32_t num_wrapped_tokens;
 	uint32_t errors;
 } opae_enumeration_context;
 
-static int opae_enumerate(const opae_api_adapter_table *adapter, void *context)
-{
-	opae_enumeration_context *ctx = (opae_enumeration_context *)context;
+// One adapter's enumeration results. These are produced concurrently by
+// opae_enumerate() and wrapped in adapter order by opae_enumerate_merge(),
+// so token order doesn't depend on which adapter finishes first.
+typedef struct _opae_adapter_enumeration {
 	fpga_result res;
-	uint32_t num_matches = 0;
-	uint32_t i;
-	uint32_t space_remaining;
-
-	space_remaining = ctx->max_wrapped_tokens - ctx->num_wrapped_tokens;
+	uint32_t num_matches;
+	uint32_t max_tokens;
+	fpga_token adapter_tokens[];
+} opae_adapter_enumeration;
 
-	if (ctx->wrapped_tokens && !space_remaining)
-		return OPAE_ENUM_STOP;
+static void *opae_enumerate(const opae_api_adapter_table *adapter,
+			    void *context)
+{
+	opae_enumeration_context *ctx = (opae_enumeration_context *)context;
+	opae_adapter_enumeration *e;
+	uint32_t max_tokens = ctx->wrapped_tokens ? ctx->max_wrapped_tokens : 0;
 
 	if (!adapter->fpgaEnumerate) {
 		OPAE_MSG("NULL fpgaEnumerate in adapter \"%s\"",
 			 adapter->plugin.path);
-		return OPAE_ENUM_CONTINUE;
+		return NULL;
+	}
+
+	// Adapters run side by side, so each may have to fill the
+	// caller's whole token array.
+	e = (opae_adapter_enumeration *)opae_calloc(1,
+		sizeof(opae_adapter_enumeration) +
+		max_tokens * sizeof(fpga_token));
+	if (!e) {
+		OPAE_ERR("out of memory");
+		__sync_fetch_and_add(&ctx->errors, 1);
+		return NULL;
 	}
 
-	res = adapter->fpgaEnumerate(ctx->filters, ctx->num_filters,
-				     ctx->adapter_tokens, space_remaining,
-				     &num_matches);
+	e->max_tokens = max_tokens;
+	e->res = opae_api_call(adapter, fpgaEnumerate,
+		ctx->filters, ctx->num_filters,
+		max_tokens ? e->adapter_tokens : NULL,
+		max_tokens, &e->num_matches);
 
-	if (res != FPGA_OK) {
+	return e;
+}
+
+static void opae_enumerate_merge(const opae_api_adapter_table *adapter,
+				 void *result, void *context)
+{
+	opae_enumeration_context *ctx = (opae_enumeration_context *)context;
+	opae_adapter_enumeration *e = (opae_adapter_enumeration *)result;
+	uint32_t num_tokens;
+	uint32_t i;
+
+	if (!e)
+		return;
+
+	if (e->res != FPGA_OK) {
 		OPAE_DBG("fpgaEnumerate() failed for \"%s\": %s",
-			 adapter->plugin.path, fpgaErrStr(res));
-		switch (res) {
+			 adapter->plugin.path, fpgaErrStr(e->res));
+		switch (e->res) {
 		case FPGA_NO_DRIVER: // Fall through
 		case FPGA_NOT_FOUND:
-			return OPAE_ENUM_CONTINUE;
+			break;
 		default:
+			++ctx->errors;
 			break;
 		}
-		++ctx->errors;
-		return OPAE_ENUM_CONTINUE;
+		goto out_free;
 	}
 
-	*ctx->num_matches += num_matches;
+	*ctx->num_matches += e->num_matches;
 
-	if (!ctx->adapter_tokens) {
-		// requesting token count, only.
-		return OPAE_ENUM_CONTINUE;
-	}
-
-	if (space_remaining > num_matches)
-		space_remaining = num_matches;
+	num_tokens = (e->num_matches < e->max_tokens) ?
+		e->num_matches : e->max_tokens;
 
-	for (i = 0; i < space_remaining; ++i) {
-		opae_wrapped_token *wt = opae_allocate_wrapped_token(
-			ctx->adapter_tokens[i], adapter);
-		if (!wt) {
+	for (i = 0; i < num_tokens; ++i) {
+		if (ctx->num_wrapped_tokens < ctx->max_wrapped_tokens) {
+			opae_wrapped_token *wt = opae_allocate_wrapped_token(
+				e->adapter_tokens[i], adapter);
+			if (wt) {
+				ctx->wrapped_tokens[ctx->num_wrapped_tokens++] =
+					wt;
+				continue;
+			}
 			++ctx->errors;
-			return OPAE_ENUM_STOP;
 		}
 
-		if (ctx->wrapped_tokens) {
-			ctx->wrapped_tokens[ctx->num_wrapped_tokens++] = wt;
-		} else {
-			opae_destroy_wrapped_token(wt);
-		}
+		// Earlier adapters already filled the caller's array.
+		if (adapter->fpgaDestroyToken)
+			opae_api_call(adapter, fpgaDestroyToken,
+				&e->adapter_tokens[i]);
 	}
 
-	return ctx->num_wrapped_tokens == ctx->max_wrapped_tokens
-		       ? OPAE_ENUM_STOP
-		       : OPAE_ENUM_CONTINUE;
+out_free:
+	opae_free(e);
 }
 
 fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
@@ -688,21 +785,17 @@ fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 	uint32_t *num_matches)
 {
 	fpga_result res = FPGA_EXCEPTION;
-	fpga_token *adapter_tokens = NULL;
 
 	opae_enumeration_context enum_context;
 
-	typedef struct _parent_token_fixup {
-		struct _parent_token_fixup *next;
-		fpga_properties prop;
-		opae_wrapped_token *wrapped_token;
-	} parent_token_fixup;
-
-	parent_token_fixup *ptf_list = NULL;
+	struct _fpga_properties *filter_snapshots = NULL;
+	fpga_properties *snapshot_filters = NULL;
 	uint32_t i;
 
 	ASSERT_NOT_NULL(num_matches);
 
+	opae_initialize_on_demand();
+
 	if ((max_tokens > 0) && !tokens) {
 		OPAE_ERR("max_tokens > 0 with NULL tokens");
 		return FPGA_INVALID_PARAM;
@@ -720,103 +813,81 @@ fpga_result __OPAE_API__ fpgaEnumerate(const fpga_properties *filters,
 
 	*num_matches = 0;
 
-	enum_context.filters = filters;
-	enum_context.num_filters = num_filters;
 	enum_context.wrapped_tokens = tokens;
 	enum_context.max_wrapped_tokens = max_tokens;
 	enum_context.num_matches = num_matches;
 
-	if (tokens) {
-		adapter_tokens =
-			(fpga_token *)opae_calloc(max_tokens, sizeof(fpga_token));
-		if (!adapter_tokens) {
-			OPAE_ERR("out of memory");
-			return FPGA_NO_MEMORY;
-		}
-	}
-
-	enum_context.adapter_tokens = adapter_tokens;
 	enum_context.num_wrapped_tokens = 0;
 	enum_context.errors = 0;
 
-	// If any of the input filters has a parent token set,
-	// then it will be wrapped. We need to unwrap it here,
-	// then re-wrap below.
+	// The adapters see read-only snapshots of the input filters,
+	// with any wrapped parent token unwrapped. The adapters read
+	// the snapshots concurrently and without locking, and the
+	// caller's filters are never modified.
+	if (num_filters) {
+		filter_snapshots = (struct _fpga_properties *)opae_calloc(
+			num_filters, sizeof(struct _fpga_properties));
+		snapshot_filters = (fpga_properties *)opae_calloc(
+			num_filters, sizeof(fpga_properties));
+
+		if (!filter_snapshots || !snapshot_filters) {
+			OPAE_ERR("malloc failed");
+			res = FPGA_NO_MEMORY;
+			goto out_free_snapshots;
+		}
+	}
+
 	for (i = 0; i < num_filters; ++i) {
 		int err;
+		struct _fpga_properties *snap = &filter_snapshots[i];
 		struct _fpga_properties *p =
 			opae_validate_and_lock_properties(filters[i]);
 
 		if (!p) {
 			OPAE_ERR("Invalid input filter");
 			res = FPGA_INVALID_PARAM;
-			goto out_free_tokens;
+			goto out_free_snapshots;
 		}
 
-		if (FIELD_VALID(p, FPGA_PROPERTY_PARENT)) {
-			parent_token_fixup *fixup;
+		*snap = *p;
+		memset(&snap->lock, 0, sizeof(snap->lock));
+		snap->flags |= OPAE_PROPERTIES_SNAPSHOT;
+
+		opae_properties_unlock(err, p);
+
+		if (FIELD_VALID(snap, FPGA_PROPERTY_PARENT)) {
 			opae_wrapped_token *wrapped_parent =
-				opae_validate_wrapped_token(p->parent);
+				opae_validate_wrapped_token(snap->parent);
 
 			if (!wrapped_parent) {
 				OPAE_ERR("Invalid wrapped parent in filter");
 				res = FPGA_INVALID_PARAM;
-				opae_mutex_unlock(err, &p->lock);
-				goto out_free_tokens;
-			}
-
-			fixup = (parent_token_fixup *)opae_malloc(
-				sizeof(parent_token_fixup));
-
-			if (!fixup) {
-				OPAE_ERR("malloc failed");
-				res = FPGA_NO_MEMORY;
-				opae_mutex_unlock(err, &p->lock);
-				goto out_free_tokens;
-			}
-
-			fixup->next = NULL;
-			fixup->prop = filters[i];
-			fixup->wrapped_token = wrapped_parent;
-
-			if (!ptf_list)
-				ptf_list = fixup;
-			else {
-				fixup->next = ptf_list;
-				ptf_list = fixup;
+				goto out_free_snapshots;
 			}
 
 			// Set the unwrapped parent token.
-			p->parent = wrapped_parent->opae_token;
+			snap->parent = wrapped_parent->opae_token;
 		}
 
-		opae_mutex_unlock(err, &p->lock);
+		snapshot_filters[i] = snap;
 	}
 
-	// perform the enumeration.
-	opae_plugin_mgr_for_each_adapter(opae_enumerate, &enum_context);
-
-	res = (enum_context.errors > 0) ? FPGA_EXCEPTION : FPGA_OK;
-
-out_free_tokens:
-	if (adapter_tokens)
-		opae_free(adapter_tokens);
+	enum_context.filters = snapshot_filters;
+	enum_context.num_filters = num_filters;
 
-	// Re-establish any wrapped parent tokens.
-	while (ptf_list) {
-		int err;
-		parent_token_fixup *trash = ptf_list;
-		struct _fpga_properties *p =
-			opae_validate_and_lock_properties(trash->prop);
-		ptf_list = ptf_list->next;
+	// perform the enumeration, all adapters at once.
+	if (opae_plugin_mgr_for_each_adapter_concurrent(opae_enumerate,
+							opae_enumerate_merge,
+							&enum_context))
+		++enum_context.errors;
 
-		if (p) {
-			p->parent = trash->wrapped_token;
-			opae_mutex_unlock(err, &p->lock);
-		}
+	res = (enum_context.errors > 0) ? FPGA_EXCEPTION : FPGA_OK;
 
-		opae_free(trash);
-	}
+out_free_snapshots:
+	if (snapshot_filters)
+		opae_free(snapshot_filters);
+	if (filter_snapshots)
+		opae_free(filter_snapshots);
 
 	return res;
 }
@@ -838,7 +909,7 @@ fpga_result __OPAE_API__ fpgaCloneToken(fpga_token src, fpga_token *dst)
 		wrapped_src_token->adapter_table->fpgaDestroyToken,
 		FPGA_NOT_SUPPORTED);
 
-	res = wrapped_src_token->adapter_table->fpgaCloneToken(
+	res = opae_api_call(wrapped_src_token->adapter_table, fpgaCloneToken,
 		wrapped_src_token->opae_token, &cloned_token);
 
 	ASSERT_RESULT(res);
@@ -849,7 +920,7 @@ fpga_result __OPAE_API__ fpgaCloneToken(fpga_token src, fpga_token *dst)
 	if (!wrapped_dst_token) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_src_token->adapter_table->fpgaDestroyToken(
+		dres = opae_api_call(wrapped_src_token->adapter_table, fpgaDestroyToken,
 			&cloned_token);
 	}
 
@@ -921,7 +992,7 @@ fpga_result __OPAE_API__ fpgaPrepareBuffer(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaPrepareBuffer,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaPrepareBuffer(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaPrepareBuffer,
 		wrapped_handle->opae_handle, len, buf_addr, wsid, flags);
 }
 
@@ -934,7 +1005,7 @@ fpga_result __OPAE_API__ fpgaReleaseBuffer(fpga_handle handle, uint64_t wsid)
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaReleaseBuffer,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReleaseBuffer(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaReleaseBuffer,
 		wrapped_handle->opae_handle, wsid);
 }
 
@@ -949,7 +1020,7 @@ fpga_result __OPAE_API__ fpgaGetIOAddress(fpga_handle handle, uint64_t wsid,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetIOAddress,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetIOAddress(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaGetIOAddress,
 		wrapped_handle->opae_handle, wsid, ioaddr);
 }
 
@@ -1001,7 +1072,7 @@ fpga_result __OPAE_API__ fpgaReadError(fpga_token token,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaReadError,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaReadError(
+	return opae_api_call(wrapped_token->adapter_table, fpgaReadError,
 		wrapped_token->opae_token, error_num, value);
 }
 
@@ -1013,7 +1084,7 @@ fpga_result __OPAE_API__ fpgaClearError(fpga_token token, uint32_t error_num)
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaClearError,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaClearError(
+	return opae_api_call(wrapped_token->adapter_table, fpgaClearError,
 		wrapped_token->opae_token, error_num);
 }
 
@@ -1025,7 +1096,7 @@ fpga_result __OPAE_API__ fpgaClearAllErrors(fpga_token token)
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaClearAllErrors,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaClearAllErrors(
+	return opae_api_call(wrapped_token->adapter_table, fpgaClearAllErrors,
 		wrapped_token->opae_token);
 }
 
@@ -1039,7 +1110,7 @@ fpga_result __OPAE_API__ fpgaGetErrorInfo(fpga_token token, uint32_t error_num,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaGetErrorInfo,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_token->adapter_table->fpgaGetErrorInfo(
+	return opae_api_call(wrapped_token->adapter_table, fpgaGetErrorInfo,
 		wrapped_token->opae_token, error_num, error_info);
 }
 
@@ -1089,8 +1160,8 @@ fpga_result __OPAE_API__ fpgaDestroyEventHandle(fpga_event_handle *event_handle)
 			return FPGA_INVALID_PARAM;
 		}
 
-		res = wrapped_event_handle->adapter_table
-			      ->fpgaDestroyEventHandle(
+		res = opae_api_call(wrapped_event_handle->adapter_table,
+			      fpgaDestroyEventHandle,
 				      &wrapped_event_handle->opae_event_handle);
 	}
 
@@ -1135,8 +1206,8 @@ fpga_result __OPAE_API__ fpgaGetOSObjectFromEventHandle(
 		return FPGA_NOT_SUPPORTED;
 	}
 
-	res = wrapped_event_handle->adapter_table
-		      ->fpgaGetOSObjectFromEventHandle(
+	res = opae_api_call(wrapped_event_handle->adapter_table,
+		      fpgaGetOSObjectFromEventHandle,
 			      wrapped_event_handle->opae_event_handle, fd);
 
 	opae_mutex_unlock(ires, &wrapped_event_handle->lock);
@@ -1171,7 +1242,7 @@ fpga_result __OPAE_API__ fpgaRegisterEvent(fpga_handle handle,
 			return FPGA_NOT_SUPPORTED;
 		}
 
-		res = wrapped_handle->adapter_table->fpgaCreateEventHandle(
+		res = opae_api_call(wrapped_handle->adapter_table, fpgaCreateEventHandle,
 			&wrapped_event_handle->opae_event_handle);
 
 		if (res != FPGA_OK) {
@@ -1204,7 +1275,7 @@ fpga_result __OPAE_API__ fpgaRegisterEvent(fpga_handle handle,
 		return FPGA_NOT_SUPPORTED;
 	}
 
-	res = wrapped_event_handle->adapter_table->fpgaRegisterEvent(
+	res = opae_api_call(wrapped_event_handle->adapter_table, fpgaRegisterEvent,
 		wrapped_handle->opae_handle, event_type,
 		wrapped_event_handle->opae_event_handle, flags);
 
@@ -1248,7 +1319,7 @@ fpga_result __OPAE_API__ fpgaUnregisterEvent(fpga_handle handle,
 		return FPGA_NOT_SUPPORTED;
 	}
 
-	res = wrapped_event_handle->adapter_table->fpgaUnregisterEvent(
+	res = opae_api_call(wrapped_event_handle->adapter_table, fpgaUnregisterEvent,
 		wrapped_handle->opae_handle, event_type,
 		wrapped_event_handle->opae_event_handle);
 
@@ -1268,7 +1339,7 @@ fpga_result __OPAE_API__ fpgaAssignPortToInterface(fpga_handle fpga,
 		wrapped_handle->adapter_table->fpgaAssignPortToInterface,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaAssignPortToInterface(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaAssignPortToInterface,
 		wrapped_handle->opae_handle, interface_num, slot_num, flags);
 }
 
@@ -1286,7 +1357,7 @@ fpga_result __OPAE_API__ fpgaAssignToInterface(fpga_handle fpga,
 		wrapped_handle->adapter_table->fpgaAssignToInterface,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaAssignToInterface(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaAssignToInterface,
 		wrapped_handle->opae_handle, wrapped_token->opae_token,
 		host_interface, flags);
 }
@@ -1305,7 +1376,7 @@ fpga_result __OPAE_API__ fpgaReleaseFromInterface(fpga_handle fpga,
 		wrapped_handle->adapter_table->fpgaReleaseFromInterface,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReleaseFromInterface(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaReleaseFromInterface,
 		wrapped_handle->opae_handle, wrapped_token->opae_token);
 }
 
@@ -1322,7 +1393,7 @@ fpga_result __OPAE_API__ fpgaReconfigureSlot(fpga_handle fpga, uint32_t slot,
 		wrapped_handle->adapter_table->fpgaReconfigureSlot,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaReconfigureSlot(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaReconfigureSlot,
 		wrapped_handle->opae_handle, slot, bitstream, bitstream_len,
 		flags);
 }
@@ -1344,7 +1415,7 @@ fpga_result __OPAE_API__ fpgaTokenGetObject(fpga_token token, const char *name,
 	ASSERT_NOT_NULL_RESULT(wrapped_token->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_token->adapter_table->fpgaTokenGetObject(
+	res = opae_api_call(wrapped_token->adapter_table, fpgaTokenGetObject,
 		wrapped_token->opae_token, name, &obj, flags);
 
 	ASSERT_RESULT(res);
@@ -1355,7 +1426,8 @@ fpga_result __OPAE_API__ fpgaTokenGetObject(fpga_token token, const char *name,
 	if (!wrapped_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_token->adapter_table->fpgaDestroyObject(&obj);
+		dres = opae_api_call(wrapped_token->adapter_table, fpgaDestroyObject,
+				&obj);
 	}
 
 	*object = wrapped_object;
@@ -1382,7 +1454,7 @@ fpga_result __OPAE_API__ fpgaHandleGetObject(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_handle->adapter_table->fpgaHandleGetObject(
+	res = opae_api_call(wrapped_handle->adapter_table, fpgaHandleGetObject,
 		wrapped_handle->opae_handle, name, &obj, flags);
 
 	ASSERT_RESULT(res);
@@ -1393,7 +1465,8 @@ fpga_result __OPAE_API__ fpgaHandleGetObject(fpga_handle handle,
 	if (!wrapped_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_handle->adapter_table->fpgaDestroyObject(&obj);
+		dres = opae_api_call(wrapped_handle->adapter_table, fpgaDestroyObject,
+				&obj);
 	}
 
 	*object = wrapped_object;
@@ -1419,7 +1492,7 @@ fpga_result __OPAE_API__ fpgaObjectGetObjectAt(fpga_object parent,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_object->adapter_table->fpgaObjectGetObjectAt(
+	res = opae_api_call(wrapped_object->adapter_table, fpgaObjectGetObjectAt,
 		wrapped_object->opae_object, index, &obj);
 
 	ASSERT_RESULT(res);
@@ -1430,7 +1503,8 @@ fpga_result __OPAE_API__ fpgaObjectGetObjectAt(fpga_object parent,
 	if (!wrapped_child_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_object->adapter_table->fpgaDestroyObject(&obj);
+		dres = opae_api_call(wrapped_object->adapter_table, fpgaDestroyObject,
+				&obj);
 	}
 
 	*object = wrapped_child_object;
@@ -1458,7 +1532,7 @@ fpga_result __OPAE_API__ fpgaObjectGetObject(fpga_object parent,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_object->adapter_table->fpgaObjectGetObject(
+	res = opae_api_call(wrapped_object->adapter_table, fpgaObjectGetObject,
 		wrapped_object->opae_object, name, &obj, flags);
 
 	ASSERT_RESULT(res);
@@ -1469,7 +1543,8 @@ fpga_result __OPAE_API__ fpgaObjectGetObject(fpga_object parent,
 	if (!wrapped_child_object) {
 		OPAE_ERR("malloc failed");
 		res = FPGA_NO_MEMORY;
-		dres = wrapped_object->adapter_table->fpgaDestroyObject(&obj);
+		dres = opae_api_call(wrapped_object->adapter_table, fpgaDestroyObject,
+				&obj);
 	}
 
 	*object = wrapped_child_object;
@@ -1490,7 +1565,7 @@ fpga_result __OPAE_API__ fpgaDestroyObject(fpga_object *obj)
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaDestroyObject,
 			       FPGA_NOT_SUPPORTED);
 
-	res = wrapped_object->adapter_table->fpgaDestroyObject(
+	res = opae_api_call(wrapped_object->adapter_table, fpgaDestroyObject,
 		&wrapped_object->opae_object);
 
 	opae_destroy_wrapped_object(wrapped_object);
@@ -1508,7 +1583,7 @@ fpga_result __OPAE_API__ fpgaObjectRead(fpga_object obj, uint8_t *buffer,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectRead,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectRead(
+	return opae_api_call(wrapped_object->adapter_table, fpgaObjectRead,
 		wrapped_object->opae_object, buffer, offset, len, flags);
 }
 
@@ -1522,7 +1597,7 @@ fpga_result __OPAE_API__ fpgaObjectGetSize(fpga_object obj, uint64_t *value,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectGetSize,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectGetSize(
+	return opae_api_call(wrapped_object->adapter_table, fpgaObjectGetSize,
 		wrapped_object->opae_object, value, flags);
 }
 
@@ -1536,7 +1611,7 @@ fpga_result __OPAE_API__ fpgaObjectGetType(fpga_object obj,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectGetType,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectGetType(
+	return opae_api_call(wrapped_object->adapter_table, fpgaObjectGetType,
 		wrapped_object->opae_object, type);
 }
 
@@ -1550,7 +1625,7 @@ fpga_result __OPAE_API__ fpgaObjectRead64(fpga_object obj, uint64_t *value,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectRead64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectRead64(
+	return opae_api_call(wrapped_object->adapter_table, fpgaObjectRead64,
 		wrapped_object->opae_object, value, flags);
 }
 
@@ -1563,7 +1638,7 @@ fpga_result __OPAE_API__ fpgaObjectWrite64(fpga_object obj, uint64_t value,
 	ASSERT_NOT_NULL_RESULT(wrapped_object->adapter_table->fpgaObjectWrite64,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_object->adapter_table->fpgaObjectWrite64(
+	return opae_api_call(wrapped_object->adapter_table, fpgaObjectWrite64,
 		wrapped_object->opae_object, value, flags);
 }
 
@@ -1577,7 +1652,7 @@ fpga_result __OPAE_API__ fpgaSetUserClock(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaSetUserClock,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaSetUserClock(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaSetUserClock,
 		wrapped_handle->opae_handle, high_clk, low_clk, flags);
 }
 
@@ -1593,7 +1668,7 @@ fpga_result __OPAE_API__ fpgaGetUserClock(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetUserClock,
 			       FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetUserClock(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaGetUserClock,
 		wrapped_handle->opae_handle, high_clk, low_clk, flags);
 }
 
@@ -1609,7 +1684,7 @@ fpga_result __OPAE_API__ fpgaGetNumMetrics(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetNumMetrics,
 			     FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetNumMetrics(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaGetNumMetrics,
 		wrapped_handle->opae_handle, num_metrics);
 }
 
@@ -1626,7 +1701,7 @@ fpga_result __OPAE_API__ fpgaGetMetricsInfo(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsInfo,
 			    FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsInfo(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaGetMetricsInfo,
 		wrapped_handle->opae_handle, metric_info, num_metrics);
 }
 
@@ -1645,7 +1720,7 @@ fpga_result __OPAE_API__ fpgaGetMetricsByIndex(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsByIndex,
 			   FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsByIndex(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaGetMetricsByIndex,
 		wrapped_handle->opae_handle, metric_num, num_metric_indexes, metrics);
 }
 
@@ -1664,7 +1739,7 @@ fpga_result __OPAE_API__ fpgaGetMetricsByName(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsByName,
 			   FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsByName(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaGetMetricsByName,
 		wrapped_handle->opae_handle, metrics_names, num_metric_names, metrics);
 }
 
@@ -1681,6 +1756,6 @@ fpga_result __OPAE_API__ fpgaGetMetricsThresholdInfo(fpga_handle handle,
 	ASSERT_NOT_NULL_RESULT(wrapped_handle->adapter_table->fpgaGetMetricsThresholdInfo,
 		FPGA_NOT_SUPPORTED);
 
-	return wrapped_handle->adapter_table->fpgaGetMetricsThresholdInfo(
+	return opae_api_call(wrapped_handle->adapter_table, fpgaGetMetricsThresholdInfo,
 		wrapped_handle->opae_handle, metric_thresholds, num_thresholds);
 }
@@ -0,0 +1,789 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include <opae/log.h>
+#include <opae/utils.h>
+
+#include "api-stats.h"
+#include "opae_int.h"
+#include "mock/opae_std.h"
+
+#define OPAE_API_STATS_MAX_ADAPTERS 16
+#define OPAE_API_TRACE_SLOTS 1024 /* power of 2 */
+
+#define OPAE_API_STATS_NAME(__api) #__api,
+STATIC const char *opae_api_names[OPAE_API_COUNT] = {
+	OPAE_API_STATS_LIST(OPAE_API_STATS_NAME)
+};
+#undef OPAE_API_STATS_NAME
+
+typedef struct _opae_api_counters {
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t total_nsec;
+	uint64_t min_nsec;
+	uint64_t max_nsec;
+	uint64_t histogram[FPGA_API_STATS_BUCKETS];
+} opae_api_counters;
+
+/*
+ * One thread's counters for one adapter. The adapter pointer is only
+ * a lookup hint, valid for the thread's generation: adapters are freed
+ * by fpgaFinalize(), so entries are identified by name_id, an index
+ * into the append-only names table.
+ */
+typedef struct _opae_api_adapter_stats {
+	const opae_api_adapter_table *adapter;
+	uint32_t name_id;
+	opae_api_counters counters[OPAE_API_COUNT];
+} opae_api_adapter_stats;
+
+/*
+ * Each thread updates only its own block, so the counters need no
+ * read-modify-write atomics. Readers merge all blocks under
+ * stats_lock. A thread's block is folded into retired_stats when the
+ * thread exits.
+ */
+typedef struct _opae_api_thread_stats {
+	struct _opae_api_thread_stats *next;
+	uint32_t generation;
+	uint32_t num_adapters;
+	opae_api_adapter_stats *adapters[OPAE_API_STATS_MAX_ADAPTERS];
+} opae_api_thread_stats;
+
+typedef struct _opae_api_trace_slot {
+	uint64_t seq; /* index + 1 when complete, 0 while being written */
+	uint64_t start;
+	uint64_t duration;
+	uint32_t tid;
+	uint32_t name_id;
+	uint32_t api;
+	int32_t result;
+} opae_api_trace_slot;
+
+int opae_api_stats_flags;
+static int stats_dump_at_exit;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+static __thread opae_api_thread_stats *tls_stats;
+static opae_api_thread_stats *thread_stats;
+static opae_api_thread_stats retired_stats;
+
+/* Bumped whenever the adapters are freed. */
+static uint32_t adapters_generation;
+
+static char adapter_names[OPAE_API_STATS_MAX_ADAPTERS]
+			 [FPGA_API_STATS_NAME_MAX];
+static uint32_t num_adapter_names;
+
+static opae_api_trace_slot *trace_ring;
+static uint64_t trace_head;
+static uint64_t trace_base;
+
+static inline uint64_t opae_api_load(const uint64_t *p)
+{
+	return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static inline void opae_api_store(uint64_t *p, uint64_t v)
+{
+	__atomic_store_n(p, v, __ATOMIC_RELAXED);
+}
+
+uint64_t opae_api_stats_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void opae_api_counters_reset(opae_api_counters *c)
+{
+	int i;
+
+	opae_api_store(&c->calls, 0);
+	opae_api_store(&c->errors, 0);
+	opae_api_store(&c->total_nsec, 0);
+	opae_api_store(&c->min_nsec, UINT64_MAX);
+	opae_api_store(&c->max_nsec, 0);
+	for (i = 0 ; i < FPGA_API_STATS_BUCKETS ; ++i)
+		opae_api_store(&c->histogram[i], 0);
+}
+
+static void opae_api_counters_add(opae_api_counters *dst,
+				  opae_api_counters *src)
+{
+	uint64_t v;
+	int i;
+
+	opae_api_store(&dst->calls,
+		       opae_api_load(&dst->calls) + opae_api_load(&src->calls));
+	opae_api_store(&dst->errors,
+		       opae_api_load(&dst->errors) + opae_api_load(&src->errors));
+	opae_api_store(&dst->total_nsec,
+		       opae_api_load(&dst->total_nsec) +
+		       opae_api_load(&src->total_nsec));
+
+	v = opae_api_load(&src->min_nsec);
+	if (v < opae_api_load(&dst->min_nsec))
+		opae_api_store(&dst->min_nsec, v);
+
+	v = opae_api_load(&src->max_nsec);
+	if (v > opae_api_load(&dst->max_nsec))
+		opae_api_store(&dst->max_nsec, v);
+
+	for (i = 0 ; i < FPGA_API_STATS_BUCKETS ; ++i)
+		opae_api_store(&dst->histogram[i],
+			       opae_api_load(&dst->histogram[i]) +
+			       opae_api_load(&src->histogram[i]));
+}
+
+static opae_api_adapter_stats *
+opae_api_adapter_stats_alloc(const opae_api_adapter_table *adapter,
+			     uint32_t name_id)
+{
+	opae_api_adapter_stats *as;
+	int i;
+
+	as = opae_calloc(1, sizeof(opae_api_adapter_stats));
+	if (!as)
+		return NULL;
+
+	as->adapter = adapter;
+	as->name_id = name_id;
+	for (i = 0 ; i < OPAE_API_COUNT ; ++i)
+		opae_api_counters_reset(&as->counters[i]);
+
+	return as;
+}
+
+static opae_api_adapter_stats *
+opae_api_thread_stats_find(opae_api_thread_stats *ts, uint32_t name_id,
+			   int create)
+{
+	opae_api_adapter_stats *as;
+	uint32_t i;
+
+	for (i = 0 ; i < ts->num_adapters ; ++i) {
+		if (ts->adapters[i]->name_id == name_id)
+			return ts->adapters[i];
+	}
+
+	if (!create || ts->num_adapters >= OPAE_API_STATS_MAX_ADAPTERS)
+		return NULL;
+
+	as = opae_api_adapter_stats_alloc(NULL, name_id);
+	if (as)
+		ts->adapters[ts->num_adapters++] = as;
+
+	return as;
+}
+
+static void opae_api_thread_stats_free(opae_api_thread_stats *ts)
+{
+	uint32_t i;
+
+	for (i = 0 ; i < ts->num_adapters ; ++i)
+		opae_free(ts->adapters[i]);
+	ts->num_adapters = 0;
+}
+
+static void opae_api_stats_thread_exit(void *arg)
+{
+	opae_api_thread_stats *ts = (opae_api_thread_stats *)arg;
+	opae_api_thread_stats **prev;
+	uint32_t i;
+	int res;
+
+	opae_mutex_lock(res, &stats_lock);
+
+	for (prev = &thread_stats ; *prev ; prev = &(*prev)->next) {
+		if (*prev == ts) {
+			*prev = ts->next;
+			break;
+		}
+	}
+
+	for (i = 0 ; i < ts->num_adapters ; ++i) {
+		opae_api_adapter_stats *retired =
+			opae_api_thread_stats_find(&retired_stats,
+						   ts->adapters[i]->name_id, 1);
+		int api;
+
+		if (!retired)
+			continue;
+
+		for (api = 0 ; api < OPAE_API_COUNT ; ++api)
+			opae_api_counters_add(&retired->counters[api],
+					      &ts->adapters[i]->counters[api]);
+	}
+
+	opae_mutex_unlock(res, &stats_lock);
+
+	opae_api_thread_stats_free(ts);
+	opae_free(ts);
+}
+
+static void opae_api_stats_once(void)
+{
+	pthread_key_create(&stats_key, opae_api_stats_thread_exit);
+}
+
+// Called with stats_lock held.
+static uint32_t opae_api_stats_name_id(const opae_api_adapter_table *adapter)
+{
+	const char *name = "unknown";
+	uint32_t i;
+
+	if (adapter->plugin.path) {
+		name = strrchr(adapter->plugin.path, '/');
+		name = name ? name + 1 : adapter->plugin.path;
+	}
+
+	for (i = 0 ; i < num_adapter_names ; ++i) {
+		if (!strncmp(adapter_names[i], name, FPGA_API_STATS_NAME_MAX - 1))
+			return i;
+	}
+
+	if (num_adapter_names >= OPAE_API_STATS_MAX_ADAPTERS)
+		return OPAE_API_STATS_MAX_ADAPTERS;
+
+	strncpy(adapter_names[num_adapter_names], name,
+		FPGA_API_STATS_NAME_MAX - 1);
+	return num_adapter_names++;
+}
+
+static opae_api_adapter_stats *
+opae_api_stats_lookup(const opae_api_adapter_table *adapter)
+{
+	opae_api_thread_stats *ts = tls_stats;
+	opae_api_adapter_stats *as = NULL;
+	uint32_t name_id;
+	uint32_t i;
+	int res;
+
+	if (ts && ts->generation ==
+		  __atomic_load_n(&adapters_generation, __ATOMIC_ACQUIRE)) {
+		for (i = 0 ; i < ts->num_adapters ; ++i) {
+			if (ts->adapters[i]->adapter == adapter)
+				return ts->adapters[i];
+		}
+	}
+
+	// Slow path: first call into this adapter from this thread.
+	pthread_once(&stats_once, opae_api_stats_once);
+
+	opae_mutex_lock(res, &stats_lock);
+
+	name_id = opae_api_stats_name_id(adapter);
+	if (name_id >= OPAE_API_STATS_MAX_ADAPTERS)
+		goto out_unlock;
+
+	if (!ts) {
+		ts = opae_calloc(1, sizeof(opae_api_thread_stats));
+		if (!ts)
+			goto out_unlock;
+		ts->next = thread_stats;
+		thread_stats = ts;
+		tls_stats = ts;
+		pthread_setspecific(stats_key, ts);
+	}
+
+	// Adapters freed since this thread last looked may have been
+	// reallocated at the same addresses: forget all of the hints.
+	if (ts->generation != adapters_generation) {
+		for (i = 0 ; i < ts->num_adapters ; ++i)
+			ts->adapters[i]->adapter = NULL;
+		ts->generation = adapters_generation;
+	}
+
+	// An entry from an earlier generation may name the same plugin.
+	// Otherwise allocate a new entry.
+	for (i = 0 ; i < ts->num_adapters ; ++i) {
+		if (ts->adapters[i]->name_id == name_id) {
+			as = ts->adapters[i];
+			as->adapter = adapter;
+			goto out_unlock;
+		}
+	}
+
+	if (ts->num_adapters < OPAE_API_STATS_MAX_ADAPTERS) {
+		as = opae_api_adapter_stats_alloc(adapter, name_id);
+		if (as)
+			ts->adapters[ts->num_adapters++] = as;
+	}
+
+out_unlock:
+	opae_mutex_unlock(res, &stats_lock);
+	return as;
+}
+
+static void opae_api_trace_record(opae_api_id api, uint32_t name_id,
+				  uint64_t start, uint64_t duration,
+				  fpga_result result)
+{
+	opae_api_trace_slot *ring = __atomic_load_n(&trace_ring,
+						    __ATOMIC_ACQUIRE);
+	opae_api_trace_slot *slot;
+	uint64_t idx;
+
+	if (!ring)
+		return;
+
+	idx = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+	slot = &ring[idx & (OPAE_API_TRACE_SLOTS - 1)];
+
+	// Release stores order the seq = 0 marker before each field, so a
+	// reader that sees any new field also sees the slot as changed.
+	__atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->start, start, __ATOMIC_RELEASE);
+	__atomic_store_n(&slot->duration, duration, __ATOMIC_RELEASE);
+	__atomic_store_n(&slot->tid, (uint32_t)syscall(SYS_gettid),
+			 __ATOMIC_RELEASE);
+	__atomic_store_n(&slot->name_id, name_id, __ATOMIC_RELEASE);
+	__atomic_store_n(&slot->api, (uint32_t)api, __ATOMIC_RELEASE);
+	__atomic_store_n(&slot->result, (int32_t)result, __ATOMIC_RELEASE);
+
+	__atomic_store_n(&slot->seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+void opae_api_stats_adapters_released(void)
+{
+	int res;
+
+	opae_mutex_lock(res, &stats_lock);
+	__atomic_store_n(&adapters_generation, adapters_generation + 1,
+			 __ATOMIC_RELEASE);
+	opae_mutex_unlock(res, &stats_lock);
+}
+
+void opae_api_stats_record(opae_api_id api,
+			   const opae_api_adapter_table *adapter,
+			   uint64_t start, fpga_result result)
+{
+	uint64_t nsec = opae_api_stats_clock() - start;
+	opae_api_adapter_stats *as = opae_api_stats_lookup(adapter);
+	opae_api_counters *c;
+	int bucket;
+
+	if (!as)
+		return;
+
+	c = &as->counters[api];
+
+	opae_api_store(&c->calls, opae_api_load(&c->calls) + 1);
+	if (result != FPGA_OK)
+		opae_api_store(&c->errors, opae_api_load(&c->errors) + 1);
+	opae_api_store(&c->total_nsec, opae_api_load(&c->total_nsec) + nsec);
+	if (nsec < opae_api_load(&c->min_nsec))
+		opae_api_store(&c->min_nsec, nsec);
+	if (nsec > opae_api_load(&c->max_nsec))
+		opae_api_store(&c->max_nsec, nsec);
+
+	bucket = nsec ? 63 - __builtin_clzll(nsec) : 0;
+	if (bucket >= FPGA_API_STATS_BUCKETS)
+		bucket = FPGA_API_STATS_BUCKETS - 1;
+	opae_api_store(&c->histogram[bucket],
+		       opae_api_load(&c->histogram[bucket]) + 1);
+
+	if (opae_api_stats_flags & FPGA_API_STATS_TRACE)
+		opae_api_trace_record(api, as->name_id, start, nsec, result);
+}
+
+fpga_result __OPAE_API__ fpgaEnableApiStats(int flags)
+{
+	opae_api_trace_slot *ring;
+
+	if (flags & ~(FPGA_API_STATS_ENABLE | FPGA_API_STATS_TRACE)) {
+		OPAE_ERR("invalid flags 0x%x", flags);
+		return FPGA_INVALID_PARAM;
+	}
+
+	// Tracing implies counting.
+	if (flags & FPGA_API_STATS_TRACE)
+		flags |= FPGA_API_STATS_ENABLE;
+
+	if ((flags & FPGA_API_STATS_TRACE) &&
+	    !__atomic_load_n(&trace_ring, __ATOMIC_ACQUIRE)) {
+		ring = opae_calloc(OPAE_API_TRACE_SLOTS,
+				   sizeof(opae_api_trace_slot));
+		if (!ring) {
+			OPAE_ERR("calloc failed");
+			return FPGA_NO_MEMORY;
+		}
+
+		// The ring is never freed: callers may still be
+		// recording into it after stats are disabled.
+		if (!__sync_bool_compare_and_swap(&trace_ring, NULL, ring))
+			opae_free(ring);
+	}
+
+	__atomic_store_n(&opae_api_stats_flags, flags, __ATOMIC_RELEASE);
+
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaResetApiStats(void)
+{
+	opae_api_thread_stats *ts;
+	uint32_t i;
+	int api;
+	int res;
+
+	opae_mutex_lock(res, &stats_lock);
+
+	for (ts = thread_stats ; ts ; ts = ts->next) {
+		for (i = 0 ; i < ts->num_adapters ; ++i)
+			for (api = 0 ; api < OPAE_API_COUNT ; ++api)
+				opae_api_counters_reset(
+					&ts->adapters[i]->counters[api]);
+	}
+
+	opae_api_thread_stats_free(&retired_stats);
+
+	__atomic_store_n(&trace_base,
+			 __atomic_load_n(&trace_head, __ATOMIC_RELAXED),
+			 __ATOMIC_RELAXED);
+
+	opae_mutex_unlock(res, &stats_lock);
+
+	return FPGA_OK;
+}
+
+// Called with stats_lock held.
+static void opae_api_stats_merge(opae_api_thread_stats *merged)
+{
+	opae_api_thread_stats *ts;
+	uint32_t i;
+	int api;
+
+	for (ts = thread_stats ; ; ts = ts->next) {
+		opae_api_thread_stats *src = ts ? ts : &retired_stats;
+
+		for (i = 0 ; i < src->num_adapters ; ++i) {
+			opae_api_adapter_stats *dst =
+				opae_api_thread_stats_find(merged,
+					src->adapters[i]->name_id, 1);
+			if (!dst)
+				continue;
+
+			for (api = 0 ; api < OPAE_API_COUNT ; ++api)
+				opae_api_counters_add(&dst->counters[api],
+					&src->adapters[i]->counters[api]);
+		}
+
+		if (!ts)
+			break;
+	}
+}
+
+fpga_result __OPAE_API__ fpgaGetApiStats(fpga_api_stats *stats,
+					 uint32_t max_stats,
+					 uint32_t *num_stats)
+{
+	opae_api_thread_stats merged;
+	uint32_t count = 0;
+	uint32_t i;
+	int api;
+	int res;
+
+	ASSERT_NOT_NULL(num_stats);
+
+	if (max_stats && !stats) {
+		OPAE_ERR("max_stats > 0 with NULL stats");
+		return FPGA_INVALID_PARAM;
+	}
+
+	memset(&merged, 0, sizeof(merged));
+
+	opae_mutex_lock(res, &stats_lock);
+
+	opae_api_stats_merge(&merged);
+
+	for (i = 0 ; i < merged.num_adapters ; ++i) {
+		opae_api_adapter_stats *as = merged.adapters[i];
+
+		for (api = 0 ; api < OPAE_API_COUNT ; ++api) {
+			opae_api_counters *c = &as->counters[api];
+			fpga_api_stats *s;
+
+			if (!c->calls)
+				continue;
+
+			if (count++ >= max_stats)
+				continue;
+
+			s = &stats[count - 1];
+			memset(s, 0, sizeof(*s));
+			strncpy(s->api, opae_api_names[api],
+				sizeof(s->api) - 1);
+			strncpy(s->adapter, adapter_names[as->name_id],
+				sizeof(s->adapter) - 1);
+			s->calls = c->calls;
+			s->errors = c->errors;
+			s->total_nsec = c->total_nsec;
+			s->min_nsec = c->min_nsec;
+			s->max_nsec = c->max_nsec;
+			memcpy(s->histogram, c->histogram,
+			       sizeof(s->histogram));
+		}
+	}
+
+	opae_mutex_unlock(res, &stats_lock);
+
+	opae_api_thread_stats_free(&merged);
+
+	*num_stats = count;
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaGetApiTrace(fpga_api_trace_entry *entries,
+					 uint32_t max_entries,
+					 uint32_t *num_entries,
+					 uint32_t *num_available)
+{
+	opae_api_trace_slot *ring;
+	uint64_t head;
+	uint64_t idx;
+	uint64_t avail;
+	uint32_t count = 0;
+	int res;
+
+	ASSERT_NOT_NULL(num_entries);
+
+	if (max_entries && !entries) {
+		OPAE_ERR("max_entries > 0 with NULL entries");
+		return FPGA_INVALID_PARAM;
+	}
+
+	*num_entries = 0;
+	if (num_available)
+		*num_available = 0;
+
+	ring = __atomic_load_n(&trace_ring, __ATOMIC_ACQUIRE);
+	if (!ring)
+		return FPGA_OK;
+
+	opae_mutex_lock(res, &stats_lock);
+
+	head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+	idx = __atomic_load_n(&trace_base, __ATOMIC_RELAXED);
+	if (head - idx > OPAE_API_TRACE_SLOTS)
+		idx = head - OPAE_API_TRACE_SLOTS;
+
+	avail = head - idx;
+
+	// Return the most recent max_entries.
+	if (head - idx > max_entries)
+		idx = head - max_entries;
+
+	for ( ; idx < head ; ++idx) {
+		opae_api_trace_slot *slot =
+			&ring[idx & (OPAE_API_TRACE_SLOTS - 1)];
+		fpga_api_trace_entry e;
+		uint32_t name_id;
+		uint32_t api;
+		uint64_t seq;
+
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq != idx + 1)
+			continue; // still being written, or overwritten
+
+		memset(&e, 0, sizeof(e));
+		e.start_nsec = __atomic_load_n(&slot->start, __ATOMIC_ACQUIRE);
+		e.duration_nsec = __atomic_load_n(&slot->duration,
+						  __ATOMIC_ACQUIRE);
+		e.tid = __atomic_load_n(&slot->tid, __ATOMIC_ACQUIRE);
+		e.result = (fpga_result)__atomic_load_n(&slot->result,
+							__ATOMIC_ACQUIRE);
+		name_id = __atomic_load_n(&slot->name_id, __ATOMIC_ACQUIRE);
+		api = __atomic_load_n(&slot->api, __ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+			continue;
+
+		if (api < OPAE_API_COUNT)
+			strncpy(e.api, opae_api_names[api], sizeof(e.api) - 1);
+		if (name_id < num_adapter_names)
+			strncpy(e.adapter, adapter_names[name_id],
+				sizeof(e.adapter) - 1);
+		entries[count++] = e;
+	}
+
+	opae_mutex_unlock(res, &stats_lock);
+
+	*num_entries = count;
+	if (num_available)
+		*num_available = (uint32_t)avail;
+	return FPGA_OK;
+}
+
+// Upper bound of the histogram bucket holding the given percentile.
+static uint64_t opae_api_stats_percentile(const fpga_api_stats *s,
+					  unsigned pct)
+{
+	uint64_t target = (s->calls * pct + 99) / 100;
+	uint64_t seen = 0;
+	int i;
+
+	for (i = 0 ; i < FPGA_API_STATS_BUCKETS ; ++i) {
+		seen += s->histogram[i];
+		if (seen >= target)
+			return (2ULL << i) - 1;
+	}
+
+	return s->max_nsec;
+}
+
+static void opae_api_stats_dump(FILE *fp)
+{
+	fpga_api_stats *stats = NULL;
+	fpga_api_trace_entry *trace = NULL;
+	uint32_t num = 0;
+	uint32_t i;
+
+	if (fpgaGetApiStats(NULL, 0, &num) != FPGA_OK || !num)
+		goto out_trace;
+
+	stats = opae_calloc(num, sizeof(fpga_api_stats));
+	if (!stats || fpgaGetApiStats(stats, num, &num) != FPGA_OK)
+		goto out_trace;
+
+	fprintf(fp, "OPAE API statistics (nsec; percentiles are "
+		    "histogram bucket upper bounds)\n");
+	fprintf(fp, "%-32s %-20s %10s %8s %10s %10s %10s %10s %10s\n",
+		"api", "adapter", "calls", "errors",
+		"mean", "min", "p50", "p99", "max");
+
+	for (i = 0 ; i < num ; ++i) {
+		fpga_api_stats *s = &stats[i];
+
+		fprintf(fp, "%-32s %-20s %10" PRIu64 " %8" PRIu64
+			    " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+			    " %10" PRIu64 " %10" PRIu64 "\n",
+			s->api, s->adapter, s->calls, s->errors,
+			s->total_nsec / s->calls, s->min_nsec,
+			opae_api_stats_percentile(s, 50),
+			opae_api_stats_percentile(s, 99),
+			s->max_nsec);
+	}
+
+out_trace:
+	if (!(opae_api_stats_flags & FPGA_API_STATS_TRACE))
+		goto out_free;
+
+	num = OPAE_API_TRACE_SLOTS;
+	trace = opae_calloc(num, sizeof(fpga_api_trace_entry));
+	if (!trace || fpgaGetApiTrace(trace, num, &num, NULL) != FPGA_OK)
+		goto out_free;
+
+	fprintf(fp, "OPAE API trace (%u most recent calls)\n", num);
+	fprintf(fp, "%-20s %8s %-32s %-20s %10s %s\n",
+		"start", "tid", "api", "adapter", "nsec", "result");
+
+	for (i = 0 ; i < num ; ++i) {
+		fpga_api_trace_entry *e = &trace[i];
+
+		fprintf(fp, "%-20" PRIu64 " %8u %-32s %-20s %10" PRIu64
+			    " %s\n",
+			e->start_nsec, e->tid, e->api, e->adapter,
+			e->duration_nsec, fpgaErrStr(e->result));
+	}
+
+out_free:
+	if (stats)
+		opae_free(stats);
+	if (trace)
+		opae_free(trace);
+}
+
+void opae_api_stats_init(void)
+{
+	char *s = getenv("LIBOPAE_API_STATS");
+	int flags;
+
+	if (!s)
+		return;
+
+	flags = atoi(s);
+	if (flags <= 0)
+		return;
+
+	stats_dump_at_exit = 1;
+
+	if (flags >= 2)
+		fpgaEnableApiStats(FPGA_API_STATS_ENABLE | FPGA_API_STATS_TRACE);
+	else
+		fpgaEnableApiStats(FPGA_API_STATS_ENABLE);
+}
+
+void opae_api_stats_release(void)
+{
+	char *path;
+	FILE *fp = stderr;
+
+	if (!stats_dump_at_exit)
+		return;
+	stats_dump_at_exit = 0;
+
+	path = getenv("LIBOPAE_API_STATS_FILE");
+	if (path) {
+		fp = opae_fopen(path, "w");
+		if (!fp) {
+			OPAE_ERR("Could not open %s for writing: %s",
+				 path, strerror(errno));
+			fp = stderr;
+		}
+	}
+
+	opae_api_stats_dump(fp);
+
+	if (fp != stderr)
+		opae_fclose(fp);
+	else
+		fflush(fp);
+}
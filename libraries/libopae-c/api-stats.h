@@ -0,0 +1,129 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __OPAE_API_STATS_H__
+#define __OPAE_API_STATS_H__
+
+#include <opae/stats.h>
+#include "adapter.h"
+
+// Every adapter entry point that api-shell.c forwards to.
+#define OPAE_API_STATS_LIST(X)            \
+	X(fpgaOpen)                       \
+	X(fpgaClose)                      \
+	X(fpgaReset)                      \
+	X(fpgaGetPropertiesFromHandle)    \
+	X(fpgaGetProperties)              \
+	X(fpgaUpdateProperties)           \
+	X(fpgaWriteMMIO64)                \
+	X(fpgaReadMMIO64)                 \
+	X(fpgaWriteMMIO32)                \
+	X(fpgaReadMMIO32)                 \
+	X(fpgaWriteMMIO512)               \
+	X(fpgaMapMMIO)                    \
+	X(fpgaUnmapMMIO)                  \
+	X(fpgaEnumerate)                  \
+	X(fpgaCloneToken)                 \
+	X(fpgaDestroyToken)               \
+	X(fpgaPrepareBuffer)              \
+	X(fpgaReleaseBuffer)              \
+	X(fpgaGetIOAddress)               \
+	X(fpgaReadError)                  \
+	X(fpgaClearError)                 \
+	X(fpgaClearAllErrors)             \
+	X(fpgaGetErrorInfo)               \
+	X(fpgaCreateEventHandle)          \
+	X(fpgaDestroyEventHandle)         \
+	X(fpgaGetOSObjectFromEventHandle) \
+	X(fpgaRegisterEvent)              \
+	X(fpgaUnregisterEvent)            \
+	X(fpgaAssignPortToInterface)      \
+	X(fpgaAssignToInterface)          \
+	X(fpgaReleaseFromInterface)       \
+	X(fpgaReconfigureSlot)            \
+	X(fpgaTokenGetObject)             \
+	X(fpgaHandleGetObject)            \
+	X(fpgaObjectGetObject)            \
+	X(fpgaObjectGetObjectAt)          \
+	X(fpgaDestroyObject)              \
+	X(fpgaObjectRead)                 \
+	X(fpgaObjectRead64)               \
+	X(fpgaObjectGetSize)              \
+	X(fpgaObjectGetType)              \
+	X(fpgaObjectWrite64)              \
+	X(fpgaSetUserClock)               \
+	X(fpgaGetUserClock)               \
+	X(fpgaGetNumMetrics)              \
+	X(fpgaGetMetricsInfo)             \
+	X(fpgaGetMetricsByIndex)          \
+	X(fpgaGetMetricsByName)           \
+	X(fpgaGetMetricsThresholdInfo)
+
+#define OPAE_API_STATS_ENUM(__api) OPAE_API_##__api,
+typedef enum _opae_api_id {
+	OPAE_API_STATS_LIST(OPAE_API_STATS_ENUM)
+	OPAE_API_COUNT
+} opae_api_id;
+#undef OPAE_API_STATS_ENUM
+
+// FPGA_API_STATS_* flags, 0 when disabled.
+extern int opae_api_stats_flags;
+
+uint64_t opae_api_stats_clock(void);
+
+// Called when the adapters are freed, so that no thread keeps
+// matching calls against their addresses.
+void opae_api_stats_adapters_released(void);
+
+void opae_api_stats_record(opae_api_id api,
+			   const opae_api_adapter_table *adapter,
+			   uint64_t start, fpga_result result);
+
+// Call adapter->api(...), timing it when statistics are enabled.
+// The disabled path costs one load and a predicted branch.
+#define opae_api_call(__adapter, __api, ...)                                  \
+	({                                                                    \
+		const opae_api_adapter_table *__at = (__adapter);             \
+		fpga_result __res;                                            \
+		if (__builtin_expect(opae_api_stats_flags, 0)) {              \
+			uint64_t __start = opae_api_stats_clock();            \
+			__res = __at->__api(__VA_ARGS__);                     \
+			opae_api_stats_record(OPAE_API_##__api, __at,         \
+					      __start, __res);                \
+		} else {                                                      \
+			__res = __at->__api(__VA_ARGS__);                     \
+		}                                                             \
+		__res;                                                        \
+	})
+
+// Apply LIBOPAE_API_STATS from the environment.
+void opae_api_stats_init(void);
+
+// Write the statistics, and the trace if enabled, when
+// LIBOPAE_API_STATS was set.
+void opae_api_stats_release(void);
+
+#endif /* __OPAE_API_STATS_H__ */
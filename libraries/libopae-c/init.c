@@ -36,6 +36,8 @@
 #include <linux/limits.h>
 #include <pwd.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
 #ifndef __USE_GNU
 #define __USE_GNU
 #endif // __USE_GNU
@@ -44,14 +46,17 @@
 #include <opae/init.h>
 #include <opae/utils.h>
 #include "pluginmgr.h"
+#include "api-stats.h"
 #include "opae_int.h"
 #include "mock/opae_std.h"
 
-/* global loglevel */
-static int g_loglevel = OPAE_DEFAULT_LOGLEVEL;
+/* global loglevel, tested by the logging macros before calling opae_print() */
+int opae_log_threshold = OPAE_DEFAULT_LOGLEVEL;
 static FILE *g_logfile;
-/* mutex to protect against garbled log output */
-static pthread_mutex_t log_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+/* LIBOPAE_LOG_FORMAT=json: one JSON object per line */
+static int g_log_json;
+/* LIBOPAE_LOG_ASYNC=1: per-thread rings drained by a writer thread */
+static int g_log_async;
 
 #define CFG_PATH_MAX 64
 #define HOME_CFG_PATHS 3
@@ -66,31 +71,402 @@ STATIC const char _ase_sys_cfg_files[SYS_CFG_PATHS][CFG_PATH_MAX] = {
 	{ "/etc/opae/opae_ase.cfg" },
 };
 
-void opae_print(int loglevel, const char *fmt, ...)
+#define OPAE_LOG_RING_SLOTS 256 /* power of 2 */
+#define OPAE_LOG_MSG_MAX 240
+#define OPAE_LOG_IDLE_USEC 2000
+
+typedef struct _opae_log_record {
+	uint64_t timestamp; /* CLOCK_REALTIME nsec */
+	int level;
+	uint32_t len;
+	char msg[OPAE_LOG_MSG_MAX];
+} opae_log_record;
+
+/*
+ * Single-producer, single-consumer ring. The owning thread is the
+ * only writer of head; the drain (serialized by log_drain_lock) is
+ * the only writer of tail.
+ */
+typedef struct _opae_log_ring {
+	struct _opae_log_ring *next;
+	pid_t tid;
+	int orphaned; /* owning thread has exited */
+	uint32_t head;
+	uint32_t dropped;
+	uint32_t tail __attribute__((aligned(64)));
+	opae_log_record slots[OPAE_LOG_RING_SLOTS];
+} opae_log_ring;
+
+static __thread opae_log_ring *tls_log_ring;
+static opae_log_ring *log_rings;
+/* protects log_rings linkage, taken once per logging thread */
+static pthread_mutex_t log_rings_lock = PTHREAD_MUTEX_INITIALIZER;
+/* serializes the consumer side: the writer thread and opae_log_flush() */
+static pthread_mutex_t log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t log_ring_key;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static pthread_t log_writer;
+static int log_writer_running;
+static int log_writer_stop;
+
+/*
+ * A JSON record is assembled per thread until the trailing newline,
+ * so a line printed by several opae_print() calls stays one record.
+ */
+#define OPAE_LOG_LINE_MAX 1024
+
+typedef struct _opae_log_line {
+	uint64_t timestamp;
+	int level;
+	size_t len;
+	char msg[OPAE_LOG_LINE_MAX];
+} opae_log_line;
+
+static __thread opae_log_line tls_log_line;
+
+static uint64_t opae_log_timestamp(void)
 {
-	FILE *fp;
-	int err;
-	va_list argp;
+	struct timespec ts;
 
-	if (loglevel > g_loglevel)
-		return;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
+static FILE *opae_log_stream(int loglevel)
+{
 	if (loglevel == OPAE_LOG_ERROR)
-		fp = stderr;
-	else
-		fp = g_logfile == NULL ? stdout : g_logfile;
+		return stderr;
+	return g_logfile == NULL ? stdout : g_logfile;
+}
+
+static void opae_log_emit(FILE *fp, uint64_t timestamp, pid_t tid,
+			  int loglevel, const char *msg, size_t len)
+{
+	static const char *const level_names[] = {
+		"error", "message", "debug"
+	};
+	size_t i;
+
+	if (!g_log_json) {
+		fwrite(msg, 1, len, fp);
+		return;
+	}
+
+	/* the caller's trailing newline terminates the record instead */
+	while (len && (msg[len - 1] == '\n'))
+		--len;
+
+	flockfile(fp);
+	fprintf(fp, "{\"time\":%lu.%09lu,\"tid\":%d,\"level\":\"%s\",\"msg\":\"",
+		(unsigned long)(timestamp / 1000000000ULL),
+		(unsigned long)(timestamp % 1000000000ULL),
+		(int)tid,
+		(loglevel >= OPAE_LOG_ERROR && loglevel <= OPAE_LOG_DEBUG) ?
+			level_names[loglevel] : "unknown");
+
+	for (i = 0 ; i < len ; ++i) {
+		unsigned char c = (unsigned char)msg[i];
+
+		if (c == '"' || c == '\\') {
+			putc_unlocked('\\', fp);
+			putc_unlocked(c, fp);
+		} else if (c < 0x20) {
+			fprintf(fp, "\\u%04x", c);
+		} else {
+			putc_unlocked(c, fp);
+		}
+	}
+
+	fputs("\"}\n", fp);
+	funlockfile(fp);
+}
+
+static void opae_log_ring_orphan(void *arg)
+{
+	opae_log_ring *ring = (opae_log_ring *)arg;
+	__atomic_store_n(&ring->orphaned, 1, __ATOMIC_RELEASE);
+}
+
+static void opae_log_atfork_child(void)
+{
+	/* The writer thread did not survive the fork. */
+	g_log_async = 0;
+	log_writer_running = 0;
+	tls_log_ring = NULL;
+}
+
+static void opae_log_once(void)
+{
+	pthread_key_create(&log_ring_key, opae_log_ring_orphan);
+	pthread_atfork(NULL, NULL, opae_log_atfork_child);
+}
+
+static opae_log_ring *opae_log_register_ring(void)
+{
+	opae_log_ring *ring;
+
+	ring = opae_calloc(1, sizeof(opae_log_ring));
+	if (!ring)
+		return NULL;
+
+	ring->tid = (pid_t)syscall(SYS_gettid);
+
+	pthread_mutex_lock(&log_rings_lock);
+	ring->next = log_rings;
+	__atomic_store_n(&log_rings, ring, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&log_rings_lock);
+
+	pthread_setspecific(log_ring_key, ring);
+	tls_log_ring = ring;
+
+	return ring;
+}
+
+/* Returns 0 when the message was queued. */
+static int opae_log_enqueue(int loglevel, uint64_t timestamp,
+			    const char *fmt, va_list argp)
+{
+	opae_log_ring *ring = tls_log_ring;
+	opae_log_record *rec;
+	uint32_t head;
+	int len;
+
+	if (!ring) {
+		ring = opae_log_register_ring();
+		if (!ring)
+			return 1;
+	}
+
+	head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+	    OPAE_LOG_RING_SLOTS) {
+		__atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+
+	rec = &ring->slots[head & (OPAE_LOG_RING_SLOTS - 1)];
+	rec->timestamp = timestamp;
+	rec->level = loglevel;
+
+	len = vsnprintf(rec->msg, sizeof(rec->msg), fmt, argp);
+	if (len < 0)
+		len = 0;
+	else if (len >= (int)sizeof(rec->msg)) {
+		/* keep the line terminated when truncating */
+		len = sizeof(rec->msg) - 1;
+		rec->msg[len - 1] = '\n';
+	}
+	rec->len = (uint32_t)len;
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static int opae_log_enqueuef(int loglevel, uint64_t timestamp,
+			     const char *fmt, ...)
+{
+	va_list argp;
+	int res;
 
 	va_start(argp, fmt);
-	err = pthread_mutex_lock(
-		&log_lock); /* ignore failure and print anyway */
-	if (err)
-		fprintf(stderr, "pthread_mutex_lock() failed: %s",
-			strerror(err));
-	vfprintf(fp, fmt, argp);
-	err = pthread_mutex_unlock(&log_lock);
-	if (err)
-		fprintf(stderr, "pthread_mutex_unlock() failed: %s",
+	res = opae_log_enqueue(loglevel, timestamp, fmt, argp);
+	va_end(argp);
+
+	return res;
+}
+
+/* Write out the calling thread's pending JSON record, if any. */
+static void opae_log_line_emit(void)
+{
+	opae_log_line *line = &tls_log_line;
+
+	if (!line->len)
+		return;
+
+	if (!g_log_async ||
+	    opae_log_enqueuef(line->level, line->timestamp, "%.*s",
+			      (int)line->len, line->msg))
+		opae_log_emit(opae_log_stream(line->level), line->timestamp,
+			      (pid_t)syscall(SYS_gettid), line->level,
+			      line->msg, line->len);
+
+	line->len = 0;
+}
+
+static void opae_log_line_append(int loglevel, const char *fmt,
+				 va_list argp)
+{
+	opae_log_line *line = &tls_log_line;
+	size_t room;
+	int len;
+
+	/* a fragment at another level starts a new record */
+	if (line->len && line->level != loglevel)
+		opae_log_line_emit();
+
+	if (!line->len) {
+		line->timestamp = opae_log_timestamp();
+		line->level = loglevel;
+	}
+
+	room = sizeof(line->msg) - line->len;
+	len = vsnprintf(line->msg + line->len, room, fmt, argp);
+	if (len < 0)
+		len = 0;
+	else if ((size_t)len >= room)
+		len = room - 1;
+	line->len += len;
+
+	if ((line->len && line->msg[line->len - 1] == '\n') ||
+	    line->len == sizeof(line->msg) - 1)
+		opae_log_line_emit();
+}
+
+/* Returns the number of records written. */
+static size_t opae_log_drain(void)
+{
+	opae_log_ring *ring;
+	opae_log_ring **prev;
+	size_t count = 0;
+	int orphans = 0;
+
+	pthread_mutex_lock(&log_drain_lock);
+
+	/* Rings are only pushed at the head and only freed below,
+	 * so the list can be walked without log_rings_lock. */
+	for (ring = __atomic_load_n(&log_rings, __ATOMIC_ACQUIRE) ;
+	     ring ; ring = ring->next) {
+		uint32_t tail = ring->tail;
+		uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		uint32_t dropped;
+
+		for ( ; tail != head ; ++tail, ++count) {
+			opae_log_record *rec =
+				&ring->slots[tail & (OPAE_LOG_RING_SLOTS - 1)];
+
+			opae_log_emit(opae_log_stream(rec->level),
+				      rec->timestamp, ring->tid, rec->level,
+				      rec->msg, rec->len);
+		}
+
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+		dropped = __atomic_exchange_n(&ring->dropped, 0,
+					      __ATOMIC_RELAXED);
+		if (dropped) {
+			char msg[64];
+			int len = snprintf(msg, sizeof(msg),
+					   "%u log message(s) dropped\n",
+					   dropped);
+
+			opae_log_emit(stderr, opae_log_timestamp(), ring->tid,
+				      OPAE_LOG_ERROR, msg, len);
+		}
+
+		if (__atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE))
+			++orphans;
+	}
+
+	if (count) {
+		fflush(stdout);
+		if (g_logfile && g_logfile != stdout)
+			fflush(g_logfile);
+	}
+
+	if (orphans) {
+		pthread_mutex_lock(&log_rings_lock);
+		for (prev = &log_rings ; *prev ; ) {
+			ring = *prev;
+			if (__atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE) &&
+			    (ring->tail ==
+			     __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))) {
+				*prev = ring->next;
+				opae_free(ring);
+			} else {
+				prev = &ring->next;
+			}
+		}
+		pthread_mutex_unlock(&log_rings_lock);
+	}
+
+	pthread_mutex_unlock(&log_drain_lock);
+
+	return count;
+}
+
+static void *opae_log_writer(void *arg)
+{
+	(void)arg;
+
+	while (!__atomic_load_n(&log_writer_stop, __ATOMIC_ACQUIRE)) {
+		if (!opae_log_drain())
+			usleep(OPAE_LOG_IDLE_USEC);
+	}
+
+	return NULL;
+}
+
+static void opae_log_start_writer(void)
+{
+	int err;
+
+	pthread_once(&log_once, opae_log_once);
+
+	log_writer_stop = 0;
+	err = pthread_create(&log_writer, NULL, opae_log_writer, NULL);
+	if (err) {
+		fprintf(stderr, "libopae-c: failed to start log writer: %s\n",
 			strerror(err));
+		return;
+	}
+
+	log_writer_running = 1;
+	g_log_async = 1;
+}
+
+static void opae_log_stop_writer(void)
+{
+	if (!log_writer_running)
+		return;
+
+	g_log_async = 0;
+	__atomic_store_n(&log_writer_stop, 1, __ATOMIC_RELEASE);
+	pthread_join(log_writer, NULL);
+	log_writer_running = 0;
+
+	opae_log_drain();
+}
+
+void opae_log_flush(void)
+{
+	opae_log_line_emit();
+
+	if (log_writer_running)
+		opae_log_drain();
+
+	fflush(stdout);
+	if (g_logfile && g_logfile != stdout)
+		fflush(g_logfile);
+}
+
+void opae_print(int loglevel, const char *fmt, ...)
+{
+	va_list argp;
+
+	if (loglevel > opae_log_threshold)
+		return;
+
+	va_start(argp, fmt);
+
+	if (g_log_json) {
+		opae_log_line_append(loglevel, fmt, argp);
+	} else if (!g_log_async ||
+		   opae_log_enqueue(loglevel, opae_log_timestamp(),
+				    fmt, argp)) {
+		/* stdio locks the stream for the duration of the call */
+		vfprintf(opae_log_stream(loglevel), fmt, argp);
+	}
+
 	va_end(argp);
 }
 
@@ -165,10 +541,7 @@ STATIC char *find_ase_cfg(void)
 extern int initialized;
 __attribute__((constructor(1000))) STATIC void opae_init(void)
 {
-	fpga_result res;
 	g_logfile = NULL;
-	char *cfg_path = NULL;
-	char *with_ase = NULL;
 
 	if (initialized)
 		return;
@@ -176,9 +549,9 @@ __attribute__((constructor(1000))) STATIC void opae_init(void)
 	/* try to read loglevel from environment */
 	char *s = getenv("LIBOPAE_LOG");
 	if (s) {
-		g_loglevel = atoi(s);
+		opae_log_threshold = atoi(s);
 #ifndef LIBOPAE_DEBUG
-		if (g_loglevel >= OPAE_LOG_DEBUG)
+		if (opae_log_threshold >= OPAE_LOG_DEBUG)
 			fprintf(stderr,
 				"WARNING: Environment variable LIBOPAE_LOG is "
 				"set to output debug\nmessages, "
@@ -202,8 +575,25 @@ __attribute__((constructor(1000))) STATIC void opae_init(void)
 	if (g_logfile == NULL)
 		g_logfile = stdout;
 
-	with_ase = getenv("WITH_ASE");
-	if (with_ase) {
+	s = getenv("LIBOPAE_LOG_FORMAT");
+	g_log_json = s && !strcmp(s, "json");
+
+	s = getenv("LIBOPAE_LOG_ASYNC");
+	if (s && atoi(s) && !log_writer_running)
+		opae_log_start_writer();
+
+	opae_api_stats_init();
+
+	// Config file discovery, platform detection and plugin loading
+	// are deferred until the first API call that needs them.
+	// See opae_initialize_on_demand().
+}
+
+STATIC void opae_implicit_initialize(void)
+{
+	char *cfg_path = NULL;
+
+	if (getenv("WITH_ASE")) {
 		cfg_path = find_ase_cfg();
 
 		if (cfg_path == NULL) {
@@ -211,30 +601,52 @@ __attribute__((constructor(1000))) STATIC void opae_init(void)
 			return;
 		}
 
-		res = fpgaInitialize(cfg_path);
-		if (res != FPGA_OK)
-			OPAE_ERR("fpgaInitialize: %s", fpgaErrStr(res));
+		if (opae_plugin_mgr_initialize(cfg_path))
+			OPAE_ERR("fpgaInitialize: %s",
+				 fpgaErrStr(FPGA_EXCEPTION));
 
 		opae_free(cfg_path);
 	}
 	// If the environment hasn't requested explicit initialization,
 	// perform the initialization implicitly here.
 	else if (getenv("OPAE_EXPLICIT_INITIALIZE") == NULL)
-		fpgaInitialize(NULL);
+		opae_plugin_mgr_initialize(NULL);
+}
+
+static void opae_no_implicit_initialize(void)
+{
+}
+
+STATIC pthread_once_t implicit_init_once = PTHREAD_ONCE_INIT;
+
+void opae_initialize_on_demand(void)
+{
+	pthread_once(&implicit_init_once, opae_implicit_initialize);
+}
+
+void opae_skip_implicit_initialize(void)
+{
+	pthread_once(&implicit_init_once, opae_no_implicit_initialize);
 }
 
 __attribute__((destructor)) STATIC void opae_release(void)
 {
 	fpga_result res = FPGA_OK;
 
+	opae_api_stats_release();
+
 	if (getenv("OPAE_EXPLICIT_INITIALIZE") == NULL)
 		res = fpgaFinalize();
 
 	if (res != FPGA_OK)
 		OPAE_ERR("fpgaFinalize: %s", fpgaErrStr(res));
 
+	opae_log_line_emit();
+	opae_log_stop_writer();
+
 	if (g_logfile != NULL && g_logfile != stdout) {
 		opae_fclose(g_logfile);
 	}
 	g_logfile = NULL;
+	g_log_json = 0;
 }
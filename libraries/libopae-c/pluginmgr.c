@@ -44,6 +44,7 @@
 #include "opae_int.h"
 #include "mock/opae_std.h"
 #include "cfg-file.h"
+#include "api-stats.h"
 
 #define OPAE_PLUGIN_CONFIGURE "opae_plugin_configure"
 typedef int (*opae_plugin_configure_t)(opae_api_adapter_table *, const char *);
@@ -206,6 +207,7 @@ int opae_plugin_mgr_finalize_all(void)
 	}
 
 	adapter_list = NULL;
+	opae_api_stats_adapters_released();
 
 	if (platform_data_table) {
 		for (cfg = platform_data_table ; cfg->module_library ; ++cfg) {
@@ -287,6 +289,23 @@ STATIC void opae_plugin_mgr_detect_platform(opae_pci_device *dev)
 	}
 }
 
+// Whether any platform_data_table entry names this vendor/device.
+// Most PCIe functions in the system are not FPGAs, so checking this
+// before reading the subsystem IDs halves the sysfs reads per device.
+STATIC bool opae_plugin_mgr_is_candidate(uint16_t vendor_id,
+					 uint16_t device_id)
+{
+	int i;
+
+	for (i = 0 ; platform_data_table[i].module_library ; ++i) {
+		if ((platform_data_table[i].vendor_id == vendor_id) &&
+		    (platform_data_table[i].device_id == device_id))
+			return true;
+	}
+
+	return false;
+}
+
 STATIC int opae_plugin_mgr_detect_platforms(bool with_ase)
 {
 	DIR *dir;
@@ -393,6 +412,10 @@ STATIC int opae_plugin_mgr_detect_platforms(bool with_ase)
 
 		opae_fclose(fp);
 
+		if (!opae_plugin_mgr_is_candidate((uint16_t)vendor_id,
+						  (uint16_t)device_id))
+			continue;
+
 		// Read the 'subsystem_vendor' file.
 		if (snprintf(file_path, sizeof(file_path),
 			     "%s/%s/subsystem_vendor",
@@ -624,6 +647,105 @@ out_unlock:
 	return cb_res;
 }
 
+typedef struct _opae_adapter_fanout {
+	opae_api_adapter_table **adapters;
+	void **results;
+	uint32_t num_adapters;
+	uint32_t next;
+	void *(*work)(const opae_api_adapter_table *, void *);
+	void *context;
+} opae_adapter_fanout;
+
+static void *opae_plugin_mgr_fanout_worker(void *arg)
+{
+	opae_adapter_fanout *fanout = (opae_adapter_fanout *)arg;
+	uint32_t i;
+
+	while ((i = __sync_fetch_and_add(&fanout->next, 1)) <
+	       fanout->num_adapters)
+		fanout->results[i] = fanout->work(fanout->adapters[i],
+						  fanout->context);
+
+	return NULL;
+}
+
+int opae_plugin_mgr_for_each_adapter_concurrent
+	(void *(*work)(const opae_api_adapter_table *, void *),
+	 void (*merge)(const opae_api_adapter_table *, void *, void *),
+	 void *context)
+{
+	int res = 0;
+	int err;
+	opae_api_adapter_table *aptr;
+	opae_adapter_fanout fanout;
+	pthread_t threads[OPAE_MAX_ADAPTER_THREADS - 1];
+	uint32_t num_threads = 0;
+	uint32_t i;
+
+	if (!work || !merge) {
+		OPAE_ERR("NULL callback passed to %s()", __func__);
+		return 1;
+	}
+
+	opae_mutex_lock(err, &adapter_list_lock);
+
+	memset(&fanout, 0, sizeof(fanout));
+	fanout.work = work;
+	fanout.context = context;
+
+	for (aptr = adapter_list; aptr; aptr = aptr->next)
+		++fanout.num_adapters;
+
+	if (!fanout.num_adapters)
+		goto out_unlock;
+
+	fanout.adapters = (opae_api_adapter_table **)opae_calloc(
+		fanout.num_adapters, sizeof(opae_api_adapter_table *));
+	fanout.results = (void **)opae_calloc(
+		fanout.num_adapters, sizeof(void *));
+
+	if (!fanout.adapters || !fanout.results) {
+		OPAE_ERR("out of memory");
+		res = 1;
+		goto out_free;
+	}
+
+	for (i = 0, aptr = adapter_list; aptr; aptr = aptr->next)
+		fanout.adapters[i++] = aptr;
+
+	// The calling thread takes a share of the adapters, so a single
+	// adapter never leaves this thread. Should pthread_create() fail,
+	// the remaining threads (at least the caller) pick up the slack.
+	while ((num_threads + 1 < fanout.num_adapters) &&
+	       (num_threads + 1 < OPAE_MAX_ADAPTER_THREADS)) {
+		err = pthread_create(&threads[num_threads], NULL,
+				     opae_plugin_mgr_fanout_worker, &fanout);
+		if (err) {
+			OPAE_DBG("pthread_create failed: %s", strerror(err));
+			break;
+		}
+		++num_threads;
+	}
+
+	opae_plugin_mgr_fanout_worker(&fanout);
+
+	for (i = 0 ; i < num_threads ; ++i)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0 ; i < fanout.num_adapters ; ++i)
+		merge(fanout.adapters[i], fanout.results[i], context);
+
+out_free:
+	if (fanout.results)
+		opae_free(fanout.results);
+	if (fanout.adapters)
+		opae_free(fanout.adapters);
+out_unlock:
+	opae_mutex_unlock(err, &adapter_list_lock);
+
+	return res;
+}
+
 int opae_plugin_mgr_register_plugin(const char *name, const char *cfg)
 {
 	int res;
@@ -32,6 +32,15 @@
 // non-zero on failure.
 int opae_plugin_mgr_initialize(const char *cfg_file);
 
+// Performs the implicit, environment-driven initialization
+// (WITH_ASE, OPAE_EXPLICIT_INITIALIZE) the first time it is called.
+// Cheap once that has happened.
+void opae_initialize_on_demand(void);
+
+// Called for an explicit fpgaInitialize() of a given config file,
+// which takes the place of the implicit initialization.
+void opae_skip_implicit_initialize(void);
+
 // non-zero on failure.
 int opae_plugin_mgr_finalize_all(void);
 
@@ -41,4 +50,18 @@ int opae_plugin_mgr_finalize_all(void);
 int opae_plugin_mgr_for_each_adapter(
 	int (*callback)(const opae_api_adapter_table *, void *), void *context);
 
+// Upper bound on the threads used by
+// opae_plugin_mgr_for_each_adapter_concurrent(), including the caller.
+#define OPAE_MAX_ADAPTER_THREADS 8
+
+// work() is invoked for every adapter, concurrently across adapters,
+// and may return a per-adapter result. Once all calls to work() have
+// completed, merge() is invoked on the calling thread for every
+// adapter, in adapter list order, with that adapter's result.
+// non-zero on failure.
+int opae_plugin_mgr_for_each_adapter_concurrent(
+	void *(*work)(const opae_api_adapter_table *, void *),
+	void (*merge)(const opae_api_adapter_table *, void *, void *),
+	void *context);
+
 #endif /* __OPAE_PLUGINMGR_H__ */
@@ -106,11 +106,14 @@ fpga_result __OPAE_API__ fpgaDestroyProperties(fpga_properties *prop)
 
 	p->magic = 0;
 
-	opae_mutex_unlock(err, &p->lock);
+	if (!opae_properties_is_snapshot(p)) {
+		opae_mutex_unlock(err, &p->lock);
 
-	err = pthread_mutex_destroy(&p->lock);
-	if (err)
-		OPAE_ERR("pthread_mutex_destroy() failed: %s", strerror(err));
+		err = pthread_mutex_destroy(&p->lock);
+		if (err)
+			OPAE_ERR("pthread_mutex_destroy() failed: %s",
+				 strerror(err));
+	}
 
 	opae_free(p);
 	*prop = NULL;
@@ -134,7 +137,7 @@ fpga_result __OPAE_API__ fpgaCloneProperties(fpga_properties src,
 
 	clone = opae_properties_create();
 	if (!clone) {
-		opae_mutex_unlock(err, &p->lock);
+		opae_properties_unlock(err, p);
 		return FPGA_EXCEPTION;
 	}
 
@@ -142,6 +145,7 @@ fpga_result __OPAE_API__ fpgaCloneProperties(fpga_properties src,
 
 	*clone = *p;
 	clone->lock = save_lock;
+	clone->flags &= ~OPAE_PROPERTIES_SNAPSHOT;
 
 	if (FIELD_VALID(p, FPGA_PROPERTY_PARENT)) {
 		opae_wrapped_token *wrapped_token =
@@ -152,7 +156,47 @@ fpga_result __OPAE_API__ fpgaCloneProperties(fpga_properties src,
 
 	*dst = clone;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
+
+	return FPGA_OK;
+}
+
+fpga_result __OPAE_API__ fpgaSnapshotProperties(fpga_properties src,
+						fpga_properties *snapshot)
+{
+	int err;
+	struct _fpga_properties *snap;
+	struct _fpga_properties *p;
+
+	ASSERT_NOT_NULL(snapshot);
+
+	p = opae_validate_and_lock_properties(src);
+
+	ASSERT_NOT_NULL(p);
+
+	// A snapshot never takes its lock, so there is
+	// no mutex to initialize.
+	snap = (struct _fpga_properties *)opae_calloc(
+		1, sizeof(struct _fpga_properties));
+	if (!snap) {
+		opae_properties_unlock(err, p);
+		return FPGA_NO_MEMORY;
+	}
+
+	*snap = *p;
+	memset(&snap->lock, 0, sizeof(snap->lock));
+	snap->flags |= OPAE_PROPERTIES_SNAPSHOT;
+
+	if (FIELD_VALID(p, FPGA_PROPERTY_PARENT)) {
+		opae_wrapped_token *wrapped_token =
+			opae_validate_wrapped_token(p->parent);
+		if (wrapped_token)
+			opae_upref_wrapped_token(wrapped_token);
+	}
+
+	*snapshot = snap;
+
+	opae_properties_unlock(err, p);
 
 	return FPGA_OK;
 }
@@ -160,7 +204,7 @@ fpga_result __OPAE_API__ fpgaCloneProperties(fpga_properties src,
 fpga_result __OPAE_API__ fpgaClearProperties(fpga_properties props)
 {
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(props);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(props);
 
 	ASSERT_NOT_NULL(p);
 
@@ -174,7 +218,7 @@ fpga_result __OPAE_API__ fpgaClearProperties(fpga_properties props)
 	}
 	p->valid_fields = 0;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return FPGA_OK;
 }
@@ -199,7 +243,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetParent(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -213,7 +257,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetParent(fpga_properties prop,
 
 	ASSERT_NOT_NULL(parent);
 
-	p = opae_validate_and_lock_properties(prop);
+	p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -232,7 +276,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetParent(fpga_properties prop,
 	p->parent = parent;
 	SET_FIELD_VALID(p, FPGA_PROPERTY_PARENT);
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return FPGA_OK;
 }
@@ -257,7 +301,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetObjectType(
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -266,14 +310,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetObjectType(fpga_properties prop,
 						     fpga_objtype objtype)
 {
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	p->objtype = objtype;
 	SET_FIELD_VALID(p, FPGA_PROPERTY_OBJTYPE);
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return FPGA_OK;
 }
@@ -298,7 +342,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetSegment(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -307,14 +351,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetSegment(fpga_properties prop,
 						  uint16_t segment)
 {
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_SEGMENT);
 	p->segment = segment;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return FPGA_OK;
 }
@@ -339,7 +383,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetBus(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -349,14 +393,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetBus(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_BUS);
 	p->bus = bus;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -381,7 +425,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetDevice(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -391,14 +435,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetDevice(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_DEVICE);
 	p->device = device;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -423,7 +467,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetFunction(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -441,13 +485,13 @@ fpga_result __OPAE_API__ fpgaPropertiesSetFunction(fpga_properties prop,
 		return FPGA_INVALID_PARAM;
 	}
 
-	p = opae_validate_and_lock_properties(prop);
+	p = opae_validate_and_lock_mutable_properties(prop);
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_FUNCTION);
 	p->function = function;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -472,7 +516,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetSocketID(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -482,14 +526,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetSocketID(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_SOCKETID);
 	p->socket_id = socket_id;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -514,7 +558,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetDeviceID(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -524,14 +568,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetDeviceID(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_DEVICEID);
 	p->device_id = device_id;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -564,7 +608,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetNumSlots(const fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -574,7 +618,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetNumSlots(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -589,7 +633,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetNumSlots(fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -622,7 +666,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetBBSID(const fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -632,7 +676,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetBBSID(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -646,7 +690,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetBBSID(fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -679,7 +723,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetBBSVersion(const fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -689,7 +733,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetBBSVersion(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -704,7 +748,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetBBSVersion(fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -729,7 +773,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetVendorID(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -739,14 +783,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetVendorID(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_VENDORID);
 	p->vendor_id = vendor_id;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -825,7 +869,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetGUID(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -835,7 +879,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetGUID(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -843,7 +887,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetGUID(fpga_properties prop,
 
 	memcpy(p->guid, guid, sizeof(fpga_guid));
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -876,7 +920,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetNumMMIO(const fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -886,7 +930,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetNumMMIO(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -901,7 +945,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetNumMMIO(fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -934,7 +978,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetNumInterrupts(
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -944,7 +988,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetNumInterrupts(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -959,7 +1003,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetNumInterrupts(fpga_properties prop,
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -991,7 +1035,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetAcceleratorState(
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1001,7 +1045,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetAcceleratorState(
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
@@ -1015,7 +1059,7 @@ fpga_result __OPAE_API__ fpgaPropertiesSetAcceleratorState(
 		res = FPGA_INVALID_PARAM;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1040,7 +1084,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetObjectID(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1050,14 +1094,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetObjectID(fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_OBJECTID);
 	p->object_id = object_id;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1082,7 +1126,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetNumErrors(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1092,14 +1136,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetNumErrors(const fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_NUM_ERRORS);
 	p->num_errors = num_errors;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1124,7 +1168,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetInterface(const fpga_properties prop,
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1134,14 +1178,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetInterface(const fpga_properties prop,
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_INTERFACE);
 	p->interface = interface;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1167,7 +1211,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetSubsystemVendorID(
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1178,14 +1222,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetSubsystemVendorID(
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_SUB_VENDORID);
 	p->subsystem_vendor_id = subsystem_vendor_id;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1211,7 +1255,7 @@ fpga_result __OPAE_API__ fpgaPropertiesGetSubsystemDeviceID(
 		res = FPGA_NOT_FOUND;
 	}
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
@@ -1222,14 +1266,14 @@ fpga_result __OPAE_API__ fpgaPropertiesSetSubsystemDeviceID(
 {
 	fpga_result res = FPGA_OK;
 	int err;
-	struct _fpga_properties *p = opae_validate_and_lock_properties(prop);
+	struct _fpga_properties *p = opae_validate_and_lock_mutable_properties(prop);
 
 	ASSERT_NOT_NULL(p);
 
 	SET_FIELD_VALID(p, FPGA_PROPERTY_SUB_DEVICEID);
 	p->subsystem_device_id = subsystem_device_id;
 
-	opae_mutex_unlock(err, &p->lock);
+	opae_properties_unlock(err, p);
 
 	return res;
 }
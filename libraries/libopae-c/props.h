@@ -1,4 +1,4 @@
-// Copyright(c) 2018-2022, Intel Corporation
+// Copyright(c) 2018-2023, Intel Corporation
 //
 // Redistribution  and  use  in source  and  binary  forms,  with  or  without
 // modification, are permitted provided that the following conditions are met:
@@ -27,7 +27,9 @@
 #ifndef __OPAE_PROPS_H__
 #define __OPAE_PROPS_H__
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #ifndef __USE_GNU
 #define __USE_GNU 1
 #endif
@@ -81,8 +83,39 @@
 	((P)->valid_fields = (P)->valid_fields & ~((uint64_t)1 << (F)))
 
 
+// fpga_properties flags
+#define OPAE_PROPERTIES_SNAPSHOT 0x00000001 // read-only, lock-free
+
+/* Object-specific properties
+ * bitfields start as 0x20
+ */
+union _fpga_object_properties {
+
+	/* fpga object properties
+	 * */
+	struct {
+		uint64_t bbs_id;
+		fpga_version bbs_version;
+		uint32_t num_slots;
+		// TODO char model[FPGA_MODEL_LENGTH];
+		// TODO uint64_t local_memory_size;
+		// TODO uint64_t capabilities; #<{(| bitfield (HSSI,
+		// iommu, ...) |)}>#
+	} fpga;
+
+	/* accelerator object properties
+	 * */
+	struct {
+		fpga_accelerator_state state;
+		uint32_t num_mmio;
+		uint32_t num_interrupts;
+	} accelerator;
+
+};
+
+// Fields are ordered by size, so that the common properties
+// pack without holes. The lock is last, as snapshots never use it.
 struct _fpga_properties {
-	pthread_mutex_t lock;
 	uint64_t magic;
 	/* Common properties */
 	uint64_t valid_fields; // bitmap of valid fields
@@ -94,49 +127,34 @@ struct _fpga_properties {
 	// up to bit 0x1F
 	fpga_guid guid; // Applies only to accelerator types
 	fpga_token parent;
+	uint64_t object_id;
 	fpga_objtype objtype;
+	fpga_interface interface;
+	uint32_t num_errors;
+	uint32_t flags; // OPAE_PROPERTIES_*
 	uint16_t segment;
-	uint8_t bus;
-	uint8_t device;
-	uint8_t function;
-	uint8_t socket_id;
-	uint64_t object_id;
 	uint16_t vendor_id;
 	uint16_t device_id;
-	uint32_t num_errors;
-	fpga_interface interface;
 	uint16_t subsystem_vendor_id;
 	uint16_t subsystem_device_id;
+	uint8_t bus;
+	uint8_t device;
+	uint8_t function;
+	uint8_t socket_id;
+
+	union _fpga_object_properties u;
 
-	/* Object-specific properties
-	 * bitfields start as 0x20
-	 */
-	union {
-
-		/* fpga object properties
-		 * */
-		struct {
-			uint32_t num_slots;
-			uint64_t bbs_id;
-			fpga_version bbs_version;
-			// TODO char model[FPGA_MODEL_LENGTH];
-			// TODO uint64_t local_memory_size;
-			// TODO uint64_t capabilities; #<{(| bitfield (HSSI,
-			// iommu, ...) |)}>#
-		} fpga;
-
-		/* accelerator object properties
-		 * */
-		struct {
-			fpga_accelerator_state state;
-			uint32_t num_mmio;
-			uint32_t num_interrupts;
-		} accelerator;
-
-	} u;
+	pthread_mutex_t lock;
 };
 
+static inline bool
+opae_properties_is_snapshot(const struct _fpga_properties *p)
+{
+	return p->flags & OPAE_PROPERTIES_SNAPSHOT;
+}
+
 // returns NULL on error, locked _fpga_properties object on success.
+// Snapshots are immutable and are returned without taking the lock.
 static inline struct _fpga_properties *
 opae_validate_and_lock_properties(fpga_properties props)
 {
@@ -146,6 +164,9 @@ opae_validate_and_lock_properties(fpga_properties props)
 	if (!p)
 		return NULL;
 
+	if (opae_properties_is_snapshot(p))
+		return (p->magic == FPGA_PROPERTY_MAGIC) ? p : NULL;
+
 	opae_mutex_lock(res, &p->lock);
 
 	if (p->magic != FPGA_PROPERTY_MAGIC) {
@@ -156,6 +177,170 @@ opae_validate_and_lock_properties(fpga_properties props)
 	return p;
 }
 
+// As opae_validate_and_lock_properties(), but fails for snapshots.
+static inline struct _fpga_properties *
+opae_validate_and_lock_mutable_properties(fpga_properties props)
+{
+	struct _fpga_properties *p = (struct _fpga_properties *)props;
+
+	if (p && opae_properties_is_snapshot(p)) {
+		OPAE_ERR("properties object is a read-only snapshot");
+		return NULL;
+	}
+
+	return opae_validate_and_lock_properties(props);
+}
+
+#define opae_properties_unlock(__res, __p)                                    \
+	do {                                                                   \
+		if (!opae_properties_is_snapshot(__p))                         \
+			opae_mutex_unlock(__res, &(__p)->lock);                \
+	} while (0)
+
+/*
+ * Precompiled filters
+ *
+ * The common properties that a plugin compares against its token
+ * header are packed into a fixed-size key, and a filter's valid_fields
+ * bitmap is turned into a mask over that key, so that matching a
+ * filter becomes a mask-and-compare of a few words. Fields that can't
+ * be packed (parent, num_errors and the object-specific properties)
+ * remain in the compiled filter's valid_fields, for the plugin to check
+ * individually with FIELD_VALID().
+ */
+#define OPAE_FILTER_KEY_WORDS 5
+
+typedef struct _opae_filter_key {
+	uint64_t w[OPAE_FILTER_KEY_WORDS];
+} opae_filter_key;
+
+// The valid_fields bits that are packed into an opae_filter_key.
+#define OPAE_FILTER_KEY_FIELDS                                                 \
+	(((uint64_t)1 << FPGA_PROPERTY_OBJTYPE)      |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_SEGMENT)      |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_BUS)          |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_DEVICE)       |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_FUNCTION)     |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_SOCKETID)     |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_VENDORID)     |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_DEVICEID)     |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_GUID)         |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_OBJECTID)     |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_INTERFACE)    |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_SUB_VENDORID) |                         \
+	 ((uint64_t)1 << FPGA_PROPERTY_SUB_DEVICEID))
+
+typedef struct _opae_compiled_filter {
+	opae_filter_key mask;
+	opae_filter_key value;
+	uint64_t valid_fields;  // valid fields not covered by mask
+	fpga_token parent;
+	uint32_t num_errors;
+	fpga_objtype objtype;
+	union _fpga_object_properties u;
+} opae_compiled_filter;
+
+static inline void
+opae_filter_key_pack(opae_filter_key *key,
+		     const fpga_token_header *hdr,
+		     uint8_t socket_id)
+{
+	key->w[0] = (uint64_t)hdr->segment |
+		    ((uint64_t)hdr->bus << 16) |
+		    ((uint64_t)hdr->device << 24) |
+		    ((uint64_t)hdr->function << 32) |
+		    ((uint64_t)socket_id << 40) |
+		    ((uint64_t)(hdr->objtype & 0xff) << 48) |
+		    ((uint64_t)(hdr->interface & 0xff) << 56);
+	key->w[1] = (uint64_t)hdr->vendor_id |
+		    ((uint64_t)hdr->device_id << 16) |
+		    ((uint64_t)hdr->subsystem_vendor_id << 32) |
+		    ((uint64_t)hdr->subsystem_device_id << 48);
+	key->w[2] = hdr->object_id;
+	memcpy(&key->w[3], hdr->guid, sizeof(fpga_guid));
+}
+
+// Compile filter p, which must be locked or a snapshot.
+static inline void
+opae_filter_compile(const struct _fpga_properties *p,
+		    opae_compiled_filter *f)
+{
+	fpga_token_header hdr;
+	uint64_t m0 = 0;
+	uint64_t m1 = 0;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.segment = p->segment;
+	hdr.bus = p->bus;
+	hdr.device = p->device;
+	hdr.function = p->function;
+	hdr.objtype = p->objtype;
+	hdr.interface = p->interface;
+	hdr.vendor_id = p->vendor_id;
+	hdr.device_id = p->device_id;
+	hdr.subsystem_vendor_id = p->subsystem_vendor_id;
+	hdr.subsystem_device_id = p->subsystem_device_id;
+	hdr.object_id = p->object_id;
+	memcpy(hdr.guid, p->guid, sizeof(fpga_guid));
+
+	if (FIELD_VALID(p, FPGA_PROPERTY_SEGMENT))
+		m0 |= UINT64_C(0xffff);
+	if (FIELD_VALID(p, FPGA_PROPERTY_BUS))
+		m0 |= UINT64_C(0xff) << 16;
+	if (FIELD_VALID(p, FPGA_PROPERTY_DEVICE))
+		m0 |= UINT64_C(0xff) << 24;
+	if (FIELD_VALID(p, FPGA_PROPERTY_FUNCTION))
+		m0 |= UINT64_C(0xff) << 32;
+	if (FIELD_VALID(p, FPGA_PROPERTY_SOCKETID))
+		m0 |= UINT64_C(0xff) << 40;
+	if (FIELD_VALID(p, FPGA_PROPERTY_OBJTYPE))
+		m0 |= UINT64_C(0xff) << 48;
+	if (FIELD_VALID(p, FPGA_PROPERTY_INTERFACE))
+		m0 |= UINT64_C(0xff) << 56;
+
+	if (FIELD_VALID(p, FPGA_PROPERTY_VENDORID))
+		m1 |= UINT64_C(0xffff);
+	if (FIELD_VALID(p, FPGA_PROPERTY_DEVICEID))
+		m1 |= UINT64_C(0xffff) << 16;
+	if (FIELD_VALID(p, FPGA_PROPERTY_SUB_VENDORID))
+		m1 |= UINT64_C(0xffff) << 32;
+	if (FIELD_VALID(p, FPGA_PROPERTY_SUB_DEVICEID))
+		m1 |= UINT64_C(0xffff) << 48;
+
+	f->mask.w[0] = m0;
+	f->mask.w[1] = m1;
+	f->mask.w[2] = FIELD_VALID(p, FPGA_PROPERTY_OBJECTID) ?
+		UINT64_MAX : 0;
+	f->mask.w[3] = f->mask.w[4] = FIELD_VALID(p, FPGA_PROPERTY_GUID) ?
+		UINT64_MAX : 0;
+
+	opae_filter_key_pack(&f->value, &hdr, p->socket_id);
+	for (int i = 0 ; i < OPAE_FILTER_KEY_WORDS ; ++i)
+		f->value.w[i] &= f->mask.w[i];
+
+	f->valid_fields = p->valid_fields & ~OPAE_FILTER_KEY_FIELDS;
+	// The object-specific fields apply only when the filter
+	// specifies the object type.
+	if (!FIELD_VALID(p, FPGA_PROPERTY_OBJTYPE))
+		f->valid_fields &= UINT64_C(0xffffffff);
+	f->parent = p->parent;
+	f->num_errors = p->num_errors;
+	f->objtype = p->objtype;
+	f->u = p->u;
+}
+
+static inline bool
+opae_filter_key_matches(const opae_compiled_filter *f,
+			const opae_filter_key *key)
+{
+	uint64_t diff = 0;
+
+	for (int i = 0 ; i < OPAE_FILTER_KEY_WORDS ; ++i)
+		diff |= (key->w[i] & f->mask.w[i]) ^ f->value.w[i];
+
+	return !diff;
+}
+
 struct _fpga_properties *opae_properties_create(void);
 
 #endif // ___OPAE_PROPS_H__
@@ -0,0 +1,177 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include <opae/cxx/core/buffer_pool.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace opae {
+namespace fpga {
+namespace types {
+
+buffer_pool::buffer_pool(handle::ptr_t handle, bool read_only,
+                         size_t max_idle)
+    : handle_(handle), read_only_(read_only), max_idle_(max_idle) {}
+
+buffer_pool::~buffer_pool() { trim(); }
+
+buffer_pool::ptr_t buffer_pool::create(handle::ptr_t handle, bool read_only,
+                                       size_t max_idle) {
+  if (!handle) {
+    throw std::invalid_argument("handle object is null");
+  }
+  return ptr_t(new buffer_pool(handle, read_only, max_idle));
+}
+
+size_t buffer_pool::size_class(size_t len) {
+  size_t cls = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  while (cls < len) cls <<= 1;
+  return cls;
+}
+
+buffer_pool::buffer_t buffer_pool::take(size_t cls) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = idle_.find(cls);
+    if (it != idle_.end() && !it->second.empty()) {
+      buffer_t buf = std::move(it->second.back());
+      it->second.pop_back();
+      return buf;
+    }
+  }
+
+  // Nothing idle in this class: prepare a new buffer, outside the lock.
+  return prepare(cls);
+}
+
+buffer_pool::buffer_t buffer_pool::prepare(size_t cls) {
+  uint8_t *virt = nullptr;
+  uint64_t wsid = 0;
+  uint64_t io_address = 0;
+  int flags = read_only_ ? FPGA_BUF_READ_ONLY : 0;
+
+  fpga_result res = fpgaPrepareBuffer(
+      handle_->c_type(), cls, reinterpret_cast<void **>(&virt), &wsid, flags);
+  ASSERT_FPGA_OK(res);
+  res = fpgaGetIOAddress(handle_->c_type(), wsid, &io_address);
+  if (res != FPGA_OK) {
+    fpgaReleaseBuffer(handle_->c_type(), wsid);
+    ASSERT_FPGA_OK(res);
+  }
+
+  return buffer_t(new shared_buffer(handle_, cls, virt, wsid, io_address));
+}
+
+void buffer_pool::recycle(std::weak_ptr<buffer_pool> pool, size_t cls,
+                          shared_buffer *buffer) {
+  buffer_t buf(buffer);
+  auto p = pool.lock();
+
+  // A buffer that was released explicitly can't be reused.
+  if (!p || !buf->virt_) return;
+
+  std::lock_guard<std::mutex> guard(p->lock_);
+  auto &bucket = p->idle_[cls];
+  if (!p->max_idle_ || bucket.size() < p->max_idle_) {
+    buf->len_ = cls;
+    bucket.push_back(std::move(buf));
+  }
+}
+
+shared_buffer::ptr_t buffer_pool::acquire(size_t len, bool zero) {
+  if (!len) {
+    throw except(OPAECXX_HERE);
+  }
+
+  size_t cls = size_class(len);
+  buffer_t buf = take(cls);
+
+  if (zero) std::memset(buf->virt_, 0, len);
+
+  buf->len_ = len;
+
+  std::weak_ptr<buffer_pool> pool = shared_from_this();
+  return shared_buffer::ptr_t(buf.release(), [pool, cls](shared_buffer *b) {
+    buffer_pool::recycle(pool, cls, b);
+  });
+}
+
+size_t buffer_pool::reserve(size_t len, size_t count) {
+  size_t cls = size_class(len);
+  std::vector<buffer_t> bufs;
+
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    size_t have = idle_[cls].size();
+    if (max_idle_ && count > max_idle_) count = max_idle_;
+    count = (count > have) ? count - have : 0;
+  }
+
+  while (count--) {
+    bufs.push_back(prepare(cls));
+    // Touch every page now rather than on first use.
+    std::memset(bufs.back()->virt_, 0, cls);
+  }
+
+  std::lock_guard<std::mutex> guard(lock_);
+  auto &bucket = idle_[cls];
+  // Leases recycled meanwhile may have filled the class; any
+  // buffers beyond max_idle are released as bufs goes out of scope.
+  for (auto &b : bufs) {
+    if (max_idle_ && bucket.size() >= max_idle_) break;
+    bucket.push_back(std::move(b));
+  }
+  return bucket.size();
+}
+
+std::future<size_t> buffer_pool::reserve_async(size_t len, size_t count) {
+  auto self = shared_from_this();
+  return std::async(std::launch::async, [self, len, count]() {
+    return self->reserve(len, count);
+  });
+}
+
+void buffer_pool::trim() {
+  std::map<size_t, std::vector<buffer_t>> trash;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    trash.swap(idle_);
+  }
+  // The buffers are released as trash goes out of scope.
+}
+
+size_t buffer_pool::idle() const {
+  size_t n = 0;
+  std::lock_guard<std::mutex> guard(lock_);
+  for (const auto &bucket : idle_) n += bucket.second.size();
+  return n;
+}
+
+}  // end of namespace types
+}  // end of namespace fpga
+}  // end of namespace opae
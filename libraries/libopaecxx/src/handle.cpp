@@ -1,4 +1,4 @@
-// Copyright(c) 2018-2021, Intel Corporation
+// Copyright(c) 2018-2023, Intel Corporation
 //
 // Redistribution  and  use  in source  and  binary  forms,  with  or  without
 // modification, are permitted provided that the following conditions are met:
@@ -35,7 +35,10 @@ namespace opae {
 namespace fpga {
 namespace types {
 
-handle::handle(fpga_handle h) : handle_(h), token_(nullptr) {}
+handle::handle(fpga_handle h) : handle_(h), token_(nullptr) {
+  for (auto &base : mmio_base_)
+    base.store(nullptr, std::memory_order_relaxed);
+}
 
 handle::~handle() {
   close();
@@ -70,6 +73,8 @@ handle::ptr_t handle::open(token::ptr_t tok, int flags) {
 
 fpga_result handle::close() {
   if (handle_ != nullptr) {
+    for (auto &base : mmio_base_)
+      base.store(nullptr, std::memory_order_relaxed);
     auto res = fpgaClose(handle_);
     ASSERT_FPGA_OK(res);
     handle_ = nullptr;
@@ -117,10 +122,21 @@ void handle::write_csr512(uint64_t offset, const void *value,
 uint8_t *handle::mmio_ptr(uint64_t offset, uint32_t csr_space) const {
   uint8_t *base = nullptr;
 
+  if (csr_space < mmio_cache_size) {
+    base = mmio_base_[csr_space].load(std::memory_order_acquire);
+    if (base)
+      return base + offset;
+  }
+
+  // Mapping is idempotent, so racing callers see the same base.
   auto res =
       fpgaMapMMIO(handle_, csr_space, reinterpret_cast<uint64_t **>(&base));
 
   ASSERT_FPGA_OK(res);
+
+  if (csr_space < mmio_cache_size)
+    mmio_base_[csr_space].store(base, std::memory_order_release);
+
   return base + offset;
 }
 
@@ -1,4 +1,4 @@
-// Copyright(c) 2018, Intel Corporation
+// Copyright(c) 2018-2023, Intel Corporation
 //
 // Redistribution  and  use  in source  and  binary  forms,  with  or  without
 // modification, are permitted provided that the following conditions are met:
@@ -66,6 +66,13 @@ shared_buffer::ptr_t shared_buffer::allocate(handle::ptr_t handle, size_t len,
   return p;
 }
 
+std::future<shared_buffer::ptr_t> shared_buffer::allocate_async(
+    handle::ptr_t handle, size_t len, bool read_only) {
+  return std::async(std::launch::async, [handle, len, read_only]() {
+    return shared_buffer::allocate(handle, len, read_only);
+  });
+}
+
 shared_buffer::ptr_t shared_buffer::attach(handle::ptr_t handle, uint8_t *base,
                                            size_t len, bool read_only) {
   ptr_t p;
@@ -39,7 +39,6 @@
 #include <unistd.h>
 #include <assert.h>
 #include <inttypes.h>
-#include <signal.h>
 #include "fpga_dma_internal.h"
 #include "fpga_dma.h"
 
@@ -54,11 +53,6 @@ double buf_full_count = 0;
 
 uint64_t fpga_dma_buf_size = 1023 * 1024;
 
-// For signal handler - need to properly handle HUP
-static struct sigaction old_action;
-static volatile uint32_t *CsrControl;
-static void sig_handler(int sig, siginfo_t *signfo, void *unused);
-
 /**
  * local_memcpy
  *
@@ -69,7 +63,7 @@ static void sig_handler(int sig, siginfo_t *signfo, void *unused);
  * @return dst
  *
  */
-void *local_memcpy(void *dst, void *src, size_t n)
+static void *local_memcpy(void *dst, void *src, size_t n)
 {
 #ifdef USE_MEMCPY
 	return memcpy(dst, src, n);
@@ -694,20 +688,6 @@ fpga_result fpgaDmaOpen(fpga_handle fpga, int dma_idx, fpga_dma_handle *dma_p)
 				0 /*vector id */);
 	ON_ERR_GOTO(res, destroy_eh, "fpgaRegisterEvent");
 
-	struct sigaction sa;
-	int sigres;
-
-	memset(&sa, 0, sizeof(sa));
-	sa.sa_flags = SA_SIGINFO | SA_RESETHAND;
-	sa.sa_sigaction = sig_handler;
-
-	sigres = sigaction(SIGHUP, &sa, &old_action);
-	if (sigres < 0) {
-		ON_ERR_GOTO(sigres < 0, destroy_eh,
-			    "Error: failed to unregister signal handler.\n");
-	}
-	CsrControl = HOST_MMIO_32_ADDR(dma_h, CSR_CONTROL(dma_h));
-
 	return FPGA_OK;
 
 destroy_eh:
@@ -1187,7 +1167,7 @@ static void _wait_magic(fpga_dma_handle dma_h)
 	*(dma_h->magic_buf) = 0x0ULL;
 }
 
-fpga_result transferHostToFpga(fpga_dma_handle dma_h, uint64_t dst,
+static fpga_result transferHostToFpga(fpga_dma_handle dma_h, uint64_t dst,
 			       uint64_t src, size_t count,
 			       fpga_dma_transfer_t type)
 {
@@ -1319,7 +1299,7 @@ out:
 	return res;
 }
 
-fpga_result transferFpgaToHost(fpga_dma_handle dma_h, uint64_t dst,
+static fpga_result transferFpgaToHost(fpga_dma_handle dma_h, uint64_t dst,
 			       uint64_t src, size_t count,
 			       fpga_dma_transfer_t type)
 {
@@ -1466,7 +1446,7 @@ out:
 	return res;
 }
 
-fpga_result transferFpgaToFpga(fpga_dma_handle dma_h, uint64_t dst,
+static fpga_result transferFpgaToFpga(fpga_dma_handle dma_h, uint64_t dst,
 			       uint64_t src, size_t count,
 			       fpga_dma_transfer_t type)
 {
@@ -1614,7 +1594,6 @@ fpga_result fpgaDmaClose(fpga_dma_handle dma_h)
 {
 	fpga_result res = FPGA_OK;
 	int i = 0;
-	int sigres;
 	if (!dma_h) {
 		return FPGA_INVALID_PARAM;
 	}
@@ -1624,15 +1603,6 @@ fpga_result fpgaDmaClose(fpga_dma_handle dma_h)
 		goto out;
 	}
 
-	if (CsrControl) {
-		sigres = sigaction(SIGHUP, &old_action, NULL);
-		if (sigres < 0) {
-			error_print(
-				"Error: failed to unregister signal handler.\n");
-		}
-		CsrControl = NULL;
-	}
-
 	for (i = 0; i < FPGA_DMA_MAX_BUF; i++) {
 		res = fpgaReleaseBuffer(dma_h->fpga_h, dma_h->dma_buf_wsid[i]);
 		ON_ERR_GOTO(res, out, "fpgaReleaseBuffer failed");
@@ -1657,27 +1627,3 @@ out:
 	free((void *)dma_h);
 	return res;
 }
-
-void sig_handler(int sig, siginfo_t *info, void *unused)
-{
-	(void)(info);
-	(void)(unused);
-
-	if (CsrControl == NULL) {
-		return;
-	}
-
-	switch (sig) {
-	case SIGHUP: {
-		// Driver removed - shut down!
-		*CsrControl = DMA_SHUTDOWN_CTL_VAL;
-		ON_ERR_GOTO(FPGA_NO_DRIVER, out, "Got SIGHUP. Exiting.\n");
-	out:
-		*CsrControl = DMA_SHUTDOWN_CTL_VAL;
-		usleep(1000);
-		exit(-1);
-	} break;
-	default:
-		break;
-	}
-}
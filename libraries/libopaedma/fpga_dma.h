@@ -41,6 +41,15 @@
 extern "C" {
 #endif
 
+/*
+ * The DMA BBB driver is internal to libopaedma, behind the opae_dma_*
+ * API of <opae/dma.h>, so none of its symbols are exported.
+ */
+#pragma GCC visibility push(hidden)
+
+// Size of each of the host bounce buffers.
+extern uint64_t fpga_dma_buf_size;
+
 /*
  * The DMA driver supports host to FPGA, FPGA to host and FPGA
  * to FPGA transfers. The FPGA interface can be streaming
@@ -130,6 +139,8 @@ fpga_result fpgaDmaTransferAsync(fpga_dma_handle dma, uint64_t dst,
  */
 fpga_result fpgaDmaClose(fpga_dma_handle dma);
 
+#pragma GCC visibility pop
+
 #ifdef __cplusplus
 }
 #endif
@@ -61,6 +61,7 @@
 	})
 #endif
 
+// Written to the control register to stop the engine.
 #define DMA_SHUTDOWN_CTL_VAL (0x21)
 
 #define FPGA_DMA_TIMEOUT_MSEC (120000)
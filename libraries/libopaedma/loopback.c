@@ -0,0 +1,132 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include "opaedma_int.h"
+
+// Matches the number of DMA BBBs fpgaDmaOpen() can address.
+#define LOOPBACK_MAX_CHANNELS 4
+
+STATIC fpga_result loopback_handle_open(struct _opae_dma_handle *dma)
+{
+	if (!dma->attr.loopback_size) {
+		OPAE_ERR("loopback_size must be non-zero");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (!dma->attr.num_channels)
+		dma->attr.num_channels = LOOPBACK_MAX_CHANNELS;
+
+	dma->loopback_mem = opae_calloc(1, dma->attr.loopback_size);
+	if (!dma->loopback_mem) {
+		OPAE_ERR("failed to allocate %zu bytes of loopback memory",
+			 dma->attr.loopback_size);
+		return FPGA_NO_MEMORY;
+	}
+
+	return FPGA_OK;
+}
+
+STATIC fpga_result loopback_channel_open(struct _opae_dma_handle *dma,
+					 uint32_t index,
+					 void **ctx)
+{
+	UNUSED_PARAM(index);
+	*ctx = dma;
+	return FPGA_OK;
+}
+
+STATIC bool loopback_in_range(struct _opae_dma_handle *dma,
+			      uint64_t offset,
+			      size_t len)
+{
+	return (offset <= dma->attr.loopback_size) &&
+	       (len <= dma->attr.loopback_size - offset);
+}
+
+STATIC fpga_result loopback_transfer(void *ctx,
+				     uint64_t dst,
+				     uint64_t src,
+				     size_t len,
+				     opae_dma_direction dir,
+				     size_t *bytes)
+{
+	struct _opae_dma_handle *dma = (struct _opae_dma_handle *)ctx;
+	uint8_t *mem = dma->loopback_mem;
+	void *d;
+	const void *s;
+
+	switch (dir) {
+	case OPAE_DMA_HOST_TO_FPGA:
+		if (!loopback_in_range(dma, dst, len))
+			return FPGA_INVALID_PARAM;
+		d = mem + dst;
+		s = (const void *)(uintptr_t)src;
+		break;
+	case OPAE_DMA_FPGA_TO_HOST:
+		if (!loopback_in_range(dma, src, len))
+			return FPGA_INVALID_PARAM;
+		d = (void *)(uintptr_t)dst;
+		s = mem + src;
+		break;
+	case OPAE_DMA_FPGA_TO_FPGA:
+		if (!loopback_in_range(dma, dst, len) ||
+		    !loopback_in_range(dma, src, len))
+			return FPGA_INVALID_PARAM;
+		d = mem + dst;
+		s = mem + src;
+		break;
+	default:
+		return FPGA_INVALID_PARAM;
+	}
+
+	memmove(d, s, len);
+	*bytes = len;
+
+	return FPGA_OK;
+}
+
+STATIC void loopback_channel_close(void *ctx)
+{
+	UNUSED_PARAM(ctx);
+}
+
+STATIC void loopback_handle_close(struct _opae_dma_handle *dma)
+{
+	opae_free(dma->loopback_mem);
+	dma->loopback_mem = NULL;
+}
+
+const struct opae_dma_backend_ops opae_dma_loopback_ops = {
+	.handle_open = loopback_handle_open,
+	.channel_open = loopback_channel_open,
+	.transfer = loopback_transfer,
+	.channel_close = loopback_channel_close,
+	.handle_close = loopback_handle_close
+};
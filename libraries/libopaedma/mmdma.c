@@ -0,0 +1,155 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include "opaedma_int.h"
+#include "fpga_dma.h"
+
+// fpgaDmaOpen() addresses at most four DMA BBBs per AFU.
+#define MM_MAX_CHANNELS 4
+
+/*
+ * Opening a DMA BBB prepares its bounce buffers, so the channels are
+ * opened once here and handed to channel_open() rather than probed and
+ * re-opened.
+ */
+STATIC fpga_result mm_handle_open(struct _opae_dma_handle *dma)
+{
+	fpga_dma_handle *engines;
+	uint32_t want = dma->attr.num_channels;
+	uint32_t i;
+	fpga_result res = FPGA_OK;
+
+	if (want > MM_MAX_CHANNELS) {
+		OPAE_ERR("at most %d MM DMA channels are supported",
+			 MM_MAX_CHANNELS);
+		return FPGA_INVALID_PARAM;
+	}
+
+	engines = opae_calloc(MM_MAX_CHANNELS, sizeof(fpga_dma_handle));
+	if (!engines) {
+		OPAE_ERR("calloc() failed");
+		return FPGA_NO_MEMORY;
+	}
+
+	for (i = 0 ; i < (want ? want : MM_MAX_CHANNELS) ; ++i) {
+		res = fpgaDmaOpen(dma->fpga, (int)i, &engines[i]);
+		if (res != FPGA_OK)
+			break;
+	}
+
+	if (!i || (want && i < want)) {
+		OPAE_ERR("found %u of %u MM DMA channels", i, want);
+		while (i-- > 0)
+			fpgaDmaClose(engines[i]);
+		opae_free(engines);
+		return (res == FPGA_OK) ? FPGA_NOT_FOUND : res;
+	}
+
+	dma->attr.num_channels = i;
+	dma->priv = engines;
+
+	return FPGA_OK;
+}
+
+STATIC fpga_result mm_channel_open(struct _opae_dma_handle *dma,
+				   uint32_t index,
+				   void **ctx)
+{
+	fpga_dma_handle *engines = (fpga_dma_handle *)dma->priv;
+
+	*ctx = engines[index];
+	engines[index] = NULL;
+
+	return FPGA_OK;
+}
+
+STATIC fpga_result mm_transfer(void *ctx,
+			       uint64_t dst,
+			       uint64_t src,
+			       size_t len,
+			       opae_dma_direction dir,
+			       size_t *bytes)
+{
+	fpga_dma_handle engine = (fpga_dma_handle)ctx;
+	fpga_dma_transfer_t type;
+	fpga_result res;
+
+	switch (dir) {
+	case OPAE_DMA_HOST_TO_FPGA:
+		type = HOST_TO_FPGA_MM;
+		break;
+	case OPAE_DMA_FPGA_TO_HOST:
+		type = FPGA_TO_HOST_MM;
+		break;
+	case OPAE_DMA_FPGA_TO_FPGA:
+		type = FPGA_TO_FPGA_MM;
+		break;
+	default:
+		return FPGA_INVALID_PARAM;
+	}
+
+	res = fpgaDmaTransferSync(engine, dst, src, len, type);
+	if (res == FPGA_OK)
+		*bytes = len;
+
+	return res;
+}
+
+STATIC void mm_channel_close(void *ctx)
+{
+	if (ctx)
+		fpgaDmaClose((fpga_dma_handle)ctx);
+}
+
+STATIC void mm_handle_close(struct _opae_dma_handle *dma)
+{
+	fpga_dma_handle *engines = (fpga_dma_handle *)dma->priv;
+	uint32_t i;
+
+	if (!engines)
+		return;
+
+	// Close any engine that was never claimed by a channel.
+	for (i = 0 ; i < MM_MAX_CHANNELS ; ++i) {
+		if (engines[i])
+			fpgaDmaClose(engines[i]);
+	}
+
+	opae_free(engines);
+	dma->priv = NULL;
+}
+
+const struct opae_dma_backend_ops opae_dma_mm_ops = {
+	.handle_open = mm_handle_open,
+	.channel_open = mm_channel_open,
+	.transfer = mm_transfer,
+	.channel_close = mm_channel_close,
+	.handle_close = mm_handle_close
+};
@@ -0,0 +1,545 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif // _GNU_SOURCE
+#include <sched.h>
+#include <time.h>
+
+#include "opaedma_int.h"
+
+void opae_dma_attr_init(struct opae_dma_attr *attr)
+{
+	if (!attr)
+		return;
+
+	attr->backend = OPAE_DMA_BACKEND_MM;
+	attr->num_channels = 0;
+	attr->queue_depth = OPAE_DMA_DEFAULT_QUEUE_DEPTH;
+	attr->loopback_size = OPAE_DMA_DEFAULT_LOOPBACK_SIZE;
+}
+
+STATIC void opae_dma_complete(struct _opae_dma_channel *ch,
+			      struct _opae_dma_request *req)
+{
+	bool detached;
+	int err;
+
+	if (req->cb)
+		req->cb(req->context, req->result, req->bytes);
+
+	opae_mutex_lock(err, &ch->lock);
+
+	--ch->outstanding;
+	detached = req->detached;
+	__atomic_store_n(&req->state, OPAE_DMA_REQ_COMPLETE, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&ch->completed);
+
+	opae_mutex_unlock(err, &ch->lock);
+
+	if (detached)
+		opae_free(req);
+}
+
+STATIC void *opae_dma_worker(void *arg)
+{
+	struct _opae_dma_channel *ch = (struct _opae_dma_channel *)arg;
+	const struct opae_dma_backend_ops *ops = ch->dma->ops;
+	struct _opae_dma_request *req;
+	int err;
+
+	while (1) {
+		opae_mutex_lock(err, &ch->lock);
+
+		while (!ch->head && !ch->stop)
+			pthread_cond_wait(&ch->submitted, &ch->lock);
+
+		if (!ch->head) {
+			// stop requested and the queue is empty.
+			opae_mutex_unlock(err, &ch->lock);
+			break;
+		}
+
+		req = ch->head;
+		ch->head = req->next;
+		if (!ch->head)
+			ch->tail = NULL;
+
+		opae_mutex_unlock(err, &ch->lock);
+
+		req->bytes = 0;
+		req->result = ops->transfer(ch->ctx,
+					    req->dst,
+					    req->src,
+					    req->len,
+					    req->dir,
+					    &req->bytes);
+
+		opae_dma_complete(ch, req);
+	}
+
+	return NULL;
+}
+
+STATIC fpga_result opae_dma_channel_init(opae_dma_handle dma,
+					 uint32_t index)
+{
+	struct _opae_dma_channel *ch = &dma->channels[index];
+	pthread_mutexattr_t mattr;
+	fpga_result res;
+	int err;
+
+	ch->dma = dma;
+	ch->index = index;
+
+	if (pthread_mutexattr_init(&mattr)) {
+		OPAE_ERR("pthread_mutexattr_init() failed");
+		return FPGA_EXCEPTION;
+	}
+
+	if (pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE) ||
+	    pthread_mutex_init(&ch->lock, &mattr)) {
+		OPAE_ERR("failed to init channel %u lock", index);
+		pthread_mutexattr_destroy(&mattr);
+		return FPGA_EXCEPTION;
+	}
+
+	pthread_mutexattr_destroy(&mattr);
+
+	pthread_cond_init(&ch->submitted, NULL);
+	pthread_cond_init(&ch->completed, NULL);
+
+	res = dma->ops->channel_open(dma, index, &ch->ctx);
+	if (res != FPGA_OK)
+		goto out_destroy;
+
+	err = pthread_create(&ch->worker, NULL, opae_dma_worker, ch);
+	if (err) {
+		OPAE_ERR("failed to create worker for channel %u: %s",
+			 index, strerror(err));
+		dma->ops->channel_close(ch->ctx);
+		res = FPGA_EXCEPTION;
+		goto out_destroy;
+	}
+
+	ch->worker_running = true;
+	return FPGA_OK;
+
+out_destroy:
+	pthread_cond_destroy(&ch->completed);
+	pthread_cond_destroy(&ch->submitted);
+	pthread_mutex_destroy(&ch->lock);
+	return res;
+}
+
+STATIC void opae_dma_channel_destroy(struct _opae_dma_channel *ch)
+{
+	int err;
+
+	if (!ch->worker_running)
+		return;
+
+	opae_mutex_lock(err, &ch->lock);
+	ch->stop = true;
+	pthread_cond_signal(&ch->submitted);
+	opae_mutex_unlock(err, &ch->lock);
+
+	pthread_join(ch->worker, NULL);
+	ch->worker_running = false;
+
+	ch->dma->ops->channel_close(ch->ctx);
+	ch->ctx = NULL;
+
+	pthread_cond_destroy(&ch->completed);
+	pthread_cond_destroy(&ch->submitted);
+	pthread_mutex_destroy(&ch->lock);
+}
+
+fpga_result opae_dma_open(fpga_handle fpga,
+			  const struct opae_dma_attr *attr,
+			  opae_dma_handle *dma)
+{
+	struct _opae_dma_handle *h;
+	fpga_result res;
+	uint32_t i;
+
+	if (!dma) {
+		OPAE_ERR("NULL dma handle pointer");
+		return FPGA_INVALID_PARAM;
+	}
+
+	h = opae_calloc(1, sizeof(struct _opae_dma_handle));
+	if (!h) {
+		OPAE_ERR("calloc() failed");
+		return FPGA_NO_MEMORY;
+	}
+
+	h->fpga = fpga;
+	if (attr)
+		h->attr = *attr;
+	else
+		opae_dma_attr_init(&h->attr);
+
+	if (!h->attr.queue_depth)
+		h->attr.queue_depth = OPAE_DMA_DEFAULT_QUEUE_DEPTH;
+
+	switch (h->attr.backend) {
+	case OPAE_DMA_BACKEND_MM:
+		if (!fpga) {
+			OPAE_ERR("MM backend requires an fpga_handle");
+			res = FPGA_INVALID_PARAM;
+			goto out_free;
+		}
+		h->ops = &opae_dma_mm_ops;
+		break;
+	case OPAE_DMA_BACKEND_LOOPBACK:
+		h->ops = &opae_dma_loopback_ops;
+		break;
+	default:
+		OPAE_ERR("invalid backend %d", h->attr.backend);
+		res = FPGA_INVALID_PARAM;
+		goto out_free;
+	}
+
+	// handle_open() resolves attr.num_channels of 0 to the
+	// number of engines the backend actually provides.
+	res = h->ops->handle_open(h);
+	if (res != FPGA_OK)
+		goto out_free;
+
+	h->num_channels = h->attr.num_channels;
+	h->channels = opae_calloc(h->num_channels,
+				  sizeof(struct _opae_dma_channel));
+	if (!h->channels) {
+		OPAE_ERR("calloc() failed");
+		res = FPGA_NO_MEMORY;
+		goto out_close;
+	}
+
+	for (i = 0 ; i < h->num_channels ; ++i) {
+		res = opae_dma_channel_init(h, i);
+		if (res != FPGA_OK)
+			goto out_destroy;
+	}
+
+	*dma = h;
+	return FPGA_OK;
+
+out_destroy:
+	while (i-- > 0)
+		opae_dma_channel_destroy(&h->channels[i]);
+	opae_free(h->channels);
+out_close:
+	h->ops->handle_close(h);
+out_free:
+	opae_free(h);
+	return res;
+}
+
+fpga_result opae_dma_channel_count(opae_dma_handle dma, uint32_t *count)
+{
+	if (!dma || !count) {
+		OPAE_ERR("NULL param");
+		return FPGA_INVALID_PARAM;
+	}
+
+	*count = dma->num_channels;
+	return FPGA_OK;
+}
+
+fpga_result opae_dma_channel_set_affinity(opae_dma_handle dma,
+					  uint32_t channel,
+					  int cpu)
+{
+	cpu_set_t set;
+	int i;
+	int err;
+
+	if (!dma || channel >= dma->num_channels) {
+		OPAE_ERR("invalid DMA handle or channel");
+		return FPGA_INVALID_PARAM;
+	}
+
+	CPU_ZERO(&set);
+	if (cpu < 0) {
+		for (i = 0 ; i < CPU_SETSIZE ; ++i)
+			CPU_SET(i, &set);
+	} else if (cpu < CPU_SETSIZE) {
+		CPU_SET(cpu, &set);
+	} else {
+		OPAE_ERR("invalid cpu %d", cpu);
+		return FPGA_INVALID_PARAM;
+	}
+
+	err = pthread_setaffinity_np(dma->channels[channel].worker,
+				     sizeof(set), &set);
+	if (err) {
+		OPAE_ERR("pthread_setaffinity_np() failed: %s",
+			 strerror(err));
+		return FPGA_EXCEPTION;
+	}
+
+	return FPGA_OK;
+}
+
+fpga_result opae_dma_submit(opae_dma_handle dma,
+			    uint32_t channel,
+			    uint64_t dst,
+			    uint64_t src,
+			    size_t len,
+			    opae_dma_direction dir,
+			    opae_dma_callback cb,
+			    void *context,
+			    opae_dma_request *req)
+{
+	struct _opae_dma_channel *ch;
+	struct _opae_dma_request *r;
+	int err;
+
+	if (!dma || channel >= dma->num_channels) {
+		OPAE_ERR("invalid DMA handle or channel");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (dir >= OPAE_DMA_MAX_DIRECTION) {
+		OPAE_ERR("invalid direction %d", dir);
+		return FPGA_INVALID_PARAM;
+	}
+
+	ch = &dma->channels[channel];
+
+	r = opae_malloc(sizeof(struct _opae_dma_request));
+	if (!r) {
+		OPAE_ERR("malloc() failed");
+		return FPGA_NO_MEMORY;
+	}
+
+	r->channel = ch;
+	r->dst = dst;
+	r->src = src;
+	r->len = len;
+	r->dir = dir;
+	r->cb = cb;
+	r->context = context;
+	r->result = FPGA_OK;
+	r->bytes = 0;
+	r->state = OPAE_DMA_REQ_QUEUED;
+	r->detached = (req == NULL);
+	r->next = NULL;
+
+	opae_mutex_lock(err, &ch->lock);
+
+	if (ch->outstanding >= dma->attr.queue_depth) {
+		opae_mutex_unlock(err, &ch->lock);
+		opae_free(r);
+		return FPGA_BUSY;
+	}
+
+	if (ch->tail)
+		ch->tail->next = r;
+	else
+		ch->head = r;
+	ch->tail = r;
+	++ch->outstanding;
+
+	pthread_cond_signal(&ch->submitted);
+
+	opae_mutex_unlock(err, &ch->lock);
+
+	if (req)
+		*req = r;
+
+	return FPGA_OK;
+}
+
+fpga_result opae_dma_poll(opae_dma_request req, size_t *bytes)
+{
+	if (!req) {
+		OPAE_ERR("NULL request");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (__atomic_load_n(&req->state, __ATOMIC_ACQUIRE) !=
+	    OPAE_DMA_REQ_COMPLETE)
+		return FPGA_BUSY;
+
+	if (bytes)
+		*bytes = req->bytes;
+
+	return req->result;
+}
+
+fpga_result opae_dma_wait(opae_dma_request req,
+			  int timeout_ms,
+			  size_t *bytes)
+{
+	struct _opae_dma_channel *ch;
+	struct timespec deadline;
+	int err;
+	int res = 0;
+
+	if (!req) {
+		OPAE_ERR("NULL request");
+		return FPGA_INVALID_PARAM;
+	}
+
+	ch = req->channel;
+
+	if (timeout_ms >= 0) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			++deadline.tv_sec;
+			deadline.tv_nsec -= 1000000000L;
+		}
+	}
+
+	opae_mutex_lock(err, &ch->lock);
+
+	while (req->state != OPAE_DMA_REQ_COMPLETE && res != ETIMEDOUT) {
+		if (timeout_ms < 0)
+			pthread_cond_wait(&ch->completed, &ch->lock);
+		else
+			res = pthread_cond_timedwait(&ch->completed,
+						     &ch->lock,
+						     &deadline);
+	}
+
+	opae_mutex_unlock(err, &ch->lock);
+
+	return opae_dma_poll(req, bytes);
+}
+
+fpga_result opae_dma_request_release(opae_dma_request req)
+{
+	struct _opae_dma_channel *ch;
+	bool complete;
+	int err;
+
+	if (!req) {
+		OPAE_ERR("NULL request");
+		return FPGA_INVALID_PARAM;
+	}
+
+	ch = req->channel;
+
+	opae_mutex_lock(err, &ch->lock);
+	complete = (req->state == OPAE_DMA_REQ_COMPLETE);
+	if (!complete)
+		req->detached = true;
+	opae_mutex_unlock(err, &ch->lock);
+
+	if (complete)
+		opae_free(req);
+
+	return FPGA_OK;
+}
+
+fpga_result opae_dma_transfer_sync(opae_dma_handle dma,
+				   uint32_t channel,
+				   uint64_t dst,
+				   uint64_t src,
+				   size_t len,
+				   opae_dma_direction dir)
+{
+	opae_dma_request req = NULL;
+	fpga_result res;
+
+	res = opae_dma_submit(dma, channel, dst, src, len, dir,
+			      NULL, NULL, &req);
+	if (res != FPGA_OK)
+		return res;
+
+	res = opae_dma_wait(req, -1, NULL);
+	opae_dma_request_release(req);
+
+	return res;
+}
+
+fpga_result opae_dma_drain(opae_dma_handle dma, uint32_t channel)
+{
+	struct _opae_dma_channel *ch;
+	int err;
+
+	if (!dma || channel >= dma->num_channels) {
+		OPAE_ERR("invalid DMA handle or channel");
+		return FPGA_INVALID_PARAM;
+	}
+
+	ch = &dma->channels[channel];
+
+	opae_mutex_lock(err, &ch->lock);
+	while (ch->outstanding)
+		pthread_cond_wait(&ch->completed, &ch->lock);
+	opae_mutex_unlock(err, &ch->lock);
+
+	return FPGA_OK;
+}
+
+fpga_result opae_dma_close(opae_dma_handle dma)
+{
+	uint32_t i;
+
+	if (!dma) {
+		OPAE_ERR("NULL DMA handle");
+		return FPGA_INVALID_PARAM;
+	}
+
+	// Workers finish their queues before exiting.
+	for (i = 0 ; i < dma->num_channels ; ++i)
+		opae_dma_channel_destroy(&dma->channels[i]);
+
+	opae_free(dma->channels);
+	dma->ops->handle_close(dma);
+	opae_free(dma);
+
+	return FPGA_OK;
+}
+
+fpga_result opae_dma_loopback_memory(opae_dma_handle dma,
+				     uint8_t **ptr,
+				     size_t *size)
+{
+	if (!dma || !ptr) {
+		OPAE_ERR("NULL param");
+		return FPGA_INVALID_PARAM;
+	}
+
+	if (dma->attr.backend != OPAE_DMA_BACKEND_LOOPBACK)
+		return FPGA_NOT_SUPPORTED;
+
+	*ptr = dma->loopback_mem;
+	if (size)
+		*size = dma->attr.loopback_size;
+
+	return FPGA_OK;
+}
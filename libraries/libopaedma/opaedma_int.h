@@ -0,0 +1,103 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __OPAEDMA_INT_H__
+#define __OPAEDMA_INT_H__
+
+#include <opae/dma.h>
+#include "opae_int.h"
+
+struct _opae_dma_handle;
+
+/*
+ * Backend operations. Each DMA channel owns a backend context, created
+ * by channel_open() and consumed only by that channel's worker thread.
+ */
+struct opae_dma_backend_ops {
+	fpga_result (*handle_open)(struct _opae_dma_handle *dma);
+	fpga_result (*channel_open)(struct _opae_dma_handle *dma,
+				    uint32_t index,
+				    void **ctx);
+	fpga_result (*transfer)(void *ctx,
+				uint64_t dst,
+				uint64_t src,
+				size_t len,
+				opae_dma_direction dir,
+				size_t *bytes);
+	void (*channel_close)(void *ctx);
+	void (*handle_close)(struct _opae_dma_handle *dma);
+};
+
+// The backends are selected by opae_dma_open(), never by name.
+extern const struct opae_dma_backend_ops opae_dma_mm_ops
+	__attribute__((visibility("hidden")));
+extern const struct opae_dma_backend_ops opae_dma_loopback_ops
+	__attribute__((visibility("hidden")));
+
+#define OPAE_DMA_REQ_QUEUED   0
+#define OPAE_DMA_REQ_COMPLETE 1
+
+struct _opae_dma_request {
+	struct _opae_dma_channel *channel;
+	uint64_t dst;
+	uint64_t src;
+	size_t len;
+	opae_dma_direction dir;
+	opae_dma_callback cb;
+	void *context;
+	fpga_result result;
+	size_t bytes;
+	int state;
+	bool detached;
+	struct _opae_dma_request *next;
+};
+
+struct _opae_dma_channel {
+	struct _opae_dma_handle *dma;
+	uint32_t index;
+	void *ctx;
+	pthread_t worker;
+	bool worker_running;
+	pthread_mutex_t lock;
+	pthread_cond_t submitted;
+	pthread_cond_t completed;
+	struct _opae_dma_request *head;
+	struct _opae_dma_request *tail;
+	uint32_t outstanding;
+	bool stop;
+};
+
+struct _opae_dma_handle {
+	fpga_handle fpga;
+	struct opae_dma_attr attr;
+	const struct opae_dma_backend_ops *ops;
+	uint32_t num_channels;
+	struct _opae_dma_channel *channels;
+	uint8_t *loopback_mem;
+	void *priv;
+};
+
+#endif // __OPAEDMA_INT_H__
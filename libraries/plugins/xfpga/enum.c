@@ -64,217 +64,96 @@ struct dev_list {
 	struct dev_list *fme;
 };
 
-STATIC bool matches_filter(const struct dev_list *attr, const fpga_properties filter)
+STATIC bool matches_compiled_filter(const struct dev_list *attr,
+				    const opae_compiled_filter *filter)
 {
-	struct _fpga_properties *_filter = (struct _fpga_properties *)filter;
-	bool res = true;
-	int err = 0;
+	opae_filter_key key;
 
-	if (pthread_mutex_lock(&_filter->lock)) {
-		OPAE_MSG("Failed to lock filter mutex");
-		return false;
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_PARENT)) {
-		fpga_token_header *parent_hdr =
-			(fpga_token_header *)_filter->parent;
-
-		if (!parent_hdr) {
-			res = false; // Reject search based on NULL parent token
-			goto out_unlock;
-		}
+	opae_filter_key_pack(&key, &attr->hdr, attr->socket_id);
 
-		if (!fpga_is_parent_child(parent_hdr,
-					  &attr->hdr)) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_OBJTYPE)) {
-		if (_filter->objtype != attr->hdr.objtype) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_SEGMENT)) {
-		if (_filter->segment != attr->hdr.segment) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_BUS)) {
-		if (_filter->bus != attr->hdr.bus) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_DEVICE)) {
-		if (_filter->device != attr->hdr.device) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_FUNCTION)) {
-		if (_filter->function != attr->hdr.function) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_SOCKETID)) {
-		if (_filter->socket_id != attr->socket_id) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_GUID)) {
-		if (0 != memcmp(attr->hdr.guid, _filter->guid, sizeof(fpga_guid))) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_OBJECTID)) {
-		if (_filter->object_id != attr->hdr.object_id) {
-			res = false;
-			goto out_unlock;
-		}
-	}
+	if (!opae_filter_key_matches(filter, &key))
+		return false;
 
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_VENDORID)) {
-		if (_filter->vendor_id != attr->hdr.vendor_id) {
-			res = false;
-			goto out_unlock;
-		}
-	}
+	if (!filter->valid_fields)
+		return true;
 
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_DEVICEID)) {
-		if (_filter->device_id != attr->hdr.device_id) {
-			res = false;
-			goto out_unlock;
-		}
-	}
+	if (FIELD_VALID(filter, FPGA_PROPERTY_PARENT)) {
+		fpga_token_header *parent_hdr =
+			(fpga_token_header *)filter->parent;
 
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_SUB_VENDORID)) {
-		if (_filter->subsystem_vendor_id != attr->hdr.subsystem_vendor_id) {
-			res = false;
-			goto out_unlock;
-		}
-	}
+		if (!parent_hdr)
+			return false; // Reject search based on NULL parent token
 
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_SUB_DEVICEID)) {
-		if (_filter->subsystem_device_id != attr->hdr.subsystem_device_id) {
-			res = false;
-			goto out_unlock;
-		}
+		if (!fpga_is_parent_child(parent_hdr, &attr->hdr))
+			return false;
 	}
 
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_NUM_ERRORS)) {
+	if (FIELD_VALID(filter, FPGA_PROPERTY_NUM_ERRORS)) {
 		uint32_t errors;
 		char errpath[SYSFS_PATH_MAX] = { 0, };
 
 		if (snprintf(errpath, sizeof(errpath),
 			     "%s/errors", attr->sysfspath) < 0) {
 			OPAE_ERR("snprintf buffer overflow");
-			res = false;
-			goto out_unlock;
+			return false;
 		}
 
 		errors = count_error_files(errpath);
-		if (errors != _filter->num_errors) {
-			res = false;
-			goto out_unlock;
-		}
-	}
-
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_INTERFACE)) {
-		if (_filter->interface != attr->hdr.interface) {
-			res = false;
-			goto out_unlock;
-		}
+		if (errors != filter->num_errors)
+			return false;
 	}
 
-	if (FIELD_VALID(_filter, FPGA_PROPERTY_OBJTYPE)
-	    && (FPGA_DEVICE == _filter->objtype)) {
+	// The object-specific fields are valid only when the filter
+	// specifies the object type, which the key has already matched.
+	if (FPGA_DEVICE == filter->objtype) {
 
-		if (FIELD_VALID(_filter, FPGA_PROPERTY_NUM_SLOTS)) {
-			if ((FPGA_DEVICE != attr->hdr.objtype)
-			    || (attr->fpga_num_slots
-				!= _filter->u.fpga.num_slots)) {
-				res = false;
-				goto out_unlock;
-			}
+		if (FIELD_VALID(filter, FPGA_PROPERTY_NUM_SLOTS)) {
+			if (attr->fpga_num_slots != filter->u.fpga.num_slots)
+				return false;
 		}
 
-		if (FIELD_VALID(_filter, FPGA_PROPERTY_BBSID)) {
-			if ((FPGA_DEVICE != attr->hdr.objtype)
-			    || (attr->fpga_bitstream_id
-				!= _filter->u.fpga.bbs_id)) {
-				res = false;
-				goto out_unlock;
-			}
+		if (FIELD_VALID(filter, FPGA_PROPERTY_BBSID)) {
+			if (attr->fpga_bitstream_id != filter->u.fpga.bbs_id)
+				return false;
 		}
 
-		if (FIELD_VALID(_filter, FPGA_PROPERTY_BBSVERSION)) {
-			if ((FPGA_DEVICE != attr->hdr.objtype)
-			    || (attr->fpga_bbs_version.major
-				!= _filter->u.fpga.bbs_version.major)
+		if (FIELD_VALID(filter, FPGA_PROPERTY_BBSVERSION)) {
+			if ((attr->fpga_bbs_version.major
+				!= filter->u.fpga.bbs_version.major)
 			    || (attr->fpga_bbs_version.minor
-				!= _filter->u.fpga.bbs_version.minor)
+				!= filter->u.fpga.bbs_version.minor)
 			    || (attr->fpga_bbs_version.patch
-				!= _filter->u.fpga.bbs_version.patch)) {
-				res = false;
-				goto out_unlock;
-			}
+				!= filter->u.fpga.bbs_version.patch))
+				return false;
 		}
 
-	} else if (FIELD_VALID(_filter, FPGA_PROPERTY_OBJTYPE)
-		   && (FPGA_ACCELERATOR == _filter->objtype)) {
+	} else if (FPGA_ACCELERATOR == filter->objtype) {
 
-		if (FIELD_VALID(_filter, FPGA_PROPERTY_ACCELERATOR_STATE)) {
-			if ((FPGA_ACCELERATOR != attr->hdr.objtype)
-			    || (attr->accelerator_state
-				!= _filter->u.accelerator.state)) {
-				res = false;
-				goto out_unlock;
-			}
+		if (FIELD_VALID(filter, FPGA_PROPERTY_ACCELERATOR_STATE)) {
+			if (attr->accelerator_state
+				!= filter->u.accelerator.state)
+				return false;
 		}
 
-		if (FIELD_VALID(_filter, FPGA_PROPERTY_NUM_MMIO)) {
-			if ((FPGA_ACCELERATOR != attr->hdr.objtype)
-			    || (attr->accelerator_num_mmios
-				!= _filter->u.accelerator.num_mmio)) {
-				res = false;
-				goto out_unlock;
-			}
+		if (FIELD_VALID(filter, FPGA_PROPERTY_NUM_MMIO)) {
+			if (attr->accelerator_num_mmios
+				!= filter->u.accelerator.num_mmio)
+				return false;
 		}
 
-		if (FIELD_VALID(_filter, FPGA_PROPERTY_NUM_INTERRUPTS)) {
-			if ((FPGA_ACCELERATOR != attr->hdr.objtype)
-			    || (attr->accelerator_num_irqs
-				!= _filter->u.accelerator.num_interrupts)) {
-				res = false;
-				goto out_unlock;
-			}
+		if (FIELD_VALID(filter, FPGA_PROPERTY_NUM_INTERRUPTS)) {
+			if (attr->accelerator_num_irqs
+				!= filter->u.accelerator.num_interrupts)
+				return false;
 		}
 	}
 
-out_unlock:
-	err = pthread_mutex_unlock(&_filter->lock);
-	if (err) {
-		OPAE_ERR("pthread_mutex_unlock() failed: %S", strerror(err));
-	}
-	return res;
+	return true;
 }
 
-STATIC bool matches_filters(const struct dev_list *attr, const fpga_properties *filter,
-		     uint32_t num_filter)
+STATIC bool matches_compiled_filters(const struct dev_list *attr,
+				     const opae_compiled_filter *filter,
+				     uint32_t num_filter)
 {
 	uint32_t i;
 
@@ -282,13 +161,49 @@ STATIC bool matches_filters(const struct dev_list *attr, const fpga_properties *
 		return true;
 
 	for (i = 0; i < num_filter; ++i) {
-		if (matches_filter(attr, filter[i])) {
+		if (matches_compiled_filter(attr, &filter[i])) {
 			return true;
 		}
 	}
 	return false;
 }
 
+// Compile each of the filters once, so that matching a device
+// against them needs no further locking.
+STATIC opae_compiled_filter *compile_filters(const fpga_properties *filter,
+					     uint32_t num_filter)
+{
+	opae_compiled_filter *compiled;
+	uint32_t i;
+
+	compiled = (opae_compiled_filter *)opae_calloc(num_filter,
+					sizeof(opae_compiled_filter));
+	if (!compiled)
+		return NULL;
+
+	for (i = 0; i < num_filter; ++i) {
+		struct _fpga_properties *_filter;
+		int err = 0;
+
+		_filter = opae_validate_and_lock_properties(filter[i]);
+		if (!_filter) {
+			OPAE_MSG("Invalid filter");
+			opae_free(compiled);
+			return NULL;
+		}
+
+		opae_filter_compile(_filter, &compiled[i]);
+
+		opae_properties_unlock(err, _filter);
+		if (err) {
+			OPAE_ERR("pthread_mutex_unlock() failed: %s",
+				 strerror(err));
+		}
+	}
+
+	return compiled;
+}
+
 STATIC struct dev_list *add_dev(const char *sysfspath, const char *devpath,
 				struct dev_list *parent)
 {
@@ -712,6 +627,7 @@ fpga_result __XFPGA_API__ xfpga_fpgaEnumerate(const fpga_properties *filters,
 
 	struct dev_list head;
 	struct dev_list *lptr;
+	opae_compiled_filter *compiled = NULL;
 
 	if (NULL == num_matches) {
 		OPAE_MSG("num_matches is NULL");
@@ -737,6 +653,14 @@ fpga_result __XFPGA_API__ xfpga_fpgaEnumerate(const fpga_properties *filters,
 
 	*num_matches = 0;
 
+	if (num_filters) {
+		compiled = compile_filters(filters, num_filters);
+		if (!compiled) {
+			OPAE_ERR("Failed to compile filters");
+			return FPGA_INVALID_PARAM;
+		}
+	}
+
 	memset(&head, 0, sizeof(head));
 
 	// enum FPGA regions & resources
@@ -745,7 +669,7 @@ fpga_result __XFPGA_API__ xfpga_fpgaEnumerate(const fpga_properties *filters,
 
 	if (result != FPGA_OK) {
 		OPAE_MSG("No FPGA resources found");
-		return result;
+		goto out_free_compiled;
 	}
 
 	/* create and populate token data structures */
@@ -762,7 +686,7 @@ fpga_result __XFPGA_API__ xfpga_fpgaEnumerate(const fpga_properties *filters,
 			continue;
 		}
 
-		if (matches_filters(lptr, filters, num_filters)) {
+		if (matches_compiled_filters(lptr, compiled, num_filters)) {
 			if (*num_matches < max_tokens) {
 
 				tokens[*num_matches] = token_add(lptr);
@@ -791,6 +715,10 @@ out_free_trash:
 		opae_free(trash);
 	}
 
+out_free_compiled:
+	if (compiled)
+		opae_free(compiled);
+
 	return result;
 }
 
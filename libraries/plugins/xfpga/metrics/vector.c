@@ -107,17 +107,24 @@ fpga_result fpga_vector_resize(fpga_metric_vector *vector, uint64_t capacity)
 		return FPGA_INVALID_PARAM;
 	}
 
-	void **fpga_metric_item = realloc(vector->fpga_metric_item, sizeof(void *) * capacity);
+	// Stay within opae_calloc()/opae_free() so that the
+	// allocation hooks see the old array being released.
+	void **fpga_metric_item = opae_calloc(capacity, sizeof(void *));
 
 	if (fpga_metric_item == NULL) {
 		OPAE_ERR("Invalid parm");
 		return FPGA_NO_MEMORY;
 	}
 
-	if (fpga_metric_item) {
-		vector->fpga_metric_item = fpga_metric_item;
-		vector->capacity = capacity;
+	if (vector->fpga_metric_item) {
+		memcpy(fpga_metric_item, vector->fpga_metric_item,
+		       sizeof(void *) * (vector->total < capacity ?
+					 vector->total : capacity));
+		opae_free(vector->fpga_metric_item);
 	}
+
+	vector->fpga_metric_item = fpga_metric_item;
+	vector->capacity = capacity;
 	return result;
 }
 
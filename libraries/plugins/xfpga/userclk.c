@@ -47,8 +47,6 @@ fpga_result __XFPGA_API__ xfpga_fpgaSetUserClock(fpga_handle handle,
 	struct _fpga_token  *_token;
 	char *p                       = 0;
 
-	UNUSED_PARAM(flags);
-
 	result = handle_check_and_lock(_handle);
 	if (result)
 		return result;
@@ -79,7 +77,11 @@ fpga_result __XFPGA_API__ xfpga_fpgaSetUserClock(fpga_handle handle,
 		goto out_unlock;
 	}
 
-	result = set_userclock(_token->sysfspath, high_clk, low_clk);
+	if (flags & FPGA_USERCLK_KHZ)
+		result = set_userclock_khz(_token->sysfspath,
+					   high_clk, low_clk);
+	else
+		result = set_userclock(_token->sysfspath, high_clk, low_clk);
 	if (result != FPGA_OK) {
 		OPAE_ERR("Failed to set user clock");
 	}
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <glob.h>
 #include <opae/uio.h>
 
@@ -129,11 +130,21 @@
 #define IOPLL_MEASURE_HIGH            1
 #define IOPLL_MEASURE_DELAY_MS        4000
 #define IOPLL_RESET_DELAY_MS          1000
-#define IOPLL_CAL_DELAY_MS            1000
 
 #define IOPLL_WRITE_POLL_INVL_US      10 /* Write poll interval */
 #define IOPLL_WRITE_POLL_TIMEOUT_US   1000000 /* Write poll timeout */
 
+#define IOPLL_LOCK_POLL_INVL_US       10 /* Lock poll interval */
+#define IOPLL_LOCK_POLL_TIMEOUT_US    100000 /* Lock poll timeout */
+
+/*
+ * IOPLL divider solver limits. The reference clock is the one assumed by
+ * the frequency tables in fpga_user_clk_freq.h. The VCO, PFD and counter
+ * ranges cover the configurations used by those tables.
+ */
+#define IOPLL_REF_FREQ_KHZ            100000
+#define IOPLL_MAX_COUNT               510 /* high + low, 8 bits each */
+
 #define USRCLK_FEATURE_ID             0x14
 
  // DFHv0
@@ -153,8 +164,66 @@ struct dfh {
 	};
 };
 
+struct iopll_limits {
+	uint32_t ref_khz;
+	uint32_t vco_min_khz;
+	uint32_t vco_max_khz;
+	uint32_t pfd_min_khz;
+	uint32_t pfd_max_khz;
+	uint32_t out_min_khz;
+	uint32_t out_max_khz;
+	uint32_t out2x_max_khz; // 2x output is muted (== 1x) above this
+};
+
+static const struct iopll_limits iopll_s10_limits = {
+	.ref_khz       = IOPLL_REF_FREQ_KHZ,
+	.vco_min_khz   = 800000,
+	.vco_max_khz   = 1600000,
+	.pfd_min_khz   = 10000,
+	.pfd_max_khz   = 100000,
+	.out_min_khz   = IOPLL_MIN_FREQ * 1000,
+	.out_max_khz   = IOPLL_MAX_FREQ * 1000,
+	.out2x_max_khz = IOPLL_MAX_FREQ * 1000
+};
+
+static const struct iopll_limits iopll_agilex_limits = {
+	.ref_khz       = IOPLL_REF_FREQ_KHZ,
+	.vco_min_khz   = 720000,
+	.vco_max_khz   = 1600000,
+	.pfd_min_khz   = 10000,
+	.pfd_max_khz   = 100000,
+	.out_min_khz   = IOPLL_AGILEX_MIN_FREQ * 1000,
+	.out_max_khz   = IOPLL_AGILEX_MAX_FREQ * 1000,
+	.out2x_max_khz = IOPLL_AGILEX_MAX_FREQ * 1000
+};
+
 static int using_iopll(char *sysfs_usrpath, const char *sysfs_path);
 
+fpga_result usrclk_wait_locked(uint8_t *uio_ptr)
+{
+	uint64_t v       = 0;
+	uint32_t timeout = IOPLL_LOCK_POLL_TIMEOUT_US /
+			   IOPLL_LOCK_POLL_INVL_US;
+
+	if (uio_ptr == NULL) {
+		OPAE_ERR("Invalid input parameters");
+		return FPGA_INVALID_PARAM;
+	}
+
+	v = *((volatile uint64_t *)(uio_ptr + IOPLL_FREQ_STS0));
+
+	while (!(v & IOPLL_LOCKED)) {
+		if (--timeout == 0) {
+			OPAE_ERR("Timeout waiting for IOPLL lock");
+			return FPGA_BUSY;
+		}
+		usleep(IOPLL_LOCK_POLL_INVL_US);
+		v = *((volatile uint64_t *)(uio_ptr + IOPLL_FREQ_STS0));
+	}
+
+	return FPGA_OK;
+}
+
 fpga_result usrclk_reset(uint8_t *uio_ptr)
 {
 	uint64_t v      = 0;
@@ -181,13 +250,9 @@ fpga_result usrclk_reset(uint8_t *uio_ptr)
 	v = IOPLL_AVMM_RESET_N;
 	*((volatile uint64_t *)(uio_ptr + IOPLL_FREQ_CMD0)) = v;
 
-	usleep(IOPLL_RESET_DELAY_MS);
-
-	v = *((volatile uint64_t *)(uio_ptr + IOPLL_FREQ_STS0));
-	if (!(v & IOPLL_LOCKED)) {
-		OPAE_ERR("IOPLL NOT locked after reset");;
-		res = FPGA_BUSY;
-	}
+	res = usrclk_wait_locked(uio_ptr);
+	if (res)
+		OPAE_ERR("IOPLL NOT locked after reset");
 
 	return res;
 }
@@ -495,10 +560,161 @@ fpga_result usrclk_calibrate(uint8_t *uio_ptr, uint8_t *seq)
 	/* Enable calibration interface */
 	res = usrclk_write(uio_ptr, PLL_ENABLE_CAL_ADDR, PLL_ENABLE_CALIBRATION,
 		(*seq)++);
-	usleep(IOPLL_CAL_DELAY_MS);
+	if (res)
+		return res;
+
+	res = usrclk_wait_locked(uio_ptr);
+	if (res)
+		OPAE_ERR("IOPLL NOT locked after calibration");
+
 	return res;
 }
 
+// Encode a divider count as IOPLL high/low/bypass/odd fields.
+static uint32_t usrclk_counter(uint32_t count)
+{
+	if (count <= 1)
+		return CFG_PLL_BYPASS_EN;
+
+	return FIELD_PREP(CFG_PLL_HIGH, (count + 1) / 2) |
+	       FIELD_PREP(CFG_PLL_LOW, count / 2) |
+	       ((count & 1) ? CFG_PLL_EVEN_DUTY_EN : 0);
+}
+
+// Loop filter and charge pump settings, which depend only on M.
+static void usrclk_loop_settings(uint32_t m, struct pll_config *c)
+{
+	c->pll_lf = 0x180;
+	c->pll_cp = 0x4;
+	c->pll_rc = 0x2;
+
+	if (m <= 15) {
+		c->pll_lf = 0xc0;
+		c->pll_rc = 0x0;
+	} else if (m <= 24) {
+		c->pll_lf = 0xc0;
+	} else if (m <= 43) {
+		c->pll_lf = 0x100;
+		c->pll_rc = 0x0;
+	} else if (m <= 64) {
+		c->pll_lf = 0x140;
+	} else if (m > 124) {
+		c->pll_cp = 0x6;
+	}
+}
+
+/*
+ * Find M, N and C1 such that ref * M / (N * C1) is as close as possible
+ * to freq_khz, subject to the PFD and VCO ranges in lim. C0 drives the 2x
+ * clock, so C1 must be even unless the 2x output is muted. Among equally
+ * accurate solutions, prefer the highest PFD and then the highest VCO.
+ */
+static fpga_result usrclk_solve(const struct iopll_limits *lim,
+				uint32_t freq_khz, struct pll_config *c)
+{
+	uint64_t best_err = UINT64_MAX;
+	uint64_t best_div = 1;
+	uint32_t best_m   = 0;
+	uint32_t best_n   = 0;
+	uint32_t best_c   = 0;
+	int out2x;
+	uint32_t n, c1;
+
+	if (!lim || !c ||
+	    freq_khz < lim->out_min_khz || freq_khz > lim->out_max_khz)
+		return FPGA_INVALID_PARAM;
+
+	out2x = (uint64_t)freq_khz * 2 <= lim->out2x_max_khz;
+
+	for (n = 1 ; n <= IOPLL_MAX_COUNT ; ++n) {
+		uint32_t pfd = lim->ref_khz / n;
+
+		if (pfd < lim->pfd_min_khz)
+			break;
+		if (pfd > lim->pfd_max_khz)
+			continue;
+
+		for (c1 = IOPLL_MAX_COUNT ; c1 >= 1 ; --c1) {
+			uint64_t div = (uint64_t)n * c1;
+			uint64_t want = (uint64_t)freq_khz * div;
+			uint64_t m, m_lo, vco, err;
+			int i;
+
+			if (out2x && (c1 & 1))
+				continue;
+
+			m_lo = want / lim->ref_khz;
+			for (i = 0 ; i < 2 ; ++i) {
+				m = m_lo + i;
+				if (m < 1 || m > IOPLL_MAX_COUNT)
+					continue;
+
+				vco = lim->ref_khz * m / n;
+				if (vco < lim->vco_min_khz ||
+				    vco > lim->vco_max_khz)
+					continue;
+
+				// |ref * M / div - freq|, scaled by div
+				err = lim->ref_khz * m;
+				err = err > want ? err - want : want - err;
+
+				// err / div < best_err / best_div
+				if (err * best_div < best_err * div ||
+				    best_m == 0) {
+					best_err = err;
+					best_div = div;
+					best_m = m;
+					best_n = n;
+					best_c = c1;
+				}
+			}
+		}
+
+		if (best_m && best_err == 0)
+			break;
+	}
+
+	if (!best_m)
+		return FPGA_NOT_FOUND;
+
+	c->pll_freq_khz = (uint64_t)lim->ref_khz * best_m / best_div;
+	c->pll_m = usrclk_counter(best_m);
+	c->pll_n = usrclk_counter(best_n);
+	c->pll_c1 = usrclk_counter(best_c);
+	c->pll_c0 = usrclk_counter(out2x ? best_c / 2 : best_c);
+	usrclk_loop_settings(best_m, c);
+
+	return FPGA_OK;
+}
+
+/*
+ * Use the qualified table entry when freq_khz is a whole MHz that the
+ * table produces exactly. Otherwise solve for the dividers.
+ */
+static fpga_result usrclk_config(const struct iopll_limits *lim,
+				 const struct iopll_config *table,
+				 uint32_t freq_khz, struct pll_config *c)
+{
+	fpga_result res;
+
+	if (freq_khz < lim->out_min_khz || freq_khz > lim->out_max_khz)
+		return FPGA_INVALID_PARAM;
+
+	if (!(freq_khz % 1000) &&
+	    table[freq_khz / 1000].pll_freq_khz == freq_khz) {
+		memcpy(c, &table[freq_khz / 1000], sizeof(*c));
+		return FPGA_OK;
+	}
+
+	res = usrclk_solve(lim, freq_khz, c);
+	if (res)
+		return res;
+
+	OPAE_MSG("IOPLL: %u kHz requested, %u kHz configured",
+		 freq_khz, c->pll_freq_khz);
+	return FPGA_OK;
+}
+
 fpga_result get_usrclk_uio(const char *sysfs_path,
 	uint32_t feature_id,
 	struct opae_uio *uio,
@@ -647,15 +863,27 @@ fpga_result set_userclock(const char *sysfs_path,
 	uint64_t userclk_high,
 	uint64_t userclk_low)
 {
-	char sysfs_usrpath[SYSFS_PATH_MAX] = { 0 };
-	int fd, ret                        = 0;
-	char *bufp                         = NULL;
-	ssize_t cnt                        = 0;
-	uint64_t revision                  = 0;
-	uint8_t seq                        = 1;
-	uint8_t *uio_ptr                   = NULL;
-	fpga_result result                 = FPGA_OK;
-	ssize_t bytes_written              = 0;
+	return set_userclock_khz(sysfs_path,
+		userclk_high * 1000,
+		userclk_low * 1000);
+}
+
+// set fpga user clock, frequencies in kHz
+fpga_result set_userclock_khz(const char *sysfs_path,
+	uint64_t userclk_high,
+	uint64_t userclk_low)
+{
+	char sysfs_usrpath[SYSFS_PATH_MAX]     = { 0 };
+	int fd, ret                            = 0;
+	ssize_t cnt                            = 0;
+	uint64_t revision                      = 0;
+	uint8_t seq                            = 1;
+	uint8_t *uio_ptr                       = NULL;
+	fpga_result result                     = FPGA_OK;
+	ssize_t bytes_written                  = 0;
+	const struct iopll_limits *limits      = &iopll_s10_limits;
+	const struct iopll_config *table       = iopll_freq_config;
+	struct pll_config iopll_config;
 	struct opae_uio uio;
 
 	memset(&uio, 0, sizeof(uio));
@@ -665,7 +893,7 @@ fpga_result set_userclock(const char *sysfs_path,
 		return FPGA_INVALID_PARAM;
 	}
 
-	if (userclk_high < MIN_FPGA_FREQ) {
+	if (userclk_high < MIN_FPGA_FREQ * 1000) {
 		OPAE_ERR("Invalid Input frequency");
 		return FPGA_INVALID_PARAM;
 	}
@@ -674,23 +902,23 @@ fpga_result set_userclock(const char *sysfs_path,
 	// S10 & A10 user clock DFH revision 0
 	result = get_userclk_revision(sysfs_path, &revision);
 	if (result == FPGA_OK && revision == AGILEX_USRCLK_REV) {
-		// Enforce 1x clock within valid range
-		if ((userclk_low > IOPLL_AGILEX_MAX_FREQ) ||
-			(userclk_low < IOPLL_AGILEX_MIN_FREQ)) {
-			OPAE_ERR("Invalid Input frequency");
-			return FPGA_INVALID_PARAM;
-		}
+		limits = &iopll_agilex_limits;
+		table = iopll_agilex_freq_config;
+	}
 
-		bufp = (char *)&iopll_agilex_freq_config[userclk_low];
-	} else {
-		// S10 & A10 user clock
-		// Enforce 1x clock within valid range
-		if ((userclk_low > IOPLL_MAX_FREQ) ||
-			(userclk_low < IOPLL_MIN_FREQ)) {
-			OPAE_ERR("Invalid Input frequency");
-			return FPGA_INVALID_PARAM;
-		}
-		bufp = (char *)&iopll_freq_config[userclk_low];
+	// Enforce 1x clock within valid range
+	if ((userclk_low > limits->out_max_khz) ||
+		(userclk_low < limits->out_min_khz)) {
+		OPAE_ERR("Invalid Input frequency");
+		return FPGA_INVALID_PARAM;
+	}
+
+	result = usrclk_config(limits, table, (uint32_t)userclk_low,
+		&iopll_config);
+	if (result != FPGA_OK) {
+		OPAE_ERR("No IOPLL configuration for %" PRIu64 " kHz",
+			userclk_low);
+		return FPGA_INVALID_PARAM;
 	}
 
 	ret = using_iopll(sysfs_usrpath, sysfs_path);
@@ -704,7 +932,7 @@ fpga_result set_userclock(const char *sysfs_path,
 		}
 		cnt = sizeof(struct iopll_config);
 
-		bytes_written = eintr_write(fd, bufp, cnt);
+		bytes_written = eintr_write(fd, &iopll_config, cnt);
 		if (bytes_written != cnt) {
 			OPAE_ERR("Failed to write: %s", strerror(errno));
 			opae_close(fd);
@@ -717,11 +945,6 @@ fpga_result set_userclock(const char *sysfs_path,
 		return FPGA_NO_ACCESS;
 	}
 
-	struct pll_config *iopll_config = (struct pll_config *)bufp;
-	if ((iopll_config->pll_freq_khz > IOPLL_MAX_FREQ * 1000) ||
-		(iopll_config->pll_freq_khz < IOPLL_MIN_FREQ * 1000))
-		return FPGA_EXCEPTION;
-
 	result = get_usrclk_uio(sysfs_path,
 		USRCLK_FEATURE_ID,
 		&uio,
@@ -731,7 +954,7 @@ fpga_result set_userclock(const char *sysfs_path,
 		return result;
 	}
 
-	result = usrclk_set_freq(uio_ptr, iopll_config, &seq);
+	result = usrclk_set_freq(uio_ptr, &iopll_config, &seq);
 	if (result != FPGA_OK) {
 		OPAE_ERR("Failed to set user clock");
 		goto uio_close;
@@ -92,6 +92,21 @@ fpga_result get_userclock(const char *sysfs_path, uint64_t *userclk_high,
 fpga_result set_userclock(const char *sysfs_path, uint64_t userclk_high,
 			  uint64_t userclk_low);
 
+/**
+ * @brief set fpga user clock, frequencies in kHz
+ *
+ * The low clock need not be a whole number of MHz. The IOPLL dividers
+ * are solved for the closest frequency the device can produce.
+ *
+ * @param sysfs_path  port sysfs path
+ * @parm  high user clock in kHz
+ * @parm  low user clock in kHz
+ *
+ * @return error code
+ */
+fpga_result set_userclock_khz(const char *sysfs_path, uint64_t userclk_high,
+			      uint64_t userclk_low);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,381 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "pyopaeflash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <mtd/mtd-user.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+// granularity at which erased (all 0xff) image pages are skipped
+#define FLASH_PAGE_SIZE 4096
+// largest single pwrite()/pread() issued to the mtd device
+#define FLASH_IO_SIZE (1024 * 1024)
+
+struct free_deleter {
+  void operator()(void *p) const { free(p); }
+};
+
+// swap adjacent bits, bit pairs and nibbles of every byte in x
+static inline uint64_t reverse_bits64(uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+  return x;
+}
+
+void flash_reverse_bits(uint8_t *buf, size_t len) {
+  size_t i = 0;
+  uint64_t w;
+
+  for (; i + sizeof(w) <= len; i += sizeof(w)) {
+    memcpy(&w, buf + i, sizeof(w));
+    w = reverse_bits64(w);
+    memcpy(buf + i, &w, sizeof(w));
+  }
+
+  for (; i < len; ++i) buf[i] = (uint8_t)reverse_bits64(buf[i]);
+}
+
+bool flash_is_erased(const uint8_t *buf, size_t len) {
+  const size_t block = 8 * sizeof(uint64_t);
+  size_t i = 0;
+  uint64_t w[8];
+
+  for (; i + block <= len; i += block) {
+    uint64_t acc = ~0ULL;
+    memcpy(w, buf + i, block);
+    for (size_t j = 0; j < 8; ++j) acc &= w[j];
+    if (acc != ~0ULL) return false;
+  }
+
+  for (; i < len; ++i)
+    if (buf[i] != 0xff) return false;
+
+  return true;
+}
+
+static int pread_all(int fd, uint8_t *buf, size_t len, off_t offset) {
+  while (len) {
+    ssize_t n = pread(fd, buf, len, offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    if (!n) {
+      errno = EIO;
+      return -1;
+    }
+    buf += n;
+    len -= n;
+    offset += n;
+  }
+  return 0;
+}
+
+static int pwrite_all(int fd, const uint8_t *buf, size_t len, off_t offset) {
+  while (len) {
+    ssize_t n = pwrite(fd, buf, len, offset);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    buf += n;
+    len -= n;
+    offset += n;
+  }
+  return 0;
+}
+
+flash_image::flash_image(const std::string &path, uint64_t offset,
+                         bool reverse)
+    : buf_(nullptr), size_(0) {
+  struct stat st;
+  void *p = nullptr;
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error(path + ": " + strerror(errno));
+
+  if (fstat(fd, &st) || (uint64_t)st.st_size < offset) {
+    close(fd);
+    throw std::invalid_argument(path + ": invalid image offset");
+  }
+
+  size_ = st.st_size - offset;
+  if (posix_memalign(&p, FLASH_PAGE_SIZE, std::max(size_, (size_t)1))) {
+    close(fd);
+    throw std::bad_alloc();
+  }
+  buf_ = static_cast<uint8_t *>(p);
+
+  if (pread_all(fd, buf_, size_, offset)) {
+    std::string err = path + ": " + strerror(errno);
+    close(fd);
+    free(buf_);
+    throw std::runtime_error(err);
+  }
+  close(fd);
+
+  if (reverse) flash_reverse_bits(buf_, size_);
+}
+
+flash_image::~flash_image() { free(buf_); }
+
+flash_job::flash_job(std::shared_ptr<flash_image> image,
+                     const std::string &mtd_dev, uint64_t target_offset,
+                     uint64_t erase_len, bool verify)
+    : mtd_dev(mtd_dev),
+      image_(image),
+      target_offset_(target_offset),
+      erase_len_(erase_len),
+      verify_(verify),
+      phase_(FLASH_IDLE),
+      done_(0),
+      total_(0),
+      bytes_written_(0) {
+  if (!image_) throw std::invalid_argument("null flash image");
+  // MEMERASE takes 32-bit sector addresses
+  if (erase_len_ > UINT32_MAX || target_offset_ > UINT32_MAX - erase_len_)
+    throw std::invalid_argument(mtd_dev + ": erase range exceeds 4 GiB");
+}
+
+flash_job::~flash_job() {
+  if (thread_.joinable()) thread_.join();
+}
+
+void flash_job::start() {
+  if (thread_.joinable() || phase_ != FLASH_IDLE)
+    throw std::logic_error(mtd_dev + ": flash job already started");
+  set_phase(FLASH_ERASE, erase_len_);
+  thread_ = std::thread(&flash_job::run, this);
+}
+
+int flash_job::wait() {
+  if (thread_.joinable()) thread_.join();
+  return phase_ == FLASH_DONE ? 0 : -1;
+}
+
+std::string flash_job::phase() const {
+  static const char *const names[] = {"idle",   "erase", "write",
+                                      "verify", "done",  "failed"};
+  return names[phase_];
+}
+
+std::string flash_job::error() const {
+  std::lock_guard<std::mutex> g(lock_);
+  return error_;
+}
+
+void flash_job::set_phase(flash_phase p, uint64_t total) {
+  done_ = 0;
+  total_ = total;
+  phase_ = p;
+}
+
+int flash_job::fail(const std::string &what, int err) {
+  std::lock_guard<std::mutex> g(lock_);
+  error_ = mtd_dev + ": " + what;
+  if (err) error_ += std::string(": ") + strerror(err);
+  phase_ = FLASH_FAILED;
+  return -1;
+}
+
+void flash_job::run() {
+  int fd = open(mtd_dev.c_str(), O_RDWR);
+  if (fd < 0) {
+    fail("open", errno);
+    return;
+  }
+
+  if (erase(fd) || write(fd) || (verify_ && verify(fd))) {
+    close(fd);
+    return;
+  }
+
+  close(fd);
+  set_phase(FLASH_DONE, total_);
+  done_ = total_.load();
+}
+
+int flash_job::erase(int fd) {
+  struct mtd_info_user info;
+  uint64_t chunk;
+
+  set_phase(FLASH_ERASE, erase_len_);
+  if (!erase_len_) return 0;
+
+  if (ioctl(fd, MEMGETINFO, &info)) return fail("MEMGETINFO", errno);
+
+  // erase in whole sectors, ~FLASH_IO_SIZE at a time, so that progress
+  // is visible during what is the slowest phase of the update
+  chunk = info.erasesize ? info.erasesize : FLASH_IO_SIZE;
+  if (chunk < FLASH_IO_SIZE) chunk = (FLASH_IO_SIZE / chunk) * chunk;
+
+  for (uint64_t off = 0; off < erase_len_;) {
+    struct erase_info_user ei;
+    uint64_t n = std::min(chunk, erase_len_ - off);
+
+    ei.start = (uint32_t)(target_offset_ + off);
+    ei.length = (uint32_t)n;
+    if (ioctl(fd, MEMERASE, &ei)) return fail("MEMERASE", errno);
+
+    off += n;
+    done_ = off;
+  }
+
+  return 0;
+}
+
+int flash_job::write(int fd) {
+  const uint8_t *data = image_->data();
+  size_t size = image_->size();
+  size_t off = 0;
+  size_t end = 0;
+
+  set_phase(FLASH_WRITE, size);
+
+  while (off < size) {
+    size_t run = std::min((size_t)FLASH_PAGE_SIZE, size - off);
+
+    // The flash was just erased: pages that are all 0xff are
+    // already programmed.
+    if (flash_is_erased(data + off, run)) {
+      off += run;
+      done_ = off;
+      continue;
+    }
+
+    // coalesce neighbouring non-erased pages into a single write
+    while (run < FLASH_IO_SIZE && off + run < size) {
+      size_t n = std::min((size_t)FLASH_PAGE_SIZE, size - off - run);
+      if (flash_is_erased(data + off + run, n)) break;
+      run += n;
+    }
+
+    if (pwrite_all(fd, data + off, run, target_offset_ + off))
+      return fail("write", errno);
+
+    off += run;
+    end = off;
+    done_ = off;
+  }
+
+  // mtdchar writes go straight to the part and it has no fsync
+  // method (EINVAL); one flush covers any other backing file.
+  if (fsync(fd) && errno != EINVAL) return fail("fsync", errno);
+
+  bytes_written_ = end;
+  return 0;
+}
+
+int flash_job::verify(int fd) {
+  const uint8_t *data = image_->data();
+  uint64_t len = bytes_written_;
+  void *p = nullptr;
+
+  set_phase(FLASH_VERIFY, len);
+
+  if (posix_memalign(&p, FLASH_PAGE_SIZE, FLASH_IO_SIZE))
+    return fail("out of memory", ENOMEM);
+  std::unique_ptr<uint8_t, free_deleter> buf(static_cast<uint8_t *>(p));
+
+  for (uint64_t off = 0; off < len;) {
+    size_t n = std::min((uint64_t)FLASH_IO_SIZE, len - off);
+
+    if (pread_all(fd, buf.get(), n, target_offset_ + off))
+      return fail("read", errno);
+
+    if (memcmp(buf.get(), data + off, n)) {
+      char msg[64];
+      snprintf(msg, sizeof(msg), "verify failed near 0x%lx",
+               (unsigned long)(target_offset_ + off));
+      return fail(msg, 0);
+    }
+
+    off += n;
+    done_ = off;
+  }
+
+  return 0;
+}
+
+namespace py = pybind11;
+
+PYBIND11_MODULE(pyopaeflash, m) {
+  m.doc() = "pybind11 pyopaeflash plugin";
+
+  m.def(
+      "reverse_bits",
+      [](py::buffer b) {
+        py::buffer_info info = b.request();
+        std::string s(static_cast<const char *>(info.ptr),
+                      info.size * info.itemsize);
+        flash_reverse_bits(reinterpret_cast<uint8_t *>(&s[0]), s.size());
+        return py::bytes(s);
+      },
+      "Return a copy of the buffer with the bits of each byte reversed");
+  m.def(
+      "is_erased",
+      [](py::buffer b) {
+        py::buffer_info info = b.request();
+        return flash_is_erased(static_cast<const uint8_t *>(info.ptr),
+                               info.size * info.itemsize);
+      },
+      "True when every byte of the buffer is 0xff");
+
+  py::class_<flash_image, std::shared_ptr<flash_image>>(m, "flash_image")
+      .def(py::init<const std::string &, uint64_t, bool>(), py::arg("path"),
+           py::arg("offset") = 0, py::arg("reverse") = true)
+      .def("__len__", &flash_image::size);
+
+  py::class_<flash_job>(m, "flash_job")
+      .def(py::init<std::shared_ptr<flash_image>, const std::string &,
+                    uint64_t, uint64_t, bool>(),
+           py::arg("image"), py::arg("mtd_dev"), py::arg("target_offset"),
+           py::arg("erase_len"), py::arg("verify") = true)
+      .def("start", &flash_job::start)
+      .def("wait", &flash_job::wait, py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("phase", &flash_job::phase)
+      .def_property_readonly("finished", &flash_job::finished)
+      .def_property_readonly("done", &flash_job::done)
+      .def_property_readonly("total", &flash_job::total)
+      .def_property_readonly("bytes_written", &flash_job::bytes_written)
+      .def_property_readonly("error", &flash_job::error)
+      .def_readonly("mtd_dev", &flash_job::mtd_dev);
+}
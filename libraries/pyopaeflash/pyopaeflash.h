@@ -0,0 +1,108 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PYOPAE_FLASH_H
+#define PYOPAE_FLASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// reverse the bit order within each byte of buf, in place
+void flash_reverse_bits(uint8_t *buf, size_t len);
+
+// true when every byte of buf is 0xff (erased NOR flash)
+bool flash_is_erased(const uint8_t *buf, size_t len);
+
+// flash image, loaded once into a page-aligned buffer
+class flash_image {
+ public:
+  flash_image(const std::string &path, uint64_t offset, bool reverse);
+  virtual ~flash_image();
+
+  const uint8_t *data() const { return buf_; }
+  size_t size() const { return size_; }
+
+ private:
+  uint8_t *buf_;
+  size_t size_;
+};
+
+enum flash_phase {
+  FLASH_IDLE = 0,
+  FLASH_ERASE,
+  FLASH_WRITE,
+  FLASH_VERIFY,
+  FLASH_DONE,
+  FLASH_FAILED
+};
+
+// erase/write/verify of one image to one mtd device on a worker thread
+class flash_job {
+ public:
+  flash_job(std::shared_ptr<flash_image> image, const std::string &mtd_dev,
+            uint64_t target_offset, uint64_t erase_len, bool verify);
+  virtual ~flash_job();
+
+  void start();
+  int wait();
+
+  std::string phase() const;
+  bool finished() const { return phase_ >= FLASH_DONE; }
+  uint64_t done() const { return done_; }
+  uint64_t total() const { return total_; }
+  uint64_t bytes_written() const { return bytes_written_; }
+  std::string error() const;
+
+  const std::string mtd_dev;
+
+ private:
+  void run();
+  int erase(int fd);
+  int write(int fd);
+  int verify(int fd);
+  void set_phase(flash_phase p, uint64_t total);
+  int fail(const std::string &what, int err);
+
+  std::shared_ptr<flash_image> image_;
+  uint64_t target_offset_;
+  uint64_t erase_len_;
+  bool verify_;
+  std::thread thread_;
+  std::atomic<int> phase_;
+  std::atomic<uint64_t> done_;
+  std::atomic<uint64_t> total_;
+  std::atomic<uint64_t> bytes_written_;
+  mutable std::mutex lock_;
+  std::string error_;
+};
+
+#endif  // PYOPAE_FLASH_H
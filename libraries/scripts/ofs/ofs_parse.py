@@ -81,6 +81,7 @@ typedef union _{name} {{
 driver_struct_templ = '''
 typedef struct _{driver} {{
   fpga_handle handle;
+  int event_fd;
 {members}
 }} {driver};
 
@@ -92,12 +93,25 @@ int {driver}_init({driver} *{var}, fpga_handle h)
     return res;
   }}
   {var}->handle = h;
+  {var}->event_fd = -1;
 {inits}
   return 0;
 }}
 
 '''
 
+snapshot_struct_templ = '''
+typedef struct _{driver}_{name}_snapshot {{
+{members}
+}} {driver}_{name}_snapshot;
+
+void {driver}_snapshot_{name}({driver} *drv, {driver}_{name}_snapshot *s)
+{{
+{reads}
+}}
+
+'''
+
 templates = {'c': c_struct_templ,
              'cpp': cpp_class_tmpl}
 
@@ -215,6 +229,9 @@ class ofs_driver_writer(object):
     def resolve_function(self, fn_name):
         if fn_name in self.fn_names:
             return f'{self.name}_{fn_name}'
+        if fn_name.startswith('snapshot_') and \
+           fn_name[len('snapshot_'):] in self.snapshots:
+            return f'{self.name}_{fn_name}'
         return fn_name
 
     def resolve_name(self, name):
@@ -222,6 +239,10 @@ class ofs_driver_writer(object):
             return f'drv->r_{name}'
         return name
 
+    @property
+    def snapshots(self):
+        return self.data.get('snapshots', {})
+
     @property
     def fn_names(self):
         return [fn.name for fn in self.functions]
@@ -270,6 +291,7 @@ class ofs_driver_writer(object):
     def write_header(self, output, language='c'):
         self.name = self.data['name']
         self.registers = self.data['registers']
+        self.event = self.data.get('event', False)
         self.functions = umd.get_functions(self.data.get('api', ''), self)
         if not self.functions:
             return
@@ -343,6 +365,7 @@ class ofs_driver_writer(object):
                                        var=var,
                                        members=members.getvalue().rstrip(),
                                        inits=inits.getvalue().rstrip()))
+        self.write_snapshots(fp)
 
         fp.write('\n\n// *****  function prototypes ******//\n')
         for fn in self.functions:
@@ -357,6 +380,27 @@ class ofs_driver_writer(object):
                 fp.writeline('}\n')
 
 
+    def write_snapshots(self, fp):
+        registers = {r.name: r for r in self.registers}
+        for name, group in self.snapshots.items():
+            missing = [g for g in group if g not in registers]
+            if missing:
+                raise SystemExit(f'snapshot {name}: unknown registers '
+                                 f'{", ".join(missing)}')
+            members = io.StringIO()
+            reads = io.StringIO()
+            for g in group:
+                members.write(f'  {g} r_{g};\n')
+            # read in address order so the group is fetched in one pass
+            for g in sorted(group, key=lambda g: registers[g].offset):
+                reads.write(f'  s->r_{g}.value = drv->r_{g}->value;\n')
+            fp.write(snapshot_struct_templ.format(
+                driver=self.name,
+                name=name,
+                members=members.getvalue().rstrip(),
+                reads=reads.getvalue().rstrip()))
+
+
 class ofs_header_writer(object):
     def __init__(self, fp):
         self.fp = fp
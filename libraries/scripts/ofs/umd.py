@@ -125,6 +125,8 @@ class decl_visitor(c_visitor):
 class scope_visitor(c_visitor):
     def __init__(self, driver):
         self.driver = driver
+        # local register shadows opened by a 'with' transaction
+        self.shadows = {}
 
     @c_visitor.c_alias
     def ref(self, name, cast=None):
@@ -132,6 +134,20 @@ class scope_visitor(c_visitor):
             return f'({self.get_type(cast)})&({name})'
         return f'&{name}'
 
+    def wait_for(self, op, args):
+        args = ', '.join(args)
+        if getattr(self.driver, 'event', False):
+            return c_code(f'OFS_WAIT_FOR_{op}_FD({args}, drv->event_fd)')
+        return c_code(f'OFS_WAIT_FOR_{op}({args})')
+
+    @c_visitor.c_alias
+    def OFS_WAIT_FOR_EQ(self, *args):
+        return self.wait_for('EQ', args)
+
+    @c_visitor.c_alias
+    def OFS_WAIT_FOR_NE(self, *args):
+        return self.wait_for('NE', args)
+
     def visit_arguments(self, args):
         return [decl_visitor(a.arg).visit(a.annotation) for a in args.args]
 
@@ -153,6 +169,42 @@ class scope_visitor(c_visitor):
             new_node.append(self.visit(s))
         return new_node
 
+    def visit_With(self, node):
+        # with REG as r:        load REG once into r, store it back once
+        # with REG(value) as r: start r from value, store it once (no load)
+        # The store is skipped when the body never assigns to r.
+        # A body that stores may not return, break or continue out of
+        # the block, since the store is written at the end of it.
+        new_node = c_with(node, self.driver, self)
+        outer = dict(self.shadows)
+        for item in node.items:
+            ctx = item.context_expr
+            init = None
+            if isinstance(ctx, ast.Call):
+                reg = ctx.func.id
+                init = self.visit(ctx.args[0]) if ctx.args else '0'
+            else:
+                reg = ctx.id
+            if reg not in self.driver.reg_names:
+                raise SystemExit(f'with: {reg} is not a register')
+            if not isinstance(item.optional_vars, ast.Name):
+                raise SystemExit(f'with: {reg} needs a local name (as ...)')
+            var = item.optional_vars.id
+            if init is None:
+                init = f'drv->r_{reg}->value'
+            new_node.append(c_code(f'{reg} {var}'))
+            new_node.append(c_code(f'{var}.value = {init}'))
+            if stores_to(node.body, var):
+                new_node.commit(c_code(f'drv->r_{reg}->value = {var}.value'))
+            self.shadows[var] = reg
+        if new_node.stores and exits_from(node.body):
+            raise SystemExit('with: return, break or continue would skip '
+                             'the store at the end of the block')
+        for s in node.body:
+            new_node.append(self.visit(s))
+        self.shadows = outer
+        return new_node
+
     def visit_Expr(self, node):
         return self.visit(node.value)
 
@@ -207,6 +259,9 @@ class scope_visitor(c_visitor):
         return f'{lhs} {op} {rhs}'
 
     def visit_Attribute(self, node):
+        if node.value.id in self.shadows:
+            f_prefix = '' if node.attr == 'value' else 'f_'
+            return f'{node.value.id}.{f_prefix}{node.attr}'
         if node.value.id in self.driver.reg_names:
             # bitfields prefixed with f_ but value member isn't
             f_prefix = '' if node.attr == 'value' else 'f_'
@@ -261,7 +316,11 @@ class c_block(c_node):
         spaces = '\t'*indent
         for s in self.body:
             if isinstance(s, c_block):
-                writer.writeline(f'{spaces}{s.write_header()} {{')
+                header = s.write_header()
+                if header:
+                    writer.writeline(f'{spaces}{header} {{')
+                else:
+                    writer.writeline(f'{spaces}{{')
                 s.write_body(writer, indent+1)
                 writer.writeline(f'{spaces}}}')
             else:
@@ -286,6 +345,57 @@ class c_while(c_conditional_block):
     keyword = 'while'
 
 
+class c_with(c_block):
+    def __init__(self, node, driver, sv: scope_visitor = None):
+        super().__init__(node, driver, sv)
+        self.stores = []
+
+    def commit(self, n):
+        self.stores.append(n)
+
+    def write_header(self):
+        return None
+
+    def write_body(self, writer: file_writer, indent=1):
+        super().write_body(writer, indent)
+        spaces = '\t'*indent
+        for s in self.stores:
+            writer.writeline(f'{spaces}{s.write_code()};')
+
+
+def stores_to(body, var):
+    for n in body:
+        for sub in ast.walk(n):
+            targets = []
+            if isinstance(sub, ast.Assign):
+                targets = sub.targets
+            elif isinstance(sub, (ast.AugAssign, ast.AnnAssign)):
+                targets = [sub.target]
+            for t in targets:
+                if isinstance(t, ast.Attribute) and \
+                   isinstance(t.value, ast.Name) and t.value.id == var:
+                    return True
+    return False
+
+
+def exits_from(body, in_loop=False):
+    for n in body:
+        if isinstance(n, ast.Return):
+            return True
+        if isinstance(n, (ast.Break, ast.Continue)) and not in_loop:
+            return True
+        if isinstance(n, (ast.For, ast.While)):
+            if exits_from(n.body, True) or exits_from(n.orelse, in_loop):
+                return True
+        elif isinstance(n, ast.If):
+            if exits_from(n.body, in_loop) or exits_from(n.orelse, in_loop):
+                return True
+        elif isinstance(n, ast.With):
+            if exits_from(n.body, in_loop):
+                return True
+    return False
+
+
 class c_for(c_block):
     def write_header(self):
         target = self.sv.visit(self.node.target)
@@ -392,6 +502,7 @@ def writefile(args):
         raise SystemExit(f'syntax err: {err.text}')
 
     wr = driver_writer(name, args.output)
+    wr.event = data.get('event', False)
     functions = []
     for f in tree.body:
         functions.append(fn_visitor(wr).visit(f))
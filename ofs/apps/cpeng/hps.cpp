@@ -25,7 +25,10 @@
 // POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <unistd.h>
@@ -65,6 +68,7 @@ public:
     , destination_offset_(0x2000000)
     , timeout_usec_(default_timeout_usec.count())
     , chunk_(pg_size)
+    , buffers_(4)
     , data_request_limit_(512)
     , soft_reset_(false)
     , skip_ssbl_verify_(false)
@@ -106,6 +110,11 @@ public:
       ->check(CLI::IsMember(limits));
     app->add_option("-c,--chunk", chunk_, "Chunk size. 0 indicates no chunks")
       ->default_str(std::to_string(chunk_));
+    app->add_option("-b,--buffers", buffers_,
+                    "Number of chunk buffers to stream the image through. "
+                    "1 reads and copies each chunk in turn")
+      ->default_str(std::to_string(buffers_))
+      ->check(CLI::Range(1, 64));
     app->add_flag("--soft-reset", soft_reset_, "Issue soft reset only");
     app->add_flag("--skip-ssbl-verify", skip_ssbl_verify_, "Do not wait for ssbl verify");
     app->add_flag("--skip-kernel-verify", skip_kernel_verify_, "Do not wait for kernel verify");
@@ -144,6 +153,36 @@ public:
     // if chunk_ CLI arg is 0, use the file size
     // otherwise, use the smaller of chunk_ and file size
     size_t chunk = chunk_ ? std::min(static_cast<size_t>(chunk_), sz) : sz;
+    // set the data req. limit to CLI arg (default arg is 512, default in HW is 1k)
+    ofs_cpeng_set_data_req_limit(&cpeng, limit_map[data_request_limit_]);
+    uint32_t n_chunks = 0;
+    int res = (buffers_ > 1 && chunk < sz) ?
+      copy_streaming(afu, &cpeng, inp, sz, chunk, n_chunks) :
+      copy_serial(afu, &cpeng, inp, sz, chunk, n_chunks);
+    if (res) {
+      return res;
+    }
+    log_->info("transferred file in {} chunk(s)", n_chunks);
+    ofs_cpeng_image_complete(&cpeng);
+
+    // wait for both ssbl and kernel verify (if not skipped)
+    if (!skip_ssbl_verify_) {
+      wait_for_verify("ssbl", &cpeng, ofs_cpeng_hps_ssbl_verify);
+    }
+    if (!skip_kernel_verify_) {
+      wait_for_verify("kernel", &cpeng, ofs_cpeng_hps_kernel_verify);
+    }
+
+    return 0;
+  }
+
+
+private:
+  // Read each chunk into a single buffer, then copy it.
+  int copy_serial(opae::afu_test::afu *afu, ofs_cpeng *cpeng,
+                  std::ifstream &inp, size_t sz, size_t chunk,
+                  uint32_t &n_chunks)
+  {
     shared_buffer::ptr_t buffer(0);
     // make sure we align our buffer size to data request limit
     try {
@@ -164,25 +203,22 @@ public:
     size_t written = 0;
     log_->info("starting copy of file:{}, size: {}, chunk size: {}",
                filename_, sz, chunk);
-    uint32_t n_chunks = 0;
     // set our xfer size to chunk size
     // but align it with req. limit size in case
     // our chunk is the entire file
     auto xfer_sz = aligned(chunk, data_request_limit_);
-    // set the data req. limit to CLI arg (default arg is 512, default in HW is 1k)
-    ofs_cpeng_set_data_req_limit(&cpeng, limit_map[data_request_limit_]);
     while (written < sz) {
         auto unread = sz-written;
         inp.read(ptr, chunk);
         if (ofs_cpeng_copy_chunk(
-              &cpeng, buffer->io_address(),
+              cpeng, buffer->io_address(),
               destination_offset_ + written,
               xfer_sz,
               timeout_usec_)) {
-          auto status = ofs_cpeng_dma_status(&cpeng);
+          auto status = ofs_cpeng_dma_status(cpeng);
           log_->warn("copy chunk: {}, size: {}, unread: {}, dma_status: {:x}",
                       n_chunks, xfer_sz, unread, status);
-          if (dmastatus_err(&cpeng)) {
+          if (dmastatus_err(cpeng)) {
             return 4;
           }
         }
@@ -199,22 +235,137 @@ public:
           log_->info("last chunk {}, aligned {}", chunk, xfer_sz);
         }
     }
-    log_->info("transferred file in {} chunk(s)", n_chunks);
-    ofs_cpeng_image_complete(&cpeng);
+    return 0;
+  }
 
-    // wait for both ssbl and kernel verify (if not skipped)
-    if (!skip_ssbl_verify_) {
-      wait_for_verify("ssbl", &cpeng, ofs_cpeng_hps_ssbl_verify);
+  // Stream the image through a ring of pinned chunk buffers.
+  // A reader thread fills free buffers from the file while this
+  // thread hands filled ones to the copy engine, so file I/O
+  // overlaps with the DMA of earlier chunks. The copy engine has
+  // a single descriptor, so chunks are still transferred in order.
+  int copy_streaming(opae::afu_test::afu *afu, ofs_cpeng *cpeng,
+                     std::ifstream &inp, size_t sz, size_t chunk,
+                     uint32_t &n_chunks)
+  {
+    struct filled {
+      size_t index;
+      size_t offset;
+      size_t size;
+    };
+
+    auto buffer_sz = aligned(chunk, data_request_limit_);
+    std::vector<shared_buffer::ptr_t> buffers;
+    while (buffers.size() < buffers_) {
+      try {
+        buffers.push_back(shared_buffer::allocate(afu->handle(), buffer_sz));
+      } catch (opae_exception &ex) {
+        if (buffers.empty()) {
+          log_->error("could not allocate {} bytes of memory", buffer_sz);
+          if (buffer_sz > pg_size) {
+            auto hugepage_sz = buffer_sz <= MB(2) ? "2MB" : "1GB";
+            log_->error("might need {} hugepages reserved", hugepage_sz);
+          }
+          return 3;
+        }
+        log_->warn("could only allocate {} of {} buffers",
+                   buffers.size(), buffers_);
+        break;
+      }
     }
-    if (!skip_kernel_verify_) {
-      wait_for_verify("kernel", &cpeng, ofs_cpeng_hps_kernel_verify);
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<size_t> free_q;
+    std::deque<filled> full_q;
+    bool stop = false;
+    bool read_error = false;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      free_q.push_back(i);
     }
 
-    return 0;
-  }
+    std::thread reader([&]() {
+      size_t offset = 0;
+      while (offset < sz) {
+        size_t index;
+        {
+          std::unique_lock<std::mutex> guard(lock);
+          cv.wait(guard, [&] { return stop || !free_q.empty(); });
+          if (stop) {
+            return;
+          }
+          index = free_q.front();
+          free_q.pop_front();
+        }
+        auto ptr = reinterpret_cast<char*>(
+          const_cast<uint8_t*>(buffers[index]->c_type()));
+        auto size = std::min(chunk, sz - offset);
+        inp.read(ptr, size);
+        bool ok = static_cast<size_t>(inp.gcount()) == size;
+        // zero the tail of a short last chunk up to the transfer size
+        memset(ptr + size, 0, aligned(size, data_request_limit_) - size);
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          if (ok) {
+            full_q.push_back({index, offset, size});
+          } else {
+            read_error = true;
+          }
+        }
+        cv.notify_all();
+        if (!ok) {
+          return;
+        }
+        offset += size;
+      }
+    });
+
+    log_->info("streaming copy of file:{}, size: {}, chunk size: {}, "
+               "buffers: {}", filename_, sz, chunk, buffers.size());
+    int res = 0;
+    size_t written = 0;
+    while (written < sz) {
+      filled f;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [&] { return read_error || !full_q.empty(); });
+        if (full_q.empty()) {
+          log_->error("error reading {} at offset {}", filename_, written);
+          res = 5;
+          break;
+        }
+        f = full_q.front();
+        full_q.pop_front();
+      }
+      auto xfer_sz = aligned(f.size, data_request_limit_);
+      ofs_cpeng_start_chunk(cpeng, buffers[f.index]->io_address(),
+                            destination_offset_ + f.offset, xfer_sz);
+      if (ofs_cpeng_wait_chunk(cpeng, timeout_usec_)) {
+        auto status = ofs_cpeng_dma_status(cpeng);
+        log_->warn("copy chunk: {}, size: {}, unread: {}, dma_status: {:x}",
+                   n_chunks, xfer_sz, sz - written, status);
+        if (dmastatus_err(cpeng)) {
+          res = 4;
+          break;
+        }
+      }
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        free_q.push_back(f.index);
+      }
+      cv.notify_all();
+      ++n_chunks;
+      written += f.size;
+    }
 
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stop = true;
+    }
+    cv.notify_all();
+    reader.join();
+    return res;
+  }
 
-private:
   bool dmastatus_err(ofs_cpeng *cpeng)
   {
     if (ofs_cpeng_dma_status_error(cpeng)) {
@@ -259,6 +410,7 @@ private:
   uint64_t destination_offset_;
   uint32_t timeout_usec_;
   uint32_t chunk_;
+  uint32_t buffers_;
   uint32_t data_request_limit_;
   bool soft_reset_;
   bool skip_ssbl_verify_;
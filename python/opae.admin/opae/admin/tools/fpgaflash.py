@@ -38,6 +38,7 @@ import filecmp
 import stat
 import subprocess
 import re
+import threading
 import time
 import datetime
 from array import array
@@ -48,6 +49,11 @@ try:
 except ImportError:
     sys.exit('Missing intelhex. Install by: sudo pip install intelhex')
 
+try:
+    import pyopaeflash
+except ImportError:
+    pyopaeflash = None
+
 if sys.version_info[0] == 3:
     raw_input = input
 
@@ -57,6 +63,9 @@ VC_PVID = '0x8086:0x0b30'
 
 KNOWN_PVIDS = [RC_PVID, DC_PVID, VC_PVID]
 
+MULTI_CARD_TYPES = ['user', 'factory', 'factory_only', 'dtb', 'bmc_img',
+                    'bmc_factory']
+
 RC = 'Intel PAC with Arria 10 GX FPGA'
 
 VC_EEPROM_SIZE = 65536
@@ -111,25 +120,20 @@ def check_rpd(ifile):
     return pof_hdr[4]
 
 
-if sys.version_info[0] == 2:
-    def reverse_bits(val):
-        return int('{:08b}'.format(ord(val))[::-1], 2)
-else:
-    def reverse_bits(val):
-        return int('{:08b}'.format(val)[::-1], 2)
+BIT_REVERSE_TABLE = bytes(bytearray(
+    [int('{:08b}'.format(b)[::-1], 2) for b in range(256)]))
+
+NATIVE_IMAGES = dict()
+NATIVE_IMAGES_LOCK = threading.Lock()
 
 
 def reverse_bits_in_file(ifile, ofile):
     while True:
-        ichunk = ifile.read(4096)
+        ichunk = ifile.read(1024 * 1024)
         if not ichunk:
             break
 
-        bit_reversed = array('B')
-        for b in ichunk:
-            bb = reverse_bits(b)
-            bit_reversed.append(bb)
-        ofile.write(bit_reversed)
+        ofile.write(ichunk.translate(BIT_REVERSE_TABLE))
 
 
 def get_flash_size(dev):
@@ -176,7 +180,7 @@ def flash_write(dev, start, nbytes, ifile):
             if not ichunk:
                 raise Exception("read of flash failed")
 
-            if all([c == '\xFF' for c in ichunk]):
+            if ichunk == b'\xff' * len(ichunk):
                 os.lseek(file_.fileno(), rbytes, os.SEEK_CUR)
             else:
                 os.write(file_.fileno(), ichunk)
@@ -233,6 +237,7 @@ def parse_args():
     epi += 'example usages:\n\n'
     epi += '    fpgaflash user new_image.rpd 0000:04:00.0\n\n'
     epi += '    fpgaflash rsu dcp_2_0.bin 0000:08:00.0\n\n'
+    epi += '    fpgaflash user new_image.bin 0000:04:00.0 0000:08:00.0\n\n'
 
     fc_ = argparse.RawDescriptionHelpFormatter
     parser = argparse.ArgumentParser(description=descr, epilog=epi,
@@ -246,9 +251,12 @@ def parse_args():
                         help='file to program into flash')
 
     bdf_help = "bdf of device to program (e.g. 04:00.0 or 0000:04:00.0)"
-    bdf_help += " optional when one device in system"
+    bdf_help += " optional when one device in system. Several bdfs may be"
+    bdf_help += " given for {} updates; those cards".format(
+        ', '.join(MULTI_CARD_TYPES))
+    bdf_help += " are flashed concurrently"
 
-    parser.add_argument('bdf', nargs='?', help=bdf_help)
+    parser.add_argument('bdf', nargs='*', help=bdf_help)
 
     rsu_help = "perform remote system update after update"
     rsu_help += " causing the board to be rebooted"
@@ -353,9 +361,66 @@ def normalize_bdf(bdf):
         return "0000:{}".format(bdf)
 
 
+def flash_label(mtd_dev):
+    name = threading.current_thread().name
+    return mtd_dev if name == 'MainThread' else '{} {}'.format(name, mtd_dev)
+
+
+def load_native_image(path, input_offset):
+    # cards flashed concurrently from one file share its reversed image
+    key = (os.path.realpath(path), input_offset)
+    with NATIVE_IMAGES_LOCK:
+        if key not in NATIVE_IMAGES:
+            NATIVE_IMAGES[key] = pyopaeflash.flash_image(path, input_offset,
+                                                         True)
+        return NATIVE_IMAGES[key]
+
+
+def report_progress(job, label):
+    last = None
+    while not job.finished:
+        total = job.total
+        pct = job.done * 100 // total if total else 100
+        state = (job.phase, pct // 10)
+        if state != last:
+            print("%s %s %s %3d%%" % (datetime.datetime.now(), label,
+                                      job.phase, pct))
+            last = state
+        time.sleep(0.5)
+
+
+def native_update_flash(ifile, mtd_dev, target_offset, input_offset,
+                        erase_len, no_verify):
+    label = flash_label(mtd_dev)
+
+    print("%s %s reversing bits" % (datetime.datetime.now(), label))
+    image = load_native_image(ifile.name, input_offset)
+    ifile.close()
+
+    job = pyopaeflash.flash_job(image, mtd_dev, target_offset, erase_len,
+                                not no_verify)
+    job.start()
+    report_progress(job, label)
+
+    if job.wait():
+        print(job.error)
+        raise Exception("failed to update flash")
+
+    print("%s %s actual bytes written 0x%x" % (
+        datetime.datetime.now(), label, job.bytes_written))
+
+    if not no_verify:
+        print("%s %s flash successfully verified" % (
+            datetime.datetime.now(), label))
+
+
 def update_flash(ifile, mtd_dev, target_offset, input_offset, erase_len,
                  no_verify):
 
+    if pyopaeflash and os.path.isfile(ifile.name):
+        return native_update_flash(ifile, mtd_dev, target_offset,
+                                   input_offset, erase_len, no_verify)
+
     ofile = tempfile.NamedTemporaryFile(mode='wb', delete=False)
 
     ifile.seek(input_offset)
@@ -1215,16 +1280,8 @@ def vc_phy_eeprom_update(ifile, spi_path, no_verify, no_nios_release):
     return ret
 
 
-def main():
-    args = parse_args()
-
-    bdf_pvid_map = get_bdf_pvid_mapping()
-
-    if len(bdf_pvid_map) == 0:
-        print("No FPGA devices found")
-        sys.exit(1)
-
-    bdf = validate_bdf(args.bdf, bdf_pvid_map)
+def check_card(args, bdf, bdf_pvid_map):
+    spi_path = None
 
     # Is the device secure?
     path = os.path.join(bdf, 'fpga')
@@ -1244,6 +1301,130 @@ def main():
         if check_file_extension(args.file, args.type) == 1:
             sys.exit(1)
 
+    return spi_path
+
+
+def flash_card(args, bdf, pvid, spi_path, ifile):
+    if pvid == RC_PVID:
+        if args.type in ['rsu', 'bmc_img', 'eeprom', 'bmc_factory']:
+            print("%s not supported on %s" % (args.type, RC))
+            return 1
+
+        return rc_fpga_update(ifile, args.type, bdf, args.no_verify)
+
+    if pvid == DC_PVID:
+        boot_page = "1"
+    elif pvid == VC_PVID:
+        boot_page = "0"
+    else:
+        raise Exception("bad pvid %s" % (pvid))
+
+    if args.type == 'rsu':
+        return board_rsu(bdf, spi_path, boot_page)
+
+    if args.type == 'eeprom':
+        if pvid == DC_PVID:
+            return dc_update_eeprom(ifile, spi_path)
+        elif pvid == VC_PVID:
+            return vc_update_eeprom(ifile, bdf)
+        print("eeprom only supported on {} and {}".format(DC_PVID, VC_PVID))
+        return 1
+
+    # file validation check for Vista Creek
+    if pvid == VC_PVID:
+        ret = check_file(ifile, args.type)
+        if ret != 0:
+            return ret
+    elif args.type in ['factory', 'factory_only', 'user']:
+        ret = check_file_dc(ifile)
+        if ret != 0:
+            return ret
+
+    if args.type in ['bmc_img', 'bmc_factory']:
+        sfile = tempfile.NamedTemporaryFile(mode='wb+', delete=False)
+        a = array("I", ifile.read())
+        for elem in a:
+            sfile.write(struct.pack('>I', elem))
+        sfile.close()
+        sfile = open(sfile.name, 'rb')
+    elif args.type == 'dtb':
+        sfile = tempfile.NamedTemporaryFile(mode='wb+', delete=False)
+        ifile.seek(VC_DC_DTB_BLOCK_OFFSET)
+        block = ifile.read(VC_DC_DTB_BLOCK_SIZE)
+        sfile.write(block)
+        sfile.close()
+        sfile = open(sfile.name, 'rb')
+    elif args.type == 'factory_only':
+        sfile = tempfile.NamedTemporaryFile(mode='wb+', delete=False)
+        ifile.seek(VC_DC_FACTORY_BLOCK_OFFSET)
+        block = ifile.read(VC_DC_FACTORY_BLOCK_SIZE)
+        sfile.write(block)
+        sfile.close()
+        sfile = open(sfile.name, 'rb')
+    else:
+        sfile = ifile
+
+    return dc_vc_fpga_update(sfile, args.type, bdf, spi_path,
+                             args.rsu, boot_page, args.no_verify)
+
+
+def flash_cards(args, bdfs, bdf_pvid_map, spi_paths):
+    results = dict()
+
+    def flash_one(bdf):
+        try:
+            with open(args.file.name, 'rb') as ifile:
+                results[bdf] = flash_card(args, bdf, bdf_pvid_map[bdf],
+                                          spi_paths[bdf], ifile)
+        except SystemExit as ex:
+            results[bdf] = ex.code
+        except Exception as ex:
+            print("{} {}".format(bdf, ex))
+            results[bdf] = 1
+
+    threads = [threading.Thread(target=flash_one, args=(bdf,), name=bdf)
+               for bdf in bdfs]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    ret = 0
+    for bdf in bdfs:
+        if results.get(bdf, 1):
+            print("{} update failed".format(bdf))
+            ret = 1
+        else:
+            print("{} update succeeded".format(bdf))
+
+    return ret
+
+
+def main():
+    args = parse_args()
+
+    bdf_pvid_map = get_bdf_pvid_mapping()
+
+    if len(bdf_pvid_map) == 0:
+        print("No FPGA devices found")
+        sys.exit(1)
+
+    if len(args.bdf) > 1 and args.type not in MULTI_CARD_TYPES:
+        print("{} updates one card at a time".format(args.type))
+        sys.exit(1)
+
+    bdfs = [validate_bdf(b, bdf_pvid_map) for b in args.bdf or [None]]
+    if len(set(bdfs)) != len(bdfs):
+        print("duplicate bdf given")
+        sys.exit(1)
+
+    spi_paths = dict()
+    for b in bdfs:
+        spi_paths[b] = check_card(args, b, bdf_pvid_map)
+
+    bdf = bdfs[0]
+    spi_path = spi_paths[bdf]
+
     if args.type != 'eeprom':
         assert_not_running(["pacd", "fpgad"])
 
@@ -1276,75 +1457,10 @@ def main():
         if line != "Yes":
             sys.exit(1)
 
-    if bdf_pvid_map[bdf] == RC_PVID:
-        if args.type in ['rsu', 'bmc_img', 'eeprom', 'bmc_factory']:
-            print("%s not supported on %s" % (args.type, RC))
-            sys.exit(1)
-
-        ret = rc_fpga_update(args.file, args.type, bdf, args.no_verify)
+    if len(bdfs) == 1:
+        ret = flash_card(args, bdf, bdf_pvid_map[bdf], spi_path, args.file)
     else:
-        if bdf_pvid_map[bdf] == DC_PVID:
-            boot_page = "1"
-        elif bdf_pvid_map[bdf] == VC_PVID:
-            boot_page = "0"
-        else:
-            raise Exception("bad pvid %s" % (bdf_pvid_map[bdf]))
-
-        if bdf_pvid_map[bdf] == DC_PVID:
-            boot_page = "1"
-        elif bdf_pvid_map[bdf] == VC_PVID:
-            boot_page = "0"
-        else:
-            raise Exception("bad pvid %s" % (bdf_pvid_map[bdf]))
-
-        if args.type == 'rsu':
-            ret = board_rsu(bdf, spi_path, boot_page)
-        elif args.type == 'eeprom':
-            if bdf_pvid_map[bdf] == DC_PVID:
-                ret = dc_update_eeprom(args.file, spi_path)
-            elif bdf_pvid_map[bdf] == VC_PVID:
-                ret = vc_update_eeprom(args.file, bdf)
-            else:
-                print("eeprom only supported on {} and {}".format(DC_PVID,
-                                                                  VC_PVID))
-                ret = 1
-        else:
-            # file validation check for Vista Creek
-            if bdf_pvid_map[bdf] == VC_PVID:
-                ret = check_file(args.file, args.type)
-                if ret != 0:
-                    sys.exit(ret)
-            elif args.type in ['factory', 'factory_only', 'user']:
-                ret = check_file_dc(args.file)
-                if ret != 0:
-                    sys.exit(ret)
-
-            if args.type in ['bmc_img', 'bmc_factory']:
-                sfile = tempfile.NamedTemporaryFile(mode='wb+', delete=False)
-                a = array("I", args.file.read())
-                for elem in a:
-                    sfile.write(struct.pack('>I', elem))
-                sfile.close()
-                sfile = open(sfile.name, 'rb')
-            elif args.type == 'dtb':
-                sfile = tempfile.NamedTemporaryFile(mode='wb+', delete=False)
-                args.file.seek(VC_DC_DTB_BLOCK_OFFSET)
-                block = args.file.read(VC_DC_DTB_BLOCK_SIZE)
-                sfile.write(block)
-                sfile.close()
-                sfile = open(sfile.name, 'rb')
-            elif args.type == 'factory_only':
-                sfile = tempfile.NamedTemporaryFile(mode='wb+', delete=False)
-                args.file.seek(VC_DC_FACTORY_BLOCK_OFFSET)
-                block = args.file.read(VC_DC_FACTORY_BLOCK_SIZE)
-                sfile.write(block)
-                sfile.close()
-                sfile = open(sfile.name, 'rb')
-            else:
-                sfile = args.file
-
-            ret = dc_vc_fpga_update(sfile, args.type, bdf, spi_path,
-                                    args.rsu, boot_page, args.no_verify)
+        ret = flash_cards(args, bdfs, bdf_pvid_map, spi_paths)
 
     sys.exit(ret)
 
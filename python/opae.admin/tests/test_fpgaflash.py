@@ -0,0 +1,250 @@
+# Copyright(c) 2023, Intel Corporation
+#
+# Redistribution  and  use  in source  and  binary  forms,  with  or  without
+# modification, are permitted provided that the following conditions are met:
+#
+# * Redistributions of  source code  must retain the  above copyright notice,
+#   this list of conditions and the following disclaimer.
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+# * Neither the name  of Intel Corporation  nor the names of its contributors
+#   may be used to  endorse or promote  products derived  from this  software
+#   without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+# IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+# LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+# CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+# SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+# INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+# CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+from __future__ import absolute_import
+import os
+import tempfile
+import unittest
+import mock
+from opae.admin.tools import fpgaflash
+
+try:
+    import pyopaeflash
+except ImportError:
+    pyopaeflash = None
+
+
+def slow_reverse(b):
+    return int('{:08b}'.format(b)[::-1], 2)
+
+
+class test_fpgaflash(unittest.TestCase):
+    def test_reverse_bits_in_file(self):
+        """test_reverse_bits_in_file
+           Given an input file holding every byte value, when
+           reverse_bits_in_file copies it to an output file, then each
+           output byte is the bit-reversed input byte.
+        """
+        data = bytearray(range(256)) * 5000
+        with tempfile.TemporaryFile() as ifile, \
+                tempfile.TemporaryFile() as ofile:
+            ifile.write(data)
+            ifile.seek(0)
+            fpgaflash.reverse_bits_in_file(ifile, ofile)
+            ofile.seek(0)
+            result = bytearray(ofile.read())
+
+        self.assertEqual(len(result), len(data))
+        for i in range(256):
+            self.assertEqual(result[i], slow_reverse(data[i]))
+        self.assertEqual(result[256:512], result[:256])
+
+    def test_flash_write_skips_erased(self):
+        """test_flash_write_skips_erased
+           Given an image whose trailing pages are all 0xff, when
+           flash_write writes it, then those pages are not written and
+           the returned byte count stops at the last programmed page.
+        """
+        image = b'\x5a' * 4096 + b'\xff' * 4096 + b'\xa5' * 100 + \
+            b'\xff' * 8192
+        with tempfile.NamedTemporaryFile() as dev, \
+                tempfile.TemporaryFile() as ifile:
+            dev.write(b'\x00' * (len(image) + 4096))
+            dev.flush()
+            ifile.write(image)
+            ifile.seek(0)
+
+            written = fpgaflash.flash_write(dev.name, 4096, len(image),
+                                            ifile)
+            with open(dev.name, 'rb') as f:
+                f.seek(4096)
+                flash = f.read(len(image))
+
+        self.assertEqual(written, 4096 * 3)
+        self.assertEqual(flash[:4096], image[:4096])
+        self.assertEqual(flash[4096:8192], b'\x00' * 4096)
+        self.assertEqual(flash[8192:12288], image[8192:12288])
+        self.assertEqual(flash[12288:], b'\x00' * (len(image) - 12288))
+
+    def test_flash_cards(self):
+        """test_flash_cards
+           When several cards are flashed concurrently, then each card is
+           updated from its own handle on the image file and the result
+           fails when any one card fails.
+        """
+        with tempfile.NamedTemporaryFile() as image:
+            args = mock.MagicMock()
+            args.file.name = image.name
+            pvids = {'0000:04:00.0': fpgaflash.DC_PVID,
+                     '0000:08:00.0': fpgaflash.VC_PVID}
+            spi = {'0000:04:00.0': 'spi0', '0000:08:00.0': 'spi1'}
+            seen = []
+
+            def flash_card(args, bdf, pvid, spi_path, ifile):
+                seen.append((bdf, pvid, spi_path, ifile.name))
+                return 0 if bdf == '0000:04:00.0' else 1
+
+            with mock.patch.object(fpgaflash, 'flash_card', new=flash_card):
+                ret = fpgaflash.flash_cards(args, sorted(pvids), pvids, spi)
+
+        self.assertEqual(ret, 1)
+        self.assertEqual(sorted(seen),
+                         [('0000:04:00.0', fpgaflash.DC_PVID, 'spi0',
+                           image.name),
+                          ('0000:08:00.0', fpgaflash.VC_PVID, 'spi1',
+                           image.name)])
+
+
+# 16-byte header, two programmed pages, an erased page, a partly
+# programmed page, two erased pages and a short programmed tail
+IMAGE_OFFSET = 16
+IMAGE = b'\xa5' * IMAGE_OFFSET + bytes(bytearray(range(256))) * 32 + \
+    b'\xff' * 4096 + b'\x5a' * 100 + b'\xff' * (4096 - 100 + 8192) + \
+    b'\x3c' * 10
+TARGET_OFFSET = 4096
+
+
+def flash_file(fill):
+    dev = tempfile.NamedTemporaryFile()
+    dev.write(fill * (TARGET_OFFSET + len(IMAGE) + 4096))
+    dev.flush()
+    return dev
+
+
+def python_flash(image, dev):
+    with open(image, 'rb') as ifile, tempfile.TemporaryFile() as rfile:
+        ifile.seek(IMAGE_OFFSET)
+        fpgaflash.reverse_bits_in_file(ifile, rfile)
+        nbytes = rfile.tell()
+        rfile.seek(0)
+        return fpgaflash.flash_write(dev, TARGET_OFFSET, nbytes, rfile)
+
+
+def native_flash(image, dev, erase_len=0, verify=False):
+    img = pyopaeflash.flash_image(image, IMAGE_OFFSET, True)
+    job = pyopaeflash.flash_job(img, dev, TARGET_OFFSET, erase_len, verify)
+    job.start()
+    return job.wait(), job
+
+
+@unittest.skipIf(pyopaeflash is None, 'pyopaeflash is not installed')
+class test_pyopaeflash(unittest.TestCase):
+    def setUp(self):
+        self.image = tempfile.NamedTemporaryFile()
+        self.image.write(IMAGE)
+        self.image.flush()
+
+    def tearDown(self):
+        self.image.close()
+
+    def test_reverse_bits(self):
+        """test_reverse_bits
+           Given a buffer whose length is not a multiple of 8, when
+           pyopaeflash reverses its bits, then the result matches the
+           Python translation table.
+        """
+        data = bytes(bytearray(range(256))) * 3 + b'\x01\x80\x0f'
+        self.assertEqual(pyopaeflash.reverse_bits(data),
+                         data.translate(fpgaflash.BIT_REVERSE_TABLE))
+
+    def test_is_erased(self):
+        """test_is_erased
+           A buffer is erased only when every byte, including those
+           past the last whole 64-byte block, is 0xff.
+        """
+        self.assertTrue(pyopaeflash.is_erased(b''))
+        self.assertTrue(pyopaeflash.is_erased(b'\xff' * 1000))
+        for pos in [0, 63, 64, 999]:
+            data = bytearray(b'\xff' * 1000)
+            data[pos] = 0xfe
+            self.assertFalse(pyopaeflash.is_erased(bytes(data)), pos)
+
+    def test_write_matches_fallback(self):
+        """test_write_matches_fallback
+           Given the same image, when flash_job writes it without an
+           erase, then erased pages are skipped, neighbouring pages are
+           coalesced, and the flash and byte count match the Python
+           fallback.
+        """
+        with flash_file(b'\x00') as pydev, flash_file(b'\x00') as dev:
+            written = python_flash(self.image.name, pydev.name)
+            ret, job = native_flash(self.image.name, dev.name)
+            self.assertEqual(ret, 0, job.error)
+            self.assertEqual(job.phase, 'done')
+            self.assertEqual(job.bytes_written, written)
+            self.assertEqual(written, len(IMAGE) - IMAGE_OFFSET)
+            with open(pydev.name, 'rb') as f:
+                expected = f.read()
+            with open(dev.name, 'rb') as f:
+                self.assertEqual(f.read(), expected)
+
+        # the erased page between the programmed ones was skipped
+        page = TARGET_OFFSET + 8192
+        self.assertEqual(expected[page:page + 4096], b'\x00' * 4096)
+
+    def test_verify(self):
+        """test_verify
+           When the skipped pages read back as erased, then the verify
+           phase passes. When they don't, then the job fails.
+        """
+        with flash_file(b'\xff') as dev:
+            ret, job = native_flash(self.image.name, dev.name, verify=True)
+            self.assertEqual(ret, 0, job.error)
+            self.assertEqual(job.phase, 'done')
+
+        with flash_file(b'\x00') as dev:
+            ret, job = native_flash(self.image.name, dev.name, verify=True)
+            self.assertEqual(ret, -1)
+            self.assertEqual(job.phase, 'failed')
+            self.assertIn('verify failed', job.error)
+
+    def test_erase(self):
+        """test_erase
+           Given a regular file in place of an mtd device, when the job
+           must erase, then it fails without writing the image.
+        """
+        with flash_file(b'\x00') as dev:
+            ret, job = native_flash(self.image.name, dev.name,
+                                    erase_len=4096)
+            self.assertEqual(ret, -1)
+            self.assertEqual(job.phase, 'failed')
+            self.assertIn('MEMGETINFO', job.error)
+            self.assertEqual(job.bytes_written, 0)
+            with open(dev.name, 'rb') as f:
+                self.assertEqual(f.read(),
+                                 b'\x00' * (TARGET_OFFSET + len(IMAGE) + 4096))
+
+    def test_erase_range(self):
+        """test_erase_range
+           Given an erase range that ends past 4 GiB, when the job is
+           created, then it raises ValueError, as struct.pack('II')
+           does in the Python fallback.
+        """
+        img = pyopaeflash.flash_image(self.image.name, IMAGE_OFFSET, True)
+        with self.assertRaises(ValueError):
+            pyopaeflash.flash_job(img, 'mtd0', 2**32 - 4096, 8192, False)
+        with self.assertRaises(ValueError):
+            pyopaeflash.flash_job(img, 'mtd0', 0, 2**32, False)
+        pyopaeflash.flash_job(img, 'mtd0', 2**32 - 1 - 8192, 8192, False)
@@ -24,7 +24,16 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 #pragma once
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 #include "dummy_afu.h"
 
 namespace dummy_afu {
@@ -60,6 +69,225 @@ inline void timeit_rd(std::shared_ptr<spdlog::logger> log, dummy_afu *afu, uint3
 }
 
 
+// Serialized cycle counter used to time single MMIO accesses; falls
+// back to steady_clock nanoseconds where there is no TSC.
+inline uint64_t bench_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_lfence();
+  uint64_t t = __rdtsc();
+  _mm_lfence();
+  return t;
+#else
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(
+    steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline double bench_ticks_per_nsec()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  using namespace std::chrono;
+  auto t0 = steady_clock::now();
+  auto c0 = bench_ticks();
+  std::this_thread::sleep_for(milliseconds(10));
+  auto c1 = bench_ticks();
+  auto t1 = steady_clock::now();
+  auto ns = duration_cast<nanoseconds>(t1 - t0).count();
+  return ns > 0 ? static_cast<double>(c1 - c0) / ns : 1.0;
+#else
+  return 1.0;
+#endif
+}
+
+// Log-linear latency histogram: values below 64 are counted exactly,
+// larger values in 32 linear sub-buckets per power of two (~3% error).
+class latency_histogram
+{
+public:
+  enum {
+    sub_bits = 5,
+    sub_count = 1 << sub_bits,
+    num_buckets = (64 - sub_bits + 1) * sub_count
+  };
+
+  latency_histogram()
+  : buckets_(num_buckets, 0)
+  , count_(0)
+  , sum_(0)
+  , min_(UINT64_MAX)
+  , max_(0)
+  {}
+
+  static size_t index(uint64_t v)
+  {
+    if (v < 2 * sub_count)
+      return v;
+    unsigned shift = 63 - __builtin_clzll(v) - sub_bits;
+    return (shift + 1) * sub_count + ((v >> shift) - sub_count);
+  }
+
+  // smallest value counted in bucket i
+  static uint64_t lowest(size_t i)
+  {
+    if (i < 2 * sub_count)
+      return i;
+    unsigned shift = i / sub_count - 1;
+    return static_cast<uint64_t>(i % sub_count + sub_count) << shift;
+  }
+
+  void add(uint64_t v)
+  {
+    ++buckets_[index(v)];
+    ++count_;
+    sum_ += v;
+    if (v < min_)
+      min_ = v;
+    if (v > max_)
+      max_ = v;
+  }
+
+  void merge(const latency_histogram &other)
+  {
+    for (size_t i = 0; i < buckets_.size(); ++i)
+      buckets_[i] += other.buckets_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  // Upper bound of the bucket holding the p-th percentile, so that the
+  // reported tail is never below the measured one.
+  uint64_t percentile(double p) const
+  {
+    if (!count_)
+      return 0;
+    uint64_t target = static_cast<uint64_t>(std::ceil(p / 100.0 * count_));
+    if (!target)
+      target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+      seen += buckets_[i];
+      if (seen >= target)
+        return std::min(i + 1 < buckets_.size() ? lowest(i + 1) - 1 : max_,
+                        max_);
+    }
+    return max_;
+  }
+
+  uint64_t count() const { return count_; }
+  uint64_t min() const { return count_ ? min_ : 0; }
+  uint64_t max() const { return max_; }
+  double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+private:
+  std::vector<uint64_t> buckets_;
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+// MMIO through the OPAE API (fpgaReadMMIO*/fpgaWriteMMIO*).
+template<typename T>
+struct api_access;
+
+template<>
+struct api_access<uint32_t>
+{
+  api_access(dummy_afu *afu, uint32_t offset)
+  : handle(afu->handle()), offset(offset) {}
+  uint32_t read() const { return handle->read_csr32(offset); }
+  void write(uint32_t v) const { handle->write_csr32(offset, v); }
+  opae::fpga::types::handle::ptr_t handle;
+  uint32_t offset;
+};
+
+template<>
+struct api_access<uint64_t>
+{
+  api_access(dummy_afu *afu, uint32_t offset)
+  : handle(afu->handle()), offset(offset) {}
+  uint64_t read() const { return handle->read_csr64(offset); }
+  void write(uint64_t v) const { handle->write_csr64(offset, v); }
+  opae::fpga::types::handle::ptr_t handle;
+  uint32_t offset;
+};
+
+// MMIO through the mapped BAR pointer, resolved once up front.
+template<typename T>
+struct direct_access
+{
+  direct_access(dummy_afu *afu, uint32_t offset)
+  : ptr(afu->register_ptr<T>(offset)) {}
+  T read() const { return *ptr; }
+  void write(T v) const { *ptr = v; }
+  volatile T *ptr;
+};
+
+// Time count accesses, read_pct percent of them reads, interleaved
+// evenly. The read/write decision is made outside the timed window.
+template<class Access>
+inline void bench_loop(const Access &a, uint32_t count, uint32_t read_pct,
+                       latency_histogram &rd, latency_histogram &wr)
+{
+  uint32_t acc = 0;
+  uint64_t sink = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    acc += read_pct;
+    if (acc >= 100) {
+      acc -= 100;
+      auto t0 = bench_ticks();
+      sink += a.read();
+      auto t1 = bench_ticks();
+      rd.add(t1 - t0);
+    } else {
+      auto t0 = bench_ticks();
+      a.write(i);
+      auto t1 = bench_ticks();
+      wr.add(t1 - t0);
+    }
+  }
+  (void)sink;
+}
+
+// Run bench_loop on threads concurrent threads, each on its own
+// scratchpad register, and merge their histograms.
+template<class Access>
+inline void bench_threads(dummy_afu *afu, uint32_t threads, uint32_t count,
+                          uint32_t read_pct,
+                          latency_histogram &rd, latency_histogram &wr)
+{
+  std::vector<latency_histogram> rds(threads), wrs(threads);
+  std::vector<std::thread> workers;
+  std::atomic<uint32_t> ready(0);
+
+  for (uint32_t t = 0; t < threads; ++t) {
+    Access a(afu, MMIO_TEST_SCRATCHPAD + sizeof(uint64_t) * (t % 64));
+    workers.emplace_back([&, a, t]() {
+      ready.fetch_add(1);
+      while (ready.load() < threads)
+        std::this_thread::yield();
+      bench_loop(a, count, read_pct, rds[t], wrs[t]);
+    });
+  }
+
+  for (uint32_t t = 0; t < threads; ++t) {
+    workers[t].join();
+    rd.merge(rds[t]);
+    wr.merge(wrs[t]);
+  }
+}
+
+struct bench_result
+{
+  std::string path;
+  std::string op;
+  latency_histogram hist;
+};
+
 template<typename T>
 inline void write_verify(dummy_afu *afu, uint32_t addr, T value)
 {
@@ -99,6 +327,11 @@ public:
   , perf_(false)
   , width_(64)
   , op_("rd")
+  , bench_(false)
+  , path_("both")
+  , read_pct_(100)
+  , threads_(1)
+  , format_("text")
   {
 
   }
@@ -126,11 +359,25 @@ public:
     opt->check(CLI::IsMember({8, 16, 32, 64}))->default_str(std::to_string(width_));
     opt = app->add_option("--op", op_, "operation for mmio performance stats");
     opt->check(CLI::IsMember({"rd", "wr"}))->default_str(op_);
+    app->add_flag("--bench", bench_,
+                  "record per-access mmio latency histograms (count accesses per thread)");
+    app->add_option("--path", path_, "mmio path to benchmark {api, direct, both}")->
+      check(CLI::IsMember({"api", "direct", "both"}))->default_str(path_);
+    app->add_option("--read-pct", read_pct_,
+                    "percentage of reads in the benchmark, default from --op")->
+      check(CLI::Range(0, 100));
+    app->add_option("--threads", threads_, "number of concurrent benchmark threads")->
+      check(CLI::Range(1, 64))->default_str(std::to_string(threads_));
+    app->add_option("--format", format_, "benchmark report format {text, csv, json}")->
+      check(CLI::IsMember({"text", "csv", "json"}))->default_str(format_);
+    app->add_option("--output", output_, "benchmark report file, default stdout");
   }
 
   virtual int run(test_afu *afu, CLI::App *app)
   {
     auto d_afu = dynamic_cast<dummy_afu*>(afu);
+    if (bench_)
+      return run_bench(d_afu, app);
     if (perf_)
       return run_perf(d_afu, app);
     auto sp_index = app->get_option("--scratchpad-index");
@@ -177,12 +424,153 @@ public:
       rd_tests[width_](log, afu, count_);
     return 0;
   }
+  int run_bench(dummy_afu *afu, CLI::App *app)
+  {
+    auto log = spdlog::get(this->name());
+    uint32_t read_pct = read_pct_;
+    if (!*app->get_option("--read-pct"))
+      read_pct = op_ == "wr" ? 0 : 100;
+
+    std::vector<bench_result> results;
+    for (auto path : {"api", "direct"}) {
+      if (path_ != "both" && path_ != path)
+        continue;
+      latency_histogram rd, wr;
+      if (std::string(path) == "direct") {
+        switch (width_) {
+        case 8:
+          bench_threads<direct_access<uint8_t>>(afu, threads_, count_, read_pct, rd, wr);
+          break;
+        case 16:
+          bench_threads<direct_access<uint16_t>>(afu, threads_, count_, read_pct, rd, wr);
+          break;
+        case 32:
+          bench_threads<direct_access<uint32_t>>(afu, threads_, count_, read_pct, rd, wr);
+          break;
+        default:
+          bench_threads<direct_access<uint64_t>>(afu, threads_, count_, read_pct, rd, wr);
+          break;
+        }
+      } else if (width_ == 32) {
+        bench_threads<api_access<uint32_t>>(afu, threads_, count_, read_pct, rd, wr);
+      } else if (width_ == 64) {
+        bench_threads<api_access<uint64_t>>(afu, threads_, count_, read_pct, rd, wr);
+      } else {
+        log->warn("api path supports 32 and 64 bit mmio only, skipping");
+        continue;
+      }
+      if (rd.count())
+        results.push_back(bench_result{path, "rd", rd});
+      if (wr.count())
+        results.push_back(bench_result{path, "wr", wr});
+    }
+
+    double tpns = bench_ticks_per_nsec();
+    for (auto &r : results) {
+      auto key = r.path + "_" + r.op + "_";
+      afu->report_metric(key + "p50_ns", r.hist.percentile(50.0) / tpns);
+      afu->report_metric(key + "p99_ns", r.hist.percentile(99.0) / tpns);
+      afu->report_metric(key + "p999_ns", r.hist.percentile(99.9) / tpns);
+      afu->report_metric(key + "max_ns", r.hist.max() / tpns);
+    }
+
+    std::ofstream file;
+    if (!output_.empty()) {
+      file.open(output_);
+      if (!file) {
+        log->error("could not open {0}", output_);
+        return test_afu::exit_codes::error;
+      }
+    }
+
+    if (format_ == "text" && output_.empty()) {
+      for (auto &r : results)
+        log->info("{0} {1} width: {2}, threads: {3}, count: {4}, "
+                  "min: {5:0.1f}, mean: {6:0.1f}, p50: {7:0.1f}, "
+                  "p99: {8:0.1f}, p99.9: {9:0.1f}, max: {10:0.1f} nsec",
+                  r.path, r.op, width_, threads_, r.hist.count(),
+                  r.hist.min() / tpns, r.hist.mean() / tpns,
+                  r.hist.percentile(50.0) / tpns,
+                  r.hist.percentile(99.0) / tpns,
+                  r.hist.percentile(99.9) / tpns, r.hist.max() / tpns);
+      return 0;
+    }
+
+    std::ostream &os = output_.empty() ? std::cout : file;
+    if (format_ == "csv")
+      write_csv(os, results, read_pct, tpns);
+    else if (format_ == "json")
+      write_json(os, results, read_pct, tpns);
+    else
+      write_text(os, results, tpns);
+    return 0;
+  }
+
 private:
+  void write_text(std::ostream &os, const std::vector<bench_result> &results,
+                  double tpns) const
+  {
+    os << std::fixed << std::setprecision(1);
+    for (auto &r : results)
+      os << r.path << " " << r.op << " width: " << width_
+         << ", threads: " << threads_ << ", count: " << r.hist.count()
+         << ", min: " << r.hist.min() / tpns
+         << ", mean: " << r.hist.mean() / tpns
+         << ", p50: " << r.hist.percentile(50.0) / tpns
+         << ", p99: " << r.hist.percentile(99.0) / tpns
+         << ", p99.9: " << r.hist.percentile(99.9) / tpns
+         << ", max: " << r.hist.max() / tpns << " nsec\n";
+  }
+
+  void write_csv(std::ostream &os, const std::vector<bench_result> &results,
+                 uint32_t read_pct, double tpns) const
+  {
+    os << "path,op,width,threads,read_pct,count,"
+          "min_ns,mean_ns,p50_ns,p99_ns,p999_ns,max_ns\n";
+    for (auto &r : results)
+      os << r.path << "," << r.op << "," << width_ << "," << threads_
+         << "," << read_pct << "," << r.hist.count()
+         << "," << r.hist.min() / tpns << "," << r.hist.mean() / tpns
+         << "," << r.hist.percentile(50.0) / tpns
+         << "," << r.hist.percentile(99.0) / tpns
+         << "," << r.hist.percentile(99.9) / tpns
+         << "," << r.hist.max() / tpns << "\n";
+  }
+
+  void write_json(std::ostream &os, const std::vector<bench_result> &results,
+                  uint32_t read_pct, double tpns) const
+  {
+    os << "{\"test\": \"mmio\", \"width\": " << width_
+       << ", \"threads\": " << threads_
+       << ", \"read_pct\": " << read_pct
+       << ", \"ticks_per_ns\": " << tpns
+       << ", \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+      auto &r = results[i];
+      os << (i ? ", " : "")
+         << "{\"path\": \"" << r.path << "\", \"op\": \"" << r.op
+         << "\", \"count\": " << r.hist.count()
+         << ", \"min_ns\": " << r.hist.min() / tpns
+         << ", \"mean_ns\": " << r.hist.mean() / tpns
+         << ", \"p50_ns\": " << r.hist.percentile(50.0) / tpns
+         << ", \"p99_ns\": " << r.hist.percentile(99.0) / tpns
+         << ", \"p999_ns\": " << r.hist.percentile(99.9) / tpns
+         << ", \"max_ns\": " << r.hist.max() / tpns << "}";
+    }
+    os << "]}\n";
+  }
+
   uint32_t count_;
   uint32_t sp_index_;
   bool perf_;
   uint32_t width_;
   std::string op_;
+  bool bench_;
+  std::string path_;
+  uint32_t read_pct_;
+  uint32_t threads_;
+  std::string format_;
+  std::string output_;
 };
 
 } // end of namespace dummy_afu
@@ -31,6 +31,7 @@
 #include "afu_test.h"
 
 namespace host_exerciser {
+using opae::fpga::types::buffer_pool;
 using opae::fpga::types::event;
 using opae::fpga::types::shared_buffer;
 using opae::fpga::types::token;
@@ -403,6 +404,34 @@ public:
 
     app_.add_option("--clock-mhz", he_clock_mhz_,
         "Clock frequency (MHz) -- when zero, read the frequency from the AFU")->default_val("0");
+
+    // Soak mode: sample bandwidth and telemetry while continuous mode runs
+    app_.add_option("--soak-interval", he_soak_interval_,
+        "Continuous mode sample interval (msec) -- when zero, soak mode is off")->default_val("0");
+
+    app_.add_option("--soak-window", he_soak_window_,
+        "Number of samples in the rolling bandwidth average")
+        ->transform(CLI::Range(1, 100000))->default_val("10");
+
+    app_.add_option("--soak-regression", he_soak_regression_,
+        "Flag samples this many percent below the rolling average")
+        ->transform(CLI::Range(1, 100))->default_val("20");
+
+    app_.add_option("--soak-stall", he_soak_stall_,
+        "Fail after this many consecutive samples without progress -- zero never fails")->default_val("3");
+
+    app_.add_option("--soak-format", he_soak_format_, "Soak time series format {csv, json}")
+      ->check(CLI::IsMember({"csv", "json"}))->default_val("csv");
+
+    app_.add_option("--soak-output", he_soak_output_, "Soak time series file, default stdout");
+
+    // Sweep: run every point of a parameter grid and report a results matrix
+    app_.add_option("--sweep", he_sweep_, "Run the parameter sweep described by a JSON spec file");
+
+    app_.add_option("--sweep-format", he_sweep_format_, "Sweep results matrix format {text, csv, json}")
+      ->check(CLI::IsMember({"text", "csv", "json"}))->default_val("text");
+
+    app_.add_option("--sweep-output", he_sweep_output_, "Sweep results matrix file, default stdout");
    }
 
   virtual int run(CLI::App *app, test_command::ptr_t test) override
@@ -412,7 +441,7 @@ public:
     logger_->set_pattern("    %v");
     // Info prints details of an individual run. Turn it on if doing only one test
     // and the user hasn't changed level from the default.
-    if ((log_level_.compare("warning") == 0) && !he_test_all_)
+    if ((log_level_.compare("warning") == 0) && !he_test_all_ && he_sweep_.empty())
         logger_->set_level(spdlog::level::info);
 
     logger_->info("starting test run, count of {0:d}", count_);
@@ -458,9 +487,13 @@ public:
     write<T>(get_offset(offset, i), value);
   }
 
+  // Buffers come from a pool, so that running several tests, or the
+  // same test repeatedly, pins the DSM and data buffers only once.
   shared_buffer::ptr_t allocate(size_t size)
   {
-    return shared_buffer::allocate(handle_, size);
+    if (!pool_ || pool_->owner() != handle_)
+      pool_ = buffer_pool::create(handle_);
+    return pool_->acquire(size);
   }
 
   void fill(shared_buffer::ptr_t buffer)
@@ -538,8 +571,18 @@ public:
   uint32_t he_interrupt_;
   uint32_t he_contmodetime_;
   uint32_t he_clock_mhz_;
+  uint32_t he_soak_interval_;
+  uint32_t he_soak_window_;
+  uint32_t he_soak_regression_;
+  uint32_t he_soak_stall_;
+  std::string he_soak_format_;
+  std::string he_soak_output_;
+  std::string he_sweep_;
+  std::string he_sweep_format_;
+  std::string he_sweep_output_;
 
   std::map<uint32_t, uint32_t> limits_;
+  buffer_pool::ptr_t pool_;
 
   uint32_t get_offset(uint32_t base, uint32_t i) const {
     auto limit = limits_.find(base);
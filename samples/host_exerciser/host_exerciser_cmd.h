@@ -26,9 +26,14 @@
 #pragma once
 
 #include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <thread>
 
 #include "afu_test.h"
 #include "host_exerciser.h"
+#include "host_exerciser_soak.h"
+#include "host_exerciser_sweep.h"
 
 using test_afu = opae::afu_test::afu;
 using opae::fpga::types::shared_buffer;
@@ -125,6 +130,20 @@ public:
         return (double)(num_lines * 64) / ((1000.0 / host_exe_->he_clock_mhz_ * num_ticks));
     }
 
+    // Cache lines moved for the given read and write counts in the
+    // current test mode
+    uint64_t he_num_cache_lines(uint64_t num_reads, uint64_t num_writes)
+    {
+        switch (he_lpbk_cfg_.TestMode) {
+        case HOST_EXEMODE_READ:
+            return num_reads;
+        case HOST_EXEMODE_WRITE:
+            return num_writes;
+        default:
+            return num_writes * 2;
+        }
+    }
+
     void he_perf_counters()
     {
         struct he_dsm_status *dsm_status = NULL;
@@ -140,14 +159,8 @@ public:
         host_exe_->logger_->info("Host Exerciser Performance Counter:");
         // calculate number of cache lines in continuous mode
         if (host_exe_->he_continuousmode_) {
-            if (he_lpbk_cfg_.TestMode == HOST_EXEMODE_LPBK1)
-                num_cache_lines = dsm_status->num_writes * 2;
-            if (he_lpbk_cfg_.TestMode == HOST_EXEMODE_READ)
-                num_cache_lines = dsm_status->num_reads;
-            if (he_lpbk_cfg_.TestMode == HOST_EXEMODE_WRITE)
-                num_cache_lines = (dsm_status->num_writes);
-            if (he_lpbk_cfg_.TestMode == HOST_EXEMODE_TRPUT)
-                num_cache_lines = dsm_status->num_writes * 2;
+            num_cache_lines = he_num_cache_lines(dsm_status->num_reads,
+                                                 dsm_status->num_writes);
         } else {
             num_cache_lines = (LPBK1_BUFFER_SIZE / (1 * CL));
         }
@@ -167,6 +180,7 @@ public:
         if (dsm_status->num_ticks > 0) {
             double perf_data = he_num_xfers_to_bw(num_cache_lines, dsm_status->num_ticks);
             host_exe_->logger_->info("Bandwidth: {0:0.3f} GB/s", perf_data);
+            host_exe_->report_metric("bandwidth_gbps", perf_data);
         }
     }
 
@@ -357,9 +371,124 @@ public:
         return 0;
     }
 
+    struct he_soak_counters {
+        std::chrono::steady_clock::time_point time;
+        uint64_t num_ticks;
+        uint32_t num_reads;
+        uint32_t num_writes;
+        uint32_t csr_reads;
+        uint32_t csr_writes;
+    };
+
+    he_soak_counters he_soak_read_counters()
+    {
+        volatile he_dsm_status *dsm_status =
+            reinterpret_cast<he_dsm_status *>((uint8_t*)dsm_->c_type());
+        he_status0 he_status0;
+        he_soak_counters c;
+
+        he_status0.value = host_exe_->read64(HE_STATUS0);
+        c.time = std::chrono::steady_clock::now();
+        c.num_ticks = dsm_status->num_ticks;
+        c.num_reads = dsm_status->num_reads;
+        c.num_writes = dsm_status->num_writes;
+        c.csr_reads = he_status0.numReads;
+        c.csr_writes = he_status0.numWrites;
+        return c;
+    }
+
+    // Sample the transfer counters every he_soak_interval_ msec while
+    // continuous mode runs and stream bandwidth and telemetry. The DSM
+    // counters are used when the AFU refreshes them during the run;
+    // otherwise the live STATUS0 counters are timed with the host clock.
+    bool he_soak()
+    {
+        using namespace std::chrono;
+        auto log = host_exe_->logger_;
+        bool ok = true;
+
+        soak_monitor monitor(host_exe_->he_soak_window_,
+                             host_exe_->he_soak_regression_,
+                             host_exe_->he_soak_stall_);
+        soak_telemetry telemetry;
+        if (!telemetry.open(token_))
+            log->debug("no power or thermal metrics found, soak telemetry disabled");
+
+        std::ofstream file;
+        if (!host_exe_->he_soak_output_.empty()) {
+            file.open(host_exe_->he_soak_output_);
+            if (!file) {
+                std::cerr << "Failed to open soak output: "
+                          << host_exe_->he_soak_output_ << std::endl;
+                he_forcetestcmpl();
+                return false;
+            }
+        }
+        soak_writer writer(file.is_open() ? file : std::cout,
+                           host_exe_->he_soak_format_ == "json",
+                           telemetry.names());
+
+        auto interval = milliseconds(host_exe_->he_soak_interval_);
+        auto prev = he_soak_read_counters();
+        auto start = prev.time;
+        auto end = start + seconds(host_exe_->he_contmodetime_);
+
+        while (!g_he_exit && prev.time < end) {
+            std::this_thread::sleep_until(std::min(prev.time + interval, end));
+            auto cur = he_soak_read_counters();
+
+            double secs;
+            uint64_t lines;
+            uint64_t ticks = (cur.num_ticks - prev.num_ticks) & ((1ULL << 40) - 1);
+            if (ticks) {
+                secs = ticks / (host_exe_->he_clock_mhz_ * 1e6);
+                lines = he_num_cache_lines(uint32_t(cur.num_reads - prev.num_reads),
+                                           uint32_t(cur.num_writes - prev.num_writes));
+            } else {
+                secs = duration<double>(cur.time - prev.time).count();
+                lines = he_num_cache_lines(uint32_t(cur.csr_reads - prev.csr_reads),
+                                           uint32_t(cur.csr_writes - prev.csr_writes));
+            }
+
+            auto sample = monitor.update(duration<double>(cur.time - start).count(),
+                                         secs, lines * CL);
+            writer.write(sample, telemetry.sample());
+            if (*sample.event)
+                log->warn("{0} at {1:0.3f} s: {2:0.3f} GB/s, rolling {3:0.3f} GB/s",
+                          sample.event, sample.time, sample.gbps, sample.rolling_gbps);
+            prev = cur;
+
+            if (monitor.stalled()) {
+                std::cerr << "HE LPBK STALL: no progress in "
+                          << host_exe_->he_soak_stall_ << " samples" << std::endl;
+                host_exerciser_errors();
+                ok = false;
+                break;
+            }
+        }
+
+        he_forcetestcmpl();
+        he_perf_counters();
+
+        log->info("Soak: {0} samples, min {1:0.3f} GB/s, mean {2:0.3f} GB/s, "
+                  "max {3:0.3f} GB/s, {4} regressions, {5} stalls",
+                  monitor.samples(), monitor.min_gbps(), monitor.mean_gbps(),
+                  monitor.max_gbps(), monitor.regressions(), monitor.stalls());
+        host_exe_->report_metric("soak_min_gbps", monitor.min_gbps());
+        host_exe_->report_metric("soak_mean_gbps", monitor.mean_gbps());
+        host_exe_->report_metric("soak_max_gbps", monitor.max_gbps());
+        host_exe_->report_metric("soak_regressions", monitor.regressions());
+        host_exe_->report_metric("soak_stalls", monitor.stalls());
+        return ok;
+    }
+
     bool he_continuousmode()
     {
         uint32_t count = 0;
+        if (host_exe_->he_continuousmode_ && host_exe_->he_contmodetime_ > 0 &&
+            host_exe_->he_soak_interval_ > 0)
+            return he_soak();
+
         if (host_exe_->he_continuousmode_ && host_exe_->he_contmodetime_ > 0)
         { 
             host_exe_->logger_->debug("continuous mode time: {0} seconds", host_exe_->he_contmodetime_);
@@ -456,6 +585,41 @@ public:
             return -1;
         }
 
+        if (host_exe_->he_soak_interval_ && host_exe_->he_test_all_) {
+            std::cerr << "Soak mode is not supported with testall"
+                << std::endl;
+            return -1;
+        }
+
+        if (host_exe_->he_soak_interval_ && !host_exe_->he_continuousmode_) {
+            std::cerr << "Soak mode requires continuous mode"
+                << std::endl;
+            return -1;
+        }
+
+        if (!host_exe_->he_sweep_.empty()) {
+            if (host_exe_->he_test_all_ || host_exe_->he_soak_interval_ ||
+                (he_lpbk_cfg_.IntrTestMode == 1)) {
+                std::cerr << "Sweep is not supported with testall, soak or interrupt modes"
+                    << std::endl;
+                return -1;
+            }
+
+            // Check every value up front rather than part way through
+            try {
+                sweep_spec_ = parse_sweep_spec(host_exe_->he_sweep_);
+                auto cfg = he_lpbk_cfg_;
+                uint32_t threads = 0;
+                for (auto &axis : sweep_spec_.axes)
+                    for (auto &value : axis.values)
+                        he_sweep_apply(axis.name, value, threads);
+                he_lpbk_cfg_ = cfg;
+            } catch (std::exception &ex) {
+                std::cerr << ex.what() << std::endl;
+                return -1;
+            }
+        }
+
         return 0;
     }
 
@@ -505,7 +669,8 @@ public:
             }
         } else if (host_exe_->he_continuousmode_) {
             // Continuous mode
-            he_continuousmode();
+            if (!he_continuousmode())
+                status = -1;
 
             if (host_exe_->logger_->should_log(spdlog::level::debug)) {
                 std::cout << std::endl;
@@ -670,6 +835,167 @@ public:
         return status;
     }
 
+    // Apply one sweep parameter value to the test configuration.
+    void he_sweep_apply(const std::string &name, const std::string &value,
+                        uint32_t &threads)
+    {
+        try {
+            if (name == "mode") {
+                he_lpbk_cfg_.TestMode = he_modes.at(value);
+            } else if (name == "cls") {
+                he_lpbk_cfg_.ReqLen = he_req_cls_len.at(value);
+            } else if (name == "interleave") {
+                auto interleave = std::stoul(value);
+                if (interleave > 2)
+                    throw std::out_of_range(value);
+                he_lpbk_cfg_.TputInterleave = interleave;
+            } else if (name == "encoding") {
+                he_lpbk_cfg_.Encoding = he_req_encoding.at(value);
+            } else if (name == "delay") {
+                if (value != "true" && value != "false")
+                    throw std::out_of_range(value);
+                he_lpbk_cfg_.DelayEn = value == "true";
+            } else if (name == "atomic") {
+                he_lpbk_cfg_.AtomicFunc = he_req_atomic_func.at(value);
+            } else if (name == "threads") {
+                threads = std::stoul(value);
+                if (threads > 256)
+                    throw std::out_of_range(value);
+            }
+        } catch (std::logic_error &) {
+            throw std::runtime_error("invalid sweep value for " + name + ": " + value);
+        }
+    }
+
+    // Why the current configuration can not run, or empty if it can.
+    std::string he_sweep_check()
+    {
+        if (he_lpbk_cfg_.AtomicFunc != HOSTEXE_ATOMIC_OFF) {
+            if (!he_lpbk_atomics_supported_)
+                return "skipped: no atomics";
+            if ((he_lpbk_cfg_.ReqLen != HOSTEXE_CLS_1) &&
+                (he_lpbk_cfg_.TestMode == HOST_EXEMODE_LPBK1))
+                return "skipped: atomic lpbk needs cl_1";
+        }
+        if ((he_lpbk_cfg_.Encoding != HOSTEXE_ENCODING_DEFAULT) && (he_lpbk_api_ver_ == 0))
+            return "skipped: no encoding";
+        if ((he_lpbk_cfg_.TputInterleave != 0) && (he_lpbk_cfg_.TestMode != HOST_EXEMODE_TRPUT))
+            return "skipped: interleave is trput only";
+        return "";
+    }
+
+    // One continuous mode run of the current configuration. Returns GB/s
+    // from the DSM counters, or a negative value when the run failed.
+    double he_sweep_run(uint32_t threads)
+    {
+        sweep_host_load load;
+        if (threads)
+            load.start(threads, {{source_->c_type(), source_->size()},
+                                 {destination_->c_type(), destination_->size()}});
+        int status = run_single_test();
+        load.stop();
+
+        volatile he_dsm_status *dsm_status =
+            reinterpret_cast<he_dsm_status *>((uint8_t*)dsm_->c_type());
+        if (status || !dsm_status->num_ticks)
+            return -1.0;
+        return he_num_xfers_to_bw(he_num_cache_lines(dsm_status->num_reads,
+                                                     dsm_status->num_writes),
+                                  dsm_status->num_ticks);
+    }
+
+    // Run every point of the sweep grid: warm-up runs are discarded and
+    // the measured repetitions give the mean and its confidence interval.
+    int run_sweep()
+    {
+        int status = 0;
+        auto base = he_lpbk_cfg_;
+
+        host_exe_->he_continuousmode_ = true;
+        if (sweep_spec_.duration)
+            host_exe_->he_contmodetime_ = sweep_spec_.duration;
+
+        sweep_grid grid(sweep_spec_.axes);
+        std::cout << "Sweeping " << grid.size() << " configurations, "
+                  << sweep_spec_.warmup << " warm-up and "
+                  << sweep_spec_.repetitions << " measured runs of "
+                  << host_exe_->he_contmodetime_ << " seconds each" << std::endl;
+
+        std::vector<sweep_result> results;
+        for (; !grid.done() && !g_he_exit; grid.next()) {
+            sweep_result r;
+            r.point = grid.point();
+
+            he_lpbk_cfg_ = base;
+            he_lpbk_cfg_.Continuous = 1;
+            uint32_t threads = 0;
+            for (auto &p : r.point)
+                he_sweep_apply(p.first, p.second, threads);
+
+            r.status = he_sweep_check();
+            if (r.status.empty()) {
+                std::vector<double> samples;
+                r.status = "ok";
+                for (uint32_t i = 0; i < sweep_spec_.warmup + sweep_spec_.repetitions; ++i) {
+                    double bw = he_sweep_run(threads);
+                    if (bw < 0.0) {
+                        r.status = "fail";
+                        status = -1;
+                        break;
+                    }
+                    if (i >= sweep_spec_.warmup)
+                        samples.push_back(bw);
+                }
+                // A failed point carries no numbers, like a skipped one.
+                if (r.status == "ok")
+                    r.gbps = sweep_stats(samples);
+            }
+            results.push_back(r);
+
+            std::cout << "  [" << results.size() << "/" << grid.size() << "]";
+            for (auto &p : r.point)
+                std::cout << " " << p.first << "=" << p.second;
+            if (r.status == "ok")
+                std::cout << ": " << std::fixed << std::setprecision(2)
+                          << r.gbps.mean << " +/- " << r.gbps.ci << " GB/s"
+                          << std::defaultfloat << std::endl;
+            else
+                std::cout << ": " << r.status << std::endl;
+        }
+        he_lpbk_cfg_ = base;
+
+        std::ofstream file;
+        if (!host_exe_->he_sweep_output_.empty()) {
+            file.open(host_exe_->he_sweep_output_);
+            if (!file) {
+                std::cerr << "Failed to open sweep output: "
+                          << host_exe_->he_sweep_output_ << std::endl;
+                return -1;
+            }
+        }
+        std::cout << std::endl;
+        write_sweep_results(file.is_open() ? file : std::cout,
+                            host_exe_->he_sweep_format_, results);
+
+        const sweep_result *peak = nullptr;
+        for (auto &r : results) {
+            if (r.status == "ok" && (!peak || r.gbps.mean > peak->gbps.mean))
+                peak = &r;
+        }
+        if (peak) {
+            std::cout << std::endl << "Peak throughput: " << std::fixed
+                      << std::setprecision(2) << peak->gbps.mean << " +/- "
+                      << peak->gbps.ci << " GB/s at";
+            for (auto &p : peak->point)
+                std::cout << " " << p.first << "=" << p.second;
+            std::cout << std::defaultfloat << std::endl;
+            host_exe_->report_metric("sweep_peak_gbps", peak->gbps.mean);
+        }
+        host_exe_->report_metric("sweep_points", results.size());
+
+        return status;
+    }
+
     virtual int run(test_afu *afu, CLI::App *app)
     {
         (void)app;
@@ -754,7 +1080,9 @@ public:
         d_afu->write64(HE_NUM_LINES, (LPBK1_BUFFER_SIZE / (1 * CL)) -1);
 
         int status = 0;
-        if (host_exe_->he_test_all_)
+        if (!host_exe_->he_sweep_.empty())
+            status = run_sweep();
+        else if (host_exe_->he_test_all_)
             status = run_all_tests();
         else
             status = run_single_test();
@@ -771,6 +1099,7 @@ protected:
     shared_buffer::ptr_t dsm_;
     he_interrupt0 he_interrupt_;
     token::ptr_t token_;
+    sweep_spec sweep_spec_;
     uint8_t he_lpbk_api_ver_;
     bool he_lpbk_atomics_supported_;
     bool is_ase_sim_;
@@ -0,0 +1,308 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cctype>
+#include <cmath>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opae/cxx/core/token.h>
+#include <opae/access.h>
+#include <opae/metrics.h>
+
+namespace host_exerciser {
+
+// One point of the soak time series.
+struct soak_sample {
+    double time;            // seconds since the start of the soak
+    uint64_t bytes;         // bytes moved during this interval
+    double gbps;            // instantaneous bandwidth
+    double rolling_gbps;    // bandwidth over the rolling window
+    const char *event;      // "", "regression" or "stall"
+};
+
+// Turns per-interval transfer counts into instantaneous and rolling
+// bandwidth, and flags intervals that regress against the window or
+// make no progress at all.
+class soak_monitor
+{
+public:
+    soak_monitor(uint32_t window, uint32_t regression_pct, uint32_t stall_limit)
+        : window_len_(window ? window : 1)
+        , regression_pct_(regression_pct)
+        , stall_limit_(stall_limit)
+        , win_bytes_(0)
+        , win_seconds_(0.0)
+        , total_bytes_(0)
+        , total_seconds_(0.0)
+        , min_gbps_(0.0)
+        , max_gbps_(0.0)
+        , samples_(0)
+        , regressions_(0)
+        , stalls_(0)
+        , consecutive_stalls_(0) {
+    }
+
+    soak_sample update(double time, double seconds, uint64_t bytes)
+    {
+        soak_sample s;
+        s.time = time;
+        s.bytes = bytes;
+        s.gbps = to_gbps(bytes, seconds);
+        s.event = "";
+
+        // Compare against the window before this interval joins it, and
+        // only once the window is full so that ramp-up is not flagged.
+        if (!bytes) {
+            s.event = "stall";
+            ++stalls_;
+            ++consecutive_stalls_;
+        } else {
+            consecutive_stalls_ = 0;
+            double baseline = to_gbps(win_bytes_, win_seconds_);
+            if (window_.size() >= window_len_ &&
+                s.gbps < baseline * (100 - regression_pct_) / 100.0) {
+                s.event = "regression";
+                ++regressions_;
+            }
+        }
+
+        window_.push_back(std::make_pair(bytes, seconds));
+        win_bytes_ += bytes;
+        win_seconds_ += seconds;
+        if (window_.size() > window_len_) {
+            win_bytes_ -= window_.front().first;
+            win_seconds_ -= window_.front().second;
+            window_.pop_front();
+        }
+        s.rolling_gbps = to_gbps(win_bytes_, win_seconds_);
+
+        if (!samples_ || s.gbps < min_gbps_)
+            min_gbps_ = s.gbps;
+        if (s.gbps > max_gbps_)
+            max_gbps_ = s.gbps;
+        total_bytes_ += bytes;
+        total_seconds_ += seconds;
+        ++samples_;
+        return s;
+    }
+
+    // True once stall_limit consecutive intervals made no progress.
+    bool stalled() const
+    {
+        return stall_limit_ && consecutive_stalls_ >= stall_limit_;
+    }
+
+    double mean_gbps() const { return to_gbps(total_bytes_, total_seconds_); }
+    double min_gbps() const { return min_gbps_; }
+    double max_gbps() const { return max_gbps_; }
+    uint32_t samples() const { return samples_; }
+    uint32_t regressions() const { return regressions_; }
+    uint32_t stalls() const { return stalls_; }
+
+private:
+    static double to_gbps(uint64_t bytes, double seconds)
+    {
+        return seconds > 0.0 ? bytes / seconds / 1e9 : 0.0;
+    }
+
+    size_t window_len_;
+    uint32_t regression_pct_;
+    uint32_t stall_limit_;
+    std::deque<std::pair<uint64_t, double>> window_;
+    uint64_t win_bytes_;
+    double win_seconds_;
+    uint64_t total_bytes_;
+    double total_seconds_;
+    double min_gbps_;
+    double max_gbps_;
+    uint32_t samples_;
+    uint32_t regressions_;
+    uint32_t stalls_;
+    uint32_t consecutive_stalls_;
+};
+
+// Power and thermal sensors of the FPGA device that hosts the
+// accelerator, read through the same metrics API as fpgainfo.
+class soak_telemetry
+{
+public:
+    soak_telemetry()
+        : handle_(nullptr) {
+    }
+
+    ~soak_telemetry()
+    {
+        if (handle_)
+            fpgaClose(handle_);
+    }
+
+    // Returns false when the device exposes no power or thermal metrics;
+    // the soak then runs without telemetry columns.
+    bool open(opae::fpga::types::token::ptr_t accelerator)
+    {
+        auto device = accelerator->get_parent();
+        if (!device)
+            return false;
+        if (fpgaOpen(device->c_type(), &handle_, FPGA_OPEN_SHARED) != FPGA_OK) {
+            handle_ = nullptr;
+            return false;
+        }
+
+        uint64_t num = 0;
+        if (fpgaGetNumMetrics(handle_, &num) != FPGA_OK || !num)
+            return false;
+        std::vector<fpga_metric_info> info(num);
+        if (fpgaGetMetricsInfo(handle_, info.data(), &num) != FPGA_OK)
+            return false;
+
+        for (uint64_t i = 0; i < num; ++i) {
+            if (info[i].metric_type != FPGA_METRIC_TYPE_POWER &&
+                info[i].metric_type != FPGA_METRIC_TYPE_THERMAL)
+                continue;
+            ids_.push_back(i);
+            types_.push_back(info[i].metric_datatype);
+            names_.push_back(column_name(info[i].metric_name,
+                                         info[i].metric_units));
+        }
+        values_.resize(ids_.size());
+        return !ids_.empty();
+    }
+
+    const std::vector<std::string> &names() const { return names_; }
+
+    // Invalid or unreadable sensors are reported as NaN.
+    const std::vector<double> &sample()
+    {
+        std::vector<fpga_metric> metrics(ids_.size());
+        bool ok = !ids_.empty() &&
+            fpgaGetMetricsByIndex(handle_, ids_.data(), ids_.size(),
+                                  metrics.data()) == FPGA_OK;
+        for (size_t i = 0; i < ids_.size(); ++i) {
+            values_[i] = NAN;
+            if (!ok || !metrics[i].isvalid)
+                continue;
+            switch (types_[i]) {
+            case FPGA_METRIC_DATATYPE_INT:
+                values_[i] = metrics[i].value.ivalue;
+                break;
+            case FPGA_METRIC_DATATYPE_FLOAT:
+                values_[i] = metrics[i].value.fvalue;
+                break;
+            case FPGA_METRIC_DATATYPE_DOUBLE:
+                values_[i] = metrics[i].value.dvalue;
+                break;
+            case FPGA_METRIC_DATATYPE_BOOL:
+                values_[i] = metrics[i].value.bvalue;
+                break;
+            default:
+                break;
+            }
+        }
+        return values_;
+    }
+
+    // "FPGA Core Temperature", "Celsius" -> "fpga_core_temperature_celsius"
+    static std::string column_name(const std::string &name,
+                                   const std::string &units)
+    {
+        std::string col;
+        for (auto c : name + " " + units) {
+            if (std::isalnum(static_cast<unsigned char>(c)))
+                col += std::tolower(static_cast<unsigned char>(c));
+            else if (!col.empty() && col.back() != '_')
+                col += '_';
+        }
+        while (!col.empty() && col.back() == '_')
+            col.pop_back();
+        return col;
+    }
+
+private:
+    fpga_handle handle_;
+    std::vector<uint64_t> ids_;
+    std::vector<enum fpga_metric_datatype> types_;
+    std::vector<std::string> names_;
+    std::vector<double> values_;
+};
+
+// Streams the soak time series as CSV or as JSON lines, one object per
+// sample, flushing each record so that it can be followed live.
+class soak_writer
+{
+public:
+    soak_writer(std::ostream &os, bool json, const std::vector<std::string> &columns)
+        : os_(os)
+        , json_(json)
+        , columns_(columns) {
+        if (json_)
+            return;
+        os_ << "time_s,bytes,gbps,rolling_gbps,event";
+        for (auto &c : columns_)
+            os_ << "," << c;
+        os_ << std::endl;
+    }
+
+    void write(const soak_sample &s, const std::vector<double> &values)
+    {
+        if (json_) {
+            os_ << "{\"time_s\": " << s.time
+                << ", \"bytes\": " << s.bytes
+                << ", \"gbps\": " << s.gbps
+                << ", \"rolling_gbps\": " << s.rolling_gbps
+                << ", \"event\": \"" << s.event << "\"";
+            for (size_t i = 0; i < columns_.size() && i < values.size(); ++i) {
+                os_ << ", \"" << columns_[i] << "\": ";
+                if (std::isnan(values[i]))
+                    os_ << "null";
+                else
+                    os_ << values[i];
+            }
+            os_ << "}" << std::endl;
+            return;
+        }
+
+        os_ << s.time << "," << s.bytes << "," << s.gbps << ","
+            << s.rolling_gbps << "," << s.event;
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            os_ << ",";
+            if (i < values.size() && !std::isnan(values[i]))
+                os_ << values[i];
+        }
+        os_ << std::endl;
+    }
+
+private:
+    std::ostream &os_;
+    bool json_;
+    std::vector<std::string> columns_;
+};
+
+} // end of namespace host_exerciser
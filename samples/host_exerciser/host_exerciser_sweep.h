@@ -0,0 +1,357 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <json-c/json.h>
+
+namespace host_exerciser {
+
+// Sweep parameters, in the order they vary in the results matrix
+// (the last one varies fastest).
+const std::vector<std::string> sweep_parameters = {
+    "mode", "cls", "interleave", "encoding", "delay", "atomic", "threads"
+};
+
+struct sweep_axis {
+    std::string name;
+    std::vector<std::string> values;
+};
+
+// A sweep spec is a JSON object such as
+//
+//   {
+//     "warmup": 1,
+//     "repetitions": 5,
+//     "duration": 2,
+//     "parameters": {
+//       "mode": ["read", "write", "trput"],
+//       "cls": ["cl_1", "cl_2", "cl_4", "cl_8"],
+//       "interleave": [0, 1, 2],
+//       "threads": [0, 4]
+//     }
+//   }
+//
+// Parameters left out keep their command line value; a parameter may
+// also be given as a single value instead of a list.
+struct sweep_spec {
+    sweep_spec()
+        : warmup(1)
+        , repetitions(3)
+        , duration(0) {
+    }
+
+    uint32_t warmup;
+    uint32_t repetitions;
+    uint32_t duration;      // seconds per run, 0 keeps --contmodetime
+    std::vector<sweep_axis> axes;
+};
+
+inline std::string sweep_value_string(json_object *value)
+{
+    if (json_object_is_type(value, json_type_string))
+        return json_object_get_string(value);
+    if (json_object_is_type(value, json_type_boolean))
+        return json_object_get_boolean(value) ? "true" : "false";
+    if (json_object_is_type(value, json_type_int))
+        return std::to_string(json_object_get_int(value));
+    throw std::runtime_error("sweep values must be strings, integers or booleans");
+}
+
+inline uint32_t sweep_uint(json_object *root, const char *key, uint32_t def)
+{
+    json_object *value = nullptr;
+    if (!json_object_object_get_ex(root, key, &value))
+        return def;
+    if (!json_object_is_type(value, json_type_int) || json_object_get_int(value) < 0)
+        throw std::runtime_error(std::string("sweep ") + key +
+                                 " must be a non-negative integer");
+    return json_object_get_int(value);
+}
+
+inline sweep_spec parse_sweep_spec(const std::string &path)
+{
+    std::unique_ptr<json_object, int (*)(json_object *)> root(
+        json_object_from_file(path.c_str()), json_object_put);
+    if (!root || !json_object_is_type(root.get(), json_type_object))
+        throw std::runtime_error("could not parse sweep spec " + path);
+
+    sweep_spec spec;
+    spec.warmup = sweep_uint(root.get(), "warmup", spec.warmup);
+    spec.repetitions = sweep_uint(root.get(), "repetitions", spec.repetitions);
+    spec.duration = sweep_uint(root.get(), "duration", spec.duration);
+    if (!spec.repetitions)
+        throw std::runtime_error("sweep repetitions must be at least 1");
+
+    json_object *params = nullptr;
+    if (!json_object_object_get_ex(root.get(), "parameters", &params) ||
+        !json_object_is_type(params, json_type_object))
+        throw std::runtime_error("sweep spec has no parameters object");
+
+    json_object_object_foreach(params, key, val) {
+        (void)val;
+        if (std::find(sweep_parameters.begin(), sweep_parameters.end(), key) ==
+            sweep_parameters.end())
+            throw std::runtime_error(std::string("unknown sweep parameter: ") + key);
+    }
+
+    for (auto &name : sweep_parameters) {
+        json_object *value = nullptr;
+        if (!json_object_object_get_ex(params, name.c_str(), &value))
+            continue;
+        sweep_axis axis;
+        axis.name = name;
+        if (json_object_is_type(value, json_type_array)) {
+            for (size_t i = 0; i < json_object_array_length(value); ++i)
+                axis.values.push_back(
+                    sweep_value_string(json_object_array_get_idx(value, i)));
+        } else {
+            axis.values.push_back(sweep_value_string(value));
+        }
+        if (axis.values.empty())
+            throw std::runtime_error("sweep parameter " + name + " has no values");
+        spec.axes.push_back(axis);
+    }
+    return spec;
+}
+
+// Enumerates every point of the grid, odometer style.
+class sweep_grid
+{
+public:
+    explicit sweep_grid(const std::vector<sweep_axis> &axes)
+        : axes_(axes)
+        , index_(axes.size(), 0)
+        , done_(false) {
+    }
+
+    size_t size() const
+    {
+        size_t n = 1;
+        for (auto &a : axes_)
+            n *= a.values.size();
+        return n;
+    }
+
+    bool done() const { return done_; }
+
+    std::vector<std::pair<std::string, std::string>> point() const
+    {
+        std::vector<std::pair<std::string, std::string>> p;
+        for (size_t i = 0; i < axes_.size(); ++i)
+            p.push_back(std::make_pair(axes_[i].name, axes_[i].values[index_[i]]));
+        return p;
+    }
+
+    void next()
+    {
+        for (size_t i = axes_.size(); i-- > 0;) {
+            if (++index_[i] < axes_[i].values.size())
+                return;
+            index_[i] = 0;
+        }
+        done_ = true;
+    }
+
+private:
+    std::vector<sweep_axis> axes_;
+    std::vector<size_t> index_;
+    bool done_;
+};
+
+// Mean, sample standard deviation and the half width of the two-sided
+// 95% confidence interval of the mean (Student's t).
+struct sweep_stats {
+    sweep_stats()
+        : n(0), mean(0.0), stddev(0.0), ci(0.0), min(0.0), max(0.0) {
+    }
+
+    explicit sweep_stats(const std::vector<double> &v)
+        : sweep_stats() {
+        n = v.size();
+        if (!n)
+            return;
+        min = max = v[0];
+        for (auto x : v) {
+            mean += x;
+            min = std::min(min, x);
+            max = std::max(max, x);
+        }
+        mean /= n;
+        if (n < 2)
+            return;
+        double ss = 0.0;
+        for (auto x : v)
+            ss += (x - mean) * (x - mean);
+        stddev = std::sqrt(ss / (n - 1));
+        ci = t_975(n - 1) * stddev / std::sqrt(static_cast<double>(n));
+    }
+
+    static double t_975(size_t df)
+    {
+        static const double t[] = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+        };
+        if (!df)
+            return 0.0;
+        return df <= 30 ? t[df - 1] : 1.960;
+    }
+
+    size_t n;
+    double mean;
+    double stddev;
+    double ci;
+    double min;
+    double max;
+};
+
+struct sweep_result {
+    std::vector<std::pair<std::string, std::string>> point;
+    std::string status;     // "ok", "fail" or why the point was skipped
+    sweep_stats gbps;
+};
+
+// Host threads that keep reading the data buffers while the AFU runs,
+// so that bandwidth can be measured under host memory contention.
+// Only reads are issued: the buffers stay valid for the AFU.
+class sweep_host_load
+{
+public:
+    sweep_host_load()
+        : stop_(false) {
+    }
+
+    ~sweep_host_load() { stop(); }
+
+    void start(uint32_t threads,
+               const std::vector<std::pair<const volatile uint8_t *, size_t>> &buffers)
+    {
+        stop_ = false;
+        for (uint32_t t = 0; t < threads; ++t) {
+            threads_.emplace_back([this, buffers, t]() {
+                uint64_t sink = 0;
+                while (!stop_.load(std::memory_order_relaxed)) {
+                    for (auto &b : buffers) {
+                        auto p = reinterpret_cast<const volatile uint64_t *>(b.first);
+                        // Start each thread at a different line.
+                        for (size_t i = t * 8; i < b.second / 8; i += 8)
+                            sink += p[i];
+                    }
+                }
+                (void)sink;
+            });
+        }
+    }
+
+    void stop()
+    {
+        stop_ = true;
+        for (auto &t : threads_)
+            t.join();
+        threads_.clear();
+    }
+
+private:
+    std::atomic<bool> stop_;
+    std::vector<std::thread> threads_;
+};
+
+inline void write_sweep_results(std::ostream &os, const std::string &format,
+                                const std::vector<sweep_result> &results)
+{
+    if (results.empty())
+        return;
+    auto &names = results[0].point;
+
+    if (format == "json") {
+        os << "[";
+        for (size_t i = 0; i < results.size(); ++i) {
+            auto &r = results[i];
+            os << (i ? ",\n " : "") << "{";
+            for (auto &p : r.point)
+                os << "\"" << p.first << "\": \"" << p.second << "\", ";
+            os << "\"status\": \"" << r.status << "\""
+               << ", \"n\": " << r.gbps.n
+               << ", \"mean_gbps\": " << r.gbps.mean
+               << ", \"stddev_gbps\": " << r.gbps.stddev
+               << ", \"ci95_low_gbps\": " << r.gbps.mean - r.gbps.ci
+               << ", \"ci95_high_gbps\": " << r.gbps.mean + r.gbps.ci
+               << ", \"min_gbps\": " << r.gbps.min
+               << ", \"max_gbps\": " << r.gbps.max << "}";
+        }
+        os << "]" << std::endl;
+        return;
+    }
+
+    if (format == "csv") {
+        for (auto &p : names)
+            os << p.first << ",";
+        os << "status,n,mean_gbps,stddev_gbps,ci95_low_gbps,ci95_high_gbps,"
+              "min_gbps,max_gbps" << std::endl;
+        for (auto &r : results) {
+            for (auto &p : r.point)
+                os << p.second << ",";
+            os << r.status << "," << r.gbps.n << "," << r.gbps.mean << ","
+               << r.gbps.stddev << "," << r.gbps.mean - r.gbps.ci << ","
+               << r.gbps.mean + r.gbps.ci << "," << r.gbps.min << ","
+               << r.gbps.max << std::endl;
+        }
+        return;
+    }
+
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os.setf(std::ios::fixed);
+    os.precision(2);
+    for (auto &p : names)
+        os << std::left << std::setw(12) << p.first;
+    os << std::right << std::setw(10) << "GB/s" << std::setw(10) << "+/-"
+       << std::setw(10) << "min" << std::setw(10) << "max" << "  status" << std::endl;
+    for (auto &r : results) {
+        for (auto &p : r.point)
+            os << std::left << std::setw(12) << p.second;
+        os << std::right << std::setw(10) << r.gbps.mean
+           << std::setw(10) << r.gbps.ci << std::setw(10) << r.gbps.min
+           << std::setw(10) << r.gbps.max << "  " << r.status << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+} // end of namespace host_exerciser
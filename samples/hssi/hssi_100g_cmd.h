@@ -25,6 +25,7 @@
 // POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 #include "hssi_cmd.h"
+#include "hssi_stats.h"
 #include <cmath>
 
 #define CSR_SCRATCH               0x1000
@@ -84,6 +85,9 @@ public:
     , end_select_("pkt_num")
     , continuous_("off")
     , contmonitor_(0)
+    , stats_interval_(0)
+    , stats_duty_(10)
+    , stats_depth_(65536)
   {}
 
   virtual const char *name() const override
@@ -149,6 +153,21 @@ public:
     opt = app->add_option("--contmonitor", contmonitor_,
                           "time period(in seconds) for performance monitor");
     opt->default_str(std::to_string(contmonitor_));
+
+    opt = app->add_option("--stats-interval", stats_interval_,
+                          "statistics sampling interval in usec, 0 to disable");
+    opt->default_str(std::to_string(stats_interval_));
+
+    opt = app->add_option("--stats-duty", stats_duty_,
+                          "maximum percent of time spent sampling statistics");
+    opt->check(CLI::Range(1, 100))->default_str(std::to_string(stats_duty_));
+
+    opt = app->add_option("--stats-depth", stats_depth_,
+                          "number of statistics samples kept for export");
+    opt->check(CLI::PositiveNumber)->default_str(std::to_string(stats_depth_));
+
+    app->add_option("--stats-output", stats_output_,
+                    "statistics CSV file");
   }
 
   uint64_t timestamp_in_seconds(uint64_t x) const
@@ -200,10 +219,18 @@ public:
 
   void read_performance(perf_data *perf, hssi_afu *hafu) const
   {
-    perf->tx_count = data_64(hafu->mbox_read(CSR_STATS_TX_CNT_LO), hafu->mbox_read(CSR_STATS_TX_CNT_HI));
-    perf->rx_count = data_64(hafu->mbox_read(CSR_STATS_RX_CNT_LO), hafu->mbox_read(CSR_STATS_RX_CNT_HI));
-    perf->rx_good_packet_count = data_64(hafu->mbox_read(CSR_STATS_RX_GD_CNT_LO), hafu->mbox_read(CSR_STATS_RX_GD_CNT_HI));
-    perf->rx_pkt_sec = data_64(hafu->mbox_read(CSR_RX_END_TIMESTAMP_LO), hafu->mbox_read(CSR_RX_END_TIMESTAMP_HI));
+    const uint16_t offsets[] = {
+      CSR_STATS_TX_CNT_LO, CSR_STATS_TX_CNT_HI,
+      CSR_STATS_RX_CNT_LO, CSR_STATS_RX_CNT_HI,
+      CSR_STATS_RX_GD_CNT_LO, CSR_STATS_RX_GD_CNT_HI,
+      CSR_RX_END_TIMESTAMP_LO, CSR_RX_END_TIMESTAMP_HI
+    };
+    uint32_t values[8];
+    hafu->mbox_read_batch(offsets, values, 8);
+    perf->tx_count = data_64(values[0], values[1]);
+    perf->rx_count = data_64(values[2], values[3]);
+    perf->rx_good_packet_count = data_64(values[4], values[5]);
+    perf->rx_pkt_sec = data_64(values[6], values[7]);
   }
 
   void calc_performance(perf_data *old_perf, perf_data *new_perf, perf_data *perf, uint64_t size) const
@@ -291,7 +318,7 @@ public:
   void select_port(int port, ctrl_config config_data, hssi_afu *hafu) const
   {
     /* Selects the port before performing read/write to traffic controller reg space */
-    hafu->write64(TRAFFIC_CTRL_PORT_SEL, port);
+    hafu->write_port_sel(port);
     write_ctrl_config(hafu, config_data);
     write_csr_addr(hafu, mac_bits_for(src_addr_), mac_bits_for(dest_addr_));
   }
@@ -299,6 +326,7 @@ public:
   void capture_perf(perf_data *old_perf_data, hssi_afu *hafu) const
   {
     memset(old_perf_data, 0, sizeof(perf_data));
+    auto lock = hafu->lock_mbox();
     if (stall_enable(hafu))
     {
       read_performance(old_perf_data, hafu);
@@ -428,7 +456,7 @@ public:
     DFH dfh;
     dfh.csr = hafu->read64(ETH_AFU_DFH);
 
-    hafu->write64(TRAFFIC_CTRL_PORT_SEL, port_[0]);
+    hafu->write_port_sel(port_[0]);
     hafu->mbox_write(CSR_CTRL1, STOP_BITS);
 
     uint32_t reg;
@@ -484,6 +512,8 @@ public:
     if(port_.size() > 1) // Supporting for 2nd port register setting
       select_port(port_[1], config_data, hafu);
 
+    stats_guard stats(this, hafu);
+
     volatile uint32_t count;
     const uint64_t interval = 100ULL;
     do
@@ -577,6 +607,60 @@ public:
     return test_afu::success;
   }
 
+  // Samples the statistics of all ports in the background for the
+  // lifetime of the test, then exports and summarizes them.
+  class stats_guard
+  {
+  public:
+    stats_guard(hssi_100g_cmd *cmd, hssi_afu *hafu)
+    : cmd_(cmd)
+    , hafu_(hafu)
+    {
+      if (!cmd_->stats_interval_)
+        return;
+      const std::vector<hssi_counter> counters = {
+        { "tx_count", CSR_STATS_TX_CNT_LO, CSR_STATS_TX_CNT_HI },
+        { "rx_count", CSR_STATS_RX_CNT_LO, CSR_STATS_RX_CNT_HI },
+        { "rx_good_count", CSR_STATS_RX_GD_CNT_LO, CSR_STATS_RX_GD_CNT_HI }
+      };
+      collector_.reset(new hssi_stats_collector(hafu_, cmd_->port_, counters,
+                                                cmd_->stats_depth_));
+      collector_->set_freeze(CSR_STATS_CTRL, 1 << 1);
+      collector_->start(cmd_->stats_interval_, cmd_->stats_duty_);
+    }
+
+    ~stats_guard()
+    {
+      if (!collector_)
+        return;
+      collector_->stop();
+
+      if (!cmd_->stats_output_.empty()) {
+        std::ofstream out(cmd_->stats_output_);
+        if (out.is_open())
+          collector_->export_csv(out);
+        else
+          std::cerr << "could not open " << cmd_->stats_output_ << std::endl;
+      }
+
+      std::cout << "statistics: " << collector_->sweeps() << " sweeps, "
+                << collector_->sweep_usec_mean() << " usec mean, "
+                << collector_->sweep_usec_max() << " usec max, "
+                << collector_->overruns() << " overruns, "
+                << collector_->ring().dropped() << " dropped" << std::endl;
+
+      hafu_->report_metric("stats_sweeps", collector_->sweeps());
+      hafu_->report_metric("stats_sweep_us_mean", collector_->sweep_usec_mean());
+      hafu_->report_metric("stats_sweep_us_max", collector_->sweep_usec_max());
+      hafu_->report_metric("stats_overruns", collector_->overruns());
+    }
+
+  private:
+    hssi_100g_cmd *cmd_;
+    hssi_afu *hafu_;
+    std::unique_ptr<hssi_stats_collector> collector_;
+  };
+
   virtual const char *afu_id() const override
   {
     return "43425ee6-92b2-4742-b03a-bd8d4a533812";
@@ -643,4 +727,8 @@ protected:
   std::string end_select_;
   std::string continuous_;
   uint32_t contmonitor_;
+  uint32_t stats_interval_;
+  uint32_t stats_duty_;
+  uint32_t stats_depth_;
+  std::string stats_output_;
 };
@@ -282,8 +282,13 @@ public:
                 << "\tAchieved Tx throughput : " << achieved_tx_tput_gbps << " GB/s" << std::endl;
       if (eth_loopback_ == "on") {
         std::cout << "\tAchieved Rx throughput : " << achieved_rx_tput_gbps << " GB/s" << std::endl;
+        hafu->report_metric("rx_throughput_gbps", achieved_rx_tput_gbps);
       }
       std::cout << std::endl;
+
+      hafu->report_metric("latency_min_ns", latency_min_ns);
+      hafu->report_metric("latency_max_ns", latency_max_ns);
+      hafu->report_metric("tx_throughput_gbps", achieved_tx_tput_gbps);
     }
 
     if (eth_ifc == "") {
@@ -28,6 +28,7 @@
 #include <string>
 #include <sstream>
 #include <exception>
+#include <mutex>
 #include <glob.h>
 #include <time.h>
 #include "afu_test.h"
@@ -50,6 +51,10 @@ using namespace opae::fpga::types;
 #define WRITE_DATA_SHIFT      32
 
 #define NO_TIMEOUT            0xffffffffffffffffULL
+#define MBOX_SPIN_POLLS       1000
+
+using traffic_ctrl_cmd = csr<uint64_t, TRAFFIC_CTRL_CMD>;
+using traffic_ctrl_data = csr<uint64_t, TRAFFIC_CTRL_DATA>;
 
 class hssi_afu : public test_afu {
 public:
@@ -117,113 +122,126 @@ public:
     return std::string("");
   }
 
+  // Mailbox accesses, and the port selection they depend on, come from
+  // both the test and the statistics collector thread.
+  std::unique_lock<std::recursive_mutex> lock_mbox()
+  {
+    return std::unique_lock<std::recursive_mutex>(mbox_lock_);
+  }
+
+  void write_port_sel(uint64_t port)
+  {
+    auto lock = lock_mbox();
+    write64(TRAFFIC_CTRL_PORT_SEL, port);
+  }
+
   void mbox_write(uint16_t offset, uint32_t data)
   {
-    volatile uint8_t *mmio_base = handle_->mmio_ptr(0);
+    auto lock = lock_mbox();
+    mmio_region mmio(handle_);
 
     uint64_t val;
-    struct timespec ts;
-    uint64_t ticks;
-    const uint64_t max_ticks = 10000ULL;
 
     val = (((uint64_t)data) << WRITE_DATA_SHIFT);
-    *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_DATA)) = val;
+    mmio.write<traffic_ctrl_data>(val);
 
     val = (((uint64_t)offset) << AFU_CMD_SHIFT) | WRITE_CMD;
-    *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD)) = val;
-
-    ticks = max_ticks;
-    ts.tv_sec = 0;
-    ts.tv_nsec = 100;
-    do
-    {
-        val = *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD));
-        if (val & ACK_TRANS)
-            break;
-        if (nanosleep(&ts, NULL) != -1 &&
-            ticks != NO_TIMEOUT) {
-            if (!ticks) {
-                const char *msg = "mbox_write timed out [a]";
-                std::cerr << msg << std::endl;
-                throw std::runtime_error(msg);
-            }
-            --ticks;
-        }
-    } while (!(val & ACK_TRANS));
+    mmio.write<traffic_ctrl_cmd>(val);
 
-    ticks = max_ticks;
-    do
-    {
-        *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD)) = ACK_TRANS;
-        val = *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD));
-        if (!(val & ACK_TRANS))
-            break;
-        if (nanosleep(&ts, NULL) != -1 &&
-            ticks != NO_TIMEOUT) {
-            if (!ticks) {
-                const char *msg = "mbox_write timed out [b]";
-                std::cerr << msg << std::endl;
-                throw std::runtime_error(msg);
-            }
-            --ticks;
-        }
-    } while (val & ACK_TRANS); 
+    mbox_wait_ack(mmio, "mbox_write timed out [a]");
+    mbox_clear_ack(mmio, "mbox_write timed out [b]");
   }
 
   uint32_t mbox_read(uint16_t offset)
   {
-    volatile uint8_t *mmio_base = handle_->mmio_ptr(0);
     uint32_t res = 0;
+    mbox_read_batch(&offset, &res, 1);
+    return res;
+  }
+
+  // Read several mailbox registers under one lock and one mapping.
+  void mbox_read_batch(const uint16_t *offsets, uint32_t *values, size_t count)
+  {
+    auto lock = lock_mbox();
+    mmio_region mmio(handle_);
+
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t val = (((uint64_t)offsets[i]) << AFU_CMD_SHIFT) | READ_CMD;
+      mmio.write<traffic_ctrl_cmd>(val);
+
+      mbox_wait_ack(mmio, "mbox_read timed out [a]");
+      values[i] = (uint32_t)mmio.read<traffic_ctrl_data>();
+      mbox_clear_ack(mmio, "mbox_read timed out [b]");
+    }
+  }
+
+private:
+  // The acknowledge normally turns around within a few register reads,
+  // so poll before falling back to sleeping: a 100 ns nanosleep() costs
+  // tens of microseconds of timer slack.
+  void mbox_wait_ack(const mmio_region &mmio, const char *msg) const
+  {
+    for (uint32_t i = 0; i < MBOX_SPIN_POLLS; ++i) {
+      if (mmio.read<traffic_ctrl_cmd>() & ACK_TRANS)
+        return;
+    }
 
     uint64_t val;
     struct timespec ts;
     uint64_t ticks;
     const uint64_t max_ticks = 10000ULL;
 
-    val = (((uint64_t)offset) << AFU_CMD_SHIFT) | READ_CMD;
-    *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD)) = val;
-
     ticks = max_ticks;
     ts.tv_sec = 0;
     ts.tv_nsec = 100;
     do
     {
-        val = *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD));
+        val = mmio.read<traffic_ctrl_cmd>();
         if (val & ACK_TRANS)
             break;
         if (nanosleep(&ts, NULL) != -1 &&
             ticks != NO_TIMEOUT) {
             if (!ticks) {
-                const char *msg = "mbox_read timed out [a]";
                 std::cerr << msg << std::endl;
                 throw std::runtime_error(msg);
             }
             --ticks;
         }
     } while (!(val & ACK_TRANS));
+  }
+
+  void mbox_clear_ack(const mmio_region &mmio, const char *msg) const
+  {
+    for (uint32_t i = 0; i < MBOX_SPIN_POLLS; ++i) {
+      mmio.write<traffic_ctrl_cmd>(ACK_TRANS);
+      if (!(mmio.read<traffic_ctrl_cmd>() & ACK_TRANS))
+        return;
+    }
 
-    val = *(volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_DATA);
-    res = (uint32_t)val;
+    uint64_t val;
+    struct timespec ts;
+    uint64_t ticks;
+    const uint64_t max_ticks = 10000ULL;
 
     ticks = max_ticks;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 100;
     do
     {
-        *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD)) = ACK_TRANS;
-        val = *((volatile uint64_t *)(mmio_base + TRAFFIC_CTRL_CMD));
+        mmio.write<traffic_ctrl_cmd>(ACK_TRANS);
+        val = mmio.read<traffic_ctrl_cmd>();
         if (!(val & ACK_TRANS))
             break;
         if (nanosleep(&ts, NULL) != -1 &&
             ticks != NO_TIMEOUT) {
             if (!ticks) {
-                const char *msg = "mbox_read timed out [b]";
                 std::cerr << msg << std::endl;
                 throw std::runtime_error(msg);
             }
             --ticks;
         }
     } while (val & ACK_TRANS);
-
-    return res;
   }
 
+  std::recursive_mutex mbox_lock_;
 };
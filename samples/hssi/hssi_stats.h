@@ -0,0 +1,329 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "hssi_afu.h"
+
+#define HSSI_STATS_MAX_COUNTERS 8
+
+// A traffic controller counter: one mailbox register, or a lo/hi pair
+// for 64-bit counters.
+struct hssi_counter {
+  const char *name;
+  uint16_t lo;
+  uint16_t hi;    // 0 for 32-bit counters
+};
+
+// The counters of one port from one sweep. The time is the start of
+// the sweep, so all ports of a sweep share it.
+struct hssi_stats_sample {
+  uint64_t time_ns;
+  uint32_t sweep_ns;
+  int port;
+  uint64_t values[HSSI_STATS_MAX_COUNTERS];
+};
+
+// Fixed capacity record of samples; once full, the oldest samples are
+// overwritten and counted as dropped.
+class hssi_stats_ring
+{
+public:
+  explicit hssi_stats_ring(size_t capacity)
+  : samples_(capacity ? capacity : 1)
+  , head_(0)
+  , size_(0)
+  , dropped_(0)
+  {}
+
+  void push(const hssi_stats_sample &s)
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    samples_[head_] = s;
+    head_ = (head_ + 1) % samples_.size();
+    if (size_ < samples_.size())
+      ++size_;
+    else
+      ++dropped_;
+  }
+
+  // The recorded samples, oldest first.
+  std::vector<hssi_stats_sample> snapshot() const
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::vector<hssi_stats_sample> v;
+    v.reserve(size_);
+    size_t first = (head_ + samples_.size() - size_) % samples_.size();
+    for (size_t i = 0; i < size_; ++i)
+      v.push_back(samples_[(first + i) % samples_.size()]);
+    return v;
+  }
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    return size_;
+  }
+
+  uint64_t dropped() const
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    return dropped_;
+  }
+
+private:
+  mutable std::mutex lock_;
+  std::vector<hssi_stats_sample> samples_;
+  size_t head_;
+  size_t size_;
+  uint64_t dropped_;
+};
+
+// Samples the traffic controller counters of several ports from a
+// background thread. Each sweep selects every port in turn, freezes its
+// counters (when the controller has a freeze bit) and reads them all
+// in one mailbox batch. The sweep rate is bounded by both the interval
+// and a duty cycle, so that the collector never holds the mailbox for
+// more than duty percent of the time.
+//
+// Afu provides the mailbox: lock_mbox(), read64(), write64(),
+// mbox_read(), mbox_write() and mbox_read_batch(), as hssi_afu does.
+template <typename Afu>
+class basic_hssi_stats_collector
+{
+public:
+  basic_hssi_stats_collector(Afu *hafu,
+                             const std::vector<int> &ports,
+                             const std::vector<hssi_counter> &counters,
+                             size_t capacity)
+  : hafu_(hafu)
+  , ports_(ports)
+  , counters_(counters)
+  , ring_(capacity)
+  , freeze_ctrl_(0)
+  , freeze_bit_(0)
+  , stop_(false)
+  , sweeps_(0)
+  , overruns_(0)
+  , sweep_ns_total_(0)
+  , sweep_ns_max_(0)
+  {
+    if (counters_.size() > HSSI_STATS_MAX_COUNTERS)
+      throw std::invalid_argument("too many hssi counters");
+    for (auto &c : counters_) {
+      offsets_.push_back(c.lo);
+      if (c.hi)
+        offsets_.push_back(c.hi);
+    }
+    values_.resize(offsets_.size());
+  }
+
+  ~basic_hssi_stats_collector()
+  {
+    stop();
+  }
+
+  // Freeze the counters by setting bit of ctrl around the reads.
+  void set_freeze(uint16_t ctrl, uint32_t bit)
+  {
+    freeze_ctrl_ = ctrl;
+    freeze_bit_ = bit;
+  }
+
+  void start(uint32_t interval_usec, uint32_t duty_pct)
+  {
+    stop_ = false;
+    thread_ = std::thread(&basic_hssi_stats_collector::collect, this,
+                          std::chrono::microseconds(interval_usec),
+                          duty_pct ? duty_pct : 1);
+  }
+
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(wait_lock_);
+      stop_ = true;
+    }
+    wait_.notify_all();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  // Read all ports once, restoring the port selection afterwards.
+  void sweep()
+  {
+    using namespace std::chrono;
+    auto lock = hafu_->lock_mbox();
+    auto start = steady_clock::now();
+    uint64_t port_sel = hafu_->read64(TRAFFIC_CTRL_PORT_SEL);
+
+    std::vector<hssi_stats_sample> samples(ports_.size());
+    for (size_t p = 0; p < ports_.size(); ++p) {
+      hafu_->write64(TRAFFIC_CTRL_PORT_SEL, ports_[p]);
+      uint32_t ctrl = 0;
+      if (freeze_bit_) {
+        ctrl = hafu_->mbox_read(freeze_ctrl_);
+        hafu_->mbox_write(freeze_ctrl_, ctrl | freeze_bit_);
+      }
+      hafu_->mbox_read_batch(offsets_.data(), values_.data(), offsets_.size());
+      if (freeze_bit_)
+        hafu_->mbox_write(freeze_ctrl_, ctrl & ~freeze_bit_);
+
+      auto &s = samples[p];
+      s.port = ports_[p];
+      size_t v = 0;
+      for (size_t c = 0; c < counters_.size(); ++c) {
+        s.values[c] = values_[v++];
+        if (counters_[c].hi)
+          s.values[c] |= (uint64_t)values_[v++] << 32;
+      }
+    }
+
+    hafu_->write64(TRAFFIC_CTRL_PORT_SEL, port_sel);
+    lock.unlock();
+
+    auto end = steady_clock::now();
+    uint64_t time_ns = duration_cast<nanoseconds>(start.time_since_epoch()).count();
+    uint64_t sweep_ns = duration_cast<nanoseconds>(end - start).count();
+    for (auto &s : samples) {
+      s.time_ns = time_ns;
+      s.sweep_ns = sweep_ns;
+      ring_.push(s);
+    }
+    ++sweeps_;
+    sweep_ns_total_ += sweep_ns;
+    if (sweep_ns > sweep_ns_max_)
+      sweep_ns_max_ = sweep_ns;
+  }
+
+  const hssi_stats_ring &ring() const { return ring_; }
+  uint64_t sweeps() const { return sweeps_; }
+  uint64_t overruns() const { return overruns_; }
+  double sweep_usec_mean() const
+  {
+    return sweeps_ ? sweep_ns_total_ / 1000.0 / sweeps_ : 0.0;
+  }
+  double sweep_usec_max() const { return sweep_ns_max_ / 1000.0; }
+
+  // Write the recorded samples as CSV, with per second rates of every
+  // counter computed against the previous sample of the same port.
+  void export_csv(std::ostream &os) const
+  {
+    export_csv(os, ring_.snapshot());
+  }
+
+  // Write the given samples, oldest first, as export_csv() does.
+  void export_csv(std::ostream &os,
+                  const std::vector<hssi_stats_sample> &samples) const
+  {
+    os << "time_s,sweep_us,port";
+    for (auto &c : counters_)
+      os << "," << c.name;
+    for (auto &c : counters_)
+      os << "," << c.name << "_per_s";
+    os << "\n";
+
+    std::vector<const hssi_stats_sample *> prev(ports_.size(), nullptr);
+    uint64_t t0 = samples.empty() ? 0 : samples[0].time_ns;
+    for (auto &s : samples) {
+      size_t p = 0;
+      while (p < ports_.size() && ports_[p] != s.port)
+        ++p;
+      os << (s.time_ns - t0) / 1e9 << "," << s.sweep_ns / 1e3 << "," << s.port;
+      for (size_t c = 0; c < counters_.size(); ++c)
+        os << "," << s.values[c];
+      for (size_t c = 0; c < counters_.size(); ++c) {
+        os << ",";
+        if (p < prev.size() && prev[p] && s.time_ns > prev[p]->time_ns) {
+          // 32-bit counters wrap at 2^32, not 2^64.
+          uint64_t delta = s.values[c] - prev[p]->values[c];
+          if (!counters_[c].hi)
+            delta &= 0xffffffff;
+          os << (double)delta * 1e9 / (s.time_ns - prev[p]->time_ns);
+        }
+      }
+      os << "\n";
+      if (p < prev.size())
+        prev[p] = &s;
+    }
+    os.flush();
+  }
+
+private:
+  void collect(std::chrono::microseconds interval, uint32_t duty_pct)
+  {
+    using namespace std::chrono;
+    auto next = steady_clock::now();
+    while (!stop_) {
+      auto start = steady_clock::now();
+      try {
+        sweep();
+      } catch (std::exception &ex) {
+        std::cerr << "hssi stats: " << ex.what() << std::endl;
+        return;
+      }
+      auto busy = steady_clock::now() - start;
+
+      // Keep the rate, but never catch up with a burst of sweeps and
+      // never exceed the duty cycle.
+      next += interval;
+      if (busy > interval)
+        ++overruns_;
+      auto earliest = start + busy * 100 / duty_pct;
+      if (next < earliest)
+        next = earliest;
+
+      std::unique_lock<std::mutex> lock(wait_lock_);
+      wait_.wait_until(lock, next, [this] { return stop_.load(); });
+    }
+  }
+
+  Afu *hafu_;
+  std::vector<int> ports_;
+  std::vector<hssi_counter> counters_;
+  std::vector<uint16_t> offsets_;
+  std::vector<uint32_t> values_;
+  hssi_stats_ring ring_;
+  uint16_t freeze_ctrl_;
+  uint32_t freeze_bit_;
+
+  std::thread thread_;
+  std::mutex wait_lock_;
+  std::condition_variable wait_;
+  std::atomic<bool> stop_;
+  std::atomic<uint64_t> sweeps_;
+  std::atomic<uint64_t> overruns_;
+  std::atomic<uint64_t> sweep_ns_total_;
+  std::atomic<uint64_t> sweep_ns_max_;
+};
+
+using hssi_stats_collector = basic_hssi_stats_collector<hssi_afu>;
@@ -75,6 +75,8 @@ public:
 
       std::cout << "Write BW: " << bw_calc(write_bytes,num_ticks) << " GB/s" << std::endl;
       std::cout << "Read BW: "  << bw_calc(read_bytes,num_ticks)  << " GB/s" << std::endl;
+      tg_exe_->report_metric("write_bandwidth_gbps", bw_calc(write_bytes,num_ticks));
+      tg_exe_->report_metric("read_bandwidth_gbps", bw_calc(read_bytes,num_ticks));
     }
   
     bool tg_wait_test_completion ()
@@ -0,0 +1,315 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * @file startup_bench.c
+ * @brief Measures process startup cost up to the first fpgaEnumerate().
+ *
+ * Each iteration fork()s and exec()s this same binary in child mode.
+ * The child timestamps entry to main() and the return of its first
+ * fpgaEnumerate(), and reports both back over a pipe. The parent
+ * subtracts its own pre-fork timestamp to get exec-to-main (loader and
+ * library constructors) and exec-to-first-enumerate latency.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+#include <opae/fpga.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define DEFAULT_ITERATIONS 20
+#define CHILD_OPTION "--child-fd"
+
+struct child_report {
+	struct timespec main_entry;
+	struct timespec enumerated;
+	uint32_t num_matches;
+	fpga_result result;
+};
+
+struct sample {
+	uint64_t to_main_usec;
+	uint64_t to_enum_usec;
+};
+
+struct config {
+	unsigned iterations;
+	int quiet;
+} options = { DEFAULT_ITERATIONS, 0 };
+
+static uint64_t elapsed_usec(const struct timespec *start,
+			     const struct timespec *end)
+{
+	int64_t nsec = (int64_t)(end->tv_sec - start->tv_sec) * 1000000000LL +
+		       (end->tv_nsec - start->tv_nsec);
+	return nsec < 0 ? 0 : (uint64_t)nsec / 1000;
+}
+
+static int child_main(int fd, const struct timespec *main_entry)
+{
+	struct child_report report;
+	ssize_t written;
+
+	memset(&report, 0, sizeof(report));
+	report.main_entry = *main_entry;
+
+	report.result = fpgaEnumerate(NULL, 0, NULL, 0, &report.num_matches);
+
+	clock_gettime(CLOCK_MONOTONIC, &report.enumerated);
+
+	written = write(fd, &report, sizeof(report));
+	close(fd);
+
+	return written == (ssize_t)sizeof(report) ? 0 : 1;
+}
+
+static int run_once(const char *self, struct sample *s, uint32_t *num_matches)
+{
+	int fds[2];
+	char fd_str[16];
+	struct timespec start;
+	struct child_report report;
+	ssize_t got;
+	pid_t pid;
+	int status = 0;
+
+	if (pipe(fds)) {
+		fprintf(stderr, "pipe() failed: %s\n", strerror(errno));
+		return 1;
+	}
+
+	snprintf(fd_str, sizeof(fd_str), "%d", fds[1]);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	pid = fork();
+	if (pid < 0) {
+		fprintf(stderr, "fork() failed: %s\n", strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		return 1;
+	}
+
+	if (!pid) {
+		char *const args[] = { (char *)self, CHILD_OPTION, fd_str, NULL };
+		close(fds[0]);
+		execv(self, args);
+		_exit(127);
+	}
+
+	close(fds[1]);
+
+	got = read(fds[0], &report, sizeof(report));
+	close(fds[0]);
+
+	if (waitpid(pid, &status, 0) < 0 ||
+	    !WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, "child failed (status 0x%x)\n", status);
+		return 1;
+	}
+
+	if (got != (ssize_t)sizeof(report)) {
+		fprintf(stderr, "short read from child\n");
+		return 1;
+	}
+
+	if (report.result != FPGA_OK) {
+		fprintf(stderr, "fpgaEnumerate: %s\n", fpgaErrStr(report.result));
+		return 1;
+	}
+
+	s->to_main_usec = elapsed_usec(&start, &report.main_entry);
+	s->to_enum_usec = elapsed_usec(&start, &report.enumerated);
+	*num_matches = report.num_matches;
+
+	return 0;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void print_stats(const char *label, uint64_t *v, unsigned count)
+{
+	uint64_t sum = 0;
+	unsigned i;
+
+	qsort(v, count, sizeof(uint64_t), cmp_u64);
+
+	for (i = 0 ; i < count ; ++i)
+		sum += v[i];
+
+	printf("%-24s min %8lu  median %8lu  mean %8lu  max %8lu usec\n",
+	       label, v[0], v[count / 2], sum / count, v[count - 1]);
+}
+
+void help(void)
+{
+	printf("\n"
+	       "startup_bench\n"
+	       "OPAE process startup benchmark\n"
+	       "\n"
+	       "Usage:\n"
+	       "        startup_bench [-hvq] [-n <iterations>]\n"
+	       "\n"
+	       "                -n,--iterations     Number of processes to launch (default %d)\n"
+	       "                -q,--quiet          Print only the summary\n"
+	       "                -h,--help           Print this help\n"
+	       "                -v,--version        Print version info and exit\n"
+	       "\n"
+	       "Environment variables such as WITH_ASE, LIBOPAE_CFGFILE and\n"
+	       "OPAE_EXPLICIT_INITIALIZE are passed through to each child.\n"
+	       "\n", DEFAULT_ITERATIONS);
+}
+
+#define GETOPT_STRING "hvqn:"
+int parse_args(int argc, char *argv[])
+{
+	struct option longopts[] = {
+		{ "help",       no_argument,       NULL, 'h' },
+		{ "version",    no_argument,       NULL, 'v' },
+		{ "quiet",      no_argument,       NULL, 'q' },
+		{ "iterations", required_argument, NULL, 'n' },
+		{ NULL,         0,                 NULL, 0   }
+	};
+	int getopt_ret;
+	int option_index;
+	char *endptr;
+
+	while (-1 != (getopt_ret = getopt_long(argc, argv, GETOPT_STRING,
+					       longopts, &option_index))) {
+		const char *tmp_optarg = optarg;
+		if ((optarg) && ('=' == *tmp_optarg))
+			++tmp_optarg;
+
+		switch (getopt_ret) {
+		case 'h': /* help */
+			help();
+			return -1;
+
+		case 'v': /* version */
+			printf("startup_bench %s %s%s\n",
+			       OPAE_VERSION,
+			       OPAE_GIT_COMMIT_HASH,
+			       OPAE_GIT_SRC_TREE_DIRTY ? "*":"");
+			return -1;
+
+		case 'q': /* quiet */
+			options.quiet = 1;
+			break;
+
+		case 'n': /* iterations */
+			endptr = NULL;
+			options.iterations = strtoul(tmp_optarg, &endptr, 0);
+			if (!endptr || *endptr || !options.iterations) {
+				fprintf(stderr, "invalid iterations: %s\n",
+					tmp_optarg);
+				return 1;
+			}
+			break;
+
+		default: /* invalid option */
+			fprintf(stderr, "Invalid cmdline option \n");
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec main_entry;
+	uint64_t *to_main = NULL;
+	uint64_t *to_enum = NULL;
+	uint32_t num_matches = 0;
+	char self[4096];
+	ssize_t len;
+	unsigned i;
+	int res = 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &main_entry);
+
+	if (argc == 3 && !strcmp(argv[1], CHILD_OPTION))
+		return child_main(atoi(argv[2]), &main_entry);
+
+	res = parse_args(argc, argv);
+	if (res)
+		return res < 0 ? 0 : res;
+
+	len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	if (len < 0) {
+		fprintf(stderr, "readlink(/proc/self/exe) failed: %s\n",
+			strerror(errno));
+		return 1;
+	}
+	self[len] = '\0';
+
+	to_main = calloc(options.iterations, sizeof(uint64_t));
+	to_enum = calloc(options.iterations, sizeof(uint64_t));
+	if (!to_main || !to_enum) {
+		fprintf(stderr, "calloc() failed\n");
+		res = 1;
+		goto out_free;
+	}
+
+	for (i = 0 ; i < options.iterations ; ++i) {
+		struct sample s;
+
+		res = run_once(self, &s, &num_matches);
+		if (res)
+			goto out_free;
+
+		to_main[i] = s.to_main_usec;
+		to_enum[i] = s.to_enum_usec;
+
+		if (!options.quiet)
+			printf("run %4u: exec-to-main %8lu usec, "
+			       "exec-to-first-enumerate %8lu usec\n",
+			       i, s.to_main_usec, s.to_enum_usec);
+	}
+
+	printf("%u runs, %u token(s) enumerated\n",
+	       options.iterations, num_matches);
+	print_stats("exec-to-main", to_main, options.iterations);
+	print_stats("exec-to-first-enumerate", to_enum, options.iterations);
+
+out_free:
+	free(to_main);
+	free(to_enum);
+	return res;
+}
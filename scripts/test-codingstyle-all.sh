@@ -60,6 +60,7 @@ find_cpp() {
     find "${OPAE_SDK_ROOT}/libraries/libopaecxx/samples" -type f
     find "${OPAE_SDK_ROOT}/include/opae/cxx/core" -type f
     find "${OPAE_SDK_ROOT}/libraries/pyopaeuio" -iname "*.cpp" -or -iname "*.h"
+    find "${OPAE_SDK_ROOT}/libraries/pyopaeflash" -iname "*.cpp" -or -iname "*.h"
 }
 
 check_cpp () {
@@ -0,0 +1,514 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <cstdarg>
+#include <linux/ioctl.h>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <opae/fpga.h>
+#ifdef OPAE_BENCH_DMA
+#include <opae/dma.h>
+#endif // OPAE_BENCH_DMA
+
+#include "fpga-dfl.h"
+#include "mock/test_system.h"
+
+using namespace opae::testing;
+
+namespace {
+
+// The card that the mock fleet is cloned from.
+const char *fleet_card = "dfl-n3000";
+
+const uint64_t CSR_SCRATCHPAD0 = 0x100;
+
+int mmio_ioctl(mock_object *m, int request, va_list argp) {
+  UNUSED_PARAM(m);
+  UNUSED_PARAM(request);
+  struct dfl_fpga_port_region_info *rinfo =
+    va_arg(argp, struct dfl_fpga_port_region_info *);
+
+  if (!rinfo || rinfo->argsz != sizeof(*rinfo) || rinfo->index > 1) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  rinfo->flags = DFL_PORT_REGION_READ | DFL_PORT_REGION_WRITE |
+                 DFL_PORT_REGION_MMAP;
+  rinfo->size = 0x40000;
+  rinfo->offset = 0;
+  return 0;
+}
+
+/**
+ * Brings up a mock sysfs tree of state.range(0) cards and
+ * initializes the OPAE C API against it. The device and
+ * accelerator tokens of each card are enumerated up front.
+ */
+class mock_fleet : public benchmark::Fixture {
+ public:
+  mock_fleet() :
+    system_(nullptr),
+    cards_(0),
+    initialized_(false)
+  {}
+
+  using benchmark::Fixture::SetUp;
+  using benchmark::Fixture::TearDown;
+
+  void SetUp(benchmark::State &state) override
+  {
+    cards_ = static_cast<size_t>(state.range(0));
+    platform_ = test_platform::fleet(fleet_card, cards_);
+    system_ = test_system::instance();
+    system_->initialize();
+
+    if (platform_.devices.size() != cards_) {
+      state.SkipWithError("mock platform not found");
+      return;
+    }
+
+    system_->prepare_syfs(platform_);
+
+    if (system_->replicate_sysfs_card(cards_)) {
+      state.SkipWithError("failed to replicate the mock card");
+      return;
+    }
+
+    initialized_ = true;
+    if (fpgaInitialize(nullptr) != FPGA_OK) {
+      state.SkipWithError("fpgaInitialize failed");
+      return;
+    }
+
+    if (enumerate(FPGA_DEVICE, devices_) != FPGA_OK ||
+        enumerate(FPGA_ACCELERATOR, accelerators_) != FPGA_OK ||
+        devices_.size() != cards_ ||
+        accelerators_.size() != cards_)
+      state.SkipWithError("mock fleet enumerated the wrong card count");
+  }
+
+  void TearDown(benchmark::State &state) override
+  {
+    UNUSED_PARAM(state);
+    for (auto &t : accelerators_)
+      fpgaDestroyToken(&t);
+    accelerators_.clear();
+    for (auto &t : devices_)
+      fpgaDestroyToken(&t);
+    devices_.clear();
+
+    if (initialized_) {
+      fpgaFinalize();
+      initialized_ = false;
+    }
+
+    system_->remove_sysfs();
+    system_->finalize();
+  }
+
+ protected:
+  fpga_result enumerate(fpga_objtype objtype, std::vector<fpga_token> &tokens)
+  {
+    fpga_properties filter = nullptr;
+    uint32_t matches = 0;
+    fpga_result res;
+
+    res = fpgaGetProperties(nullptr, &filter);
+    if (res != FPGA_OK)
+      return res;
+
+    res = fpgaPropertiesSetObjectType(filter, objtype);
+    if (res == FPGA_OK)
+      res = fpgaEnumerate(&filter, 1, nullptr, 0, &matches);
+    if (res == FPGA_OK) {
+      tokens.resize(matches);
+      res = fpgaEnumerate(&filter, 1, tokens.data(), matches, &matches);
+    }
+
+    fpgaDestroyProperties(&filter);
+    return res;
+  }
+
+  test_system *system_;
+  test_platform platform_;
+  size_t cards_;
+  bool initialized_;
+  std::vector<fpga_token> devices_;
+  std::vector<fpga_token> accelerators_;
+};
+
+} // end of anonymous namespace
+
+/**
+ * Enumerate every fme and port in a fleet, with no filter.
+ */
+BENCHMARK_DEFINE_F(mock_fleet, enumerate_all)(benchmark::State &state)
+{
+  std::vector<fpga_token> tokens(2 * cards_, nullptr);
+
+  for (auto _ : state) {
+    uint32_t matches = 0;
+    if (fpgaEnumerate(nullptr, 0, tokens.data(),
+                      tokens.size(), &matches) != FPGA_OK) {
+      state.SkipWithError("fpgaEnumerate failed");
+      break;
+    }
+    for (uint32_t i = 0; i < matches && i < tokens.size(); ++i)
+      fpgaDestroyToken(&tokens[i]);
+  }
+
+  state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+BENCHMARK_REGISTER_F(mock_fleet, enumerate_all)->Arg(1)->Arg(4)->Arg(16);
+
+/**
+ * Look up the accelerator of the last card in a fleet by PCIe bus.
+ */
+BENCHMARK_DEFINE_F(mock_fleet, enumerate_filtered)(benchmark::State &state)
+{
+  fpga_properties filter = nullptr;
+  fpga_token token = nullptr;
+
+  if (state.error_occurred())
+    return;
+
+  if (fpgaGetProperties(nullptr, &filter) != FPGA_OK ||
+      fpgaPropertiesSetObjectType(filter, FPGA_ACCELERATOR) != FPGA_OK ||
+      fpgaPropertiesSetBus(filter, platform_.devices.back().bus) != FPGA_OK) {
+    state.SkipWithError("failed to build the filter");
+    fpgaDestroyProperties(&filter);
+    return;
+  }
+
+  for (auto _ : state) {
+    uint32_t matches = 0;
+    if (fpgaEnumerate(&filter, 1, &token, 1, &matches) != FPGA_OK ||
+        matches != 1) {
+      state.SkipWithError("fpgaEnumerate failed");
+      break;
+    }
+    fpgaDestroyToken(&token);
+  }
+
+  fpgaDestroyProperties(&filter);
+}
+BENCHMARK_REGISTER_F(mock_fleet, enumerate_filtered)->Arg(1)->Arg(4)->Arg(16);
+
+/**
+ * Open and close the accelerators of a fleet round-robin.
+ */
+BENCHMARK_DEFINE_F(mock_fleet, open_close)(benchmark::State &state)
+{
+  size_t i = 0;
+
+  if (state.error_occurred())
+    return;
+
+  for (auto _ : state) {
+    fpga_handle handle = nullptr;
+    if (fpgaOpen(accelerators_[i], &handle, 0) != FPGA_OK) {
+      state.SkipWithError("fpgaOpen failed");
+      break;
+    }
+    fpgaClose(handle);
+    i = (i + 1) % accelerators_.size();
+  }
+}
+BENCHMARK_REGISTER_F(mock_fleet, open_close)->Arg(1)->Arg(16);
+
+/**
+ * MMIO reads and writes through the shell, mmio_fn(handle, value)
+ * being a single access to the scratchpad register.
+ */
+template <typename F>
+static void mmio_loop(benchmark::State &state, fpga_token accel, F mmio_fn)
+{
+  fpga_handle handle = nullptr;
+  uint64_t *mmio_ptr = nullptr;
+
+  test_system::instance()->register_ioctl_handler(
+    DFL_FPGA_PORT_GET_REGION_INFO, mmio_ioctl);
+
+  if (fpgaOpen(accel, &handle, 0) != FPGA_OK) {
+    state.SkipWithError("fpgaOpen failed");
+    return;
+  }
+
+  if (fpgaMapMMIO(handle, 0, &mmio_ptr) != FPGA_OK) {
+    state.SkipWithError("fpgaMapMMIO failed");
+    fpgaClose(handle);
+    return;
+  }
+
+  uint64_t value = 0;
+  for (auto _ : state) {
+    if (mmio_fn(handle, value) != FPGA_OK) {
+      state.SkipWithError("MMIO access failed");
+      break;
+    }
+    benchmark::DoNotOptimize(value);
+    ++value;
+  }
+
+  fpgaUnmapMMIO(handle, 0);
+  fpgaClose(handle);
+}
+
+BENCHMARK_DEFINE_F(mock_fleet, mmio_read64)(benchmark::State &state)
+{
+  if (state.error_occurred())
+    return;
+  mmio_loop(state, accelerators_[0], [](fpga_handle h, uint64_t &v) {
+    return fpgaReadMMIO64(h, 0, CSR_SCRATCHPAD0, &v);
+  });
+}
+BENCHMARK_REGISTER_F(mock_fleet, mmio_read64)->Arg(1);
+
+BENCHMARK_DEFINE_F(mock_fleet, mmio_write64)(benchmark::State &state)
+{
+  if (state.error_occurred())
+    return;
+  mmio_loop(state, accelerators_[0], [](fpga_handle h, uint64_t &v) {
+    return fpgaWriteMMIO64(h, 0, CSR_SCRATCHPAD0, v);
+  });
+}
+BENCHMARK_REGISTER_F(mock_fleet, mmio_write64)->Arg(1);
+
+BENCHMARK_DEFINE_F(mock_fleet, mmio_read32)(benchmark::State &state)
+{
+  if (state.error_occurred())
+    return;
+  mmio_loop(state, accelerators_[0], [](fpga_handle h, uint64_t &v) {
+    uint32_t v32 = 0;
+    fpga_result res = fpgaReadMMIO32(h, 0, CSR_SCRATCHPAD0, &v32);
+    v = v32;
+    return res;
+  });
+}
+BENCHMARK_REGISTER_F(mock_fleet, mmio_read32)->Arg(1);
+
+BENCHMARK_DEFINE_F(mock_fleet, mmio_write32)(benchmark::State &state)
+{
+  if (state.error_occurred())
+    return;
+  mmio_loop(state, accelerators_[0], [](fpga_handle h, uint64_t &v) {
+    return fpgaWriteMMIO32(h, 0, CSR_SCRATCHPAD0, static_cast<uint32_t>(v));
+  });
+}
+BENCHMARK_REGISTER_F(mock_fleet, mmio_write32)->Arg(1);
+
+/**
+ * Prepare, translate and release a buffer of state.range(1) bytes.
+ * Sizes above 4 KiB need huge pages and are skipped without them.
+ */
+BENCHMARK_DEFINE_F(mock_fleet, prepare_buffer)(benchmark::State &state)
+{
+  fpga_handle handle = nullptr;
+  uint64_t len = static_cast<uint64_t>(state.range(1));
+
+  if (state.error_occurred())
+    return;
+
+  if (fpgaOpen(accelerators_[0], &handle, 0) != FPGA_OK) {
+    state.SkipWithError("fpgaOpen failed");
+    return;
+  }
+
+  for (auto _ : state) {
+    void *buf = nullptr;
+    uint64_t wsid = 0;
+    uint64_t ioaddr = 0;
+
+    if (fpgaPrepareBuffer(handle, len, &buf, &wsid, 0) != FPGA_OK) {
+      state.SkipWithError("fpgaPrepareBuffer failed");
+      break;
+    }
+    fpgaGetIOAddress(handle, wsid, &ioaddr);
+    benchmark::DoNotOptimize(ioaddr);
+    fpgaReleaseBuffer(handle, wsid);
+  }
+
+  state.SetBytesProcessed(state.iterations() * len);
+  fpgaClose(handle);
+}
+BENCHMARK_REGISTER_F(mock_fleet, prepare_buffer)
+  ->Args({1, KiB(4)})
+  ->Args({1, MiB(2)});
+
+/**
+ * Re-read a sysfs attribute through fpgaObjectRead64.
+ */
+BENCHMARK_DEFINE_F(mock_fleet, object_read64)(benchmark::State &state)
+{
+  fpga_object obj = nullptr;
+
+  if (state.error_occurred())
+    return;
+
+  if (fpgaTokenGetObject(devices_[0], "ports_num", &obj, 0) != FPGA_OK) {
+    state.SkipWithError("fpgaTokenGetObject failed");
+    return;
+  }
+
+  for (auto _ : state) {
+    uint64_t value = 0;
+    if (fpgaObjectRead64(obj, &value, FPGA_OBJECT_SYNC) != FPGA_OK) {
+      state.SkipWithError("fpgaObjectRead64 failed");
+      break;
+    }
+    benchmark::DoNotOptimize(value);
+  }
+
+  fpgaDestroyObject(&obj);
+}
+BENCHMARK_REGISTER_F(mock_fleet, object_read64)->Arg(1);
+
+/**
+ * Read every metric that the fme exposes by index.
+ */
+BENCHMARK_DEFINE_F(mock_fleet, metrics_by_index)(benchmark::State &state)
+{
+  fpga_handle handle = nullptr;
+  uint64_t num_metrics = 0;
+
+  if (state.error_occurred())
+    return;
+
+  if (fpgaOpen(devices_[0], &handle, 0) != FPGA_OK) {
+    state.SkipWithError("fpgaOpen failed");
+    return;
+  }
+
+  if (fpgaGetNumMetrics(handle, &num_metrics) != FPGA_OK ||
+      !num_metrics) {
+    state.SkipWithError("no metrics found");
+    fpgaClose(handle);
+    return;
+  }
+
+  std::vector<uint64_t> indexes(num_metrics);
+  std::vector<fpga_metric> metrics(num_metrics);
+  for (uint64_t i = 0; i < num_metrics; ++i)
+    indexes[i] = i;
+
+  for (auto _ : state) {
+    if (fpgaGetMetricsByIndex(handle, indexes.data(), num_metrics,
+                              metrics.data()) != FPGA_OK) {
+      state.SkipWithError("fpgaGetMetricsByIndex failed");
+      break;
+    }
+    benchmark::DoNotOptimize(metrics.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_metrics);
+  fpgaClose(handle);
+}
+BENCHMARK_REGISTER_F(mock_fleet, metrics_by_index)->Arg(1);
+
+#ifdef OPAE_BENCH_DMA
+/**
+ * Submit four state.range(1) byte host to fpga transfers on each of
+ * state.range(0) loopback channels, then poll the first transfer of
+ * each channel to completion and wait for the rest. The time of an
+ * iteration is the latency of the whole batch.
+ */
+static void dma_loopback(benchmark::State &state)
+{
+  const uint32_t channels = static_cast<uint32_t>(state.range(0));
+  const size_t len = static_cast<size_t>(state.range(1));
+  const size_t per_channel = 4;
+  struct opae_dma_attr attr;
+  opae_dma_handle dma = nullptr;
+  test_system *system = test_system::instance();
+
+  // The mock allocators need an initialized test_system.
+  system->initialize();
+
+  opae_dma_attr_init(&attr);
+  attr.backend = OPAE_DMA_BACKEND_LOOPBACK;
+  attr.num_channels = channels;
+  attr.loopback_size = channels * per_channel * len;
+  if (opae_dma_open(nullptr, &attr, &dma) != FPGA_OK) {
+    state.SkipWithError("opae_dma_open failed");
+    system->finalize();
+    return;
+  }
+
+  std::vector<uint8_t> src(len, 0xa5);
+  std::vector<opae_dma_request> reqs(channels * per_channel);
+
+  for (auto _ : state) {
+    size_t submitted = 0;
+    bool ok = true;
+
+    for (uint32_t c = 0; ok && c < channels; ++c) {
+      for (size_t i = 0; ok && i < per_channel; ++i) {
+        size_t n = c * per_channel + i;
+        ok = opae_dma_submit(dma, c, n * len,
+                             reinterpret_cast<uint64_t>(src.data()), len,
+                             OPAE_DMA_HOST_TO_FPGA, nullptr, nullptr,
+                             &reqs[n]) == FPGA_OK;
+        if (ok)
+          submitted = n + 1;
+      }
+    }
+
+    for (size_t n = 0; n < submitted; ++n) {
+      fpga_result res;
+      if (n % per_channel == 0) {
+        while ((res = opae_dma_poll(reqs[n], nullptr)) == FPGA_BUSY)
+          ;
+      } else {
+        res = opae_dma_wait(reqs[n], 1000, nullptr);
+      }
+      ok = ok && res == FPGA_OK;
+      opae_dma_request_release(reqs[n]);
+    }
+
+    if (!ok) {
+      state.SkipWithError("loopback transfer failed");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * channels * per_channel);
+  state.SetBytesProcessed(state.iterations() * channels * per_channel * len);
+  opae_dma_close(dma);
+  system->finalize();
+}
+BENCHMARK(dma_loopback)
+  ->Args({1, KiB(4)})
+  ->Args({4, KiB(4)})
+  ->Args({4, MiB(1)})
+  ->UseRealTime();
+#endif // OPAE_BENCH_DMA
+
+BENCHMARK_MAIN();
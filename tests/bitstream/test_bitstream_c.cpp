@@ -38,6 +38,7 @@ fpga_result opae_bitstream_read_file(const char *file,
 void opae_resolve_legacy_bitstream(opae_bitstream_info *info);
 
 void *opae_bitstream_parse_metadata(const char *metadata,
+				    size_t len,
 				    fpga_guid pr_interface_id,
 				    int *version);
 
@@ -173,7 +174,7 @@ TEST_P(bitstream_c_p, parse_err0) {
   fpga_guid guid;
   int ver = 0;
 
-  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, guid, &ver), nullptr);
+  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, strlen(mdata), guid, &ver), nullptr);
 }
 
 /**
@@ -189,7 +190,7 @@ TEST_P(bitstream_c_p, parse_err1) {
   fpga_guid guid;
   int ver = 0;
 
-  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, guid, &ver), nullptr);
+  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, strlen(mdata), guid, &ver), nullptr);
 }
 
 /**
@@ -207,7 +208,7 @@ TEST_P(bitstream_c_p, parse_err2) {
   fpga_guid guid;
   int ver = 0;
 
-  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, guid, &ver), nullptr);
+  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, strlen(mdata), guid, &ver), nullptr);
 }
 
 /**
@@ -225,7 +226,7 @@ TEST_P(bitstream_c_p, parse_err3) {
   fpga_guid guid;
   int ver = 0;
 
-  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, guid, &ver), nullptr);
+  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, strlen(mdata), guid, &ver), nullptr);
 }
 
 /**
@@ -349,6 +350,101 @@ TEST_P(bitstream_c_p, unload_err1) {
   opae_free(save);
 }
 
+/**
+ * @test       parse_bounded
+ * @brief      Test: opae_bitstream_parse_metadata
+ * @details    The fn parses no further than the given length,<br>
+ *             so metadata that is complete only when read past<br>
+ *             that length is rejected.<br>
+ */
+TEST_P(bitstream_c_p, parse_bounded) {
+  const char *mdata = R"mdata({ "version": 99 })mdata";
+  fpga_guid guid;
+  int ver = 0;
+
+  EXPECT_EQ(opae_bitstream_parse_metadata(mdata, strlen(mdata) - 1,
+                                          guid, &ver), nullptr);
+  EXPECT_EQ(ver, 0);
+}
+
+/**
+ * @test       map_ok0
+ * @brief      Test: opae_map_bitstream
+ * @details    Given a valid GBS file,<br>
+ *             the fn maps it and resolves it exactly<br>
+ *             like opae_load_bitstream does.<br>
+ */
+TEST_P(bitstream_c_p, map_ok0) {
+  opae_bitstream_info loaded;
+  opae_bitstream_info mapped;
+
+  ASSERT_EQ(opae_load_bitstream(tmpnull_gbs_, &loaded), FPGA_OK);
+  ASSERT_EQ(opae_map_bitstream(tmpnull_gbs_, &mapped), FPGA_OK);
+
+  EXPECT_FALSE(loaded.mapped);
+  EXPECT_TRUE(mapped.mapped);
+  EXPECT_STREQ(tmpnull_gbs_, mapped.filename);
+  ASSERT_EQ(mapped.data_len, null_gbs_.size());
+  EXPECT_EQ(memcmp(mapped.data, null_gbs_.data(), mapped.data_len), 0);
+  EXPECT_EQ(mapped.rbf_data - mapped.data, loaded.rbf_data - loaded.data);
+  EXPECT_EQ(mapped.rbf_len, loaded.rbf_len);
+  EXPECT_EQ(memcmp(mapped.pr_interface_id, loaded.pr_interface_id,
+                   sizeof(fpga_guid)), 0);
+  EXPECT_EQ(mapped.metadata_version, 1);
+  EXPECT_NE(mapped.parsed_metadata, nullptr);
+
+  EXPECT_EQ(opae_unload_bitstream(&mapped), FPGA_OK);
+  EXPECT_EQ(mapped.data, nullptr);
+  EXPECT_EQ(opae_unload_bitstream(&loaded), FPGA_OK);
+}
+
+/**
+ * @test       map_ok1
+ * @brief      Test: opae_map_bitstream
+ * @details    If the given file is a legacy formatted bitstream,<br>
+ *             the fn maps and resolves it and returns FPGA_OK.<br>
+ */
+TEST_P(bitstream_c_p, map_ok1) {
+  opae_legacy_bitstream_header hdr;
+  hdr.legacy_magic = OPAE_LEGACY_BITSTREAM_MAGIC;
+  memcpy(hdr.legacy_pr_ifc_id, guid, sizeof(fpga_guid));
+
+  std::ofstream gbs;
+  gbs.open(tmpnull_gbs_, std::ios::out|std::ios::binary);
+  gbs.write((const char *)&hdr, sizeof(hdr));
+  gbs.close();
+
+  opae_bitstream_info info;
+  EXPECT_EQ(opae_map_bitstream(tmpnull_gbs_, &info), FPGA_OK);
+  EXPECT_TRUE(info.mapped);
+  EXPECT_EQ(info.data_len, sizeof(hdr));
+  EXPECT_EQ(info.rbf_data, info.data + sizeof(hdr));
+  EXPECT_EQ(memcmp(info.pr_interface_id, guid_reversed, sizeof(fpga_guid)), 0);
+  EXPECT_EQ(info.parsed_metadata, nullptr);
+  EXPECT_EQ(opae_unload_bitstream(&info), FPGA_OK);
+}
+
+/**
+ * @test       map_err0
+ * @brief      Test: opae_map_bitstream
+ * @details    If either of the parameters is NULL, or the file<br>
+ *             doesn't exist or is empty,<br>
+ *             the fn returns FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(bitstream_c_p, map_err0) {
+  opae_bitstream_info info;
+  EXPECT_EQ(opae_map_bitstream(tmpnull_gbs_, nullptr), FPGA_INVALID_PARAM);
+  EXPECT_EQ(opae_map_bitstream(nullptr, &info), FPGA_INVALID_PARAM);
+  EXPECT_EQ(opae_map_bitstream("doesntexist", &info), FPGA_INVALID_PARAM);
+
+  std::ofstream gbs;
+  gbs.open(tmpnull_gbs_, std::ios::out|std::ios::binary);
+  gbs.close();
+
+  EXPECT_EQ(opae_map_bitstream(tmpnull_gbs_, &info), FPGA_INVALID_PARAM);
+  EXPECT_EQ(info.data, nullptr);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(bitstream_c_p);
 INSTANTIATE_TEST_SUITE_P(bitstream_c, bitstream_c_p,
                          ::testing::ValuesIn(test_platform::platforms({})));
@@ -370,23 +466,28 @@ TEST_P(mock_bitstream_c_p, read_err1) {
 }
 
 /**
- * @test       resolve_err2
+ * @test       resolve_ok0
  * @brief      Test: opae_resolve_bitstream
- * @details    When malloc fails<br>
- *             the fn returns FPGA_NO_MEMORY.<br>
+ * @details    The metadata is parsed in place, without allocating<br>
+ *             a NUL-terminated copy, so a failing malloc<br>
+ *             does not prevent resolving the bitstream.<br>
  */
-TEST_P(mock_bitstream_c_p, resolve_err2) {
-  opae_bitstream_header hdr;
-  memcpy(hdr.valid_gbs_guid, valid_GBS_guid, sizeof(fpga_guid));
-  hdr.metadata_length = 1;
-
+TEST_P(mock_bitstream_c_p, resolve_ok0) {
   opae_bitstream_info info;
   info.filename = tmpnull_gbs_;
-  info.data = (uint8_t *)&hdr;
-  info.data_len = sizeof(hdr);
+  info.data = null_gbs_.data();
+  info.data_len = null_gbs_.size();
+  info.metadata_version = 0;
+  info.parsed_metadata = nullptr;
+  info.mapped = false;
 
   system_->invalidate_malloc(0, "opae_resolve_bitstream");
-  EXPECT_EQ(opae_resolve_bitstream(&info), FPGA_NO_MEMORY);
+  EXPECT_EQ(opae_resolve_bitstream(&info), FPGA_OK);
+  EXPECT_EQ(info.metadata_version, 1);
+  ASSERT_NE(info.parsed_metadata, nullptr);
+
+  info.data = nullptr;
+  EXPECT_EQ(opae_unload_bitstream(&info), FPGA_OK);
 }
 
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(mock_bitstream_c_p);
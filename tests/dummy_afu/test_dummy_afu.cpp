@@ -162,6 +162,76 @@ TEST_P(dummy_afu_p, main_mmio_count) {
   EXPECT_NE(s_out.find("Test mmio(100): PASS"), std::string::npos);
 }
 
+/*
+ * @test       main_mmio_bench
+ * @brief      Test: test main with mmio subcommand in benchmark mode
+ * @details    Two threads with a 50% read mix report latency
+ *             percentiles for both mmio paths as json.
+ */
+TEST_P(dummy_afu_p, main_mmio_bench) {
+  char tmpfile[] = "/tmp/mmio-bench-XXXXXX.json";
+  int fd = mkstemps(tmpfile, 5);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  args_.push_back(opae_strdup("dummy_afu"));
+  args_.push_back(opae_strdup("mmio"));
+  args_.push_back(opae_strdup("--bench"));
+  args_.push_back(opae_strdup("--threads"));
+  args_.push_back(opae_strdup("2"));
+  args_.push_back(opae_strdup("--read-pct"));
+  args_.push_back(opae_strdup("50"));
+  args_.push_back(opae_strdup("--count"));
+  args_.push_back(opae_strdup("1000"));
+  args_.push_back(opae_strdup("--format"));
+  args_.push_back(opae_strdup("json"));
+  args_.push_back(opae_strdup("--output"));
+  args_.push_back(opae_strdup(tmpfile));
+  EXPECT_EQ(0, app_->main(args_.size(), const_cast<char**>(args_.data())));
+
+  std::ifstream f(tmpfile);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  auto s = ss.str();
+  EXPECT_NE(s.find("\"path\": \"api\", \"op\": \"rd\", \"count\": 1000"),
+            std::string::npos);
+  EXPECT_NE(s.find("\"path\": \"direct\", \"op\": \"wr\", \"count\": 1000"),
+            std::string::npos);
+  EXPECT_NE(s.find("\"p99_ns\""), std::string::npos);
+  unlink(tmpfile);
+}
+
+/*
+ * @test       main_mmio_bench_text
+ * @brief      Test: test main with mmio subcommand in benchmark mode
+ * @details    A text report is written to the --output file.
+ */
+TEST_P(dummy_afu_p, main_mmio_bench_text) {
+  char tmpfile[] = "/tmp/mmio-bench-XXXXXX.txt";
+  int fd = mkstemps(tmpfile, 4);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  args_.push_back(opae_strdup("dummy_afu"));
+  args_.push_back(opae_strdup("mmio"));
+  args_.push_back(opae_strdup("--bench"));
+  args_.push_back(opae_strdup("--path"));
+  args_.push_back(opae_strdup("direct"));
+  args_.push_back(opae_strdup("--count"));
+  args_.push_back(opae_strdup("100"));
+  args_.push_back(opae_strdup("--output"));
+  args_.push_back(opae_strdup(tmpfile));
+  EXPECT_EQ(0, app_->main(args_.size(), const_cast<char**>(args_.data())));
+
+  std::ifstream f(tmpfile);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  auto s = ss.str();
+  EXPECT_EQ(0u, s.find("direct rd width: 64, threads: 1, count: 100, min: "));
+  EXPECT_NE(s.find(" nsec\n"), std::string::npos);
+  unlink(tmpfile);
+}
+
 /*
  * @test       main_sleep_timeout
  * @brief      Test: test main with sleep subcommand and timeout 100msec
@@ -248,6 +318,36 @@ TEST_P(dummy_afu_p, main_invalid_guid) {
             app_->main(args_.size(), const_cast<char**>(args_.data())));
 }
 
+/**
+ * @test       main_all_devices
+ * @brief      Test: main
+ * @details    When I run dummy_afu with --all-devices and --summary,
+ *             the command runs in a worker process for the matching
+ *             accelerator, and the JSON summary records its result.
+ */
+TEST_P(dummy_afu_p, main_all_devices) {
+  char summary[] = "/tmp/dummy_afu_summary-XXXXXX";
+  int fd = mkstemp(summary);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  args_.push_back(opae_strdup("dummy_afu"));
+  args_.push_back(opae_strdup("--all-devices"));
+  args_.push_back(opae_strdup("--summary"));
+  args_.push_back(opae_strdup(summary));
+  args_.push_back(opae_strdup("mmio"));
+  EXPECT_EQ(0, app_->main(args_.size(), const_cast<char**>(args_.data())));
+
+  std::ifstream f(summary);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  EXPECT_NE(ss.str().find("\"command\": \"mmio\""), std::string::npos);
+  EXPECT_NE(ss.str().find("\"result\": \"PASS\""), std::string::npos);
+  EXPECT_NE(ss.str().find("\"passed\": 1, \"failed\": 0"),
+            std::string::npos);
+  unlink(summary);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(dummy_afu_p);
 INSTANTIATE_TEST_SUITE_P(dummy_afu, dummy_afu_p,
                          ::testing::ValuesIn(test_platform::mock_platforms({"dfl-d5005"})));
@@ -267,3 +367,61 @@ TEST(dummy_afu, parse_pcie_address)
   EXPECT_EQ(p.fields.function, 1);
   EXPECT_THROW(pcie_address::parse("xy:11.g"), std::runtime_error);
 }
+
+TEST(dummy_afu, parse_cpulist)
+{
+  using opae::afu_test::parse_cpulist;
+  EXPECT_EQ(parse_cpulist("0-3,8,10-11\n"),
+            std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_TRUE(parse_cpulist("").empty());
+  EXPECT_THROW(parse_cpulist("x"), std::runtime_error);
+}
+
+TEST(dummy_afu, json_summary)
+{
+  using opae::afu_test::device_result;
+  std::vector<device_result> results(2);
+  results[0].address = "0000:3b:00.0";
+  results[0].status = 0;
+  results[0].seconds = 1.5;
+  results[0].metrics["bandwidth_gbps"] = 2.0;
+  results[1].address = "0000:af:00.0";
+  results[1].status = 4;
+  results[1].seconds = 0.5;
+  results[1].metrics["bandwidth_gbps"] = 4.0;
+
+  std::stringstream ss;
+  opae::afu_test::write_json_summary(ss, "dummy_afu", "mmio", results, 2.0);
+  auto s = ss.str();
+  EXPECT_NE(s.find("\"result\": \"FAIL\""), std::string::npos);
+  EXPECT_NE(s.find("\"passed\": 1, \"failed\": 1"), std::string::npos);
+  EXPECT_NE(s.find("\"bandwidth_gbps\": {\"sum\": 6, \"min\": 2, "
+                   "\"max\": 4, \"mean\": 3}"), std::string::npos);
+}
+
+TEST(dummy_afu, latency_histogram)
+{
+  using dummy_afu::latency_histogram;
+  std::vector<uint64_t> values = {0, 1, 63, 64, 65, 1000, 123456789, UINT64_MAX};
+  for (auto v : values) {
+    auto i = latency_histogram::index(v);
+    EXPECT_LT(i, static_cast<size_t>(latency_histogram::num_buckets));
+    EXPECT_LE(latency_histogram::lowest(i), v);
+    if (i + 1 < latency_histogram::num_buckets) {
+      EXPECT_GT(latency_histogram::lowest(i + 1), v);
+    }
+  }
+
+  latency_histogram a, b;
+  for (uint64_t v = 1; v <= 100; ++v)
+    a.add(v);
+  b.add(10000);
+  a.merge(b);
+  EXPECT_EQ(a.count(), 101u);
+  EXPECT_EQ(a.min(), 1u);
+  EXPECT_EQ(a.max(), 10000u);
+  EXPECT_EQ(a.percentile(50.0), 51u);
+  EXPECT_GE(a.percentile(99.0), 100u);
+  EXPECT_LE(a.percentile(99.0), 103u);
+  EXPECT_EQ(a.percentile(100.0), 10000u);
+}
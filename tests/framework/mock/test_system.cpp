@@ -144,6 +144,213 @@ void test_system::prepare_syfs(const test_platform &platform) {
 }
 
 
+// Translate one path component of card 0 into its name on card n.
+static std::string fleet_component(const std::string &c,
+                                   const std::string &bdf0,
+                                   const std::string &bdfn,
+                                   size_t n) {
+  static const char *prefixes[] = { "dfl-fme.", "dfl-port." };
+
+  if (c == bdf0)
+    return bdfn;
+  if (c == "region0")
+    return "region" + std::to_string(n);
+
+  for (auto p : prefixes) {
+    std::string prefix = std::string(p) + "0";
+    if (c.compare(0, prefix.size(), prefix) == 0 &&
+        (c.size() == prefix.size() || c[prefix.size()] == '.'))
+      return std::string(p) + std::to_string(n) + c.substr(prefix.size());
+  }
+
+  return c;
+}
+
+static std::string fleet_path(const std::string &path,
+                              const std::string &bdf0,
+                              const std::string &bdfn,
+                              size_t n) {
+  std::string res;
+  size_t start = 0;
+
+  while (true) {
+    size_t end = path.find('/', start);
+    res += fleet_component(path.substr(start, end - start), bdf0, bdfn, n);
+    if (end == std::string::npos)
+      break;
+    res += '/';
+    start = end + 1;
+  }
+
+  return res;
+}
+
+// Gather the nodes below dir, children ahead of their parents.
+static void fleet_nodes(const std::string &dir,
+                        std::vector<std::string> &nodes) {
+  DIR *d = ::opendir(dir.c_str());
+  struct dirent *e;
+
+  if (!d)
+    return;
+
+  while ((e = ::readdir(d)) != nullptr) {
+    struct stat st;
+    std::string name(e->d_name);
+
+    if (name == "." || name == "..")
+      continue;
+
+    std::string node = dir + "/" + name;
+    if (!::lstat(node.c_str(), &st) && S_ISDIR(st.st_mode))
+      fleet_nodes(node, nodes);
+    nodes.push_back(node);
+  }
+
+  ::closedir(d);
+}
+
+static int fleet_link(const std::string &src, const std::string &dst,
+                      const std::string &bdf0, const std::string &bdfn,
+                      size_t n) {
+  char target[PATH_MAX] = {0};
+  ssize_t len = ::readlink(src.c_str(), target, sizeof(target) - 1);
+
+  if (len < 0)
+    return -1;
+  target[len] = '\0';
+
+  std::string moved = fleet_path(target, bdf0, bdfn, n);
+  if (src == dst && moved == target)
+    return 0;
+  if (src == dst && ::unlink(src.c_str()))
+    return -1;
+  return ::symlink(moved.c_str(), dst.c_str());
+}
+
+// The dev attribute of each fme/port holds major:minor, from which
+// the object id is derived. Give the clones distinct minors.
+static int fleet_dev(const std::string &path, size_t n) {
+  unsigned major = 0, minor = 0;
+  FILE *fp = ::fopen(path.c_str(), "r");
+
+  if (!fp)
+    return -1;
+  int res = ::fscanf(fp, "%u:%u", &major, &minor);
+  ::fclose(fp);
+  if (res != 2)
+    return -1;
+
+  fp = ::fopen(path.c_str(), "w");
+  if (!fp)
+    return -1;
+  ::fprintf(fp, "%u:%u\n", major, minor + static_cast<unsigned>(n));
+  ::fclose(fp);
+  return 0;
+}
+
+/**
+ * Model a fleet of num_cards identical cards by cloning the dfl
+ * card found at /sys/class/fpga_region/region0 of the mock sysfs
+ * tree. Card n sits at the PCIe bus of card 0 plus n, and owns
+ * region<n>, dfl-fme.<n> and dfl-port.<n> along with their /dev
+ * nodes. Must be called after prepare_syfs().
+ */
+int test_system::replicate_sysfs_card(size_t num_cards) {
+  std::string class_dir = root_ + "/sys/class/fpga_region";
+  char target[PATH_MAX] = {0};
+  ssize_t len;
+
+  if (root_.find("tmpsysfs") == std::string::npos) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  len = ::readlink((class_dir + "/region0").c_str(),
+                   target, sizeof(target) - 1);
+  if (len < 0)
+    return -1;
+  target[len] = '\0';
+
+  // ../../devices/pci0000:00/0000:00:02.0/0000:05:00.0/fpga_region/region0
+  std::string region_link(target);
+  size_t pos = region_link.rfind("/fpga_region/region0");
+  if (pos == std::string::npos) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  std::string pci_dir = class_dir + "/" + region_link.substr(0, pos);
+  pos = pci_dir.rfind('/');
+  std::string parent = pci_dir.substr(0, pos);
+  std::string bdf0 = pci_dir.substr(pos + 1);
+
+  unsigned segment = 0, bus = 0, device = 0, function = 0;
+  if (sscanf(bdf0.c_str(), "%x:%x:%x.%x",
+             &segment, &bus, &device, &function) != 4 ||
+      bus + num_cards > 0x100) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (size_t n = 1; n < num_cards; ++n) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%04x:%02x:%02x.%x",
+             segment, static_cast<unsigned>(bus + n), device, function);
+    std::string bdfn(buf);
+    std::string clone = parent + "/" + bdfn;
+
+    std::string cmd = "cp -a " + pci_dir + " " + clone;
+    if (std::system(cmd.c_str()))
+      return -1;
+
+    std::vector<std::string> nodes;
+    fleet_nodes(clone, nodes);
+
+    for (const auto &node : nodes) {
+      struct stat st;
+      size_t slash = node.rfind('/');
+      std::string dir = node.substr(0, slash);
+      std::string name = node.substr(slash + 1);
+      std::string dir_name = dir.substr(dir.rfind('/') + 1);
+
+      if (::lstat(node.c_str(), &st))
+        return -1;
+
+      if (S_ISLNK(st.st_mode)) {
+        if (fleet_link(node, node, bdf0, bdfn, n))
+          return -1;
+      } else if (S_ISREG(st.st_mode) && name == "dev" &&
+                 (dir_name == "dfl-fme.0" || dir_name == "dfl-port.0")) {
+        if (fleet_dev(node, n))
+          return -1;
+      }
+
+      std::string renamed = fleet_component(name, bdf0, bdfn, n);
+      if (renamed != name &&
+          ::rename(node.c_str(), (dir + "/" + renamed).c_str()))
+        return -1;
+    }
+
+    if (fleet_link(class_dir + "/region0",
+                   class_dir + "/region" + std::to_string(n),
+                   bdf0, bdfn, n) ||
+        fleet_link(root_ + "/sys/bus/pci/devices/" + bdf0,
+                   root_ + "/sys/bus/pci/devices/" + bdfn,
+                   bdf0, bdfn, n))
+      return -1;
+
+    for (auto dev : { "/dev/dfl-fme.", "/dev/dfl-port." }) {
+      cmd = "cp -a " + root_ + dev + "0 " + root_ + dev + std::to_string(n);
+      if (std::system(cmd.c_str()))
+        return -1;
+    }
+  }
+
+  return 0;
+}
+
+
 extern "C" {
 int process_fpath(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftw) {
   (void)sb;
@@ -146,6 +146,7 @@ class test_system {
   void initialize();
   void finalize();
   void prepare_syfs(const test_platform &platform);
+  int replicate_sysfs_card(size_t num_cards);
   int remove_sysfs();
   int remove_sysfs_dir(const char *path = nullptr);
   std::string get_sysfs_claass_path(const std::string &path);
@@ -504,6 +504,28 @@ test_platform test_platform::get(const std::string &key) {
   return fpga_db::instance()->get(key);
 }
 
+// The platform that test_system::replicate_sysfs_card(num_cards)
+// produces from the single card mock platform named by key.
+test_platform test_platform::fleet(const std::string &key, size_t num_cards) {
+  test_platform platform = get(key);
+
+  if (platform.devices.empty())
+    return platform;
+
+  test_device card = platform.devices[0];
+
+  platform.devices.clear();
+  for (size_t n = 0; n < num_cards; ++n) {
+    test_device td = card;
+    td.bus += n;
+    td.fme_object_id += n;
+    td.port_object_id += n;
+    platform.devices.push_back(td);
+  }
+
+  return platform;
+}
+
 bool test_platform::exists(const std::string &key) {
   return fpga_db::instance()->exists(key);
 }
@@ -95,6 +95,7 @@ struct test_platform {
   fpga_driver driver;
   std::vector<test_device> devices;
   static test_platform get(const std::string &key);
+  static test_platform fleet(const std::string &key, size_t num_cards);
   static bool exists(const std::string &key);
   static std::vector<std::string> keys(bool sorted = false);
   static std::vector<std::string> platforms(std::initializer_list<std::string> names = {}, fpga_driver drv = fpga_driver::linux_any);
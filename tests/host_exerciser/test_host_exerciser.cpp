@@ -0,0 +1,320 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "host_exerciser_soak.h"
+#include "host_exerciser_sweep.h"
+
+using host_exerciser::soak_monitor;
+using host_exerciser::soak_sample;
+using host_exerciser::soak_telemetry;
+using host_exerciser::sweep_axis;
+using host_exerciser::sweep_grid;
+using host_exerciser::sweep_spec;
+using host_exerciser::sweep_stats;
+
+// Writes text to a temporary .json file, parses it as a sweep spec
+// and removes the file again.
+static sweep_spec parse_spec_text(const std::string &text)
+{
+  char tmpfile[] = "/tmp/he-sweep-XXXXXX.json";
+  int fd = mkstemps(tmpfile, 5);
+  if (fd < 0)
+    throw std::runtime_error("mkstemps failed");
+  close(fd);
+  {
+    std::ofstream os(tmpfile);
+    os << text;
+  }
+  try {
+    sweep_spec spec = host_exerciser::parse_sweep_spec(tmpfile);
+    unlink(tmpfile);
+    return spec;
+  } catch (...) {
+    unlink(tmpfile);
+    throw;
+  }
+}
+
+/**
+ * @test       soak_monitor
+ * @brief      Test: soak_monitor::update
+ * @details    Each sample reports its instantaneous and rolling
+ *             bandwidth. A sample more than regression_pct below the
+ *             full window is flagged, and stall_limit consecutive
+ *             samples without progress stall the soak.
+ */
+TEST(host_exerciser, soak_monitor)
+{
+  soak_monitor m(3, 20, 2);
+
+  soak_sample s = m.update(1.0, 1.0, 1000000000);
+  EXPECT_STREQ("", s.event);
+  EXPECT_DOUBLE_EQ(1.0, s.gbps);
+  EXPECT_DOUBLE_EQ(1.0, s.rolling_gbps);
+  m.update(2.0, 1.0, 1000000000);
+  m.update(3.0, 1.0, 1000000000);
+
+  // within 20% of the 1.0 GB/s window
+  s = m.update(4.0, 1.0, 850000000);
+  EXPECT_STREQ("", s.event);
+
+  // the window is now {1.0, 1.0, 0.85}: 0.5 is below 80% of 0.95
+  s = m.update(5.0, 1.0, 500000000);
+  EXPECT_STREQ("regression", s.event);
+  EXPECT_DOUBLE_EQ(0.5, s.gbps);
+  EXPECT_DOUBLE_EQ(2.35 / 3, s.rolling_gbps);
+
+  s = m.update(6.0, 1.0, 0);
+  EXPECT_STREQ("stall", s.event);
+  EXPECT_FALSE(m.stalled());
+  m.update(7.0, 1.0, 0);
+  EXPECT_TRUE(m.stalled());
+
+  // progress resets the run of stalls; the window is {0, 0, 1.0}
+  s = m.update(8.0, 1.0, 1000000000);
+  EXPECT_STREQ("", s.event);
+  EXPECT_FALSE(m.stalled());
+
+  EXPECT_EQ(8u, m.samples());
+  EXPECT_EQ(1u, m.regressions());
+  EXPECT_EQ(2u, m.stalls());
+  EXPECT_DOUBLE_EQ(0.0, m.min_gbps());
+  EXPECT_DOUBLE_EQ(1.0, m.max_gbps());
+  EXPECT_DOUBLE_EQ(5.35 / 8, m.mean_gbps());
+}
+
+/**
+ * @test       soak_monitor_ramp
+ * @brief      Test: soak_monitor::update
+ * @details    Regressions are not flagged until the window is full,
+ *             and a zero stall limit never stalls the soak.
+ */
+TEST(host_exerciser, soak_monitor_ramp)
+{
+  soak_monitor m(0, 20, 0);
+
+  // a zero window is a window of one sample
+  EXPECT_STREQ("", m.update(1.0, 1.0, 1000000000).event);
+  EXPECT_STREQ("regression", m.update(2.0, 1.0, 100000000).event);
+
+  soak_monitor r(3, 20, 0);
+  EXPECT_STREQ("", r.update(1.0, 1.0, 1000000000).event);
+  EXPECT_STREQ("", r.update(2.0, 1.0, 100000000).event);
+  EXPECT_STREQ("", r.update(3.0, 1.0, 100000000).event);
+  for (int i = 0; i < 10; ++i)
+    EXPECT_STREQ("stall", r.update(4.0 + i, 1.0, 0).event);
+  EXPECT_FALSE(r.stalled());
+  EXPECT_EQ(0u, r.regressions());
+}
+
+/**
+ * @test       soak_column_name
+ * @brief      Test: soak_telemetry::column_name
+ * @details    Sensor names and units are joined into lower case
+ *             identifiers, with each run of other characters
+ *             replaced by a single underscore.
+ */
+TEST(host_exerciser, soak_column_name)
+{
+  EXPECT_EQ("fpga_core_temperature_celsius",
+            soak_telemetry::column_name("FPGA Core Temperature", "Celsius"));
+  EXPECT_EQ("12v_backplane_current_amps",
+            soak_telemetry::column_name("12V Backplane Current", "Amps"));
+  EXPECT_EQ("board_power_w",
+            soak_telemetry::column_name("  Board Power (W) ", ""));
+  EXPECT_EQ("", soak_telemetry::column_name("", ""));
+}
+
+/**
+ * @test       sweep_spec_parse
+ * @brief      Test: parse_sweep_spec
+ * @details    Axes come back in sweep_parameters order regardless of
+ *             their order in the file, scalars become single value
+ *             axes, and omitted counts keep their defaults.
+ */
+TEST(host_exerciser, sweep_spec_parse)
+{
+  sweep_spec spec = parse_spec_text(
+      "{ \"repetitions\": 5,"
+      "  \"parameters\": {"
+      "    \"threads\": [0, 4],"
+      "    \"atomic\": true,"
+      "    \"mode\": [\"read\", \"write\"]"
+      "  }"
+      "}");
+  EXPECT_EQ(1u, spec.warmup);
+  EXPECT_EQ(5u, spec.repetitions);
+  EXPECT_EQ(0u, spec.duration);
+  ASSERT_EQ(3u, spec.axes.size());
+  EXPECT_EQ("mode", spec.axes[0].name);
+  EXPECT_EQ(std::vector<std::string>({"read", "write"}), spec.axes[0].values);
+  EXPECT_EQ("atomic", spec.axes[1].name);
+  EXPECT_EQ(std::vector<std::string>({"true"}), spec.axes[1].values);
+  EXPECT_EQ("threads", spec.axes[2].name);
+  EXPECT_EQ(std::vector<std::string>({"0", "4"}), spec.axes[2].values);
+}
+
+/**
+ * @test       sweep_spec_reject
+ * @brief      Test: parse_sweep_spec
+ * @details    Malformed specs, unknown parameters, empty value lists,
+ *             unsupported value types and bad counts are rejected
+ *             with std::runtime_error.
+ */
+TEST(host_exerciser, sweep_spec_reject)
+{
+  const char *bad[] = {
+    "not json",
+    "[1, 2]",
+    "{}",
+    "{ \"parameters\": [] }",
+    "{ \"parameters\": { \"color\": [\"red\"] } }",
+    "{ \"parameters\": { \"cls\": [] } }",
+    "{ \"parameters\": { \"delay\": [1.5] } }",
+    "{ \"repetitions\": 0, \"parameters\": {} }",
+    "{ \"warmup\": -1, \"parameters\": {} }",
+    "{ \"duration\": \"2\", \"parameters\": {} }",
+  };
+  for (auto text : bad)
+    EXPECT_THROW(parse_spec_text(text), std::runtime_error) << text;
+
+  EXPECT_THROW(host_exerciser::parse_sweep_spec("/tmp/no-such-sweep-spec.json"),
+               std::runtime_error);
+}
+
+/**
+ * @test       sweep_grid_order
+ * @brief      Test: sweep_grid
+ * @details    The grid visits every point once, odometer style, with
+ *             the last axis varying fastest.
+ */
+TEST(host_exerciser, sweep_grid_order)
+{
+  std::vector<sweep_axis> axes(3);
+  axes[0].name = "mode";
+  axes[0].values = {"read", "write"};
+  axes[1].name = "cls";
+  axes[1].values = {"cl_1"};
+  axes[2].name = "threads";
+  axes[2].values = {"0", "2", "4"};
+
+  sweep_grid grid(axes);
+  EXPECT_EQ(6u, grid.size());
+
+  std::vector<std::string> visited;
+  for (; !grid.done(); grid.next()) {
+    auto p = grid.point();
+    ASSERT_EQ(3u, p.size());
+    EXPECT_EQ("mode", p[0].first);
+    EXPECT_EQ("cls", p[1].first);
+    EXPECT_EQ("threads", p[2].first);
+    visited.push_back(p[0].second + "/" + p[1].second + "/" + p[2].second);
+  }
+  EXPECT_EQ(std::vector<std::string>({
+              "read/cl_1/0", "read/cl_1/2", "read/cl_1/4",
+              "write/cl_1/0", "write/cl_1/2", "write/cl_1/4" }),
+            visited);
+
+  // no axes is a single point that keeps the command line values
+  sweep_grid empty((std::vector<sweep_axis>()));
+  EXPECT_EQ(1u, empty.size());
+  EXPECT_FALSE(empty.done());
+  EXPECT_TRUE(empty.point().empty());
+  empty.next();
+  EXPECT_TRUE(empty.done());
+}
+
+/**
+ * @test       sweep_stats_t_table
+ * @brief      Test: sweep_stats::t_975
+ * @details    The two-sided 95% Student's t values are looked up by
+ *             degrees of freedom, falling back to the normal value
+ *             past 30.
+ */
+TEST(host_exerciser, sweep_stats_t_table)
+{
+  EXPECT_DOUBLE_EQ(0.0, sweep_stats::t_975(0));
+  EXPECT_DOUBLE_EQ(12.706, sweep_stats::t_975(1));
+  EXPECT_DOUBLE_EQ(2.776, sweep_stats::t_975(4));
+  EXPECT_DOUBLE_EQ(2.228, sweep_stats::t_975(10));
+  EXPECT_DOUBLE_EQ(2.042, sweep_stats::t_975(30));
+  EXPECT_DOUBLE_EQ(1.960, sweep_stats::t_975(31));
+  EXPECT_DOUBLE_EQ(1.960, sweep_stats::t_975(1000));
+
+  // the table is monotonically decreasing
+  for (size_t df = 1; df < 31; ++df)
+    EXPECT_GT(sweep_stats::t_975(df), sweep_stats::t_975(df + 1)) << df;
+}
+
+/**
+ * @test       sweep_stats_ci
+ * @brief      Test: sweep_stats
+ * @details    Mean, sample standard deviation, extremes and the
+ *             confidence interval half width t * s / sqrt(n); fewer
+ *             than two samples have no spread.
+ */
+TEST(host_exerciser, sweep_stats_ci)
+{
+  sweep_stats s({2.0, 4.0, 4.0, 4.0, 5.0});
+  EXPECT_EQ(5u, s.n);
+  EXPECT_DOUBLE_EQ(3.8, s.mean);
+  EXPECT_DOUBLE_EQ(2.0, s.min);
+  EXPECT_DOUBLE_EQ(5.0, s.max);
+  // sum of squares 4.8, over n - 1 = 4
+  EXPECT_DOUBLE_EQ(std::sqrt(1.2), s.stddev);
+  EXPECT_DOUBLE_EQ(2.776 * std::sqrt(1.2) / std::sqrt(5.0), s.ci);
+
+  sweep_stats one({7.5});
+  EXPECT_EQ(1u, one.n);
+  EXPECT_DOUBLE_EQ(7.5, one.mean);
+  EXPECT_DOUBLE_EQ(7.5, one.min);
+  EXPECT_DOUBLE_EQ(7.5, one.max);
+  EXPECT_DOUBLE_EQ(0.0, one.stddev);
+  EXPECT_DOUBLE_EQ(0.0, one.ci);
+
+  sweep_stats none((std::vector<double>()));
+  EXPECT_EQ(0u, none.n);
+  EXPECT_DOUBLE_EQ(0.0, none.mean);
+  EXPECT_DOUBLE_EQ(0.0, none.ci);
+
+  sweep_stats flat({3.0, 3.0, 3.0});
+  EXPECT_DOUBLE_EQ(0.0, flat.stddev);
+  EXPECT_DOUBLE_EQ(0.0, flat.ci);
+}
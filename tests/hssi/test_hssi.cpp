@@ -0,0 +1,316 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "hssi_stats.h"
+
+/**
+ * Stands in for hssi_afu: a port select register and a mailbox of
+ * 32-bit registers per port. Each batch read may be slowed down to
+ * simulate a slow mailbox.
+ */
+class mock_hssi_afu {
+public:
+  mock_hssi_afu() :
+    port_sel(0),
+    freeze_ctrl(0),
+    freeze_bit(0),
+    frozen_reads(0),
+    batch_delay(0)
+  {}
+
+  std::unique_lock<std::recursive_mutex> lock_mbox()
+  {
+    return std::unique_lock<std::recursive_mutex>(lock_);
+  }
+
+  uint64_t read64(uint32_t offset)
+  {
+    EXPECT_EQ(TRAFFIC_CTRL_PORT_SEL, offset);
+    return port_sel;
+  }
+
+  void write64(uint32_t offset, uint64_t value)
+  {
+    EXPECT_EQ(TRAFFIC_CTRL_PORT_SEL, offset);
+    port_sel = value;
+    selects.push_back(value);
+  }
+
+  uint32_t mbox_read(uint16_t offset)
+  {
+    uint32_t value = 0;
+    mbox_read_batch(&offset, &value, 1);
+    return value;
+  }
+
+  void mbox_write(uint16_t offset, uint32_t data)
+  {
+    regs[port_sel][offset] = data;
+  }
+
+  void mbox_read_batch(const uint16_t *offsets, uint32_t *values, size_t count)
+  {
+    if (batch_delay.count())
+      std::this_thread::sleep_for(batch_delay);
+    if (freeze_bit && count > 1 &&
+        (regs[port_sel][freeze_ctrl] & freeze_bit))
+      ++frozen_reads;
+    for (size_t i = 0; i < count; ++i)
+      values[i] = regs[port_sel][offsets[i]];
+  }
+
+  uint64_t port_sel;
+  std::vector<uint64_t> selects;
+  std::map<uint64_t, std::map<uint16_t, uint32_t>> regs;
+  uint16_t freeze_ctrl;
+  uint32_t freeze_bit;
+  int frozen_reads;
+  std::chrono::milliseconds batch_delay;
+
+private:
+  std::recursive_mutex lock_;
+};
+
+using mock_collector = basic_hssi_stats_collector<mock_hssi_afu>;
+
+static hssi_stats_sample make_sample(uint64_t time_ns, int port,
+                                     uint64_t v0, uint64_t v1)
+{
+  hssi_stats_sample s = {};
+  s.time_ns = time_ns;
+  s.port = port;
+  s.values[0] = v0;
+  s.values[1] = v1;
+  return s;
+}
+
+static std::vector<std::string> lines(const std::string &text)
+{
+  std::vector<std::string> v;
+  std::istringstream is(text);
+  std::string line;
+  while (std::getline(is, line))
+    v.push_back(line);
+  return v;
+}
+
+/**
+ * @test       ring_order
+ * @brief      Test: hssi_stats_ring::push, hssi_stats_ring::snapshot
+ * @details    Samples come back oldest first. Once the ring is full,
+ *             each push overwrites the oldest sample and counts it as
+ *             dropped.
+ */
+TEST(hssi_stats, ring_order)
+{
+  hssi_stats_ring ring(3);
+  EXPECT_TRUE(ring.snapshot().empty());
+
+  ring.push(make_sample(0, 0, 0, 0));
+  ring.push(make_sample(1, 0, 0, 0));
+  auto v = ring.snapshot();
+  ASSERT_EQ(2u, v.size());
+  EXPECT_EQ(0u, v[0].time_ns);
+  EXPECT_EQ(1u, v[1].time_ns);
+  EXPECT_EQ(0u, ring.dropped());
+
+  for (uint64_t t = 2; t < 7; ++t)
+    ring.push(make_sample(t, 0, 0, 0));
+  v = ring.snapshot();
+  ASSERT_EQ(3u, v.size());
+  EXPECT_EQ(4u, v[0].time_ns);
+  EXPECT_EQ(5u, v[1].time_ns);
+  EXPECT_EQ(6u, v[2].time_ns);
+  EXPECT_EQ(3u, ring.size());
+  EXPECT_EQ(4u, ring.dropped());
+
+  // a zero capacity ring keeps the latest sample
+  hssi_stats_ring one(0);
+  one.push(make_sample(1, 0, 0, 0));
+  one.push(make_sample(2, 0, 0, 0));
+  v = one.snapshot();
+  ASSERT_EQ(1u, v.size());
+  EXPECT_EQ(2u, v[0].time_ns);
+  EXPECT_EQ(1u, one.dropped());
+}
+
+/**
+ * @test       sweep
+ * @brief      Test: basic_hssi_stats_collector::sweep
+ * @details    A sweep selects each port in turn, reads its counters
+ *             while they are frozen, joins lo/hi pairs into 64-bit
+ *             values and restores the port selection.
+ */
+TEST(hssi_stats, sweep)
+{
+  mock_hssi_afu afu;
+  afu.port_sel = 7;
+  afu.freeze_ctrl = 0x5;
+  afu.freeze_bit = 0x4;
+  afu.regs[1][0x5] = 0x1;
+  afu.regs[1][0x10] = 100;
+  afu.regs[1][0x20] = 0x2;
+  afu.regs[1][0x21] = 0x1;
+  afu.regs[3][0x10] = 300;
+  afu.regs[3][0x20] = 0xffffffff;
+  afu.regs[3][0x21] = 0;
+
+  mock_collector collector(&afu, {1, 3},
+                           {{"rx", 0x10, 0}, {"tx", 0x20, 0x21}}, 16);
+  collector.set_freeze(0x5, 0x4);
+  collector.sweep();
+
+  EXPECT_EQ(std::vector<uint64_t>({1, 3, 7}), afu.selects);
+  EXPECT_EQ(7u, afu.port_sel);
+  EXPECT_EQ(2, afu.frozen_reads);
+  // the freeze bit is cleared again, other control bits are kept
+  EXPECT_EQ(0x1u, afu.regs[1][0x5]);
+  EXPECT_EQ(0x0u, afu.regs[3][0x5]);
+
+  auto v = collector.ring().snapshot();
+  ASSERT_EQ(2u, v.size());
+  EXPECT_EQ(1, v[0].port);
+  EXPECT_EQ(100u, v[0].values[0]);
+  EXPECT_EQ(0x100000002u, v[0].values[1]);
+  EXPECT_EQ(3, v[1].port);
+  EXPECT_EQ(300u, v[1].values[0]);
+  EXPECT_EQ(0xffffffffu, v[1].values[1]);
+  EXPECT_EQ(v[0].time_ns, v[1].time_ns);
+  EXPECT_EQ(1u, collector.sweeps());
+
+  EXPECT_THROW(mock_collector(&afu, {0},
+                              std::vector<hssi_counter>(
+                                HSSI_STATS_MAX_COUNTERS + 1, {"c", 0, 0}),
+                              1),
+               std::invalid_argument);
+}
+
+/**
+ * @test       export_csv
+ * @brief      Test: basic_hssi_stats_collector::export_csv
+ * @details    Rates are computed against the previous sample of the
+ *             same port. A 32-bit counter wraps at 2^32, while a
+ *             64-bit counter carries into its high word.
+ */
+TEST(hssi_stats, export_csv)
+{
+  mock_hssi_afu afu;
+  mock_collector collector(&afu, {0, 1},
+                           {{"rx32", 0x10, 0}, {"tx64", 0x20, 0x21}}, 16);
+  std::vector<hssi_stats_sample> samples = {
+    make_sample(1000000000, 0, 0xfffffff0, 0xfffffff0),
+    make_sample(1000000000, 1, 100, 1000),
+    make_sample(3000000000, 0, 0x10, 0x100000010),
+    make_sample(3000000000, 1, 300, 5000),
+  };
+
+  std::ostringstream os;
+  collector.export_csv(os, samples);
+  auto v = lines(os.str());
+  ASSERT_EQ(5u, v.size());
+  EXPECT_EQ("time_s,sweep_us,port,rx32,tx64,rx32_per_s,tx64_per_s", v[0]);
+  EXPECT_EQ("0,0,0,4294967280,4294967280,,", v[1]);
+  EXPECT_EQ("0,0,1,100,1000,,", v[2]);
+  EXPECT_EQ("2,0,0,16,4294967312,16,16", v[3]);
+  EXPECT_EQ("2,0,1,300,5000,100,2000", v[4]);
+
+  // the ring is exported the same way
+  std::ostringstream empty;
+  collector.export_csv(empty);
+  EXPECT_EQ("time_s,sweep_us,port,rx32,tx64,rx32_per_s,tx64_per_s\n",
+            empty.str());
+}
+
+/**
+ * @test       pacing_interval
+ * @brief      Test: basic_hssi_stats_collector::start
+ * @details    With a fast mailbox, sweeps follow the interval, and
+ *             stop() wakes the collector without waiting it out.
+ */
+TEST(hssi_stats, pacing_interval)
+{
+  using namespace std::chrono;
+  mock_hssi_afu afu;
+  mock_collector collector(&afu, {0}, {{"rx", 0x10, 0}}, 1024);
+
+  collector.start(20000, 100);
+  std::this_thread::sleep_for(milliseconds(210));
+  collector.stop();
+
+  // about 11 sweeps, one every 20 ms
+  EXPECT_GE(collector.sweeps(), 5u);
+  EXPECT_LE(collector.sweeps(), 13u);
+  EXPECT_EQ(collector.sweeps(), collector.ring().size());
+
+  mock_hssi_afu idle;
+  mock_collector slow(&idle, {0}, {{"rx", 0x10, 0}}, 16);
+  slow.start(10000000, 100);
+  std::this_thread::sleep_for(milliseconds(20));
+  auto t0 = steady_clock::now();
+  slow.stop();
+  EXPECT_LT(steady_clock::now() - t0, seconds(1));
+  EXPECT_EQ(1u, slow.sweeps());
+}
+
+/**
+ * @test       pacing_duty
+ * @brief      Test: basic_hssi_stats_collector::start
+ * @details    When a sweep takes longer than the interval, it counts
+ *             as an overrun, and the duty cycle rather than the
+ *             interval spaces the sweeps.
+ */
+TEST(hssi_stats, pacing_duty)
+{
+  using namespace std::chrono;
+  mock_hssi_afu afu;
+  afu.batch_delay = milliseconds(5);
+  mock_collector collector(&afu, {0}, {{"rx", 0x10, 0}}, 1024);
+
+  // a 5 ms sweep at 20% duty is one sweep per 25 ms at most,
+  // where the 1 ms interval alone would allow about 40 in 200 ms
+  collector.start(1000, 20);
+  std::this_thread::sleep_for(milliseconds(200));
+  collector.stop();
+
+  EXPECT_GE(collector.sweeps(), 2u);
+  EXPECT_LE(collector.sweeps(), 9u);
+  EXPECT_EQ(collector.sweeps(), collector.overruns());
+  EXPECT_GE(collector.sweep_usec_max(), 5000.0);
+  EXPECT_GE(collector.sweep_usec_mean(), 5000.0);
+}
@@ -27,6 +27,9 @@
 #include <chrono>
 #include <future>
 #include <thread>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <ofs/ofs.h>
 
 #include "gtest/gtest.h"
@@ -156,4 +159,123 @@ TEST(libofs, wait_for_eq_timeout)
 
   delta_usec = wait_test<uint64_t>(ofs_wait_for_eq64, false, modify_usec, timeout_usec);
   EXPECT_GE(delta_usec, timeout_usec);
-}
\ No newline at end of file
+}
+
+/**
+ * @test    ticks
+ * @brief   Tests: ofs_usec_to_ticks, ofs_ticks_to_nsec, ofs_ticks
+ * @details Verify that converting microseconds to ticks and back is exact
+ *          to within a tick, and that ofs_ticks advances by about as many
+ *          ticks as a sleep lasts (allowing 1% for calibration error).
+ * */
+TEST(libofs, ticks)
+{
+  uint64_t ticks = ofs_usec_to_ticks(1000);
+  ASSERT_GT(ticks, 0);
+  uint64_t nsec = ofs_ticks_to_nsec(ticks);
+  EXPECT_LE(nsec, 1000000);
+  EXPECT_GE(nsec, 999000);
+
+  auto begin = hrc::now();
+  uint64_t t0 = ofs_ticks();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  uint64_t t1 = ofs_ticks();
+  auto end = hrc::now();
+  auto delta_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+  EXPECT_GT(t1, t0);
+  EXPECT_LE(ofs_ticks_to_nsec(t1 - t0), static_cast<uint64_t>(delta_nsec * 1.01));
+  EXPECT_GE(ofs_ticks_to_nsec(t1 - t0), 1980000);
+}
+
+struct site_finder {
+  const char *func;
+  ofs_wait_stats stats;
+  int found;
+};
+
+static void find_site(const ofs_wait_stats *site, void *context)
+{
+  site_finder *f = reinterpret_cast<site_finder*>(context);
+  if (std::string(site->func) == f->func) {
+    f->stats = *site;
+    ++f->found;
+  }
+}
+
+static int wait_for_ne_site(volatile uint32_t *bit, uint64_t timeout_usec)
+{
+  return OFS_WAIT_FOR_NE(*bit, 0, timeout_usec, 100);
+}
+
+/**
+ * @test    wait_stats
+ * @brief   Tests: OFS_WAIT_FOR_NE, ofs_wait_stats_enable,
+ *          ofs_wait_stats_foreach, ofs_wait_stats_reset
+ * @details With statistics enabled, wait once successfully and once until
+ *          the timeout from the same call site. Verify that the site is
+ *          registered exactly once and that it accounted both waits and the
+ *          timeout. Then verify that reset zeroes the counters.
+ * */
+TEST(libofs, wait_stats)
+{
+  volatile uint32_t bit = 1;
+  ofs_wait_stats_enable(1);
+
+  EXPECT_EQ(wait_for_ne_site(&bit, 1000), 0);
+  bit = 0;
+  EXPECT_EQ(wait_for_ne_site(&bit, 1000), 1);
+
+  site_finder f = { "wait_for_ne_site", {}, 0 };
+  ofs_wait_stats_foreach(find_site, &f);
+  ASSERT_EQ(f.found, 1);
+  EXPECT_EQ(f.stats.calls, 2);
+  EXPECT_EQ(f.stats.timeouts, 1);
+  EXPECT_GE(f.stats.max_nsec, 1000000);
+  EXPECT_GE(f.stats.total_nsec, f.stats.max_nsec);
+  EXPECT_GT(f.stats.spins + f.stats.sleeps, 0);
+
+  ofs_wait_stats_reset();
+  ofs_wait_stats_enable(0);
+  EXPECT_EQ(wait_for_ne_site(&bit, 10), 1);
+
+  f.found = 0;
+  ofs_wait_stats_foreach(find_site, &f);
+  ASSERT_EQ(f.found, 1);
+  EXPECT_EQ(f.stats.calls, 0);
+  EXPECT_EQ(f.stats.timeouts, 0);
+  EXPECT_EQ(f.stats.total_nsec, 0);
+}
+
+/**
+ * @test    wait_event_fd
+ * @brief   Tests: OFS_WAIT_FOR_EQ_FD
+ * @details Wait on a variable with a one second sleep time and an eventfd.
+ *          Have another thread change the variable and then signal the
+ *          eventfd. Verify that the wait ends well before the sleep time
+ *          would have elapsed.
+ * */
+TEST(libofs, wait_event_fd)
+{
+  volatile uint64_t bit = 0b101;
+  int efd = eventfd(0, EFD_NONBLOCK);
+  ASSERT_GE(efd, 0);
+
+  std::future<void> f = std::async(std::launch::async,
+    [&bit, efd]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      bit = 0b111;
+      uint64_t one = 1;
+      EXPECT_EQ(write(efd, &one, sizeof(one)), sizeof(one));
+    });
+
+  auto begin = hrc::now();
+  auto status = OFS_WAIT_FOR_EQ_FD(bit, 0b111, 2000000, 1000000, efd);
+  auto end = hrc::now();
+  f.wait();
+  close(efd);
+
+  EXPECT_EQ(status, 0);
+  auto delta_usec = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+  EXPECT_GE(delta_usec, 1000);
+  EXPECT_LT(delta_usec, 500000);
+}
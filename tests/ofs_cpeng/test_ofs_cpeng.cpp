@@ -93,3 +93,39 @@ TEST(ofs_cpeng, copy_chunk)
   EXPECT_EQ(r_dst.f_CSR_DST_ADDR, 0x4000);
   EXPECT_EQ(r_size.f_CSR_DATA_SIZE, 8192);
 }
+
+/**
+ * @test    wait_chunk
+ * @brief   Tests: ofs_cpeng_start_chunk, ofs_cpeng_wait_chunk
+ * @details Tests ofs_cpeng_start_chunk by verifying that it programs the
+ * source, destination and size registers and sets the MRD start bit without
+ * waiting. Then verify that ofs_cpeng_wait_chunk times out while the start
+ * bit remains set and returns 0 once the engine clears it.
+ * */
+TEST(ofs_cpeng, wait_chunk)
+{
+  ofs_cpeng otest;
+  CSR_SRC_ADDR r_src = {0};
+  CSR_DST_ADDR r_dst = {0};
+  CSR_DATA_SIZE r_size = {0};
+  CSR_HOST2CE_MRD_START r_start = {0};
+  CSR_CE2HOST_STATUS r_status = {0};
+
+  otest.r_CSR_SRC_ADDR = &r_src;
+  otest.r_CSR_DST_ADDR = &r_dst;
+  otest.r_CSR_DATA_SIZE = &r_size;
+  otest.r_CSR_HOST2CE_MRD_START = &r_start;
+  otest.r_CSR_CE2HOST_STATUS = &r_status;
+
+  ofs_cpeng_start_chunk(&otest, 0x1000, 0x2000, 4096);
+  EXPECT_EQ(r_src.f_CSR_SRC_ADDR, 0x1000);
+  EXPECT_EQ(r_dst.f_CSR_DST_ADDR, 0x2000);
+  EXPECT_EQ(r_size.f_CSR_DATA_SIZE, 4096);
+  EXPECT_EQ(r_start.f_MRD_START, 1);
+
+  r_status.f_CE_DMA_STS = 0b10;
+  EXPECT_EQ(ofs_cpeng_wait_chunk(&otest, 1000), 1);
+
+  r_start.f_MRD_START = 0;
+  EXPECT_EQ(ofs_cpeng_wait_chunk(&otest, 1000), 0);
+}
@@ -96,4 +96,63 @@ TEST(ofs_driver, ofs_test_read_guid)
   char unparsed[56];
   uuid_unparse(u2, unparsed);
   EXPECT_STREQ(guid_str, unparsed);
-}
\ No newline at end of file
+}
+
+/**
+ * @test    ofs_test_transaction
+ * @brief   Tests: ofs_test_set_scratch, ofs_test_init_scratch,
+ *          ofs_test_scratch_sum
+ * @details The API in ofs_test.yml uses 'with' blocks to modify several
+ *          fields of the scratch register through a local copy. Point the
+ *          scratch register at a local variable and verify that
+ *          set_scratch preserves the field it doesn't touch, that
+ *          init_scratch starts from zero instead of the current value and
+ *          that scratch_sum reads all fields from a single load.
+ * */
+TEST(ofs_driver, ofs_test_transaction)
+{
+  ofs_test otest;
+  scratch r;
+  r.value = 0;
+  r.f_hi = 0xdeadbeef;
+  otest.r_scratch = &r;
+
+  ofs_test_set_scratch(&otest, 0x1234, 0x5678);
+  EXPECT_EQ(r.f_lo, 0x1234);
+  EXPECT_EQ(r.f_mid, 0x5678);
+  EXPECT_EQ(r.f_hi, 0xdeadbeef);
+  EXPECT_EQ(ofs_test_scratch_sum(&otest), 0x1234 + 0x5678 + 0xdeadbeefUL);
+
+  ofs_test_init_scratch(&otest, 0xa5a5);
+  EXPECT_EQ(r.f_lo, 0);
+  EXPECT_EQ(r.f_mid, 0);
+  EXPECT_EQ(r.f_hi, 0xa5a5);
+}
+
+/**
+ * @test    ofs_test_snapshot
+ * @brief   Tests: ofs_test_snapshot_ident
+ * @details ofs_test.yml declares a register group named ident. Point the
+ *          group's registers at local variables, take a snapshot and verify
+ *          that each member holds the value of its register.
+ * */
+TEST(ofs_driver, ofs_test_snapshot)
+{
+  ofs_test otest;
+  fme_dfh dfh;
+  uuid_bytes u;
+  dfh.value = 0x5010010000000000;
+  u.lo = 0xB449F9F67228EBF4;
+  u.hi = 0x0123456789abcdef;
+  otest.r_fme_dfh = &dfh;
+  otest.r_id_lo = reinterpret_cast<volatile _id_lo*>(&u.lo);
+  otest.r_id_hi = reinterpret_cast<volatile _id_hi*>(&u.hi);
+
+  ofs_test_ident_snapshot s;
+  memset(&s, 0, sizeof(s));
+  ofs_test_snapshot_ident(&otest, &s);
+  EXPECT_EQ(s.r_fme_dfh.value, dfh.value);
+  EXPECT_EQ(s.r_fme_dfh.f_feature_type, 0x5);
+  EXPECT_EQ(s.r_id_lo.f_bits, u.lo);
+  EXPECT_EQ(s.r_id_hi.f_bits, u.hi);
+}
@@ -0,0 +1,115 @@
+# Copyright(c) 2023, Intel Corporation
+#
+# Redistribution  and  use  in source  and  binary  forms,  with  or  without
+# modification, are permitted provided that the following conditions are met:
+#
+# * Redistributions of  source code  must retain the  above copyright notice,
+#   this list of conditions and the following disclaimer.
+# * Redistributions in binary form must reproduce the above copyright notice,
+#   this list of conditions and the following disclaimer in the documentation
+#   and/or other materials provided with the distribution.
+# * Neither the name  of Intel Corporation  nor the names of its contributors
+#   may be used to  endorse or promote  products derived  from this  software
+#   without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+# IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+# LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+# CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+# SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+# INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+# CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+import ast
+import collections
+import io
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', '..', 'libraries', 'scripts', 'ofs'))
+import umd  # noqa: E402
+
+
+register = collections.namedtuple('register', ['name'])
+
+
+def generate(api):
+    out = io.StringIO()
+    wr = umd.driver_writer('ofs_test', out)
+    functions = [umd.fn_visitor(wr).visit(f) for f in ast.parse(api).body]
+    wr.set_context([register('scratch')], functions)
+    wr.writefile()
+    return out.getvalue()
+
+
+class test_umd_with(unittest.TestCase):
+    def test_store_at_end(self):
+        """test_store_at_end
+           Given a with block that assigns a field, when the driver is
+           generated, then the register is stored once, after the body.
+        """
+        code = generate('def set_lo(lo: uint16_t):\n'
+                        '    with scratch as r:\n'
+                        '        r.lo = lo\n')
+        self.assertLess(code.index('r.f_lo = lo;'),
+                        code.index('drv->r_scratch->value = r.value;'))
+
+    def test_return_without_store(self):
+        """test_return_without_store
+           Given a with block that only reads fields, when it returns
+           from inside the block, then the driver is generated.
+        """
+        code = generate('def get_lo() -> uint64_t:\n'
+                        '    with scratch as r:\n'
+                        '        return r.lo\n')
+        self.assertIn('return r.f_lo;', code)
+
+    def test_return_skips_store(self):
+        """test_return_skips_store
+           Given a with block that assigns a field, when it returns
+           from inside the block, then generation is rejected.
+        """
+        with self.assertRaises(SystemExit):
+            generate('def set_lo(lo: uint16_t) -> uint64_t:\n'
+                     '    with scratch as r:\n'
+                     '        r.lo = lo\n'
+                     '        if lo:\n'
+                     '            return lo\n')
+
+    def test_break_skips_store(self):
+        """test_break_skips_store
+           Given a storing with block inside a loop, when a break or
+           continue leaves the block, then generation is rejected.
+        """
+        for stmt in ['break', 'continue']:
+            with self.assertRaises(SystemExit):
+                generate('def set_lo(lo: uint16_t):\n'
+                         '    i: int\n'
+                         '    for i in range(4):\n'
+                         '        with scratch as r:\n'
+                         '            r.lo = lo\n'
+                         f'            {stmt}\n')
+
+    def test_exit_from_inner_loop(self):
+        """test_exit_from_inner_loop
+           Given a storing with block, when a break only leaves a loop
+           nested inside the block, then exits_from allows it.
+        """
+        body = ast.parse('with scratch as r:\n'
+                         '    while 1:\n'
+                         '        r.lo = 1\n'
+                         '        break\n').body[0].body
+        self.assertFalse(umd.exits_from(body))
+        body = ast.parse('with scratch as r:\n'
+                         '    while 1:\n'
+                         '        return 1\n').body[0].body
+        self.assertTrue(umd.exits_from(body))
+
+
+if __name__ == '__main__':
+    unittest.main()
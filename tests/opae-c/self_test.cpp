@@ -189,3 +189,46 @@ INSTANTIATE_TEST_SUITE_P(self_test, self_test_p,
                                                                         "dfl-n6000-sku1",
                                                                         "dfl-c6100"
                                                                       })));
+
+
+class self_test_fleet_p : public opae_base_p<xfpga_> {
+ protected:
+  virtual void OPAEInitialize() override
+  {
+    ASSERT_EQ(system_->replicate_sysfs_card(num_cards), 0);
+    platform_ = test_platform::fleet(GetParam(), num_cards);
+    opae_base_p<xfpga_>::OPAEInitialize();
+  }
+
+  static const size_t num_cards = 16;
+};
+
+/**
+ * @test       fleet_tokens
+ * @brief      Test: test_system::replicate_sysfs_card
+ * @details    When the mock card is replicated into a fleet,<br>
+ *             then each card enumerates on its own PCIe bus,<br>
+ *             with its own accelerator.<br>
+ */
+TEST_P(self_test_fleet_p, fleet_tokens) {
+  size_t i;
+
+  for (i = 0; i < platform_.devices.size(); ++i) {
+    fpga_token token = get_device_token(i);
+    ASSERT_NE(token, nullptr);
+    EXPECT_EQ(get_pcie_address(token).bus, platform_.devices[i].bus);
+
+    fpga_token accel = get_accelerator_token(token, 0);
+    ASSERT_NE(accel, nullptr);
+    EXPECT_EQ(get_pcie_address(accel).bus, platform_.devices[i].bus);
+  }
+
+  EXPECT_EQ(get_device_token(i), nullptr);
+}
+
+GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(self_test_fleet_p);
+INSTANTIATE_TEST_SUITE_P(self_test_fleet, self_test_fleet_p,
+                         ::testing::ValuesIn(test_platform::mock_platforms({
+                                                                        "dfl-d5005",
+                                                                        "dfl-n3000"
+                                                                      })));
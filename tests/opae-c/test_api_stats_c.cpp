@@ -0,0 +1,228 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "opae_int.h"
+#include "api-stats.h"
+}
+
+#include "gtest/gtest.h"
+
+static fpga_result stats_read64(fpga_handle handle, uint32_t mmio_num,
+                                uint64_t offset, uint64_t *value) {
+  (void)handle;
+  (void)mmio_num;
+  *value = offset;
+  return (offset & 1) ? FPGA_EXCEPTION : FPGA_OK;
+}
+
+class api_stats_c : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    memset(&adapter0_, 0, sizeof(adapter0_));
+    memset(&adapter1_, 0, sizeof(adapter1_));
+    adapter0_.plugin.path = (char *)"/usr/lib64/libstats0.so";
+    adapter0_.fpgaReadMMIO64 = stats_read64;
+    adapter1_.plugin.path = (char *)"libstats1.so";
+    adapter1_.fpgaReadMMIO64 = stats_read64;
+    ASSERT_EQ(fpgaResetApiStats(), FPGA_OK);
+  }
+
+  virtual void TearDown() override {
+    EXPECT_EQ(fpgaEnableApiStats(0), FPGA_OK);
+    EXPECT_EQ(fpgaResetApiStats(), FPGA_OK);
+  }
+
+  fpga_result read64(opae_api_adapter_table *adapter, uint64_t offset) {
+    uint64_t value = 0;
+    return opae_api_call(adapter, fpgaReadMMIO64,
+                         nullptr, 0, offset, &value);
+  }
+
+  std::vector<fpga_api_stats> get_stats() {
+    uint32_t num = 0;
+    EXPECT_EQ(fpgaGetApiStats(nullptr, 0, &num), FPGA_OK);
+    std::vector<fpga_api_stats> stats(num);
+    EXPECT_EQ(fpgaGetApiStats(stats.data(), num, &num), FPGA_OK);
+    EXPECT_EQ(num, stats.size());
+    return stats;
+  }
+
+  opae_api_adapter_table adapter0_;
+  opae_api_adapter_table adapter1_;
+};
+
+/**
+ * @test       invalid
+ * @brief      Test: fpgaEnableApiStats, fpgaGetApiStats, fpgaGetApiTrace
+ * @details    When given unknown flags or NULL output parameters,<br>
+ *             the calls return FPGA_INVALID_PARAM.<br>
+ */
+TEST_F(api_stats_c, invalid) {
+  uint32_t num = 0;
+  EXPECT_EQ(fpgaEnableApiStats(0x100), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaGetApiStats(nullptr, 0, nullptr), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaGetApiStats(nullptr, 1, &num), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaGetApiTrace(nullptr, 0, nullptr, nullptr),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaGetApiTrace(nullptr, 1, &num, nullptr), FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test       disabled
+ * @brief      Test: opae_api_call
+ * @details    While statistics are disabled,<br>
+ *             calls are forwarded but not counted.<br>
+ */
+TEST_F(api_stats_c, disabled) {
+  EXPECT_EQ(read64(&adapter0_, 0), FPGA_OK);
+  EXPECT_EQ(read64(&adapter0_, 1), FPGA_EXCEPTION);
+  EXPECT_TRUE(get_stats().empty());
+}
+
+/**
+ * @test       counters
+ * @brief      Test: fpgaEnableApiStats, fpgaGetApiStats
+ * @details    When statistics are enabled,<br>
+ *             each (API, adapter) pair reports its calls, errors<br>
+ *             and a histogram that accounts for every call.<br>
+ */
+TEST_F(api_stats_c, counters) {
+  ASSERT_EQ(fpgaEnableApiStats(FPGA_API_STATS_ENABLE), FPGA_OK);
+
+  for (uint64_t i = 0; i < 10; ++i)
+    read64(&adapter0_, i);
+  read64(&adapter1_, 0);
+
+  auto stats = get_stats();
+  ASSERT_EQ(stats.size(), 2u);
+
+  EXPECT_STREQ(stats[0].api, "fpgaReadMMIO64");
+  EXPECT_STREQ(stats[0].adapter, "libstats0.so");
+  EXPECT_EQ(stats[0].calls, 10u);
+  EXPECT_EQ(stats[0].errors, 5u);
+  EXPECT_LE(stats[0].min_nsec, stats[0].max_nsec);
+
+  uint64_t total = 0;
+  for (int i = 0; i < FPGA_API_STATS_BUCKETS; ++i)
+    total += stats[0].histogram[i];
+  EXPECT_EQ(total, 10u);
+
+  EXPECT_STREQ(stats[1].adapter, "libstats1.so");
+  EXPECT_EQ(stats[1].calls, 1u);
+  EXPECT_EQ(stats[1].errors, 0u);
+
+  EXPECT_EQ(fpgaResetApiStats(), FPGA_OK);
+  EXPECT_TRUE(get_stats().empty());
+}
+
+/**
+ * @test       threads
+ * @brief      Test: fpgaGetApiStats
+ * @details    Counters kept by threads that have exited<br>
+ *             are merged with those of the live threads.<br>
+ */
+TEST_F(api_stats_c, threads) {
+  ASSERT_EQ(fpgaEnableApiStats(FPGA_API_STATS_ENABLE), FPGA_OK);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([this]() {
+      for (uint64_t i = 0; i < 100; ++i)
+        read64(&adapter0_, 0);
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+
+  read64(&adapter0_, 0);
+
+  auto stats = get_stats();
+  ASSERT_EQ(stats.size(), 1u);
+  EXPECT_EQ(stats[0].calls, 401u);
+}
+
+/**
+ * @test       trace
+ * @brief      Test: fpgaGetApiTrace
+ * @details    With FPGA_API_STATS_TRACE, the most recent calls are<br>
+ *             returned oldest first. num_entries reports how many<br>
+ *             were filled and num_available how many are in the ring.<br>
+ */
+TEST_F(api_stats_c, trace) {
+  ASSERT_EQ(fpgaEnableApiStats(FPGA_API_STATS_TRACE), FPGA_OK);
+
+  for (uint64_t i = 0; i < 5; ++i)
+    read64(i < 4 ? &adapter0_ : &adapter1_, i);
+
+  fpga_api_trace_entry entries[2];
+  uint32_t num = 0;
+  uint32_t available = 0;
+  ASSERT_EQ(fpgaGetApiTrace(entries, 2, &num, &available), FPGA_OK);
+  EXPECT_EQ(num, 2u);
+  EXPECT_EQ(available, 5u);
+
+  EXPECT_STREQ(entries[0].api, "fpgaReadMMIO64");
+  EXPECT_STREQ(entries[0].adapter, "libstats0.so");
+  EXPECT_EQ(entries[0].result, FPGA_EXCEPTION);
+  EXPECT_STREQ(entries[1].adapter, "libstats1.so");
+  EXPECT_EQ(entries[1].result, FPGA_OK);
+  EXPECT_LE(entries[0].start_nsec, entries[1].start_nsec);
+
+  // Tracing implies counting.
+  EXPECT_EQ(get_stats().size(), 2u);
+}
+
+/**
+ * @test       adapters_released
+ * @brief      Test: opae_api_stats_adapters_released
+ * @details    Once the adapters have been freed, a new adapter<br>
+ *             allocated at an old address is counted under its<br>
+ *             own name, not the name of the freed one.<br>
+ */
+TEST_F(api_stats_c, adapters_released) {
+  ASSERT_EQ(fpgaEnableApiStats(FPGA_API_STATS_ENABLE), FPGA_OK);
+
+  read64(&adapter0_, 0);
+
+  opae_api_stats_adapters_released();
+  adapter0_.plugin.path = (char *)"libstats1.so";
+  read64(&adapter0_, 0);
+
+  auto stats = get_stats();
+  ASSERT_EQ(stats.size(), 2u);
+  EXPECT_STREQ(stats[0].adapter, "libstats0.so");
+  EXPECT_EQ(stats[0].calls, 1u);
+  EXPECT_STREQ(stats[1].adapter, "libstats1.so");
+  EXPECT_EQ(stats[1].calls, 1u);
+}
@@ -27,10 +27,14 @@
 #include <config.h>
 #endif // HAVE_CONFIG_H
 
+#include <pthread.h>
+
 extern "C" {
 char *find_ase_cfg();
 void opae_init(void);
 void opae_release(void);
+extern int initialized;
+extern pthread_once_t implicit_init_once;
 
 #define HOME_CFG_PATHS 3
 const char *_ase_home_configs[HOME_CFG_PATHS] = {
@@ -40,7 +44,9 @@ const char *_ase_home_configs[HOME_CFG_PATHS] = {
 };
 }
 
+#include <algorithm>
 #include <libgen.h>
+#include <thread>
 #include "mock/opae_fixtures.h"
 
 using namespace opae::testing;
@@ -57,6 +63,29 @@ TEST(init, opae_init_rel) {
   opae_release();
 }
 
+/**
+ * @test       lazy_initialize
+ * @brief      Test: opae_init, fpgaEnumerate
+ * @details    opae_init only sets up logging. Config discovery and<br>
+ *             plugin loading are deferred to the first fpgaEnumerate,<br>
+ *             which succeeds without an explicit fpgaInitialize.<br>
+ */
+TEST(init, lazy_initialize) {
+  // Start from a clean slate, regardless of which tests ran before.
+  opae_release();
+  implicit_init_once = PTHREAD_ONCE_INIT;
+
+  opae_init();
+  EXPECT_EQ(0, initialized);
+
+  uint32_t num_matches = 0;
+  EXPECT_EQ(FPGA_OK, fpgaEnumerate(nullptr, 0, nullptr, 0, &num_matches));
+  EXPECT_EQ(FPGA_OK, fpgaInitialize(nullptr));
+
+  opae_release();
+  EXPECT_EQ(0, initialized);
+}
+
 #ifdef LIBOPAE_DEBUG
 
 /**
@@ -142,6 +171,99 @@ TEST(init, log_error) {
   EXPECT_EQ(0, unsetenv("LIBOPAE_LOG"));
 }
 
+/**
+ * @test       log_async
+ *
+ * @brief      When LIBOPAE_LOG_ASYNC is set, messages are queued
+ *             and written by the log writer thread. opae_log_flush
+ *             writes out anything still queued.
+ */
+TEST(init, log_async) {
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_ASYNC=1"));
+  opae_init();
+  testing::internal::CaptureStdout();
+  testing::internal::CaptureStderr();
+
+  std::thread t([]() {
+    for (int i = 0; i < 10; ++i)
+      OPAE_MSG("Async message %d.", i);
+  });
+  t.join();
+  OPAE_ERR("Async error.");
+  opae_log_flush();
+
+  std::string log_stdout = testing::internal::GetCapturedStdout();
+  std::string log_stderr = testing::internal::GetCapturedStderr();
+
+  EXPECT_TRUE(log_stderr.find("Async error.") != std::string::npos);
+  EXPECT_TRUE(log_stdout.find("Async message 0.") != std::string::npos);
+  EXPECT_TRUE(log_stdout.find("Async message 9.") != std::string::npos);
+  EXPECT_TRUE(log_stdout.find("test_init_c.cpp:") != std::string::npos);
+
+  opae_release();
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_ASYNC"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG"));
+}
+
+/**
+ * @test       log_json
+ *
+ * @brief      When LIBOPAE_LOG_FORMAT is json, each message is
+ *             written as a JSON object on its own line.
+ */
+TEST(init, log_json) {
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_FORMAT=json"));
+  opae_init();
+  testing::internal::CaptureStdout();
+
+  OPAE_MSG("JSON \"quoted\" message.");
+  opae_log_flush();
+
+  std::string log_stdout = testing::internal::GetCapturedStdout();
+
+  EXPECT_EQ(0u, log_stdout.find("{\"time\":"));
+  EXPECT_TRUE(log_stdout.find("\"level\":\"message\"") != std::string::npos);
+  EXPECT_TRUE(log_stdout.find("JSON \\\"quoted\\\" message.\"}\n") !=
+              std::string::npos);
+
+  opae_release();
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_FORMAT"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG"));
+}
+
+/**
+ * @test       log_json_continuation
+ *
+ * @brief      When a line is printed with several opae_print calls,
+ *             the pieces are joined into a single JSON record.
+ */
+TEST(init, log_json_continuation) {
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG=1"));
+  ASSERT_EQ(0, putenv((char*)"LIBOPAE_LOG_FORMAT=json"));
+  opae_init();
+  testing::internal::CaptureStdout();
+
+  opae_print(OPAE_LOG_MESSAGE, "0x%04x ", 0x8086);
+  opae_print(OPAE_LOG_MESSAGE, "*      ");
+  opae_print(OPAE_LOG_MESSAGE, "%s\n", "libxfpga.so");
+  opae_print(OPAE_LOG_MESSAGE, "unterminated");
+  opae_log_flush();
+
+  std::string log_stdout = testing::internal::GetCapturedStdout();
+
+  EXPECT_TRUE(log_stdout.find("\"msg\":\"0x8086 *      libxfpga.so\"}\n") !=
+              std::string::npos);
+  EXPECT_TRUE(log_stdout.find("\"msg\":\"unterminated\"}\n") !=
+              std::string::npos);
+  EXPECT_EQ(2, std::count(log_stdout.begin(), log_stdout.end(), '\n'));
+
+  opae_release();
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG_FORMAT"));
+  EXPECT_EQ(0, unsetenv("LIBOPAE_LOG"));
+}
+
 /**
  * @test       log_file
  *
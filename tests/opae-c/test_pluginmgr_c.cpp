@@ -28,6 +28,9 @@
 #endif // HAVE_CONFIG_H
 
 #include <array>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
 extern "C" {
 #include "opae_int.h"
@@ -251,6 +254,192 @@ TEST_P(pluginmgr_c_p, register_err01) {
   EXPECT_EQ(2, test_plugin_finalize_called);
 }
 
+static void *test_concurrent_work(const opae_api_adapter_table *adapter,
+                                  void *context)
+{
+  __sync_fetch_and_add(static_cast<int *>(context), 1);
+  return const_cast<opae_api_adapter_table *>(adapter);
+}
+
+static std::vector<const opae_api_adapter_table *> test_merge_order;
+static void test_concurrent_merge(const opae_api_adapter_table *adapter,
+                                  void *result, void *context)
+{
+  UNUSED_PARAM(context);
+  EXPECT_EQ(adapter, result);
+  test_merge_order.push_back(adapter);
+}
+
+/**
+ * @test       foreach_concurrent
+ * @brief      Test: opae_plugin_mgr_for_each_adapter_concurrent
+ * @details    The work fn is invoked once per adapter, and the merge<br>
+ *             fn is then invoked with each adapter's result in adapter<br>
+ *             list order. NULL callbacks are rejected.<br>
+ */
+TEST_P(pluginmgr_c_p, foreach_concurrent) {
+  int work_called = 0;
+
+  EXPECT_NE(0, opae_plugin_mgr_for_each_adapter_concurrent(
+                   nullptr, test_concurrent_merge, nullptr));
+  EXPECT_NE(0, opae_plugin_mgr_for_each_adapter_concurrent(
+                   test_concurrent_work, nullptr, nullptr));
+
+  test_merge_order.clear();
+  EXPECT_EQ(0, opae_plugin_mgr_for_each_adapter_concurrent(
+                   test_concurrent_work, test_concurrent_merge,
+                   &work_called));
+  EXPECT_EQ(2, work_called);
+  ASSERT_EQ(2, test_merge_order.size());
+  EXPECT_EQ(faux_adapter0_, test_merge_order[0]);
+  EXPECT_EQ(faux_adapter1_, test_merge_order[1]);
+
+  EXPECT_EQ(0, opae_plugin_mgr_finalize_all());
+  EXPECT_EQ(nullptr, adapter_list);
+}
+
+static fpga_token_header test_token_hdrs[4];
+
+static fpga_result test_enumerate(uint32_t base, fpga_token *tokens,
+                                  uint32_t max_tokens, uint32_t *num_matches)
+{
+  uint32_t i;
+  *num_matches = 2;
+  for (i = 0 ; i < max_tokens && i < *num_matches ; ++i) {
+    test_token_hdrs[base + i].objtype = FPGA_ACCELERATOR;
+    tokens[i] = &test_token_hdrs[base + i];
+  }
+  return FPGA_OK;
+}
+
+static fpga_result test_enumerate0(const fpga_properties *filters,
+                                   uint32_t num_filters, fpga_token *tokens,
+                                   uint32_t max_tokens, uint32_t *num_matches)
+{
+  UNUSED_PARAM(filters);
+  UNUSED_PARAM(num_filters);
+  // Finish last, so that ordering can't depend on completion order.
+  usleep(10000);
+  return test_enumerate(0, tokens, max_tokens, num_matches);
+}
+
+static fpga_result test_enumerate1(const fpga_properties *filters,
+                                   uint32_t num_filters, fpga_token *tokens,
+                                   uint32_t max_tokens, uint32_t *num_matches)
+{
+  UNUSED_PARAM(filters);
+  UNUSED_PARAM(num_filters);
+  return test_enumerate(2, tokens, max_tokens, num_matches);
+}
+
+static std::vector<fpga_token> test_destroyed_tokens;
+static fpga_result test_destroy_token(fpga_token *token)
+{
+  test_destroyed_tokens.push_back(*token);
+  *token = nullptr;
+  return FPGA_OK;
+}
+
+/**
+ * @test       enumerate_concurrent
+ * @brief      Test: fpgaEnumerate
+ * @details    When multiple adapters enumerate concurrently,<br>
+ *             fpgaEnumerate returns their tokens in adapter list order,<br>
+ *             counts all matches and releases the adapter tokens that<br>
+ *             did not fit in the caller's array.<br>
+ */
+TEST_P(pluginmgr_c_p, enumerate_concurrent) {
+  std::array<fpga_token, 3> tokens = { nullptr, nullptr, nullptr };
+  uint32_t num_matches = 0;
+  uint32_t i;
+
+  faux_adapter0_->fpgaEnumerate = test_enumerate0;
+  faux_adapter0_->fpgaDestroyToken = test_destroy_token;
+  faux_adapter1_->fpgaEnumerate = test_enumerate1;
+  faux_adapter1_->fpgaDestroyToken = test_destroy_token;
+  test_destroyed_tokens.clear();
+
+  EXPECT_EQ(FPGA_OK, fpgaEnumerate(nullptr, 0, nullptr, 0, &num_matches));
+  EXPECT_EQ(4, num_matches);
+
+  EXPECT_EQ(FPGA_OK, fpgaEnumerate(nullptr, 0, tokens.data(),
+                                   tokens.size(), &num_matches));
+  EXPECT_EQ(4, num_matches);
+
+  const fpga_token expected[] = {
+    &test_token_hdrs[0], &test_token_hdrs[1], &test_token_hdrs[2]
+  };
+  for (i = 0 ; i < tokens.size() ; ++i) {
+    opae_wrapped_token *wt = opae_validate_wrapped_token(tokens[i]);
+    ASSERT_NE(nullptr, wt);
+    EXPECT_EQ(expected[i], wt->opae_token);
+  }
+
+  ASSERT_EQ(1, test_destroyed_tokens.size());
+  EXPECT_EQ(&test_token_hdrs[3], test_destroyed_tokens[0]);
+
+  for (i = 0 ; i < tokens.size() ; ++i)
+    EXPECT_EQ(FPGA_OK, fpgaDestroyToken(&tokens[i]));
+  EXPECT_EQ(4, test_destroyed_tokens.size());
+
+  EXPECT_EQ(0, opae_plugin_mgr_finalize_all());
+  EXPECT_EQ(nullptr, adapter_list);
+}
+
+/**
+ * @test       token_ref_concurrent
+ * @brief      Test: opae_upref_wrapped_token, opae_downref_wrapped_token
+ * @details    When many threads take and drop references to the same<br>
+ *             wrapped token, the adapter token is destroyed exactly<br>
+ *             once, when the last reference is dropped.<br>
+ */
+TEST_P(pluginmgr_c_p, token_ref_concurrent) {
+  const int num_threads = 8;
+  const int iterations = 10000;
+  std::vector<std::thread> threads;
+  fpga_token_header device_hdr;
+  fpga_token_header afu_hdr;
+  int i;
+
+  faux_adapter0_->fpgaDestroyToken = test_destroy_token;
+  test_destroyed_tokens.clear();
+
+  // A device token is kept on the parent list, an accelerator is not.
+  device_hdr.objtype = FPGA_DEVICE;
+  afu_hdr.objtype = FPGA_ACCELERATOR;
+
+  for (fpga_token_header *hdr : { &device_hdr, &afu_hdr }) {
+    opae_wrapped_token *wt =
+      opae_allocate_wrapped_token(hdr, faux_adapter0_);
+    ASSERT_NE(nullptr, wt);
+
+    threads.clear();
+    for (i = 0 ; i < num_threads ; ++i) {
+      threads.emplace_back([wt, iterations]() {
+        int j;
+        for (j = 0 ; j < iterations ; ++j) {
+          opae_upref_wrapped_token(wt);
+          EXPECT_EQ(FPGA_OK, opae_downref_wrapped_token(wt));
+        }
+      });
+    }
+
+    for (auto &t : threads)
+      t.join();
+
+    EXPECT_EQ(1, wt->ref_count);
+    EXPECT_EQ(0, test_destroyed_tokens.size());
+
+    EXPECT_EQ(FPGA_OK, opae_downref_wrapped_token(wt));
+    ASSERT_EQ(1, test_destroyed_tokens.size());
+    EXPECT_EQ(hdr, test_destroyed_tokens[0]);
+    test_destroyed_tokens.clear();
+  }
+
+  EXPECT_EQ(0, opae_plugin_mgr_finalize_all());
+  EXPECT_EQ(nullptr, adapter_list);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(pluginmgr_c_p);
 INSTANTIATE_TEST_SUITE_P(pluginmgr_c, pluginmgr_c_p,
                          ::testing::ValuesIn(test_platform::platforms({})));
@@ -3619,6 +3619,155 @@ TEST_P(properties_c_p, get_sub_device_id03) {
   EXPECT_EQ(fpgaPropertiesGetSubsystemDeviceID(filter_, &sub_devid), FPGA_NOT_FOUND);
 }
 
+/**
+ * @test    snapshot01
+ * @brief   Tests: fpgaSnapshotProperties
+ * @details Given a properties object with known fields set,<br>
+ *          When I call fpgaSnapshotProperties,<br>
+ *          Then the snapshot reports the known fields,<br>
+ *          And the snapshot can't be modified,<br>
+ *          And a clone of the snapshot can be modified.<br>
+ */
+TEST_P(properties_c_p, snapshot01) {
+  fpga_properties snapshot = nullptr;
+  fpga_properties clone = nullptr;
+  fpga_objtype objtype = FPGA_DEVICE;
+  uint8_t bus = 0;
+  uint16_t vendor_id = 0;
+
+  ASSERT_EQ(fpgaPropertiesSetObjectType(filter_, FPGA_ACCELERATOR), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetBus(filter_, 0x5e), FPGA_OK);
+
+  ASSERT_EQ(fpgaSnapshotProperties(filter_, &snapshot), FPGA_OK);
+  ASSERT_NE(snapshot, nullptr);
+
+  // The source remains modifiable and independent of the snapshot.
+  EXPECT_EQ(fpgaPropertiesSetBus(filter_, 0x3b), FPGA_OK);
+
+  EXPECT_EQ(fpgaPropertiesGetObjectType(snapshot, &objtype), FPGA_OK);
+  EXPECT_EQ(objtype, FPGA_ACCELERATOR);
+  EXPECT_EQ(fpgaPropertiesGetBus(snapshot, &bus), FPGA_OK);
+  EXPECT_EQ(bus, 0x5e);
+  EXPECT_EQ(fpgaPropertiesGetVendorID(snapshot, &vendor_id), FPGA_NOT_FOUND);
+
+  EXPECT_EQ(fpgaPropertiesSetBus(snapshot, 0x3b), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaPropertiesSetVendorID(snapshot, 0x8086), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaClearProperties(snapshot), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaPropertiesGetBus(snapshot, &bus), FPGA_OK);
+  EXPECT_EQ(bus, 0x5e);
+
+  ASSERT_EQ(fpgaCloneProperties(snapshot, &clone), FPGA_OK);
+  EXPECT_EQ(fpgaPropertiesSetBus(clone, 0x3b), FPGA_OK);
+  EXPECT_EQ(fpgaPropertiesGetBus(clone, &bus), FPGA_OK);
+  EXPECT_EQ(bus, 0x3b);
+
+  EXPECT_EQ(fpgaDestroyProperties(&clone), FPGA_OK);
+  EXPECT_EQ(fpgaDestroyProperties(&snapshot), FPGA_OK);
+  EXPECT_EQ(snapshot, nullptr);
+}
+
+/**
+ * @test    snapshot02
+ * @brief   Tests: fpgaSnapshotProperties
+ * @details When the source is not a valid properties object,<br>
+ *          or the output pointer is NULL,<br>
+ *          fpgaSnapshotProperties returns FPGA_INVALID_PARAM.<br>
+ */
+TEST_P(properties_c_p, snapshot02) {
+  fpga_properties snapshot = nullptr;
+
+  EXPECT_EQ(fpgaSnapshotProperties(filter_, nullptr), FPGA_INVALID_PARAM);
+  EXPECT_EQ(fpgaSnapshotProperties(nullptr, &snapshot), FPGA_INVALID_PARAM);
+  EXPECT_EQ(snapshot, nullptr);
+}
+
+/**
+ * @test    snapshot_filter
+ * @brief   Tests: fpgaEnumerate
+ * @details When fpgaEnumerate is given a snapshot as its filter,<br>
+ *          it finds the same tokens as with the original filter.<br>
+ */
+TEST_P(properties_c_p, snapshot_filter) {
+  fpga_properties snapshot = nullptr;
+  uint32_t matches = 0;
+  uint32_t snapshot_matches = 0;
+
+  ASSERT_EQ(fpgaPropertiesSetObjectType(filter_, FPGA_ACCELERATOR), FPGA_OK);
+  ASSERT_EQ(fpgaSnapshotProperties(filter_, &snapshot), FPGA_OK);
+
+  EXPECT_EQ(fpgaEnumerate(&filter_, 1, nullptr, 0, &matches), FPGA_OK);
+  EXPECT_EQ(fpgaEnumerate(&snapshot, 1, nullptr, 0, &snapshot_matches),
+            FPGA_OK);
+  EXPECT_EQ(matches, snapshot_matches);
+
+  EXPECT_EQ(fpgaDestroyProperties(&snapshot), FPGA_OK);
+}
+
+/**
+ * @test    compiled_filter
+ * @brief   Tests: opae_filter_compile, opae_filter_key_matches
+ * @details A compiled filter matches a token header on exactly the<br>
+ *          packed fields that are valid in the filter, and leaves the<br>
+ *          remaining valid fields for the caller to check.<br>
+ */
+TEST_P(properties_c_p, compiled_filter) {
+  opae_compiled_filter compiled;
+  opae_filter_key key;
+  fpga_token_header hdr;
+  auto _prop = (_fpga_properties *)filter_;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.objtype = FPGA_ACCELERATOR;
+  hdr.bus = 0x5e;
+  hdr.vendor_id = 0x8086;
+  hdr.device_id = 0xbcce;
+  memcpy(hdr.guid, known_guid, sizeof(fpga_guid));
+
+  // No valid fields matches everything.
+  opae_filter_compile(_prop, &compiled);
+  opae_filter_key_pack(&key, &hdr, 1);
+  EXPECT_TRUE(opae_filter_key_matches(&compiled, &key));
+  EXPECT_EQ(compiled.valid_fields, 0);
+
+  ASSERT_EQ(fpgaPropertiesSetBus(filter_, 0x5e), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetVendorID(filter_, 0x8086), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetGUID(filter_, known_guid), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetNumErrors(filter_, 3), FPGA_OK);
+  opae_filter_compile(_prop, &compiled);
+
+  EXPECT_TRUE(opae_filter_key_matches(&compiled, &key));
+  EXPECT_EQ(compiled.valid_fields,
+            (uint64_t)1 << FPGA_PROPERTY_NUM_ERRORS);
+  EXPECT_EQ(compiled.num_errors, 3);
+
+  // Fields that aren't valid in the filter are ignored.
+  hdr.device_id = 0x0b30;
+  opae_filter_key_pack(&key, &hdr, 0);
+  EXPECT_TRUE(opae_filter_key_matches(&compiled, &key));
+
+  hdr.bus = 0x3b;
+  opae_filter_key_pack(&key, &hdr, 0);
+  EXPECT_FALSE(opae_filter_key_matches(&compiled, &key));
+
+  hdr.bus = 0x5e;
+  hdr.guid[15] ^= 1;
+  opae_filter_key_pack(&key, &hdr, 0);
+  EXPECT_FALSE(opae_filter_key_matches(&compiled, &key));
+
+  // Object-specific fields apply only with a valid object type.
+  ASSERT_EQ(fpgaClearProperties(filter_), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetObjectType(filter_, FPGA_ACCELERATOR), FPGA_OK);
+  ASSERT_EQ(fpgaPropertiesSetNumMMIO(filter_, 2), FPGA_OK);
+  CLEAR_FIELD_VALID(_prop, FPGA_PROPERTY_OBJTYPE);
+  opae_filter_compile(_prop, &compiled);
+  EXPECT_EQ(compiled.valid_fields, 0);
+
+  SET_FIELD_VALID(_prop, FPGA_PROPERTY_OBJTYPE);
+  opae_filter_compile(_prop, &compiled);
+  EXPECT_EQ(compiled.valid_fields, (uint64_t)1 << FPGA_PROPERTY_NUM_MMIO);
+  EXPECT_EQ(compiled.u.accelerator.num_mmio, 2);
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(properties_c_p);
 INSTANTIATE_TEST_SUITE_P(properties_c, properties_c_p,
                          ::testing::ValuesIn(test_platform::platforms({})));
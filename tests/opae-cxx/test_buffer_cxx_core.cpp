@@ -30,6 +30,7 @@
 #define NO_OPAE_C
 #include "mock/opae_fixtures.h"
 
+#include <opae/cxx/core/buffer_pool.h>
 #include <opae/cxx/core/handle.h>
 #include <opae/cxx/core/properties.h>
 #include <opae/cxx/core/shared_buffer.h>
@@ -212,6 +213,125 @@ TEST_P(buffer_cxx_core, read_write) {
   EXPECT_EQ(0xdecafbad, buf->read<uint32_t>(0));
 }
 
+/**
+ * @test shared_buffer::allocate_async
+ * shared_buffer::allocate_async returns a future holding the
+ * buffer, or rethrows the error from allocate().
+ */
+TEST_P(buffer_cxx_core, allocate_async) {
+  size_t length = 4096;
+  shared_buffer::ptr_t buf;
+
+  auto f = shared_buffer::allocate_async(handle_, length);
+  ASSERT_NO_THROW(buf = f.get());
+  ASSERT_NE(nullptr, buf);
+  EXPECT_EQ(length, buf->size());
+
+  auto bad = shared_buffer::allocate_async(handle_, 0);
+  EXPECT_THROW(bad.get(), std::exception);
+}
+
+/**
+ * @test buffer_pool::size_class
+ * Requests are rounded up to a power of two of at least one page.
+ */
+TEST(buffer_pool, size_class) {
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+  EXPECT_EQ(page, buffer_pool::size_class(1));
+  EXPECT_EQ(page, buffer_pool::size_class(page));
+  EXPECT_EQ(2 * page, buffer_pool::size_class(page + 1));
+  EXPECT_EQ(8 * page, buffer_pool::size_class(5 * page));
+}
+
+/**
+ * @test buffer_pool::create_null
+ * Creating a buffer_pool with a null handle throws.
+ */
+TEST(buffer_pool, create_null) {
+  EXPECT_THROW(buffer_pool::create(nullptr), std::invalid_argument);
+}
+
+/**
+ * @test buffer_pool::recycle
+ * When a lease is dropped, its buffer returns to the pool and
+ * is handed out, cleared, by the next acquire of the same class.
+ */
+TEST_P(buffer_cxx_core, pool_recycle) {
+  auto pool = buffer_pool::create(handle_);
+  volatile uint8_t *virt;
+  uint64_t io_address;
+
+  auto buf = pool->acquire(100);
+  ASSERT_NE(nullptr, buf);
+  EXPECT_EQ(100, buf->size());
+  EXPECT_EQ(0, pool->idle());
+  virt = buf->c_type();
+  io_address = buf->io_address();
+  buf->fill(0xa5);
+
+  buf.reset();
+  EXPECT_EQ(1, pool->idle());
+
+  buf = pool->acquire(200);
+  EXPECT_EQ(0, pool->idle());
+  EXPECT_EQ(virt, buf->c_type());
+  EXPECT_EQ(io_address, buf->io_address());
+  EXPECT_EQ(200, buf->size());
+  EXPECT_EQ(0, buf->read<uint8_t>(0));
+  EXPECT_EQ(0, buf->read<uint8_t>(199));
+
+  // An explicitly released lease isn't recycled.
+  buf->release();
+  buf.reset();
+  EXPECT_EQ(0, pool->idle());
+}
+
+/**
+ * @test buffer_pool::reserve
+ * reserve and reserve_async prepare idle buffers up front,
+ * and trim releases them.
+ */
+TEST_P(buffer_cxx_core, pool_reserve) {
+  auto pool = buffer_pool::create(handle_, false, 4);
+
+  EXPECT_EQ(2, pool->reserve(4096, 2));
+  EXPECT_EQ(2, pool->reserve(4096, 1));
+  EXPECT_EQ(3, pool->reserve_async(4096, 3).get());
+  EXPECT_EQ(3, pool->idle());
+
+  pool->trim();
+  EXPECT_EQ(0, pool->idle());
+
+  // A lease may outlive its pool.
+  auto buf = pool->acquire(4096);
+  pool.reset();
+  buf->fill(1);
+  buf.reset();
+}
+
+/**
+ * @test buffer_pool::reserve_max_idle
+ * reserve doesn't keep more idle buffers than max_idle.
+ */
+TEST_P(buffer_cxx_core, pool_reserve_max_idle) {
+  auto pool = buffer_pool::create(handle_, false, 2);
+
+  EXPECT_EQ(2, pool->reserve(4096, 5));
+  EXPECT_EQ(2, pool->reserve_async(4096, 3).get());
+  EXPECT_EQ(2, pool->idle());
+
+  // Nor do recycled leases push the class past the limit.
+  auto a = pool->acquire(4096);
+  auto b = pool->acquire(4096);
+  auto c = pool->acquire(4096);
+  EXPECT_EQ(0, pool->idle());
+  a.reset();
+  b.reset();
+  c.reset();
+  EXPECT_EQ(2, pool->idle());
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(buffer_cxx_core);
 INSTANTIATE_TEST_SUITE_P(buffer, buffer_cxx_core,
                          ::testing::ValuesIn(test_platform::platforms({})));
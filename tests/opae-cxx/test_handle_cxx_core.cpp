@@ -31,6 +31,7 @@
 #include "mock/opae_fixtures.h"
 
 #include <opae/cxx/core/handle.h>
+#include <opae/cxx/core/mmio.h>
 #include <opae/cxx/core/properties.h>
 #include <opae/cxx/core/token.h>
 
@@ -239,6 +240,64 @@ TEST_P(handle_cxx_core_mmio, mmio_ptr) {
   ASSERT_NE(nullptr, h);
 }
 
+/**
+ * @test mmio_ptr_cached
+ * Verify that handle::mmio_ptr maps the region once
+ * and returns the cached base on later calls.
+ */
+TEST_P(handle_cxx_core_mmio, mmio_ptr_cached) {
+  int flags = 0;
+  uint8_t *base = nullptr;
+
+  handle_ = handle::open(tokens_[0], flags);
+  ASSERT_NE(nullptr, handle_.get());
+
+  ASSERT_NO_THROW(base = handle_->mmio_ptr(0));
+  ASSERT_NE(nullptr, base);
+  EXPECT_EQ(base + 0x100, handle_->mmio_ptr(0x100));
+  EXPECT_EQ(base, handle_->mmio_ptr(0, 0));
+}
+
+using test_csr64 = csr<uint64_t, 0x100>;
+using test_csr32 = csr<uint32_t, 0x108>;
+using test_field = csr_field<test_csr64, 8, 4>;
+
+static_assert(test_field::mask == 0xf00, "csr_field mask");
+static_assert(test_field::extract(0xabcd) == 0xb, "csr_field extract");
+static_assert(test_field::insert(0xabcd, 0x3) == 0xa3cd, "csr_field insert");
+static_assert(csr_field<test_csr64, 0, 64>::mask == ~uint64_t(0),
+              "full width csr_field mask");
+
+/**
+ * @test mmio_region
+ * Verify that accesses through an mmio_region and csr descriptors
+ * reach the same registers as handle::read_csr64/write_csr64.
+ */
+TEST_P(handle_cxx_core_mmio, mmio_region) {
+  int flags = 0;
+
+  handle_ = handle::open(tokens_[0], flags);
+  ASSERT_NE(nullptr, handle_.get());
+
+  mmio_region mmio(handle_);
+  EXPECT_EQ(handle_->mmio_ptr(0), mmio.base());
+  EXPECT_EQ(handle_, mmio.get_handle());
+
+  mmio.write<test_csr64>(0xc0def00d);
+  EXPECT_EQ(0xc0def00d, handle_->read_csr64(test_csr64::offset));
+
+  handle_->write_csr64(test_csr64::offset, 0xabcd);
+  EXPECT_EQ(0xabcd, mmio.read<test_csr64>());
+  EXPECT_EQ(0xb, mmio.read_field<test_field>());
+
+  mmio.write_field<test_field>(0x3);
+  EXPECT_EQ(0xa3cd, mmio.read<test_csr64>());
+
+  mmio.write<test_csr32>(0x1234);
+  EXPECT_EQ(0x1234, mmio.read<uint32_t>(test_csr32::offset));
+  EXPECT_EQ(0x1234, handle_->read_csr32(test_csr32::offset));
+}
+
 GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST(handle_cxx_core_mmio);
 INSTANTIATE_TEST_SUITE_P(handle, handle_cxx_core_mmio,
                          ::testing::ValuesIn(test_platform::platforms({
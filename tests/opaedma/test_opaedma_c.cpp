@@ -0,0 +1,349 @@
+// Copyright(c) 2023, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <cstring>
+#include <vector>
+#include <opae/dma.h>
+
+#include "gtest/gtest.h"
+
+class opaedma_loopback_c_p : public ::testing::Test {
+ protected:
+  opaedma_loopback_c_p() :
+    dma_(nullptr),
+    mem_(nullptr),
+    mem_size_(0)
+  {}
+
+  virtual void SetUp() override
+  {
+    opae_dma_attr_init(&attr_);
+    attr_.backend = OPAE_DMA_BACKEND_LOOPBACK;
+    attr_.num_channels = 2;
+    attr_.loopback_size = 1024 * 1024;
+
+    ASSERT_EQ(opae_dma_open(nullptr, &attr_, &dma_), FPGA_OK);
+    ASSERT_EQ(opae_dma_loopback_memory(dma_, &mem_, &mem_size_), FPGA_OK);
+  }
+
+  virtual void TearDown() override
+  {
+    if (dma_) {
+      EXPECT_EQ(opae_dma_close(dma_), FPGA_OK);
+    }
+  }
+
+  struct opae_dma_attr attr_;
+  opae_dma_handle dma_;
+  uint8_t *mem_;
+  size_t mem_size_;
+};
+
+/**
+ * @test    attr_init
+ * @brief   Test: opae_dma_attr_init
+ * @details opae_dma_attr_init() selects the MM backend with<br>
+ *          all available channels and the default queue depth.<br>
+ */
+TEST(opaedma_c, attr_init)
+{
+  struct opae_dma_attr attr;
+  opae_dma_attr_init(&attr);
+  EXPECT_EQ(attr.backend, OPAE_DMA_BACKEND_MM);
+  EXPECT_EQ(attr.num_channels, 0);
+  EXPECT_EQ(attr.queue_depth, OPAE_DMA_DEFAULT_QUEUE_DEPTH);
+  EXPECT_EQ(attr.loopback_size, OPAE_DMA_DEFAULT_LOOPBACK_SIZE);
+}
+
+/**
+ * @test    open_invalid
+ * @brief   Test: opae_dma_open
+ * @details When the output pointer is NULL, or when the MM backend<br>
+ *          is requested without an fpga_handle,<br>
+ *          opae_dma_open returns FPGA_INVALID_PARAM.<br>
+ */
+TEST(opaedma_c, open_invalid)
+{
+  struct opae_dma_attr attr;
+  opae_dma_handle dma = nullptr;
+
+  opae_dma_attr_init(&attr);
+  EXPECT_EQ(opae_dma_open(nullptr, &attr, nullptr), FPGA_INVALID_PARAM);
+  EXPECT_EQ(opae_dma_open(nullptr, &attr, &dma), FPGA_INVALID_PARAM);
+  EXPECT_EQ(dma, nullptr);
+}
+
+/**
+ * @test    default_channels
+ * @brief   Test: opae_dma_open, opae_dma_channel_count
+ * @details When num_channels is zero, the loopback backend<br>
+ *          opens all of its channels.<br>
+ */
+TEST(opaedma_c, default_channels)
+{
+  struct opae_dma_attr attr;
+  opae_dma_handle dma = nullptr;
+  uint32_t count = 0;
+
+  opae_dma_attr_init(&attr);
+  attr.backend = OPAE_DMA_BACKEND_LOOPBACK;
+  attr.loopback_size = 4096;
+
+  ASSERT_EQ(opae_dma_open(nullptr, &attr, &dma), FPGA_OK);
+  EXPECT_EQ(opae_dma_channel_count(dma, &count), FPGA_OK);
+  EXPECT_EQ(count, 4);
+  EXPECT_EQ(opae_dma_close(dma), FPGA_OK);
+}
+
+/**
+ * @test    sync_roundtrip
+ * @brief   Test: opae_dma_transfer_sync
+ * @details A host to FPGA transfer followed by an FPGA to FPGA<br>
+ *          and an FPGA to host transfer returns the original data.<br>
+ */
+TEST_F(opaedma_loopback_c_p, sync_roundtrip)
+{
+  std::vector<uint8_t> src(4096), dst(4096, 0);
+  for (size_t i = 0 ; i < src.size() ; ++i)
+    src[i] = static_cast<uint8_t>(i);
+
+  EXPECT_EQ(opae_dma_transfer_sync(dma_, 0, 0x1000,
+                                   reinterpret_cast<uint64_t>(src.data()),
+                                   src.size(), OPAE_DMA_HOST_TO_FPGA), FPGA_OK);
+  EXPECT_EQ(0, memcmp(mem_ + 0x1000, src.data(), src.size()));
+
+  EXPECT_EQ(opae_dma_transfer_sync(dma_, 1, 0x8000, 0x1000,
+                                   src.size(), OPAE_DMA_FPGA_TO_FPGA), FPGA_OK);
+
+  EXPECT_EQ(opae_dma_transfer_sync(dma_, 1,
+                                   reinterpret_cast<uint64_t>(dst.data()),
+                                   0x8000, dst.size(),
+                                   OPAE_DMA_FPGA_TO_HOST), FPGA_OK);
+  EXPECT_EQ(src, dst);
+}
+
+/**
+ * @test    out_of_range
+ * @brief   Test: opae_dma_transfer_sync
+ * @details Transfers that fall outside the loopback memory<br>
+ *          complete with FPGA_INVALID_PARAM.<br>
+ */
+TEST_F(opaedma_loopback_c_p, out_of_range)
+{
+  uint8_t buf[64];
+  EXPECT_EQ(opae_dma_transfer_sync(dma_, 0, mem_size_ - 32,
+                                   reinterpret_cast<uint64_t>(buf),
+                                   sizeof(buf), OPAE_DMA_HOST_TO_FPGA),
+            FPGA_INVALID_PARAM);
+  EXPECT_EQ(opae_dma_transfer_sync(dma_, 0,
+                                   reinterpret_cast<uint64_t>(buf),
+                                   ~0ULL, sizeof(buf), OPAE_DMA_FPGA_TO_HOST),
+            FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test    submit_invalid
+ * @brief   Test: opae_dma_submit
+ * @details opae_dma_submit rejects an out-of-range channel<br>
+ *          and an invalid direction with FPGA_INVALID_PARAM.<br>
+ */
+TEST_F(opaedma_loopback_c_p, submit_invalid)
+{
+  opae_dma_request req = nullptr;
+  EXPECT_EQ(opae_dma_submit(dma_, 2, 0, 0, 0, OPAE_DMA_FPGA_TO_FPGA,
+                            nullptr, nullptr, &req), FPGA_INVALID_PARAM);
+  EXPECT_EQ(opae_dma_submit(dma_, 0, 0, 0, 0, OPAE_DMA_MAX_DIRECTION,
+                            nullptr, nullptr, &req), FPGA_INVALID_PARAM);
+  EXPECT_EQ(req, nullptr);
+}
+
+/**
+ * @test    poll_wait
+ * @brief   Test: opae_dma_submit, opae_dma_poll, opae_dma_wait
+ * @details A submitted request eventually polls as complete,<br>
+ *          and opae_dma_wait reports the transferred byte count.<br>
+ */
+TEST_F(opaedma_loopback_c_p, poll_wait)
+{
+  std::vector<uint8_t> src(8192, 0xa5);
+  opae_dma_request req = nullptr;
+  size_t bytes = 0;
+
+  ASSERT_EQ(opae_dma_submit(dma_, 0, 0,
+                            reinterpret_cast<uint64_t>(src.data()),
+                            src.size(), OPAE_DMA_HOST_TO_FPGA,
+                            nullptr, nullptr, &req), FPGA_OK);
+  ASSERT_NE(req, nullptr);
+
+  EXPECT_EQ(opae_dma_wait(req, -1, &bytes), FPGA_OK);
+  EXPECT_EQ(bytes, src.size());
+  EXPECT_EQ(opae_dma_poll(req, nullptr), FPGA_OK);
+  EXPECT_EQ(mem_[0], 0xa5);
+  EXPECT_EQ(mem_[src.size() - 1], 0xa5);
+
+  EXPECT_EQ(opae_dma_request_release(req), FPGA_OK);
+}
+
+struct gate {
+  std::mutex lock;
+  std::condition_variable cv;
+  bool open = false;
+  std::atomic<int> entered{0};
+};
+
+static void gated_cb(void *context, fpga_result result, size_t bytes)
+{
+  gate *g = reinterpret_cast<gate *>(context);
+  (void) result;
+  (void) bytes;
+  ++g->entered;
+  std::unique_lock<std::mutex> lk(g->lock);
+  g->cv.wait(lk, [g]{ return g->open; });
+}
+
+/**
+ * @test    queue_full
+ * @brief   Test: opae_dma_submit, opae_dma_wait
+ * @details With a queue depth of one, a second submit while the<br>
+ *          first transfer is still outstanding returns FPGA_BUSY,<br>
+ *          and a timed wait on the outstanding request times out.<br>
+ */
+TEST(opaedma_c, queue_full)
+{
+  struct opae_dma_attr attr;
+  opae_dma_handle dma = nullptr;
+  opae_dma_request req = nullptr;
+  gate g;
+
+  opae_dma_attr_init(&attr);
+  attr.backend = OPAE_DMA_BACKEND_LOOPBACK;
+  attr.num_channels = 1;
+  attr.queue_depth = 1;
+  attr.loopback_size = 4096;
+  ASSERT_EQ(opae_dma_open(nullptr, &attr, &dma), FPGA_OK);
+
+  ASSERT_EQ(opae_dma_submit(dma, 0, 0, 0, 0, OPAE_DMA_FPGA_TO_FPGA,
+                            gated_cb, &g, &req), FPGA_OK);
+  while (!g.entered)
+    std::this_thread::yield();
+
+  EXPECT_EQ(opae_dma_submit(dma, 0, 0, 0, 0, OPAE_DMA_FPGA_TO_FPGA,
+                            nullptr, nullptr, nullptr), FPGA_BUSY);
+  EXPECT_EQ(opae_dma_poll(req, nullptr), FPGA_BUSY);
+  EXPECT_EQ(opae_dma_wait(req, 10, nullptr), FPGA_BUSY);
+
+  {
+    std::lock_guard<std::mutex> lk(g.lock);
+    g.open = true;
+  }
+  g.cv.notify_all();
+
+  EXPECT_EQ(opae_dma_wait(req, -1, nullptr), FPGA_OK);
+  EXPECT_EQ(opae_dma_request_release(req), FPGA_OK);
+  EXPECT_EQ(opae_dma_close(dma), FPGA_OK);
+}
+
+static void count_cb(void *context, fpga_result result, size_t bytes)
+{
+  std::atomic<size_t> *total = reinterpret_cast<std::atomic<size_t> *>(context);
+  if (result == FPGA_OK)
+    *total += bytes;
+}
+
+/**
+ * @test    callbacks
+ * @brief   Test: opae_dma_submit, opae_dma_drain
+ * @details Detached requests submitted across all channels invoke<br>
+ *          their callbacks, and opae_dma_drain waits for them.<br>
+ */
+TEST_F(opaedma_loopback_c_p, callbacks)
+{
+  std::vector<uint8_t> src(256, 0x5a);
+  std::atomic<size_t> total(0);
+  const int per_channel = 32;
+
+  for (int i = 0 ; i < per_channel ; ++i) {
+    for (uint32_t ch = 0 ; ch < attr_.num_channels ; ++ch) {
+      uint64_t dst = (ch * per_channel + i) * src.size();
+      ASSERT_EQ(opae_dma_submit(dma_, ch, dst,
+                                reinterpret_cast<uint64_t>(src.data()),
+                                src.size(), OPAE_DMA_HOST_TO_FPGA,
+                                count_cb, &total, nullptr), FPGA_OK);
+    }
+  }
+
+  for (uint32_t ch = 0 ; ch < attr_.num_channels ; ++ch)
+    EXPECT_EQ(opae_dma_drain(dma_, ch), FPGA_OK);
+
+  EXPECT_EQ(total, per_channel * attr_.num_channels * src.size());
+  EXPECT_EQ(mem_[per_channel * attr_.num_channels * src.size() - 1], 0x5a);
+}
+
+/**
+ * @test    release_in_flight
+ * @brief   Test: opae_dma_request_release
+ * @details Releasing a request before it completes detaches it,<br>
+ *          and the channel worker frees it on completion.<br>
+ */
+TEST_F(opaedma_loopback_c_p, release_in_flight)
+{
+  opae_dma_request req = nullptr;
+  gate g;
+
+  ASSERT_EQ(opae_dma_submit(dma_, 1, 0, 0, 0, OPAE_DMA_FPGA_TO_FPGA,
+                            gated_cb, &g, &req), FPGA_OK);
+  EXPECT_EQ(opae_dma_request_release(req), FPGA_OK);
+
+  {
+    std::lock_guard<std::mutex> lk(g.lock);
+    g.open = true;
+  }
+  g.cv.notify_all();
+
+  EXPECT_EQ(opae_dma_drain(dma_, 1), FPGA_OK);
+}
+
+/**
+ * @test    affinity
+ * @brief   Test: opae_dma_channel_set_affinity
+ * @details Channel workers can be pinned to CPU 0 and released<br>
+ *          again. An out-of-range channel is rejected.<br>
+ */
+TEST_F(opaedma_loopback_c_p, affinity)
+{
+  EXPECT_EQ(opae_dma_channel_set_affinity(dma_, 0, 0), FPGA_OK);
+  EXPECT_EQ(opae_dma_channel_set_affinity(dma_, 0, -1), FPGA_OK);
+  EXPECT_EQ(opae_dma_channel_set_affinity(dma_, 2, 0), FPGA_INVALID_PARAM);
+  EXPECT_EQ(opae_dma_transfer_sync(dma_, 0, 0, 0, 0, OPAE_DMA_FPGA_TO_FPGA),
+            FPGA_OK);
+}
@@ -33,8 +33,8 @@
 extern "C" {
 struct UserClkCommandLine
 {
-  int freq_high;
-  int freq_low;
+  double freq_high;
+  double freq_low;
 };
 extern struct UserClkCommandLine userclkCmdLine;
 
@@ -101,6 +101,123 @@ TEST(usrclk_c, get_userclock_null) {
   EXPECT_EQ(result, FPGA_INVALID_PARAM);
 }
 
+static uint32_t count_of(uint32_t v)
+{
+  if (v & CFG_PLL_BYPASS_EN)
+    return 1;
+  return FIELD_GET(CFG_PLL_HIGH, v) + FIELD_GET(CFG_PLL_LOW, v);
+}
+
+/**
+ * @test    usrclk_counter
+ * @brief   Tests: usrclk_counter
+ * @details usrclk_counter encodes a divider count in the IOPLL
+ *          high/low/bypass/odd format used by the frequency tables.
+ */
+TEST(usrclk_c, usrclk_counter) {
+  EXPECT_EQ(usrclk_counter(1), 0x10000);
+  EXPECT_EQ(usrclk_counter(5), 0x20302);
+  EXPECT_EQ(usrclk_counter(77), 0x22726);
+  EXPECT_EQ(usrclk_counter(160), 0x5050);
+}
+
+/**
+ * @test    usrclk_solve_tables
+ * @brief   Tests: usrclk_solve, usrclk_loop_settings
+ * @details For every configured whole-MHz frequency in the S10 and
+ *          Agilex tables, the loop settings derived from the table's M
+ *          match the table and usrclk_solve finds a configuration that
+ *          is at least as close to the requested frequency.
+ */
+TEST(usrclk_c, usrclk_solve_tables) {
+  struct {
+    const struct iopll_limits *lim;
+    const struct iopll_config *table;
+    uint32_t max;
+  } devs[] = {
+    { &iopll_s10_limits, iopll_freq_config, IOPLL_MAX_FREQ },
+    { &iopll_agilex_limits, iopll_agilex_freq_config, IOPLL_AGILEX_MAX_FREQ },
+  };
+
+  for (auto &d : devs) {
+    for (uint32_t mhz = 10 ; mhz <= d.max ; ++mhz) {
+      const struct iopll_config *row = &d.table[mhz];
+      uint32_t khz = mhz * 1000;
+      struct pll_config expect;
+      struct pll_config c;
+
+      usrclk_loop_settings(count_of(row->pll_m), &expect);
+      EXPECT_EQ(expect.pll_lf, row->pll_lf) << mhz;
+      EXPECT_EQ(expect.pll_cp, row->pll_cp) << mhz;
+      EXPECT_EQ(expect.pll_rc, row->pll_rc) << mhz;
+
+      ASSERT_EQ(usrclk_solve(d.lim, khz, &c), FPGA_OK) << mhz;
+      uint32_t m = count_of(c.pll_m);
+      uint32_t n = count_of(c.pll_n);
+      uint32_t c1 = count_of(c.pll_c1);
+      uint32_t c0 = count_of(c.pll_c0);
+      uint64_t vco = (uint64_t)d.lim->ref_khz * m / n;
+      EXPECT_GE(vco, d.lim->vco_min_khz) << mhz;
+      EXPECT_LE(vco, d.lim->vco_max_khz) << mhz;
+      EXPECT_EQ(c.pll_freq_khz, (uint64_t)d.lim->ref_khz * m / (n * c1));
+      if (2 * khz <= d.lim->out2x_max_khz)
+        EXPECT_EQ(c1, 2 * c0) << mhz;
+      else
+        EXPECT_EQ(c1, c0) << mhz;
+      EXPECT_LE(std::abs((int64_t)c.pll_freq_khz - khz),
+                std::abs((int64_t)row->pll_freq_khz - khz)) << mhz;
+    }
+  }
+}
+
+/**
+ * @test    usrclk_solve_fractional
+ * @brief   Tests: usrclk_solve, usrclk_config
+ * @details Frequencies that are not a whole MHz are solved exactly when
+ *          the dividers allow it. Whole-MHz frequencies use the table
+ *          entry, and frequencies outside the device range are rejected.
+ */
+TEST(usrclk_c, usrclk_solve_fractional) {
+  struct pll_config c;
+
+  ASSERT_EQ(usrclk_config(&iopll_s10_limits, iopll_freq_config,
+                          156250, &c), FPGA_OK);
+  EXPECT_EQ(c.pll_freq_khz, 156250);
+  EXPECT_EQ(count_of(c.pll_c1), 2 * count_of(c.pll_c0));
+
+  ASSERT_EQ(usrclk_config(&iopll_agilex_limits, iopll_agilex_freq_config,
+                          412500, &c), FPGA_OK);
+  EXPECT_EQ(c.pll_freq_khz, 412500);
+
+  ASSERT_EQ(usrclk_config(&iopll_s10_limits, iopll_freq_config,
+                          100000, &c), FPGA_OK);
+  EXPECT_EQ(0, memcmp(&c, &iopll_freq_config[100], sizeof(c)));
+
+  EXPECT_EQ(usrclk_config(&iopll_s10_limits, iopll_freq_config,
+                          9999, &c), FPGA_INVALID_PARAM);
+  EXPECT_EQ(usrclk_config(&iopll_s10_limits, iopll_freq_config,
+                          600001, &c), FPGA_INVALID_PARAM);
+}
+
+/**
+ * @test    usrclk_wait_locked
+ * @brief   Tests: usrclk_wait_locked
+ * @details usrclk_wait_locked returns FPGA_OK as soon as IOPLL_LOCKED is
+ *          set and FPGA_BUSY when it never becomes set.
+ */
+TEST(usrclk_c, usrclk_wait_locked) {
+  uint64_t csrs[8] = { 0 };
+  uint8_t *ptr = reinterpret_cast<uint8_t *>(csrs);
+
+  EXPECT_EQ(usrclk_wait_locked(NULL), FPGA_INVALID_PARAM);
+
+  csrs[IOPLL_FREQ_STS0 / 8] = IOPLL_LOCKED;
+  EXPECT_EQ(usrclk_wait_locked(ptr), FPGA_OK);
+
+  csrs[IOPLL_FREQ_STS0 / 8] = 0;
+  EXPECT_EQ(usrclk_wait_locked(ptr), FPGA_BUSY);
+}
+
 /**
 * @test    fpga_set_user_clock
 * @brief   Tests: fpgaSetUserClock